@@ -0,0 +1,229 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Times reading and building a document with the default memory resource,
+ * a pooling resource and a JsonBumpResource, and counts the allocations that
+ * reach the system allocator. The RapidJSON benchmark is built with
+ * MJSONI_ENABLE_PMR; nlohmann::json ignores the resource, which makes it the
+ * baseline. The optional argument is the number of members of the document.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace {
+
+using mjsoni_benchmark::MeasureNanosecondsPerOperation;
+using mjsoni_benchmark::PrintResult;
+using mjsoni_benchmark::result_sink;
+
+constexpr std::size_t kDefaultMemberCount = 100000;
+
+/**
+ * A memory resource that counts the allocations that pass through it to the
+ * system allocator.
+ */
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  std::size_t allocation_count() const noexcept {
+    return this->allocation_count_;
+  }
+
+  std::size_t allocated_size() const noexcept {
+    return this->allocated_size_;
+  }
+
+  void Reset() noexcept {
+    this->allocation_count_ = 0;
+    this->allocated_size_ = 0;
+  }
+
+ private:
+  std::atomic<std::size_t> allocation_count_ = 0;
+  std::atomic<std::size_t> allocated_size_ = 0;
+
+  void* do_allocate(
+      std::size_t size,
+      std::size_t alignment
+  ) override {
+    this->allocation_count_ += 1;
+    this->allocated_size_ += size;
+
+    return std::pmr::new_delete_resource()->allocate(size, alignment);
+  }
+
+  void do_deallocate(
+      void* data,
+      std::size_t size,
+      std::size_t alignment
+  ) override {
+    std::pmr::new_delete_resource()->deallocate(data, size, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other
+  ) const noexcept override {
+    return this == &other;
+  }
+};
+
+/**
+ * Runs the workloads with the resource that make_resource creates on top of
+ * the counting resource. If it creates none, the reader allocates from the
+ * counting resource directly.
+ */
+template <typename MakeResource>
+void BenchmarkResource(
+    std::string_view resource_name,
+    const std::filesystem::path& config_file_path,
+    const std::vector<std::string>& names,
+    MakeResource&& make_resource
+) {
+  CountingResource counting_resource;
+  std::string workload_prefix = std::string(resource_name) + "_";
+
+  PrintResult(
+      workload_prefix + "read",
+      MeasureNanosecondsPerOperation(names.size(), [&]() {
+        counting_resource.Reset();
+        std::unique_ptr<std::pmr::memory_resource> resource =
+            make_resource(&counting_resource);
+
+        ConfigReader reader(
+            config_file_path,
+            resource ? resource.get() : &counting_resource
+        );
+        result_sink = result_sink + reader.Read();
+      }),
+      "ns/member"
+  );
+
+  PrintResult(
+      workload_prefix + "read_allocations",
+      static_cast<double>(counting_resource.allocation_count()),
+      "allocations"
+  );
+
+  PrintResult(
+      workload_prefix + "read_allocated",
+      static_cast<double>(counting_resource.allocated_size()) / (1 << 20),
+      "MiB"
+  );
+
+  PrintResult(
+      workload_prefix + "set_deep",
+      MeasureNanosecondsPerOperation(names.size() * 2, [&]() {
+        counting_resource.Reset();
+        std::unique_ptr<std::pmr::memory_resource> resource =
+            make_resource(&counting_resource);
+
+        ConfigReader reader(
+            config_file_path,
+            resource ? resource.get() : &counting_resource
+        );
+        for (std::size_t i = 0; i < names.size(); i += 1) {
+          reader.SetDeepInt(static_cast<int>(i), names[i], "index");
+          reader.SetDeepString(names[i], names[i], "name");
+        }
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      workload_prefix + "set_deep_allocations",
+      static_cast<double>(counting_resource.allocation_count()),
+      "allocations"
+  );
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::size_t member_count = mjsoni_benchmark::CountArgument(
+      argc,
+      argv,
+      kDefaultMemberCount
+  );
+
+  mjsoni_benchmark::BenchmarkDirectory directory("allocation");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  std::vector<std::string> names;
+  names.reserve(member_count);
+  for (std::size_t i = 0; i < member_count; i += 1) {
+    names.push_back("member" + std::to_string(i));
+  }
+
+  {
+    ConfigReader writer(config_file_path);
+    writer.Read();
+    for (std::size_t i = 0; i < member_count; i += 1) {
+      writer.SetDeepInt(static_cast<int>(i), names[i], "index");
+      writer.SetDeepString("name of " + names[i], names[i], "name");
+      writer.SetDeepVector(std::vector<double>({ 0.5, 1.5 }), names[i], "values");
+    }
+
+    writer.Write(2);
+  }
+
+  BenchmarkResource(
+      "default",
+      config_file_path,
+      names,
+      [](std::pmr::memory_resource*) {
+        return std::unique_ptr<std::pmr::memory_resource>();
+      }
+  );
+
+  BenchmarkResource(
+      "pool",
+      config_file_path,
+      names,
+      [](std::pmr::memory_resource* upstream) {
+        return std::unique_ptr<std::pmr::memory_resource>(
+            new std::pmr::synchronized_pool_resource(upstream)
+        );
+      }
+  );
+
+  BenchmarkResource(
+      "bump",
+      config_file_path,
+      names,
+      [](std::pmr::memory_resource* upstream) {
+        return std::unique_ptr<std::pmr::memory_resource>(
+            new mjsoni::JsonBumpResource(
+                mjsoni::JsonBumpResource::kDefaultChunkSize,
+                upstream
+            )
+        );
+      }
+  );
+
+  return 0;
+}
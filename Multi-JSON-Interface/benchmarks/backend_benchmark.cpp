@@ -0,0 +1,212 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Times the common workloads of a config reader, so that the backend for a
+ * workload can be picked by comparing the output of the benchmark of each
+ * backend. The optional argument is the number of members of the document.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+using namespace mjsoni::literals;
+
+namespace {
+
+using mjsoni_benchmark::MeasureNanosecondsPerOperation;
+using mjsoni_benchmark::PrintResult;
+using mjsoni_benchmark::result_sink;
+
+constexpr std::size_t kDefaultMemberCount = 100000;
+
+void FillDocument(
+    ConfigReader& reader,
+    const std::vector<std::string>& names
+) {
+  for (std::size_t i = 0; i < names.size(); i += 1) {
+    reader.SetDeepInt(static_cast<int>(i), names[i], "index");
+    reader.SetDeepString("name of " + names[i], names[i], "name");
+    reader.SetDeepDouble(i * 0.5, names[i], "ratio");
+    reader.SetDeepBool(i % 2 == 0, names[i], "enabled");
+    reader.SetDeepVector(std::vector<int>({ 1, 2, 3 }), names[i], "tags");
+  }
+
+  reader.SetDeepInt(8080, "server", "port");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::size_t member_count = mjsoni_benchmark::CountArgument(
+      argc,
+      argv,
+      kDefaultMemberCount
+  );
+
+  mjsoni_benchmark::BenchmarkDirectory directory("backend");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  std::vector<std::string> names;
+  names.reserve(member_count);
+  for (std::size_t i = 0; i < member_count; i += 1) {
+    names.push_back("member" + std::to_string(i));
+  }
+
+  ConfigReader reader(config_file_path);
+  reader.Read();
+
+  PrintResult(
+      "set_deep",
+      MeasureNanosecondsPerOperation(member_count * 5, [&reader, &names]() {
+        reader.Read();
+        FillDocument(reader, names);
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "write",
+      MeasureNanosecondsPerOperation(member_count, [&reader]() {
+        result_sink = result_sink + reader.Write(2);
+      }),
+      "ns/member"
+  );
+
+  PrintResult(
+      "read",
+      MeasureNanosecondsPerOperation(member_count, [&reader]() {
+        result_sink = result_sink + reader.Read();
+      }),
+      "ns/member"
+  );
+
+  PrintResult(
+      "get_runtime_key",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        std::int64_t sum = 0;
+        for (const std::string& name : names) {
+          sum += reader.GetInt(name, "index");
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "get_key_literal",
+      MeasureNanosecondsPerOperation(member_count, [&reader, member_count]() {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i < member_count; i += 1) {
+          sum += reader.GetInt("server"_key, "port"_key);
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "get_string",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        std::int64_t sum = 0;
+        for (const std::string& name : names) {
+          sum += reader.GetString(name, "name").size();
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "get_vector",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        std::int64_t sum = 0;
+        for (const std::string& name : names) {
+          sum += reader.GetVector<int>(name, "tags").size();
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "has_missing",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        std::int64_t sum = 0;
+        for (const std::string& name : names) {
+          sum += reader.HasInt(name, "missing");
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "set_existing",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        for (std::size_t i = 0; i < names.size(); i += 1) {
+          reader.SetInt(static_cast<int>(i) + 1, names[i], "index");
+        }
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "hash",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        // A mutation invalidates the cached subtree hashes.
+        reader.SetInt(0, names[0], "index");
+        result_sink = result_sink + static_cast<std::int64_t>(reader.Hash());
+      }),
+      "ns/member"
+  );
+
+  reader.Freeze();
+
+  PrintResult(
+      "frozen_get_runtime_key",
+      MeasureNanosecondsPerOperation(member_count, [&reader, &names]() {
+        std::int64_t sum = 0;
+        for (const std::string& name : names) {
+          sum += reader.GetInt(name, "index");
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  PrintResult(
+      "frozen_get_key_literal",
+      MeasureNanosecondsPerOperation(member_count, [&reader, member_count]() {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i < member_count; i += 1) {
+          sum += reader.GetInt("server"_key, "port"_key);
+        }
+        result_sink = result_sink + sum;
+      }),
+      "ns/op"
+  );
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_BENCHMARK_HPP_
+#define MJSONI_BENCHMARK_HPP_
+
+/**
+ * Shared parts of the benchmarks, which are built once for each backend like
+ * the tests. The backend is selected by MJSONI_BENCHMARK_NLOHMANN_JSON or
+ * MJSONI_BENCHMARK_RAPIDJSON. Every benchmark prints one line per workload,
+ * which starts with the backend name, so that the output of the backends
+ * can be compared line by line.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#if defined(MJSONI_BENCHMARK_RAPIDJSON)
+
+#include <mjsoni/rapid_json_config_reader.hpp>
+
+using ConfigReader = mjsoni::RapidJsonConfigReader;
+
+constexpr std::string_view kBackendName = "rapidjson";
+
+#elif defined(MJSONI_BENCHMARK_NLOHMANN_JSON)
+
+#include <mjsoni/nlohmann_json_config_reader.hpp>
+
+using ConfigReader = mjsoni::NlohmannJsonConfigReader;
+
+constexpr std::string_view kBackendName = "nlohmann_json";
+
+#else
+#error "Define MJSONI_BENCHMARK_NLOHMANN_JSON or MJSONI_BENCHMARK_RAPIDJSON."
+#endif
+
+namespace mjsoni_benchmark {
+
+// Each workload is timed this many times, and the fastest run is reported.
+constexpr int kRepetitionCount = 3;
+
+// Results are accumulated here, so that the measured work is not optimized
+// away.
+inline volatile std::int64_t result_sink = 0;
+
+/**
+ * A directory for the config files of a benchmark, which is removed with its
+ * contents when the benchmark ends.
+ */
+class BenchmarkDirectory {
+ public:
+  explicit BenchmarkDirectory(std::string_view benchmark_name)
+      : path_(std::filesystem::temp_directory_path()
+            / ("mjsoni_benchmark_" + std::string(benchmark_name))) {
+    std::filesystem::remove_all(this->path_);
+    std::filesystem::create_directories(this->path_);
+  }
+
+  ~BenchmarkDirectory() {
+    std::error_code error_code;
+    std::filesystem::remove_all(this->path_, error_code);
+  }
+
+  std::filesystem::path operator/(std::string_view file_name) const {
+    return this->path_ / file_name;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+/**
+ * Returns the first command line argument as a count, or the default count
+ * if there is none.
+ */
+inline std::size_t CountArgument(
+    int argc,
+    char** argv,
+    std::size_t default_count
+) {
+  if (argc < 2) {
+    return default_count;
+  }
+
+  return static_cast<std::size_t>(std::strtoull(argv[1], nullptr, 10));
+}
+
+/**
+ * Runs the workload, which performs operation_count operations, and returns
+ * the nanoseconds per operation of its fastest run.
+ */
+template <typename Workload>
+double MeasureNanosecondsPerOperation(
+    std::size_t operation_count,
+    Workload&& workload
+) {
+  double fastest_nanoseconds = std::numeric_limits<double>::max();
+
+  for (int i = 0; i < kRepetitionCount; i += 1) {
+    std::chrono::steady_clock::time_point start_time =
+        std::chrono::steady_clock::now();
+    workload();
+    std::chrono::steady_clock::time_point end_time =
+        std::chrono::steady_clock::now();
+
+    fastest_nanoseconds = std::min(
+        fastest_nanoseconds,
+        std::chrono::duration<double, std::nano>(end_time - start_time).count()
+    );
+  }
+
+  return fastest_nanoseconds / std::max<std::size_t>(operation_count, 1);
+}
+
+/**
+ * Prints the result of a workload as "<backend> <workload> <value> <unit>".
+ */
+inline void PrintResult(
+    std::string_view workload_name,
+    double value,
+    std::string_view unit
+) {
+  std::printf(
+      "%-14.*s %-28.*s %14.1f %.*s\n",
+      static_cast<int>(kBackendName.size()),
+      kBackendName.data(),
+      static_cast<int>(workload_name.size()),
+      workload_name.data(),
+      value,
+      static_cast<int>(unit.size()),
+      unit.data()
+  );
+}
+
+} // namespace mjsoni_benchmark
+
+#endif // MJSONI_BENCHMARK_HPP_
@@ -0,0 +1,61 @@
+# Rebuilds each variant of the build benchmark and prints its build time and
+# the size of its executable. Run through the <backend>_build_benchmark
+# targets, which pass:
+#   MJSONI_BUILD_DIR      the build directory
+#   MJSONI_SOURCE_DIR     the directory of the generated translation units
+#   MJSONI_BACKEND_NAME   the name of the backend
+#   MJSONI_VARIANTS       "<target>=<executable>" pairs, separated by "|"
+#
+# The sources are touched before each build, so that all of the variant's
+# translation units are recompiled. A precompiled header is not, because it
+# is only rebuilt when the headers change.
+
+cmake_minimum_required(VERSION 3.14)
+
+string(REPLACE "|" ";" variants "${MJSONI_VARIANTS}")
+file(GLOB source_files "${MJSONI_SOURCE_DIR}/*.cpp")
+
+foreach(variant IN LISTS variants)
+  string(REPLACE "=" ";" variant_parts "${variant}")
+  list(GET variant_parts 0 target_name)
+  list(GET variant_parts 1 executable_path)
+
+  # Make sure that everything other than the timed sources is up to date.
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} --build ${MJSONI_BUILD_DIR} --target ${target_name}
+    OUTPUT_QUIET
+  )
+
+  file(TOUCH ${source_files})
+
+  # %f is only supported since CMake 3.23, before which seconds are timed.
+  if (CMAKE_VERSION VERSION_LESS 3.23)
+    string(TIMESTAMP start_time "%s000000")
+  else()
+    string(TIMESTAMP start_time "%s%f")
+  endif()
+
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} --build ${MJSONI_BUILD_DIR} --target ${target_name}
+    RESULT_VARIABLE build_result
+    OUTPUT_QUIET
+  )
+
+  if (CMAKE_VERSION VERSION_LESS 3.23)
+    string(TIMESTAMP end_time "%s000000")
+  else()
+    string(TIMESTAMP end_time "%s%f")
+  endif()
+
+  if (NOT build_result EQUAL 0)
+    message(FATAL_ERROR "${target_name} failed to build.")
+  endif()
+
+  math(EXPR build_milliseconds "(${end_time} - ${start_time}) / 1000")
+  file(SIZE ${executable_path} executable_size)
+
+  message(
+    "${MJSONI_BACKEND_NAME} ${target_name}: "
+    "${build_milliseconds} ms to build, ${executable_size} bytes"
+  )
+endforeach()
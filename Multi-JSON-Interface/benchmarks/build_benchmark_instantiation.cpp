@@ -0,0 +1,27 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * The translation unit that compiles the non-template members of the reader
+ * for the variant of the build benchmark that uses MJSONI_EXTERN_TEMPLATES.
+ */
+
+#define MJSONI_INSTANTIATE_TEMPLATES
+
+#include "benchmark.hpp"
@@ -0,0 +1,270 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Times random lookups in a large frozen document whose memory comes from
+ * the default resource or from huge pages, and counts their data TLB misses
+ * where Linux perf events are available. It then times lookups from all
+ * hardware threads with and without NUMA replicas. The RapidJSON benchmark
+ * is built with MJSONI_ENABLE_PMR; nlohmann::json ignores the resource, so
+ * its huge page results match the default ones. The optional argument is
+ * the number of members of the document.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "benchmark.hpp"
+
+namespace {
+
+using mjsoni_benchmark::MeasureNanosecondsPerOperation;
+using mjsoni_benchmark::PrintResult;
+using mjsoni_benchmark::result_sink;
+
+constexpr std::size_t kDefaultMemberCount = 1000000;
+
+/**
+ * Counts the data TLB read misses of the calling thread, if the system
+ * allows it.
+ */
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+#if defined(__linux__)
+    perf_event_attr attributes = {};
+    attributes.type = PERF_TYPE_HW_CACHE;
+    attributes.size = sizeof(attributes);
+    attributes.config = PERF_COUNT_HW_CACHE_DTLB
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+
+    this->file_descriptor_ = static_cast<int>(
+        syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0)
+    );
+#endif
+  }
+
+  ~TlbMissCounter() {
+#if defined(__linux__)
+    if (this->file_descriptor_ != -1) {
+      close(this->file_descriptor_);
+    }
+#endif
+  }
+
+  TlbMissCounter(const TlbMissCounter&) = delete;
+  TlbMissCounter& operator=(const TlbMissCounter&) = delete;
+
+  bool is_available() const noexcept {
+    return this->file_descriptor_ != -1;
+  }
+
+  void Start() {
+#if defined(__linux__)
+    ioctl(this->file_descriptor_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(this->file_descriptor_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  std::uint64_t Stop() {
+    std::uint64_t miss_count = 0;
+
+#if defined(__linux__)
+    ioctl(this->file_descriptor_, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(this->file_descriptor_, &miss_count, sizeof(miss_count))
+        != sizeof(miss_count)) {
+      miss_count = 0;
+    }
+#endif
+
+    return miss_count;
+  }
+
+ private:
+  int file_descriptor_ = -1;
+};
+
+void LookUp(
+    const ConfigReader& reader,
+    const std::vector<std::string>& names
+) {
+  std::int64_t sum = 0;
+  for (const std::string& name : names) {
+    sum += reader.GetInt(name, "index");
+  }
+
+  result_sink = result_sink + sum;
+}
+
+void BenchmarkLookups(
+    std::string_view resource_name,
+    const std::filesystem::path& config_file_path,
+    const std::vector<std::string>& shuffled_names,
+    std::pmr::memory_resource* memory_resource
+) {
+  ConfigReader reader(config_file_path, memory_resource);
+  reader.Read();
+  reader.Freeze();
+
+  std::string workload_prefix = std::string(resource_name) + "_";
+
+  PrintResult(
+      workload_prefix + "lookup",
+      MeasureNanosecondsPerOperation(shuffled_names.size(), [&]() {
+        LookUp(reader, shuffled_names);
+      }),
+      "ns/op"
+  );
+
+  TlbMissCounter tlb_miss_counter;
+  if (tlb_miss_counter.is_available()) {
+    tlb_miss_counter.Start();
+    LookUp(reader, shuffled_names);
+    std::uint64_t miss_count = tlb_miss_counter.Stop();
+
+    PrintResult(
+        workload_prefix + "lookup_dtlb_misses",
+        static_cast<double>(miss_count) / shuffled_names.size(),
+        "misses/op"
+    );
+  }
+}
+
+void BenchmarkThreadedLookups(
+    bool numa_replication,
+    const std::filesystem::path& config_file_path,
+    const std::vector<std::string>& shuffled_names,
+    std::size_t thread_count
+) {
+  ConfigReader reader(config_file_path);
+  reader.set_numa_replication(numa_replication);
+  reader.Read();
+  reader.Freeze();
+
+  PrintResult(
+      std::string(numa_replication ? "numa_replicas" : "shared")
+          + "_lookup_" + std::to_string(thread_count) + "_threads",
+      MeasureNanosecondsPerOperation(shuffled_names.size(), [&]() {
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < thread_count; i += 1) {
+          threads.emplace_back([&reader, &shuffled_names]() {
+            LookUp(reader, shuffled_names);
+          });
+        }
+
+        for (std::thread& thread : threads) {
+          thread.join();
+        }
+      }),
+      "ns/op"
+  );
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::size_t member_count = mjsoni_benchmark::CountArgument(
+      argc,
+      argv,
+      kDefaultMemberCount
+  );
+
+  mjsoni_benchmark::BenchmarkDirectory directory("latency");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  std::vector<std::string> names;
+  names.reserve(member_count);
+  for (std::size_t i = 0; i < member_count; i += 1) {
+    names.push_back("member" + std::to_string(i));
+  }
+
+  {
+    ConfigReader writer(config_file_path);
+    writer.Read();
+    for (std::size_t i = 0; i < member_count; i += 1) {
+      writer.SetDeepInt(static_cast<int>(i), names[i], "index");
+      writer.SetDeepString("name of " + names[i], names[i], "name");
+    }
+
+    writer.Write(0);
+  }
+
+  // Random order defeats the caches and the prefetcher, like the lookups of
+  // a real application.
+  std::vector<std::string> shuffled_names = names;
+  std::shuffle(
+      shuffled_names.begin(),
+      shuffled_names.end(),
+      std::mt19937(12345)
+  );
+
+  BenchmarkLookups(
+      "default",
+      config_file_path,
+      shuffled_names,
+      nullptr
+  );
+
+  {
+    mjsoni::JsonHugePageResource huge_page_resource;
+    mjsoni::JsonBumpResource arena(mjsoni::kHugePageSize, &huge_page_resource);
+
+    BenchmarkLookups(
+        "huge_pages",
+        config_file_path,
+        shuffled_names,
+        &arena
+    );
+  }
+
+  PrintResult(
+      "numa_nodes",
+      static_cast<double>(mjsoni::NumaNodeCount()),
+      "nodes"
+  );
+
+  std::size_t thread_count = std::max<std::size_t>(
+      std::thread::hardware_concurrency(),
+      1
+  );
+
+  BenchmarkThreadedLookups(false, config_file_path, shuffled_names, thread_count);
+  BenchmarkThreadedLookups(true, config_file_path, shuffled_names, thread_count);
+
+  return 0;
+}
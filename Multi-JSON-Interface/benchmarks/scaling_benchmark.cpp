@@ -0,0 +1,120 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Times ReadParallel() and WriteParallel() of a large document for an
+ * increasing number of threads, next to the serial Read() and Write(). The
+ * optional argument is the number of members of the document.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace {
+
+using mjsoni_benchmark::MeasureNanosecondsPerOperation;
+using mjsoni_benchmark::PrintResult;
+using mjsoni_benchmark::result_sink;
+
+constexpr std::size_t kDefaultMemberCount = 200000;
+
+constexpr std::size_t kNanosecondsPerMillisecond = 1000000;
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::size_t member_count = mjsoni_benchmark::CountArgument(
+      argc,
+      argv,
+      kDefaultMemberCount
+  );
+
+  mjsoni_benchmark::BenchmarkDirectory directory("scaling");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  ConfigReader reader(config_file_path);
+  reader.Read();
+  for (std::size_t i = 0; i < member_count; i += 1) {
+    std::string name = "member" + std::to_string(i);
+    reader.SetDeepString(std::string(64, 'a' + (i % 26)), name, "text");
+    reader.SetDeepInt(static_cast<int>(i), name, "index");
+    reader.SetDeepVector(std::vector<double>({ 0.5, 1.5 }), name, "values");
+  }
+
+  reader.Write(2);
+
+  PrintResult(
+      "file_size",
+      static_cast<double>(std::filesystem::file_size(config_file_path)) / (1 << 20),
+      "MiB"
+  );
+
+  PrintResult(
+      "read",
+      MeasureNanosecondsPerOperation(1, [&reader]() {
+        result_sink = result_sink + reader.Read();
+      }) / kNanosecondsPerMillisecond,
+      "ms"
+  );
+
+  PrintResult(
+      "write",
+      MeasureNanosecondsPerOperation(1, [&reader]() {
+        result_sink = result_sink + reader.Write(2);
+      }) / kNanosecondsPerMillisecond,
+      "ms"
+  );
+
+  std::size_t max_thread_count = std::max<std::size_t>(
+      std::thread::hardware_concurrency(),
+      1
+  );
+
+  for (std::size_t thread_count = 1; ; thread_count *= 2) {
+    thread_count = std::min(thread_count, max_thread_count);
+
+    PrintResult(
+        "read_parallel_" + std::to_string(thread_count),
+        MeasureNanosecondsPerOperation(1, [&reader, thread_count]() {
+          result_sink = result_sink + reader.ReadParallel(thread_count);
+        }) / kNanosecondsPerMillisecond,
+        "ms"
+    );
+
+    PrintResult(
+        "write_parallel_" + std::to_string(thread_count),
+        MeasureNanosecondsPerOperation(1, [&reader, thread_count]() {
+          result_sink = result_sink + reader.WriteParallel(2, thread_count);
+        }) / kNanosecondsPerMillisecond,
+        "ms"
+    );
+
+    if (thread_count == max_thread_count) {
+      break;
+    }
+  }
+
+  return 0;
+}
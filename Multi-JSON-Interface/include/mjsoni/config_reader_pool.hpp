@@ -0,0 +1,229 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_CONFIG_READER_POOL_HPP_
+#define MJSONI_CONFIG_READER_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace mjsoni {
+
+/**
+ * Recycles config readers, together with their documents, allocators and
+ * buffers, for code that reads many short-lived configs. Readers are
+ * acquired through a Handle, which returns the reader to the pool when it is
+ * destroyed.
+ *
+ * Idle readers are kept in shards. Each thread is assigned to a shard on its
+ * first use of any pool, so that threads rarely contend for a shard's lock.
+ *
+ *   ConfigReaderPool<RapidJsonConfigReader> pool;
+ *
+ *   ConfigReaderPool<RapidJsonConfigReader>::Handle reader =
+ *       pool.Acquire(tenant_config_file_path);
+ *   reader->Read();
+ */
+template <typename Reader>
+class ConfigReaderPool {
+  struct Shard;
+
+ public:
+  /**
+   * Owns an acquired reader until it is destroyed or released.
+   */
+  class Handle {
+   public:
+    Handle() noexcept = default;
+
+    Handle(Handle&& handle) noexcept
+        : shard_(std::exchange(handle.shard_, nullptr)),
+          reader_(std::move(handle.reader_)) {
+    }
+
+    Handle& operator=(Handle&& handle) noexcept {
+      if (this != &handle) {
+        this->Release();
+        this->shard_ = std::exchange(handle.shard_, nullptr);
+        this->reader_ = std::move(handle.reader_);
+      }
+
+      return *this;
+    }
+
+    ~Handle() {
+      this->Release();
+    }
+
+    /**
+     * Returns the reader to the shard that it was acquired from. The handle
+     * is empty afterwards.
+     */
+    void Release() {
+      if (this->reader_ == nullptr) {
+        return;
+      }
+
+      std::lock_guard lock(this->shard_->mutex);
+      if (this->shard_->idle_readers.size() < this->shard_->max_idle_reader_count) {
+        this->shard_->idle_readers.push_back(std::move(this->reader_));
+      }
+
+      this->reader_.reset();
+      this->shard_ = nullptr;
+    }
+
+    Reader& operator*() const noexcept {
+      return *this->reader_;
+    }
+
+    Reader* operator->() const noexcept {
+      return this->reader_.get();
+    }
+
+    explicit operator bool() const noexcept {
+      return this->reader_ != nullptr;
+    }
+
+    /* Getter and Setters */
+
+    Reader* get() const noexcept {
+      return this->reader_.get();
+    }
+
+   private:
+    friend class ConfigReaderPool;
+
+    Handle(
+        Shard* shard,
+        std::unique_ptr<Reader> reader
+    ) noexcept
+        : shard_(shard),
+          reader_(std::move(reader)) {
+    }
+
+    Shard* shard_ = nullptr;
+    std::unique_ptr<Reader> reader_;
+  };
+
+  /**
+   * Creates a pool with the specified number of shards, each of which keeps
+   * at most max_idle_reader_count idle readers. Readers beyond that are
+   * destroyed when they are released.
+   */
+  explicit ConfigReaderPool(
+      std::size_t shard_count = std::max(std::thread::hardware_concurrency(), 1U),
+      std::size_t max_idle_reader_count = 64
+  ) : shard_count_(std::max<std::size_t>(shard_count, 1)),
+      shards_(std::make_unique<Shard[]>(this->shard_count_)) {
+    for (std::size_t i = 0; i < this->shard_count_; i += 1) {
+      this->shards_[i].max_idle_reader_count = max_idle_reader_count;
+      this->shards_[i].idle_readers.reserve(max_idle_reader_count);
+    }
+  }
+
+  ConfigReaderPool(const ConfigReaderPool&) = delete;
+  ConfigReaderPool& operator=(const ConfigReaderPool&) = delete;
+
+  /**
+   * Returns a reader for the config file, reusing an idle reader of the
+   * calling thread's shard if there is one. A reused reader is Reset(), and
+   * like a new reader, it needs to be read before use. All handles must be
+   * destroyed before the pool.
+   */
+  Handle Acquire(
+      std::filesystem::path config_file_path
+  ) {
+    Shard* shard = &this->shards_[ThreadShardIndex() % this->shard_count_];
+
+    std::unique_ptr<Reader> reader;
+    {
+      std::lock_guard lock(shard->mutex);
+      if (!shard->idle_readers.empty()) {
+        reader = std::move(shard->idle_readers.back());
+        shard->idle_readers.pop_back();
+      }
+    }
+
+    if (reader == nullptr) {
+      reader = std::make_unique<Reader>(std::move(config_file_path));
+    } else {
+      reader->Reset(std::move(config_file_path));
+    }
+
+    return Handle(shard, std::move(reader));
+  }
+
+  /**
+   * Returns the number of idle readers in all shards.
+   */
+  std::size_t idle_reader_count() const {
+    std::size_t idle_reader_count = 0;
+
+    for (std::size_t i = 0; i < this->shard_count_; i += 1) {
+      std::lock_guard lock(this->shards_[i].mutex);
+      idle_reader_count += this->shards_[i].idle_readers.size();
+    }
+
+    return idle_reader_count;
+  }
+
+  /* Getter and Setters */
+
+  constexpr std::size_t shard_count() const noexcept {
+    return this->shard_count_;
+  }
+
+ private:
+  // Shards are aligned to separate cache lines, so that threads locking
+  // different shards don't share one.
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Reader>> idle_readers;
+    std::size_t max_idle_reader_count = 0;
+  };
+
+  std::size_t shard_count_;
+  std::unique_ptr<Shard[]> shards_;
+
+  /**
+   * Returns an index that is assigned to the calling thread on its first
+   * call, in round-robin order.
+   */
+  static std::size_t ThreadShardIndex() noexcept {
+    static std::atomic<std::size_t> next_shard_index = 0;
+    thread_local std::size_t shard_index = next_shard_index.fetch_add(
+        1,
+        std::memory_order_relaxed
+    );
+
+    return shard_index;
+  }
+};
+
+} // namespace mjsoni
+
+#endif // MJSONI_CONFIG_READER_POOL_HPP_
@@ -20,20 +20,61 @@
 #ifndef MJSONI_GENERIC_JSON_CONFIG_READER_HPP_
 #define MJSONI_GENERIC_JSON_CONFIG_READER_HPP_
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <initializer_list>
+#include <istream>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "json_binary.hpp"
+#include "json_compression.hpp"
+#include "json_file.hpp"
+#include "json_frozen.hpp"
+#include "json_hash.hpp"
+#include "json_key.hpp"
+#include "json_memory.hpp"
+#include "json_number.hpp"
+#include "json_pointer.hpp"
+#include "json_query.hpp"
+#include "json_scan.hpp"
+
 namespace mjsoni {
 
+/**
+ * Whether T is a specialization of the class template, such as
+ * std::vector<int> of std::vector.
+ */
+template <typename T, template <typename...> class Template>
+struct IsSpecializationOf : std::false_type {
+};
+
+template <template <typename...> class Template, typename ...Args>
+struct IsSpecializationOf<Template<Args...>, Template> : std::true_type {
+};
+
 template<typename DOC, typename OBJ, typename VAL>
 class GenericConfigReader {
   using JsonDocument = DOC;
@@ -43,16 +84,77 @@ class GenericConfigReader {
  public:
   GenericConfigReader() = delete;
 
+  /**
+   * Constructs a reader whose documents allocate from memory_resource, or
+   * from the default memory resource if it is null. The resource must
+   * outlive the reader. See json_memory.hpp for the backends that use it.
+   */
   explicit GenericConfigReader(
+      std::filesystem::path config_file_path,
+      std::pmr::memory_resource* memory_resource = nullptr
+  );
+
+  /**
+   * Clears the reader for reuse with another config file, leaving it as if
+   * it were newly constructed. The document objects and buffers are kept, so
+   * that the following reads and writes can reuse their memory.
+   */
+  void Reset(
       std::filesystem::path config_file_path
   );
 
   /* Read and Write */
 
+  /**
+   * Reads the config file. A gzip or zstd file, recognized by its leading
+   * bytes, is decompressed while it is parsed, if its library is enabled in
+   * json_compression.hpp. A CBOR or MessagePack file, as selected by
+   * file_format(), is decoded instead of parsed.
+   */
   bool Read();
 
+  /**
+   * Reads the config file, then deep-merges each overlay file on top of it
+   * in order, with later layers winning. Values are moved out of the parsed
+   * layers rather than copied. The files are parsed concurrently by up to
+   * thread_count threads. If any file cannot be read or parsed, then the
+   * document is left unchanged and false is returned.
+   */
+  bool ReadLayers(
+      const std::vector<std::filesystem::path>& overlay_file_paths,
+      std::size_t thread_count
+  );
+
+  /**
+   * Reads the config file like Read(), but for large files whose root is an
+   * object or an array, splits the root's members or elements into up to
+   * thread_count chunks at top-level commas and parses the chunks
+   * concurrently. Small files are parsed serially.
+   */
+  bool ReadParallel(
+      std::size_t thread_count
+  );
+
+  /**
+   * Writes the config file in file_format(), compressed like the file that
+   * it replaces. A new file is compressed according to its extension, .gz
+   * or .zst. The text is compressed while it is written. indent_width only
+   * applies to JSON text.
+   */
   bool Write(int indent_width);
 
+  /**
+   * Writes the config file like Write(), serializing into reusable buffers
+   * that are written to the file in large blocks. If thread_count is greater
+   * than 1 and the root is an object or an array, then ranges of its members
+   * or elements are serialized in parallel, which pays off for large
+   * documents.
+   */
+  bool WriteParallel(
+      int indent_width,
+      std::size_t thread_count
+  );
+
   /* Functions for Generic Types */
 
   template <typename ...Args>
@@ -60,6 +162,10 @@ class GenericConfigReader {
       const Args&... keys
   ) const;
 
+  /**
+   * Returns the value at the key path, or its override. Throws
+   * std::out_of_range if there is no value at the key path.
+   */
   template <typename ...Args>
   const JsonValue& GetValueRef(
       const Args&... keys
@@ -90,12 +196,62 @@ class GenericConfigReader {
       const Args&... keys
   );
 
+  /**
+   * Sets the value at the key path, creating the values on the way to it and
+   * growing arrays with nulls up to the index. An index that would append
+   * more than kMaxArrayGrowth elements to an array, or a negative index,
+   * leaves the document unchanged. The SetDeep* functions forward to this
+   * function.
+   */
   template <typename ...Args>
   void SetDeepValue(
       JsonValue value,
       const Args&... keys
   );
 
+  /**
+   * The number of elements that a SetDeep* function may append to an array
+   * to reach the index of a key path.
+   */
+  static constexpr std::size_t kMaxArrayGrowth = 1 << 16;
+
+  /* Functions for Numbers */
+
+  /**
+   * Returns the number converted to T, which may be any arithmetic type
+   * other than bool. Integer types only accept integers, and floating-point
+   * types accept any number. Throws std::out_of_range if the value is not a
+   * number representable by T. The Get* functions for specific number types
+   * forward to this function.
+   */
+  template <typename T, typename ...Args>
+  T GetNumber(
+      const Args&... keys
+  ) const;
+
+  template <typename T, typename ...Args>
+  T GetNumberOrDefault(
+      T default_value,
+      const Args&... keys
+  ) const;
+
+  template <typename T, typename ...Args>
+  bool HasNumber(
+      const Args&... keys
+  ) const;
+
+  template <typename T, typename ...Args>
+  void SetNumber(
+      T value,
+      const Args&... keys
+  );
+
+  template <typename T, typename ...Args>
+  void SetDeepNumber(
+      T value,
+      const Args&... keys
+  );
+
   /* Functions for bool */
 
   template <typename ...Args>
@@ -180,6 +336,66 @@ class GenericConfigReader {
       const Args&... keys
   );
 
+  /* Functions for double */
+
+  template <typename ...Args>
+  double GetDouble(
+      const Args&... keys
+  ) const;
+
+  template <typename ...Args>
+  double GetDoubleOrDefault(
+      double default_value,
+      const Args&... keys
+  ) const;
+
+  template <typename ...Args>
+  bool HasDouble(
+      const Args&... keys
+  ) const;
+
+  template <typename ...Args>
+  void SetDouble(
+      double value,
+      const Args&... keys
+  );
+
+  template <typename ...Args>
+  void SetDeepDouble(
+      double value,
+      const Args&... keys
+  );
+
+  /* Functions for float */
+
+  template <typename ...Args>
+  float GetFloat(
+      const Args&... keys
+  ) const;
+
+  template <typename ...Args>
+  float GetFloatOrDefault(
+      float default_value,
+      const Args&... keys
+  ) const;
+
+  template <typename ...Args>
+  bool HasFloat(
+      const Args&... keys
+  ) const;
+
+  template <typename ...Args>
+  void SetFloat(
+      float value,
+      const Args&... keys
+  );
+
+  template <typename ...Args>
+  void SetDeepFloat(
+      float value,
+      const Args&... keys
+  );
+
   /* Functions for int */
 
   template <typename ...Args>
@@ -708,57 +924,3728 @@ class GenericConfigReader {
       const Args&... keys
   );
 
+  /* Functions for Patches */
+
+  /**
+   * Applies an RFC 7386 JSON Merge Patch to the document in place. The JSON
+   * Pointers of the values that changed are appended to changed_key_paths,
+   * if it is not null.
+   */
+  bool ApplyMergePatch(
+      const JsonValue& patch,
+      std::vector<std::string>* changed_key_paths
+  );
+
+  /**
+   * Applies an RFC 6902 JSON Patch to the document in place. If any
+   * operation fails, then the operations already applied are rolled back and
+   * false is returned. The JSON Pointers of the values that changed are
+   * appended to changed_key_paths, if it is not null.
+   */
+  bool ApplyJsonPatch(
+      const JsonValue& patch,
+      std::vector<std::string>* changed_key_paths
+  );
+
+  /* Functions for Subscriptions */
+
+  using ChangeCallback = std::function<
+      void(const std::vector<std::string>& changed_key_paths)
+  >;
+
+  /**
+   * Registers a callback for changes to the value at the JSON Pointer, or to
+   * any of its descendants or ancestors. After Read(), a Set*, or a patch,
+   * the callback receives the changed key paths that overlap its key path.
+   * Returns an id for Unsubscribe.
+   *
+   * Callbacks may subscribe and unsubscribe. A subscription that a callback
+   * adds is notified from the next change on, and one that it removes is
+   * not notified anymore.
+   */
+  std::size_t Subscribe(
+      std::string key_path_prefix,
+      ChangeCallback callback
+  );
+
+  void Unsubscribe(
+      std::size_t subscription_id
+  );
+
+  /* Functions for Diffs */
+
+  /**
+   * Returns the structural hash of the document. The hashes of all subtrees
+   * are computed in one pass and cached until the document is mutated.
+   */
+  std::uint64_t Hash() const;
+
+  /**
+   * Returns the JSON Pointers of the values that differ between this
+   * document and the other document, skipping subtrees with equal hashes. If
+   * thread_count is greater than 1, then the top-level members are hashed and
+   * compared in parallel.
+   */
+  std::vector<std::string> Diff(
+      const GenericConfigReader& other,
+      std::size_t thread_count
+  ) const;
+
+  /* Functions for Queries */
+
+  /**
+   * Appends the values selected by the compiled query to results, in
+   * document order. The values are not copied, and the pointers remain valid
+   * until the document is mutated or read again.
+   */
+  void Query(
+      const JsonQuery& query,
+      std::vector<const JsonValue*>* results
+  ) const;
+
+  /**
+   * Returns the first value selected by the compiled query, or null if no
+   * value is selected.
+   */
+  const JsonValue* QueryFirst(
+      const JsonQuery& query
+  ) const;
+
+  /* Functions for Overrides */
+
+  /**
+   * Overrides the value at the key path, and everything below it, for the
+   * Get*, Has* and ContainsKey functions, without modifying the document.
+   * Overrides are meant for values from the environment or the command
+   * line, and are ignored by Write(), Hash(), Diff() and queries. If
+   * overrides are set at several prefixes of a key path, then the longest
+   * one applies.
+   */
+  template <typename ...Args>
+  void SetOverride(
+      const JsonValue& value,
+      const Args&... keys
+  );
+
+  /**
+   * Overrides the value at the key path with the JSON text, or with the text
+   * itself as a string if it is not valid JSON, so that environment variables
+   * such as PORT=8080 and NAME=server both have the expected type.
+   */
+  template <typename ...Args>
+  void SetOverrideText(
+      std::string_view text,
+      const Args&... keys
+  );
+
+  template <typename ...Args>
+  void RemoveOverride(
+      const Args&... keys
+  );
+
+  void ClearOverrides();
+
+  /* Functions for Transactions */
+
+  class Transaction;
+
+  /**
+   * Returns a transaction that stages mutations of the document and applies
+   * them together on Commit(). The transaction must not outlive the reader.
+   */
+  Transaction BeginTransaction();
+
+  /* Functions for Journaling */
+
+  /**
+   * Enables journaled persistence, for large config files that change a few
+   * values at a time. Every Set*, patch and committed transaction then
+   * records the key paths that it changed and their new values, and
+   * FlushJournal() appends the pending records to the journal file as a
+   * group, instead of rewriting the config file. Read() replays the journal
+   * over the config file.
+   *
+   * Once the journal reaches compaction_threshold bytes, FlushJournal() folds
+   * it back into the config file with CompactJournal(), which writes the
+   * config file with the indent width.
+   */
+  void EnableJournal(
+      int indent_width,
+      std::uintmax_t compaction_threshold
+  );
+
+  /**
+   * Disables journaled persistence. Records that were not flushed are
+   * discarded.
+   */
+  void DisableJournal();
+
+  /**
+   * Appends the pending records to the journal in a single write and syncs
+   * it to storage, then compacts the journal if it has reached the
+   * compaction threshold.
+   */
+  bool FlushJournal();
+
+  /**
+   * Writes the whole document to the config file and removes the journal.
+   * The config file is replaced as a whole, and the journal is only removed
+   * once the new config file is on storage. Write() does the same, since the
+   * journal is then out of date.
+   */
+  bool CompactJournal();
+
+  /* Functions for Cached Conversions */
+
+  /**
+   * Returns the value at the key path converted to T, like the Get*
+   * function for T, and keeps the result so that later calls for the same
+   * key path and type share it instead of converting again. T may be bool,
+   * a number type, std::string, std::filesystem::path, or a std::deque,
+   * std::set, std::unordered_set or std::vector of an element type that the
+   * Get* function accepts. The cache is dropped when the document or the
+   * overrides change, but the returned values stay valid while they are
+   * held. Throws like the Get* function, in which case nothing is cached.
+   */
+  template <typename T, typename ...Args>
+  std::shared_ptr<const T> GetCached(
+      const Args&... keys
+  ) const;
+
+  /**
+   * Drops the cached conversions, releasing the memory of those that are
+   * not held elsewhere.
+   */
+  void ClearConversionCache();
+
+  /* Functions for Freezing */
+
+  /**
+   * Freezes the document for reading. ContainsKey, GetValueRef and the Get*
+   * and Has* functions built on them then look up key paths in a read-only
+   * index of the document, laid out contiguously in preorder with perfect
+   * hash tables of the member names and inline numbers, instead of walking
+   * the document's members. Freezing again rebuilds the index.
+   *
+   * While the reader is frozen, Set*, patches and transactions throw
+   * std::logic_error, until Thaw() is called. Read() and the other reads
+   * freeze the new document, so that a frozen reader stays frozen across
+   * reloads. Overrides may still be changed.
+   */
+  void Freeze();
+
+  /**
+   * Drops the read-only index, so that the document may be modified again.
+   */
+  void Thaw();
+
+  /* Functions for Memory Accounting */
+
+  /**
+   * Returns the memory that the reader holds, for its documents, overrides
+   * and buffers. The values are measured in a traversal of the document.
+   */
+  JsonMemoryStats MemoryStats() const;
+
+  /**
+   * Returns the memory of the subtrees of the document, down to max_depth
+   * levels below the root, by the JSON Pointers of their key paths. The
+   * whole document is at "". All the subtrees are measured in a single
+   * traversal of the document.
+   */
+  std::map<std::string, JsonSubtreeMemoryStats> SubtreeMemoryStats(
+      std::size_t max_depth = 1
+  ) const;
+
   /* Getter and Setters */
 
   constexpr const std::filesystem::path& config_file_path() const noexcept {
     return this->config_file_path_;
   }
 
+  constexpr std::pmr::memory_resource* memory_resource() const noexcept {
+    return this->memory_resource_;
+  }
+
   constexpr const JsonDocument& json_document() const noexcept {
     return this->json_document_;
   }
 
+  /**
+   * Whether reads parse numbers with full precision. RapidJSON's default
+   * number parser trades exactness for speed and may be off by a few ULPs;
+   * with this set, every number is parsed to the nearest double.
+   * nlohmann::json always parses numbers exactly.
+   */
+  constexpr bool full_precision_parse() const noexcept {
+    return this->full_precision_parse_;
+  }
+
+  void set_full_precision_parse(bool full_precision_parse) noexcept {
+    this->full_precision_parse_ = full_precision_parse;
+  }
+
+  /**
+   * The dictionary for compressing and decompressing zstd config files,
+   * which improves the compression of many small, similar configs. Files
+   * that were compressed with a dictionary can only be read with the same
+   * dictionary. gzip files don't use it.
+   */
+  constexpr const std::string& compression_dictionary() const noexcept {
+    return this->compression_dictionary_;
+  }
+
+  void set_compression_dictionary(std::string compression_dictionary) noexcept {
+    this->compression_dictionary_ = std::move(compression_dictionary);
+  }
+
+  /**
+   * The encoding of the config file, which Read() decodes and Write()
+   * produces. It is set from the config file's extension, .cbor for CBOR
+   * and .msgpack or .mpk for MessagePack, and may be set to read or write a
+   * file of any name in another format. Overlay files are read according to
+   * their own extensions.
+   */
+  constexpr JsonFileFormat file_format() const noexcept {
+    return this->file_format_;
+  }
+
+  void set_file_format(JsonFileFormat file_format) noexcept {
+    this->file_format_ = file_format;
+  }
+
+  /**
+   * The file next to the config file that journaled changes are appended
+   * to.
+   */
+  std::filesystem::path journal_file_path() const;
+
+  constexpr bool is_journal_enabled() const noexcept {
+    return this->is_journal_enabled_;
+  }
+
+  constexpr bool is_frozen() const noexcept {
+    return this->is_frozen_;
+  }
+
+  /**
+   * Whether Freeze() also copies the document and its index to each NUMA
+   * node, so that frozen lookups read the copy on the node of the calling
+   * thread. Each copy is built by a thread that prefers its node, so that
+   * the kernel places the copy's pages there. This costs a document's memory
+   * per node, and has no effect on systems with a single node.
+   */
+  constexpr bool numa_replication() const noexcept {
+    return this->numa_replication_;
+  }
+
+  void set_numa_replication(bool numa_replication) {
+    this->numa_replication_ = numa_replication;
+
+    if (this->is_frozen()) {
+      this->Freeze();
+    }
+  }
+
+  /**
+   * Whether Write() keeps the formatting of the config file. With this set,
+   * Read() keeps the text of the config file, and Write() replaces only the
+   * text of the values that changed since, leaving the rest of the file as
+   * it was. The file is patched in place if the new text has the same size,
+   * and otherwise rewritten from the first change on. Reads with overlay
+   * files or of compressed files don't keep the text, and a config file
+   * whose size or modification time changed since is not patched, so the
+   * following write is a full one.
+   */
+  constexpr bool preserve_format() const noexcept {
+    return this->preserve_format_;
+  }
+
+  void set_preserve_format(bool preserve_format) noexcept {
+    this->preserve_format_ = preserve_format;
+
+    if (!preserve_format) {
+      this->source_text_.clear();
+      this->edited_key_paths_.clear();
+    }
+  }
+
  private:
   std::filesystem::path config_file_path_;
+  std::pmr::memory_resource* memory_resource_;
   JsonDocument json_document_;
+  bool full_precision_parse_ = false;
+  std::string compression_dictionary_;
+  JsonFileFormat file_format_;
+
+  // Parsed overlay layers and chunks whose values were moved into
+  // json_document_. They may still own memory that those values refer to.
+  std::deque<JsonDocument> retained_documents_;
+
+  // Cleared documents that keep their allocators for reuse by later reads.
+  std::deque<JsonDocument> spare_documents_;
+
+  // Override values by the JSON Pointers of their key paths. The override
+  // document owns the memory of the values, but not the values themselves.
+  std::unordered_map<std::string, JsonValue> overrides_;
+  JsonDocument override_document_;
+
+  // Files smaller than this are not worth splitting for ReadParallel.
+  static constexpr std::size_t kMinParallelReadSize = 1 << 20;
+
+  // Serialized text of the document, in order. Their capacity is kept
+  // between writes.
+  std::vector<std::string> write_buffers_;
+
+  // Journal records that FlushJournal() has not yet appended. Each record is
+  // a line with a JSON object, whose "p" member is the key path as an array
+  // of member names and element indices, and whose "v" member is the new
+  // value. A record without a value removes the value at the key path.
+  std::string journal_buffer_;
+  bool is_journal_enabled_ = false;
+  int journal_indent_width_ = 0;
+  std::uintmax_t journal_compaction_threshold_ = 0;
+
+  // The text of the config file as of the last read or write, its
+  // modification time then, and the JSON Pointers of the values changed
+  // since, if the format is preserved.
+  bool preserve_format_ = false;
+  std::string source_text_;
+  std::filesystem::file_time_type source_file_time_;
+  std::vector<std::string> edited_key_paths_;
+
+  struct Subscription {
+    std::size_t id;
+    std::string key_path_prefix;
+    ChangeCallback callback;
+  };
+
+  // While callbacks are notified, the subscriptions are iterated in place,
+  // so new subscriptions wait in pending_subscriptions_ and removed ones are
+  // only marked with kRemovedSubscriptionId until the notification ends.
+  static constexpr std::size_t kRemovedSubscriptionId = 0;
+
+  std::vector<Subscription> subscriptions_;
+  std::vector<Subscription> pending_subscriptions_;
+  std::size_t next_subscription_id_ = 1;
+  std::size_t notification_depth_ = 0;
+
+  using SubtreeHashMap = std::unordered_map<const JsonValue*, std::uint64_t>;
+
+  // Incremented on every mutation of the document, to invalidate caches.
+  std::uint64_t generation_ = 0;
+
+  // The hashes of all subtrees of the document, for Hash() and Diff(). A
+  // published map is complete, so it is only read, and it is replaced
+  // rather than updated, under the lock.
+  mutable std::shared_ptr<SubtreeHashMap> subtree_hash_cache_;
+  mutable std::uint64_t subtree_hash_cache_generation_ = 0;
+  mutable std::mutex subtree_hash_cache_mutex_;
+
+  struct CachedConversion {
+    std::type_index type;
+    std::shared_ptr<const void> value;
+  };
+
+  // Values converted by GetCached(), by the JSON Pointers of their key paths.
+  // Const lookups may run concurrently, so the cache is guarded by a lock.
+  mutable std::unordered_map<std::string, std::vector<CachedConversion>> conversion_cache_;
+  mutable std::uint64_t conversion_cache_generation_ = 0;
+  mutable std::shared_mutex conversion_cache_mutex_;
+
+  // The read-only index of the document while the reader is frozen. Its
+  // memory is kept when the reader thaws.
+  JsonFrozenIndex<VAL> frozen_index_;
+  bool is_frozen_ = false;
+
+  // Copies of the frozen document and its index, by NUMA node, if NUMA
+  // replication is enabled on a system with several nodes.
+  struct NumaReplica {
+    JsonDocument document;
+    JsonFrozenIndex<VAL> frozen_index;
+  };
+
+  std::vector<std::unique_ptr<NumaReplica>> numa_replicas_;
+  bool numa_replication_ = false;
+
+  /**
+   * Records how to revert a single runtime-path mutation. The reference
+   * tokens locate the mutated value, and old_value holds the value that was
+   * replaced or removed.
+   */
+  struct UndoEntry {
+    enum class Kind {
+      kReplaced,
+      kAddedMember,
+      kRemovedMember,
+      kInsertedElement,
+      kRemovedElement,
+    };
+
+    Kind kind;
+    std::vector<std::string> reference_tokens;
+    std::size_t index;
+    JsonValue old_value;
+  };
+
+  static const JsonValue* FindValue(
+      const JsonObject& object,
+      std::string_view key
+  );
 
-  template <typename ...Args>
-  bool ContainsKeyRecursive(
+  static const JsonValue* FindValue(
       const JsonObject& object,
-      std::string_view current_key,
-      const Args&... keys
-  ) const;
+      const JsonKey& key
+  );
 
-  template <typename ...Args>
-  JsonValue& GetValueRefRecursive(
+  static JsonValue* FindValue(
       JsonObject& object,
-      std::string_view current_key,
-      const Args&... keys
+      std::string_view key
   );
 
-  template <typename ...Args>
-  const JsonValue& GetValueRefRecursive(
-      const JsonObject& object,
-      std::string_view current_key,
-      const Args&... keys
+  static JsonValue* FindValue(
+      JsonObject& object,
+      const JsonKey& key
+  );
+
+  static const JsonValue* FindValueByKeys(
+      const JsonValue& root,
+      std::initializer_list<JsonKey> keys
+  );
+
+  static JsonValue* FindValueByKeys(
+      JsonValue& root,
+      std::initializer_list<JsonKey> keys
+  );
+
+  bool SetValueByKeys(
+      JsonValue value,
+      std::initializer_list<JsonKey> keys
+  );
+
+  bool SetDeepValueByKeys(
+      JsonValue value,
+      std::initializer_list<JsonKey> keys
+  );
+
+  JsonValue* FindOrAddValue(
+      JsonValue& parent,
+      const JsonKey& key,
+      bool is_deep,
+      const std::vector<std::string>& reference_tokens,
+      std::size_t reference_token_count,
+      std::vector<UndoEntry>* undo_log
+  );
+
+  bool FindOverrideByKeys(
+      std::initializer_list<JsonKey> keys,
+      const JsonValue** value_ptr
   ) const;
 
-  template <typename ...Args>
-  void SetValueRecursive(
+  bool IsRecordingChanges() const noexcept;
+
+  void RecordChange(
+      const std::vector<JsonKey>& keys
+  );
+
+  void RecordChanges(
+      const std::vector<std::string>& key_paths
+  );
+
+  static void AppendJournalRecord(
+      std::string* journal_buffer,
+      const std::vector<JsonKey>& keys,
+      const JsonValue* value_ptr
+  );
+
+  static bool ReadJournalRecord(
+      const JsonValue& record,
+      std::vector<JsonKey>* keys,
+      const JsonValue** value_ptr
+  );
+
+  void ReplayJournal(
+      std::vector<std::string>* changed_key_paths
+  );
+
+  bool RemoveJournal();
+
+  bool ParseSourceFile(
+      const std::filesystem::path& file_path,
+      std::string* source_text,
+      JsonDocument* document
+  ) const;
+
+  void KeepSourceText(
+      std::string* source_text,
+      std::filesystem::file_time_type source_file_time
+  );
+
+  static void AppendSerializedValue(
+      std::string* text,
+      const JsonValue& value,
+      int indent_width
+  );
+
+  bool WriteEditedSpans(
+      int indent_width
+  );
+
+  static JsonValue CopyValue(
+      const JsonValue& value,
+      JsonDocument* document
+  );
+
+  static JsonValue MakeStringValue(
+      std::string_view text,
+      JsonDocument* document
+  );
+
+  void SetOverrideByKeys(
       JsonValue value,
-      JsonObject& object,
-      std::string_view current_key,
-      const Args&... keys
+      std::initializer_list<JsonKey> keys
   );
 
-  template <typename ...Args>
-  void SetDeepValueRecursive(
+  static JsonValue* ResolveReferenceTokens(
+      JsonValue& root,
+      const std::vector<std::string>& reference_tokens,
+      std::size_t count
+  );
+
+  static const JsonValue* ResolveReferenceTokens(
+      const JsonValue& root,
+      const std::vector<std::string>& reference_tokens,
+      std::size_t count
+  );
+
+  bool AddAtReferenceTokens(
+      std::vector<std::string>* reference_tokens,
       JsonValue value,
-      JsonObject& object,
-      std::string_view current_key,
+      std::vector<UndoEntry>* undo_log
+  );
+
+  bool RemoveAtReferenceTokens(
+      const std::vector<std::string>& reference_tokens,
+      std::vector<UndoEntry>* undo_log
+  );
+
+  bool ReplaceAtReferenceTokens(
+      const std::vector<std::string>& reference_tokens,
+      JsonValue value,
+      std::vector<UndoEntry>* undo_log
+  );
+
+  void RollBack(
+      std::vector<UndoEntry>* undo_log
+  );
+
+  bool ApplyJsonPatchOperation(
+      const JsonValue& operation,
+      std::vector<std::string>* changed_key_paths,
+      std::vector<UndoEntry>* undo_log
+  );
+
+  void MergePatchRecursive(
+      JsonValue& target,
+      const JsonValue& patch,
+      std::string* key_path,
+      std::vector<std::string>* changed_key_paths
+  );
+
+  bool CreateConfigFileIfMissing() const;
+
+  JsonFileFormat ConfigFileFormat(
+      const std::filesystem::path& file_path
+  ) const;
+
+  JsonCompression DetectConfigFileCompression() const;
+
+  bool WriteConfigFile(
+      const std::vector<std::string>& texts
+  ) const;
+
+  bool ParseConfigFile(
+      const std::filesystem::path& file_path,
+      JsonDocument* document
+  ) const;
+
+  bool ParseConfigStream(
+      std::istream& config_stream,
+      JsonDocument* document
+  ) const;
+
+  static bool DecodeConfigStream(
+      std::istream& config_stream,
+      JsonFileFormat file_format,
+      JsonDocument* document
+  );
+
+  bool ParseConfigText(
+      std::string_view text,
+      JsonDocument* document
+  ) const;
+
+  static void AppendParsedChunk(
+      JsonDocument* document,
+      JsonDocument* chunk_document
+  );
+
+  void CommitParsedDocuments(
+      std::deque<JsonDocument>* parsed_documents
+  );
+
+  static void ClearDocument(
+      JsonDocument* document
+  );
+
+  JsonDocument MakeDocument() const;
+
+  void AcquireDocuments(
+      std::size_t document_count,
+      std::deque<JsonDocument>* documents
+  );
+
+  void ReleaseDocuments(
+      std::deque<JsonDocument>* documents
+  );
+
+  void SerializeDocument(
+      int indent_width,
+      std::size_t thread_count
+  );
+
+  static void EncodeValue(
+      JsonBinaryWriter* writer,
+      const JsonValue& value
+  );
+
+  template <typename T, typename ...Args>
+  T GetConverted(
       const Args&... keys
+  ) const;
+
+  void ReplicateToNumaNodes();
+
+  const JsonFrozenIndex<VAL>& LocalFrozenIndex() const;
+
+  const JsonValue* FindDocumentValueByKeys(
+      std::initializer_list<JsonKey> keys
+  ) const;
+
+  static std::uint32_t FreezeValue(
+      const JsonValue& value,
+      JsonFrozenIndex<VAL>* frozen_index
   );
-};
+
+  void ThrowIfFrozen() const;
+
+  [[noreturn]] static void ThrowMissingKeyPath();
+
+  static JsonSubtreeMemoryStats MeasureSubtree(
+      const JsonValue& value,
+      std::size_t depth,
+      std::size_t max_depth,
+      std::string* key_path,
+      std::map<std::string, JsonSubtreeMemoryStats>* subtree_stats
+  );
+
+  void MeasureAllocators(
+      JsonMemoryStats* memory_stats
+  ) const;
+
+  template <typename T>
+  static bool ToNumber(
+      const JsonValue& value,
+      T* number
+  );
+
+  template <typename T>
+  static JsonValue MakeNumberValue(
+      T value
+  );
+
+  static void MergeLayerRecursive(
+      JsonValue& target,
+      JsonValue& layer,
+      JsonDocument* document
+  );
+
+  static std::uint64_t HashSubtrees(
+      const JsonValue& value,
+      SubtreeHashMap* subtree_hashes
+  );
+
+  static bool QueryRecursive(
+      const JsonValue& value,
+      const JsonQuery& query,
+      std::size_t step_index,
+      std::size_t max_result_count,
+      std::vector<const JsonValue*>* results
+  );
+
+  static bool MatchesQueryFilter(
+      const JsonValue& value,
+      const JsonQueryStep& step
+  );
+
+  static JsonQueryValueView ToQueryValueView(
+      const JsonValue& value
+  );
+
+  void DiffRecursive(
+      const JsonValue& old_value,
+      SubtreeHashMap* old_subtree_hashes,
+      const JsonValue& new_value,
+      SubtreeHashMap* new_subtree_hashes,
+      std::string* key_path,
+      bool is_subscribed_only,
+      std::vector<std::string>* changed_key_paths
+  ) const;
+
+  std::shared_ptr<SubtreeHashMap> GetSubtreeHashes(
+      std::size_t thread_count
+  ) const;
+
+  void HashDocumentSubtrees(
+      std::size_t thread_count,
+      SubtreeHashMap* subtree_hashes
+  ) const;
+
+  bool IsSubscribedKeyPath(
+      std::string_view key_path
+  ) const;
+
+  void NotifySubscribers(
+      const std::vector<std::string>& changed_key_paths
+  );
+
+  void EndNotification();
+};
+
+/**
+ * Stages Set* and SetDeep* mutations, which Commit() applies in a single
+ * pass over the document. The mutations are sorted by key path, so that
+ * mutations of neighbouring values share the walk to their common parent.
+ * The parents of all SetDeep* mutations are created before any value is
+ * set, so a Set* whose parent is created by a SetDeep* of the same
+ * transaction succeeds whichever is staged first. Then a mutation is
+ * skipped if a mutation staged after it replaces the same value or one of
+ * its ancestors, so the result is the same as applying the mutations in
+ * staging order.
+ *
+ * Unlike the reader's Set* functions, a Set* whose parent is missing fails
+ * the whole commit, which then leaves the document unchanged. After a
+ * successful commit, RollBack() restores the document from an undo log of
+ * the replaced values, without copying them.
+ */
+template <typename DOC, typename OBJ, typename VAL>
+class GenericConfigReader<DOC, OBJ, VAL>::Transaction {
+ public:
+  explicit Transaction(
+      GenericConfigReader* reader
+  ) : reader_(reader) {
+  }
+
+  // The staged keys refer to names owned by the transaction.
+  Transaction(const Transaction&) = delete;
+  Transaction(Transaction&&) = default;
+
+  Transaction& operator=(const Transaction&) = delete;
+  Transaction& operator=(Transaction&&) = default;
+
+  template <typename ...Args>
+  void SetValue(
+      JsonValue value,
+      const Args&... keys
+  ) {
+    static_assert(
+        sizeof...(keys) >= 1,
+        "Number of keys must be greater than 1."
+    );
+
+    this->StageByKeys(false, std::move(value), { ToJsonKey(keys)... });
+  }
+
+  template <typename ...Args>
+  void SetDeepValue(
+      JsonValue value,
+      const Args&... keys
+  ) {
+    static_assert(
+        sizeof...(keys) >= 1,
+        "Number of keys must be greater than 1."
+    );
+
+    this->StageByKeys(true, std::move(value), { ToJsonKey(keys)... });
+  }
+
+  template <typename ...Args>
+  void SetBool(
+      bool value,
+      const Args&... keys
+  ) {
+    this->SetValue(JsonValue(value), keys...);
+  }
+
+  template <typename ...Args>
+  void SetDeepBool(
+      bool value,
+      const Args&... keys
+  ) {
+    this->SetDeepValue(JsonValue(value), keys...);
+  }
+
+  template <typename T, typename ...Args>
+  void SetNumber(
+      T value,
+      const Args&... keys
+  ) {
+    this->SetValue(MakeNumberValue(value), keys...);
+  }
+
+  template <typename T, typename ...Args>
+  void SetDeepNumber(
+      T value,
+      const Args&... keys
+  ) {
+    this->SetDeepValue(MakeNumberValue(value), keys...);
+  }
+
+  template <typename ...Args>
+  void SetString(
+      std::string_view value,
+      const Args&... keys
+  ) {
+    this->SetValue(
+        MakeStringValue(value, &this->reader_->json_document_),
+        keys...
+    );
+  }
+
+  template <typename ...Args>
+  void SetDeepString(
+      std::string_view value,
+      const Args&... keys
+  ) {
+    this->SetDeepValue(
+        MakeStringValue(value, &this->reader_->json_document_),
+        keys...
+    );
+  }
+
+  /**
+   * Applies the staged mutations. If any of them fails, then the mutations
+   * already applied are rolled back and false is returned. Either way, the
+   * staged mutations are discarded.
+   */
+  bool Commit();
+
+  /**
+   * Commits like Commit(), then writes the config file. If the write fails,
+   * then the commit is rolled back and false is returned.
+   */
+  bool CommitAndWrite(
+      int indent_width
+  );
+
+  /**
+   * Discards the staged mutations, and restores the document to its state
+   * before the last commit. Returns false, without restoring anything, if
+   * the document was mutated outside of the transaction since the commit.
+   */
+  bool RollBack();
+
+ private:
+  struct StagedMutation {
+    bool is_deep;
+    std::vector<JsonKey> keys;
+    JsonValue value;
+  };
+
+  GenericConfigReader* reader_;
+  std::vector<StagedMutation> staged_mutations_;
+
+  // Owns the names of the staged keys, which may refer to temporaries.
+  std::deque<std::string> key_names_;
+
+  std::vector<UndoEntry> undo_log_;
+  std::vector<std::string> committed_key_paths_;
+  std::uint64_t committed_generation_ = 0;
+
+  void StageByKeys(
+      bool is_deep,
+      JsonValue value,
+      std::initializer_list<JsonKey> keys
+  );
+
+  bool ApplyMutations(
+      const std::vector<StagedMutation*>& sorted_mutations,
+      const std::vector<StagedMutation*>& mutations
+  );
+
+  bool ApplyMutationPass(
+      const std::vector<StagedMutation*>& mutations,
+      bool is_creating_parents
+  );
+
+  static int CompareKeys(
+      const JsonKey& key,
+      const JsonKey& other_key
+  );
+
+  static int CompareKeyPaths(
+      const std::vector<JsonKey>& keys,
+      const std::vector<JsonKey>& other_keys
+  );
+
+  static bool IsKeyPathPrefix(
+      const std::vector<JsonKey>& prefix_keys,
+      const std::vector<JsonKey>& keys
+  );
+};
+
+/* Functions for Generic Types */
+
+// The key walks are done by the non-template *ByKeys functions, so that
+// each distinct key pack only instantiates a thin wrapper.
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::ContainsKey(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  // Overrides are only looked up if there are any.
+  if (const JsonValue* override_value_ptr;
+      !this->overrides_.empty()
+          && this->FindOverrideByKeys({ ToJsonKey(keys)... }, &override_value_ptr)) {
+    return override_value_ptr != nullptr;
+  }
+
+  return this->FindDocumentValueByKeys({ ToJsonKey(keys)... }) != nullptr;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+const VAL& GenericConfigReader<DOC, OBJ, VAL>::GetValueRef(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  const JsonValue* value_ptr;
+  if (this->overrides_.empty()
+      || !this->FindOverrideByKeys({ ToJsonKey(keys)... }, &value_ptr)) {
+    value_ptr = this->FindDocumentValueByKeys({ ToJsonKey(keys)... });
+  }
+
+  if (value_ptr == nullptr) {
+    ThrowMissingKeyPath();
+  }
+
+  return *value_ptr;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetValue(
+    JsonValue value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->ThrowIfFrozen();
+
+  if (this->subscriptions_.empty() && !this->IsRecordingChanges()) {
+    if (this->SetValueByKeys(std::move(value), { ToJsonKey(keys)... })) {
+      this->generation_ += 1;
+    }
+
+    return;
+  }
+
+  // Only notify subscribers and record the change if the value actually
+  // changes. The document is compared, since overrides don't change.
+  const JsonValue* old_value_ptr = FindValueByKeys(
+      this->json_document_,
+      { ToJsonKey(keys)... }
+  );
+  bool is_changed = old_value_ptr == nullptr || *old_value_ptr != value;
+
+  // Nothing is stored if the parent of the value is missing.
+  if (!this->SetValueByKeys(std::move(value), { ToJsonKey(keys)... })) {
+    return;
+  }
+
+  this->generation_ += 1;
+
+  if (!is_changed) {
+    return;
+  }
+
+  if (this->IsRecordingChanges()) {
+    this->RecordChange({ ToJsonKey(keys)... });
+  }
+
+  if (!this->subscriptions_.empty()) {
+    this->NotifySubscribers({ MakeJsonPointer(keys...) });
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepValue(
+    JsonValue value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->ThrowIfFrozen();
+
+  if (this->subscriptions_.empty() && !this->IsRecordingChanges()) {
+    if (this->SetDeepValueByKeys(std::move(value), { ToJsonKey(keys)... })) {
+      this->generation_ += 1;
+    }
+
+    return;
+  }
+
+  // Only notify subscribers and record the change if the value actually
+  // changes. The document is compared, since overrides don't change.
+  const JsonValue* old_value_ptr = FindValueByKeys(
+      this->json_document_,
+      { ToJsonKey(keys)... }
+  );
+  bool is_changed = old_value_ptr == nullptr || *old_value_ptr != value;
+
+  // Nothing is stored if an index is out of bounds.
+  if (!this->SetDeepValueByKeys(std::move(value), { ToJsonKey(keys)... })) {
+    return;
+  }
+
+  this->generation_ += 1;
+
+  if (!is_changed) {
+    return;
+  }
+
+  if (this->IsRecordingChanges()) {
+    this->RecordChange({ ToJsonKey(keys)... });
+  }
+
+  if (!this->subscriptions_.empty()) {
+    this->NotifySubscribers({ MakeJsonPointer(keys...) });
+  }
+}
+
+/* Functions for Numbers */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+T GenericConfigReader<DOC, OBJ, VAL>::GetNumber(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  static_assert(
+      std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+      "T must be a number type."
+  );
+
+  // Forward aliased widths, such as long and std::int64_t, to a single
+  // instantiation.
+  using CanonicalType = typename CanonicalNumber<T>::type;
+
+  if constexpr (!std::is_same<T, CanonicalType>::value) {
+    return static_cast<T>(
+        this->template GetNumber<CanonicalType>(keys...)
+    );
+  } else {
+    // A frozen document has numbers inline, unless an override applies.
+    T number;
+    bool is_converted;
+    if (this->is_frozen() && this->overrides_.empty()) {
+      const typename JsonFrozenIndex<VAL>::Node* node_ptr =
+          this->LocalFrozenIndex().FindByKeys({ ToJsonKey(keys)... });
+      if (node_ptr == nullptr) {
+        ThrowMissingKeyPath();
+      }
+
+      is_converted = JsonFrozenIndex<VAL>::ToNumber(*node_ptr, &number);
+    } else {
+      is_converted = ToNumber(this->GetValueRef(keys...), &number);
+    }
+
+    if (!is_converted) {
+      throw std::out_of_range(
+          "The value is not a number representable by the requested type."
+      );
+    }
+
+    return number;
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+T GenericConfigReader<DOC, OBJ, VAL>::GetNumberOrDefault(
+    T default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  static_assert(
+      std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+      "T must be a number type."
+  );
+
+  using CanonicalType = typename CanonicalNumber<T>::type;
+
+  if constexpr (!std::is_same<T, CanonicalType>::value) {
+    return static_cast<T>(
+        this->template GetNumberOrDefault<CanonicalType>(
+            static_cast<CanonicalType>(default_value),
+            keys...
+        )
+    );
+  } else {
+    if (!this->ContainsKey(keys...)) {
+      return default_value;
+    }
+
+    T number;
+    if (!ToNumber(this->GetValueRef(keys...), &number)) {
+      return default_value;
+    }
+
+    return number;
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasNumber(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  static_assert(
+      std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+      "T must be a number type."
+  );
+
+  using CanonicalType = typename CanonicalNumber<T>::type;
+
+  if constexpr (!std::is_same<T, CanonicalType>::value) {
+    return this->template HasNumber<CanonicalType>(keys...);
+  } else {
+    if (!this->ContainsKey(keys...)) {
+      return false;
+    }
+
+    T number;
+    return ToNumber(this->GetValueRef(keys...), &number);
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetNumber(
+    T value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetValue(
+      MakeNumberValue(value),
+      keys...
+  );
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepNumber(
+    T value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepValue(
+      MakeNumberValue(value),
+      keys...
+  );
+}
+
+/* Functions for double */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+double GenericConfigReader<DOC, OBJ, VAL>::GetDouble(
+    const Args&... keys
+) const {
+  return this->template GetNumber<double>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+double GenericConfigReader<DOC, OBJ, VAL>::GetDoubleOrDefault(
+    double default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<double>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasDouble(
+    const Args&... keys
+) const {
+  return this->template HasNumber<double>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDouble(
+    double value,
+    const Args&... keys
+) {
+  this->template SetNumber<double>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepDouble(
+    double value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<double>(value, keys...);
+}
+
+/* Functions for float */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+float GenericConfigReader<DOC, OBJ, VAL>::GetFloat(
+    const Args&... keys
+) const {
+  return this->template GetNumber<float>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+float GenericConfigReader<DOC, OBJ, VAL>::GetFloatOrDefault(
+    float default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<float>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasFloat(
+    const Args&... keys
+) const {
+  return this->template HasNumber<float>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetFloat(
+    float value,
+    const Args&... keys
+) {
+  this->template SetNumber<float>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepFloat(
+    float value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<float>(value, keys...);
+}
+
+/* Functions for int */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+int GenericConfigReader<DOC, OBJ, VAL>::GetInt(
+    const Args&... keys
+) const {
+  return this->template GetNumber<int>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+int GenericConfigReader<DOC, OBJ, VAL>::GetIntOrDefault(
+    int default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<int>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasInt(
+    const Args&... keys
+) const {
+  return this->template HasNumber<int>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetInt(
+    int value,
+    const Args&... keys
+) {
+  this->template SetNumber<int>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepInt(
+    int value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<int>(value, keys...);
+}
+
+/* Functions for std::int32_t */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::int32_t GenericConfigReader<DOC, OBJ, VAL>::GetInt32(
+    const Args&... keys
+) const {
+  return this->template GetNumber<std::int32_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::int32_t GenericConfigReader<DOC, OBJ, VAL>::GetInt32OrDefault(
+    std::int32_t default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<std::int32_t>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasInt32(
+    const Args&... keys
+) const {
+  return this->template HasNumber<std::int32_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetInt32(
+    std::int32_t value,
+    const Args&... keys
+) {
+  this->template SetNumber<std::int32_t>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepInt32(
+    std::int32_t value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<std::int32_t>(value, keys...);
+}
+
+/* Functions for std::int64_t */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::int64_t GenericConfigReader<DOC, OBJ, VAL>::GetInt64(
+    const Args&... keys
+) const {
+  return this->template GetNumber<std::int64_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::int64_t GenericConfigReader<DOC, OBJ, VAL>::GetInt64OrDefault(
+    std::int64_t default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<std::int64_t>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasInt64(
+    const Args&... keys
+) const {
+  return this->template HasNumber<std::int64_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetInt64(
+    std::int64_t value,
+    const Args&... keys
+) {
+  this->template SetNumber<std::int64_t>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepInt64(
+    std::int64_t value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<std::int64_t>(value, keys...);
+}
+
+/* Functions for long */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+long GenericConfigReader<DOC, OBJ, VAL>::GetLong(
+    const Args&... keys
+) const {
+  return this->template GetNumber<long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+long GenericConfigReader<DOC, OBJ, VAL>::GetLongOrDefault(
+    long default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<long>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasLong(
+    const Args&... keys
+) const {
+  return this->template HasNumber<long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetLong(
+    long value,
+    const Args&... keys
+) {
+  this->template SetNumber<long>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepLong(
+    long value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<long>(value, keys...);
+}
+
+/* Functions for long long */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+long long GenericConfigReader<DOC, OBJ, VAL>::GetLongLong(
+    const Args&... keys
+) const {
+  return this->template GetNumber<long long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+long long GenericConfigReader<DOC, OBJ, VAL>::GetLongLongOrDefault(
+    long long default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<long long>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasLongLong(
+    const Args&... keys
+) const {
+  return this->template HasNumber<long long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetLongLong(
+    long long value,
+    const Args&... keys
+) {
+  this->template SetNumber<long long>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepLongLong(
+    long long value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<long long>(value, keys...);
+}
+
+/* Functions for unsigned int */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+unsigned int GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedInt(
+    const Args&... keys
+) const {
+  return this->template GetNumber<unsigned int>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+unsigned int GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedIntOrDefault(
+    unsigned int default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<unsigned int>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasUnsignedInt(
+    const Args&... keys
+) const {
+  return this->template HasNumber<unsigned int>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetUnsignedInt(
+    unsigned int value,
+    const Args&... keys
+) {
+  this->template SetNumber<unsigned int>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepUnsignedInt(
+    unsigned int value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<unsigned int>(value, keys...);
+}
+
+/* Functions for std::uint32_t */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::uint32_t GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedInt32(
+    const Args&... keys
+) const {
+  return this->template GetNumber<std::uint32_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::uint32_t GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedInt32OrDefault(
+    std::uint32_t default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<std::uint32_t>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasUnsignedInt32(
+    const Args&... keys
+) const {
+  return this->template HasNumber<std::uint32_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetUnsignedInt32(
+    std::uint32_t value,
+    const Args&... keys
+) {
+  this->template SetNumber<std::uint32_t>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepUnsignedInt32(
+    std::uint32_t value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<std::uint32_t>(value, keys...);
+}
+
+/* Functions for std::uint64_t */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::uint64_t GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedInt64(
+    const Args&... keys
+) const {
+  return this->template GetNumber<std::uint64_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+std::uint64_t GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedInt64OrDefault(
+    std::uint64_t default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<std::uint64_t>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasUnsignedInt64(
+    const Args&... keys
+) const {
+  return this->template HasNumber<std::uint64_t>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetUnsignedInt64(
+    std::uint64_t value,
+    const Args&... keys
+) {
+  this->template SetNumber<std::uint64_t>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepUnsignedInt64(
+    std::uint64_t value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<std::uint64_t>(value, keys...);
+}
+
+/* Functions for unsigned long */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+unsigned long GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedLong(
+    const Args&... keys
+) const {
+  return this->template GetNumber<unsigned long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+unsigned long GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedLongOrDefault(
+    unsigned long default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<unsigned long>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasUnsignedLong(
+    const Args&... keys
+) const {
+  return this->template HasNumber<unsigned long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetUnsignedLong(
+    unsigned long value,
+    const Args&... keys
+) {
+  this->template SetNumber<unsigned long>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepUnsignedLong(
+    unsigned long value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<unsigned long>(value, keys...);
+}
+
+/* Functions for unsigned long long */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+unsigned long long GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedLongLong(
+    const Args&... keys
+) const {
+  return this->template GetNumber<unsigned long long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+unsigned long long GenericConfigReader<DOC, OBJ, VAL>::GetUnsignedLongLongOrDefault(
+    unsigned long long default_value,
+    const Args&... keys
+) const {
+  return this->template GetNumberOrDefault<unsigned long long>(default_value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+bool GenericConfigReader<DOC, OBJ, VAL>::HasUnsignedLongLong(
+    const Args&... keys
+) const {
+  return this->template HasNumber<unsigned long long>(keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetUnsignedLongLong(
+    unsigned long long value,
+    const Args&... keys
+) {
+  this->template SetNumber<unsigned long long>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetDeepUnsignedLongLong(
+    unsigned long long value,
+    const Args&... keys
+) {
+  this->template SetDeepNumber<unsigned long long>(value, keys...);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::Reset(
+    std::filesystem::path config_file_path
+) {
+  this->config_file_path_ = std::move(config_file_path);
+
+  // The document may refer to memory of the retained documents, so it is
+  // cleared first.
+  ClearDocument(&this->json_document_);
+  this->ReleaseDocuments(&this->retained_documents_);
+
+  this->overrides_.clear();
+  ClearDocument(&this->override_document_);
+
+  this->full_precision_parse_ = false;
+  this->compression_dictionary_.clear();
+  this->file_format_ = JsonFileFormatFromExtension(this->config_file_path_);
+  this->DisableJournal();
+  this->set_preserve_format(false);
+  this->pending_subscriptions_.clear();
+  if (this->notification_depth_ == 0) {
+    this->subscriptions_.clear();
+  } else {
+    for (Subscription& subscription : this->subscriptions_) {
+      subscription.id = kRemovedSubscriptionId;
+    }
+  }
+  this->next_subscription_id_ = 1;
+  this->generation_ += 1;
+  {
+    std::lock_guard lock(this->subtree_hash_cache_mutex_);
+    this->subtree_hash_cache_.reset();
+  }
+  this->ClearConversionCache();
+  this->numa_replication_ = false;
+  this->Thaw();
+}
+
+/* Read and Write */
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::ReadParallel(
+    std::size_t thread_count
+) {
+  if (!this->CreateConfigFileIfMissing()) {
+    return false;
+  }
+
+  std::error_code error_code;
+  std::uintmax_t config_file_size = std::filesystem::file_size(
+      this->config_file_path(),
+      error_code
+  );
+
+  if (error_code) {
+    return false;
+  }
+
+  // Taken before the file is read, so that a change while it is read makes
+  // the next format-preserving write a full one.
+  std::filesystem::file_time_type config_file_time =
+      std::filesystem::last_write_time(this->config_file_path(), error_code);
+
+  if (error_code) {
+    return false;
+  }
+
+  std::deque<JsonDocument> parsed_documents;
+  this->AcquireDocuments(1, &parsed_documents);
+
+  std::string source_text;
+
+  // Compressed files can't be split before they are decompressed, and
+  // binary files have no top-level commas.
+  if (thread_count <= 1
+      || config_file_size < kMinParallelReadSize
+      || this->file_format() != JsonFileFormat::kText
+      || this->DetectConfigFileCompression() != JsonCompression::kNone) {
+    bool is_parsed = this->preserve_format()
+        ? this->ParseSourceFile(
+            this->config_file_path(),
+            &source_text,
+            &parsed_documents.front()
+        )
+        : this->ParseConfigFile(this->config_file_path(), &parsed_documents.front());
+
+    if (!is_parsed) {
+      return false;
+    }
+
+    this->KeepSourceText(&source_text, config_file_time);
+    this->CommitParsedDocuments(&parsed_documents);
+
+    return true;
+  }
+
+  std::string config_text(static_cast<std::size_t>(config_file_size), '\0');
+  if (std::ifstream config_stream(this->config_file_path(), std::ios::binary);
+      config_stream) {
+    config_stream.read(config_text.data(), config_text.size());
+
+    if (!config_stream) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  // Find the top-level commas without parsing. If the structure can't be
+  // scanned, then the serial parser reports the error.
+  JsonTopLevelScan scan;
+  std::vector<std::size_t> split_offsets;
+  if (ScanJsonTopLevel(config_text, &scan)) {
+    split_offsets = SelectJsonSplitOffsets(scan, thread_count);
+  }
+
+  if (split_offsets.empty()) {
+    if (!this->ParseConfigText(config_text, &parsed_documents.front())) {
+      return false;
+    }
+
+    if (this->preserve_format()) {
+      source_text.swap(config_text);
+    }
+
+    this->KeepSourceText(&source_text, config_file_time);
+    this->CommitParsedDocuments(&parsed_documents);
+
+    return true;
+  }
+
+  // Each chunk is wrapped in the root's brackets and parsed into its own
+  // document, with its own allocator. The chunks are read from config_text
+  // in place, so that the text isn't held twice.
+  std::size_t chunk_count = split_offsets.size() + 1;
+  this->AcquireDocuments(chunk_count, &parsed_documents);
+
+  char close_bracket = (scan.open_bracket == '{') ? '}' : ']';
+
+  std::vector<std::future<bool>> futures;
+  for (std::size_t i = 0; i < chunk_count; i += 1) {
+    std::size_t chunk_begin = (i == 0)
+        ? scan.open_offset + 1
+        : split_offsets[i - 1] + 1;
+    std::size_t chunk_end = (i == chunk_count - 1)
+        ? scan.close_offset
+        : split_offsets[i];
+
+    futures.push_back(std::async(
+        std::launch::async,
+        [this, &config_text, &parsed_documents, &scan, close_bracket,
+            chunk_begin, chunk_end, i]() {
+          std::string_view chunk(
+              config_text.data() + chunk_begin,
+              chunk_end - chunk_begin
+          );
+
+          // Reject empty chunks, which would hide a stray comma.
+          if (std::all_of(chunk.cbegin(), chunk.cend(), IsJsonWhitespace)) {
+            return false;
+          }
+
+          // A document creates its parse stack when it is first parsed.
+          JsonMemoryResourceScope memory_resource_scope(this->memory_resource_);
+
+          JsonChunkStreamBuf chunk_stream_buf(chunk, scan.open_bracket, close_bracket);
+          std::istream chunk_stream(&chunk_stream_buf);
+
+          return this->ParseConfigStream(chunk_stream, &parsed_documents[i]);
+        }
+    ));
+  }
+
+  bool is_parsed = true;
+  for (std::future<bool>& future : futures) {
+    is_parsed = future.get() && is_parsed;
+  }
+
+  if (!is_parsed) {
+    return false;
+  }
+
+  for (std::size_t i = 1; i < chunk_count; i += 1) {
+    AppendParsedChunk(&parsed_documents.front(), &parsed_documents[i]);
+  }
+
+  if (this->preserve_format()) {
+    source_text.swap(config_text);
+  }
+
+  this->KeepSourceText(&source_text, config_file_time);
+  this->CommitParsedDocuments(&parsed_documents);
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::WriteParallel(
+    int indent_width,
+    std::size_t thread_count
+) {
+  bool is_text = (this->file_format() == JsonFileFormat::kText);
+
+  // The config file is the base that a journal applies to, so while there
+  // is a journal, the file is replaced as a whole rather than patched in
+  // place, which a crash could leave half done.
+  if (is_text
+      && !this->source_text_.empty()
+      && !std::filesystem::exists(this->journal_file_path())
+      && this->WriteEditedSpans(indent_width)) {
+    return this->RemoveJournal();
+  }
+
+  if (is_text) {
+    this->SerializeDocument(indent_width, thread_count);
+  } else {
+    this->write_buffers_.resize(1);
+    this->write_buffers_.front().clear();
+
+    JsonBinaryWriter binary_writer(&this->write_buffers_.front(), this->file_format());
+    EncodeValue(&binary_writer, this->json_document_);
+  }
+
+  // Write to the config file any new default values.
+  if (!this->WriteConfigFile(this->write_buffers_)) {
+    return false;
+  }
+
+  if (this->preserve_format()) {
+    this->source_text_.clear();
+
+    // Only JSON text is patched by the next write.
+    std::error_code error_code;
+    this->source_file_time_ = std::filesystem::last_write_time(
+        this->config_file_path(),
+        error_code
+    );
+
+    if (is_text && !error_code) {
+      for (const std::string& write_buffer : this->write_buffers_) {
+        this->source_text_.append(write_buffer);
+      }
+    }
+
+    this->edited_key_paths_.clear();
+  }
+
+  // The config file now has every journaled change.
+  return this->RemoveJournal();
+}
+
+/* Functions for Subscriptions */
+
+template <typename DOC, typename OBJ, typename VAL>
+std::size_t GenericConfigReader<DOC, OBJ, VAL>::Subscribe(
+    std::string key_path_prefix,
+    ChangeCallback callback
+) {
+  std::size_t subscription_id = this->next_subscription_id_;
+  this->next_subscription_id_ += 1;
+
+  std::vector<Subscription>& subscriptions = (this->notification_depth_ == 0)
+      ? this->subscriptions_
+      : this->pending_subscriptions_;
+
+  subscriptions.push_back(Subscription{
+      subscription_id,
+      std::move(key_path_prefix),
+      std::move(callback)
+  });
+
+  return subscription_id;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::Unsubscribe(
+    std::size_t subscription_id
+) {
+  if (subscription_id == kRemovedSubscriptionId) {
+    return;
+  }
+
+  for (typename std::vector<Subscription>::iterator it = this->subscriptions_.begin();
+      it != this->subscriptions_.end();
+      it++) {
+    if (it->id == subscription_id) {
+      if (this->notification_depth_ == 0) {
+        this->subscriptions_.erase(it);
+      } else {
+        it->id = kRemovedSubscriptionId;
+      }
+
+      return;
+    }
+  }
+
+  for (typename std::vector<Subscription>::iterator it = this->pending_subscriptions_.begin();
+      it != this->pending_subscriptions_.end();
+      it++) {
+    if (it->id == subscription_id) {
+      this->pending_subscriptions_.erase(it);
+      return;
+    }
+  }
+}
+
+/* Functions for Queries */
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::Query(
+    const JsonQuery& query,
+    std::vector<const VAL*>* results
+) const {
+  QueryRecursive(
+      this->json_document_,
+      query,
+      0,
+      std::numeric_limits<std::size_t>::max(),
+      results
+  );
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+const VAL* GenericConfigReader<DOC, OBJ, VAL>::QueryFirst(
+    const JsonQuery& query
+) const {
+  std::vector<const JsonValue*> results;
+  QueryRecursive(this->json_document_, query, 0, 1, &results);
+
+  return results.empty() ? nullptr : results.front();
+}
+
+/* Functions for Overrides */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetOverride(
+    const VAL& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetOverrideByKeys(
+      CopyValue(value, &this->override_document_),
+      { ToJsonKey(keys)... }
+  );
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::SetOverrideText(
+    std::string_view text,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  JsonDocument document = this->MakeDocument();
+  if (this->ParseConfigText(text, &document)) {
+    this->SetOverrideByKeys(
+        CopyValue(document, &this->override_document_),
+        { ToJsonKey(keys)... }
+    );
+  } else {
+    this->SetOverrideByKeys(
+        MakeStringValue(text, &this->override_document_),
+        { ToJsonKey(keys)... }
+    );
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename ...Args>
+void GenericConfigReader<DOC, OBJ, VAL>::RemoveOverride(
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  std::string key_path = MakeJsonPointer(keys...);
+  if (this->overrides_.erase(key_path) == 0) {
+    return;
+  }
+
+  this->generation_ += 1;
+  this->NotifySubscribers({ key_path });
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ClearOverrides() {
+  if (this->overrides_.empty()) {
+    return;
+  }
+
+  std::vector<std::string> changed_key_paths;
+  changed_key_paths.reserve(this->overrides_.size());
+  for (const auto& [key_path, value] : this->overrides_) {
+    changed_key_paths.push_back(key_path);
+  }
+
+  this->overrides_.clear();
+  ClearDocument(&this->override_document_);
+  this->generation_ += 1;
+
+  this->NotifySubscribers(changed_key_paths);
+}
+
+/* Functions for Transactions */
+
+template <typename DOC, typename OBJ, typename VAL>
+typename GenericConfigReader<DOC, OBJ, VAL>::Transaction
+GenericConfigReader<DOC, OBJ, VAL>::BeginTransaction() {
+  return Transaction(this);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::Transaction::StageByKeys(
+    bool is_deep,
+    VAL value,
+    std::initializer_list<JsonKey> keys
+) {
+  StagedMutation staged_mutation = { is_deep, {}, std::move(value) };
+  staged_mutation.keys.reserve(keys.size());
+
+  for (const JsonKey& key : keys) {
+    if (key.is_index()) {
+      staged_mutation.keys.push_back(key);
+    } else {
+      const std::string& name = this->key_names_.emplace_back(key.view());
+      staged_mutation.keys.push_back(JsonKey(std::string_view(name)));
+    }
+  }
+
+  this->staged_mutations_.push_back(std::move(staged_mutation));
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+int GenericConfigReader<DOC, OBJ, VAL>::Transaction::CompareKeys(
+    const JsonKey& key,
+    const JsonKey& other_key
+) {
+  // Indices are ordered before names.
+  if (key.is_index() != other_key.is_index()) {
+    return key.is_index() ? -1 : 1;
+  }
+
+  if (key.is_index()) {
+    return (key.index() < other_key.index())
+        ? -1
+        : (key.index() > other_key.index()) ? 1 : 0;
+  }
+
+  return key.view().compare(other_key.view());
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+int GenericConfigReader<DOC, OBJ, VAL>::Transaction::CompareKeyPaths(
+    const std::vector<JsonKey>& keys,
+    const std::vector<JsonKey>& other_keys
+) {
+  std::size_t shared_size = std::min(keys.size(), other_keys.size());
+
+  for (std::size_t i = 0; i < shared_size; i += 1) {
+    int comparison = CompareKeys(keys[i], other_keys[i]);
+    if (comparison != 0) {
+      return comparison;
+    }
+  }
+
+  // A key path is ordered before its extensions.
+  return (keys.size() < other_keys.size())
+      ? -1
+      : (keys.size() > other_keys.size()) ? 1 : 0;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::Transaction::Commit() {
+  this->reader_->ThrowIfFrozen();
+
+  this->undo_log_.clear();
+  this->committed_key_paths_.clear();
+
+  // Sort by key path, keeping the staging order of equal key paths.
+  std::vector<StagedMutation*> sorted_mutations;
+  sorted_mutations.reserve(this->staged_mutations_.size());
+  for (StagedMutation& staged_mutation : this->staged_mutations_) {
+    sorted_mutations.push_back(&staged_mutation);
+  }
+
+  std::stable_sort(
+      sorted_mutations.begin(),
+      sorted_mutations.end(),
+      [](StagedMutation* mutation, StagedMutation* other_mutation) {
+        return CompareKeyPaths(mutation->keys, other_mutation->keys) < 0;
+      }
+  );
+
+  // Drop the mutations that a later staged mutation of the same key path or
+  // of an ancestor replaces. Ancestors are sorted first, so a stack of the
+  // kept ancestors of the current key path is maintained. Staging positions
+  // are compared by address, since the staged mutations are stored in
+  // staging order.
+  std::vector<StagedMutation*> mutations;
+  std::vector<StagedMutation*> ancestors;
+
+  for (std::size_t i = 0; i < sorted_mutations.size(); i += 1) {
+    StagedMutation* mutation = sorted_mutations[i];
+
+    if (i + 1 < sorted_mutations.size()
+        && CompareKeyPaths(mutation->keys, sorted_mutations[i + 1]->keys) == 0) {
+      continue;
+    }
+
+    while (!ancestors.empty()
+        && !IsKeyPathPrefix(ancestors.back()->keys, mutation->keys)) {
+      ancestors.pop_back();
+    }
+
+    // Kept ancestors are staged in increasing order down the stack.
+    if (!ancestors.empty() && ancestors.back() > mutation) {
+      continue;
+    }
+
+    mutations.push_back(mutation);
+    ancestors.push_back(mutation);
+  }
+
+  this->reader_->generation_ += 1;
+
+  bool is_applied = this->ApplyMutations(sorted_mutations, mutations);
+
+  if (is_applied && this->reader_->IsRecordingChanges()) {
+    for (StagedMutation* mutation : mutations) {
+      this->reader_->RecordChange(mutation->keys);
+    }
+  }
+
+  if (is_applied
+      && (!this->reader_->subscriptions_.empty()
+          || this->reader_->IsRecordingChanges())) {
+    for (StagedMutation* mutation : mutations) {
+      std::string key_path;
+      for (const JsonKey& key : mutation->keys) {
+        AppendJsonPointerToken(&key_path, key);
+      }
+
+      this->committed_key_paths_.push_back(std::move(key_path));
+    }
+  }
+
+  this->staged_mutations_.clear();
+  this->key_names_.clear();
+
+  if (!is_applied) {
+    this->reader_->RollBack(&this->undo_log_);
+    this->undo_log_.clear();
+    return false;
+  }
+
+  this->committed_generation_ = this->reader_->generation_;
+  this->reader_->NotifySubscribers(this->committed_key_paths_);
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::Transaction::IsKeyPathPrefix(
+    const std::vector<JsonKey>& prefix_keys,
+    const std::vector<JsonKey>& keys
+) {
+  return prefix_keys.size() < keys.size()
+      && std::equal(
+          prefix_keys.cbegin(),
+          prefix_keys.cend(),
+          keys.cbegin(),
+          [](const JsonKey& key, const JsonKey& other_key) {
+            return CompareKeys(key, other_key) == 0;
+          }
+      );
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::Transaction::ApplyMutations(
+    const std::vector<StagedMutation*>& sorted_mutations,
+    const std::vector<StagedMutation*>& mutations
+) {
+  // The parents of the SetDeep* mutations are created in a first pass, so
+  // that a Set* below one of them finds its parent even if it is sorted
+  // before the SetDeep*. The pass includes the dropped SetDeep* mutations,
+  // whose parents a later mutation of the same value or of a descendant of
+  // one of those parents may rely on. The second pass applies the kept
+  // mutations.
+  return this->ApplyMutationPass(sorted_mutations, true)
+      && this->ApplyMutationPass(mutations, false);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::Transaction::ApplyMutationPass(
+    const std::vector<StagedMutation*>& mutations,
+    bool is_creating_parents
+) {
+  // The values along the key path of the previous mutation, from the root
+  // down to its parent. The next mutation starts from the deepest of them
+  // that its key path shares. Values are only added below that one, so the
+  // pointers to it and its ancestors stay valid.
+  std::vector<JsonValue*> path_values = { &this->reader_->json_document_ };
+  std::vector<std::string> reference_tokens;
+  const StagedMutation* previous_mutation = nullptr;
+
+  for (StagedMutation* mutation : mutations) {
+    if (is_creating_parents && !mutation->is_deep) {
+      continue;
+    }
+
+    std::size_t shared_size = 0;
+    if (previous_mutation != nullptr) {
+      while (shared_size < previous_mutation->keys.size()
+          && shared_size < mutation->keys.size()
+          && CompareKeys(
+              previous_mutation->keys[shared_size],
+              mutation->keys[shared_size]
+          ) == 0) {
+        shared_size += 1;
+      }
+    }
+
+    std::size_t depth = std::min(shared_size, path_values.size() - 1);
+    path_values.resize(depth + 1);
+
+    reference_tokens.clear();
+    for (const JsonKey& key : mutation->keys) {
+      reference_tokens.push_back(
+          key.is_index() ? std::to_string(key.index()) : std::string(key.view())
+      );
+    }
+
+    std::size_t last_depth = mutation->keys.size() - 1;
+
+    for (; depth < last_depth; depth += 1) {
+      // Only SetDeep* creates the values on the way to the destination.
+      JsonValue* child_ptr = mutation->is_deep
+          ? this->reader_->FindOrAddValue(
+              *path_values.back(),
+              mutation->keys[depth],
+              true,
+              reference_tokens,
+              depth + 1,
+              &this->undo_log_
+          )
+          : FindValue(*path_values.back(), mutation->keys[depth]);
+
+      if (child_ptr == nullptr) {
+        return false;
+      }
+
+      path_values.push_back(child_ptr);
+    }
+
+    previous_mutation = mutation;
+
+    // Adding the destination also turns its parent into an object or an
+    // array, so the first pass adds it too and the second pass replaces it.
+    JsonValue* destination_ptr = this->reader_->FindOrAddValue(
+        *path_values.back(),
+        mutation->keys[last_depth],
+        mutation->is_deep,
+        reference_tokens,
+        last_depth + 1,
+        &this->undo_log_
+    );
+
+    if (destination_ptr == nullptr) {
+      return false;
+    }
+
+    if (is_creating_parents) {
+      continue;
+    }
+
+    this->undo_log_.push_back(UndoEntry{
+        UndoEntry::Kind::kReplaced,
+        reference_tokens,
+        0,
+        std::move(*destination_ptr)
+    });
+
+    *destination_ptr = std::move(mutation->value);
+  }
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::Transaction::CommitAndWrite(
+    int indent_width
+) {
+  if (!this->Commit()) {
+    return false;
+  }
+
+  if (!this->reader_->Write(indent_width)) {
+    this->RollBack();
+    return false;
+  }
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::Transaction::RollBack() {
+  this->staged_mutations_.clear();
+  this->key_names_.clear();
+
+  if (this->undo_log_.empty()) {
+    return true;
+  }
+
+  if (this->reader_->generation_ != this->committed_generation_) {
+    this->undo_log_.clear();
+    return false;
+  }
+
+  this->reader_->ThrowIfFrozen();
+
+  this->reader_->RollBack(&this->undo_log_);
+  this->undo_log_.clear();
+  this->reader_->generation_ += 1;
+
+  this->reader_->RecordChanges(this->committed_key_paths_);
+  this->reader_->NotifySubscribers(this->committed_key_paths_);
+  this->committed_key_paths_.clear();
+
+  return true;
+}
+
+/* Functions for Journaling */
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::EnableJournal(
+    int indent_width,
+    std::uintmax_t compaction_threshold
+) {
+  this->is_journal_enabled_ = true;
+  this->journal_indent_width_ = indent_width;
+  this->journal_compaction_threshold_ = compaction_threshold;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::DisableJournal() {
+  this->is_journal_enabled_ = false;
+  this->journal_buffer_.clear();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::FlushJournal() {
+  if (this->journal_buffer_.empty()) {
+    return true;
+  }
+
+  std::filesystem::path journal_file_path = this->journal_file_path();
+  bool is_journal_created = !std::filesystem::exists(journal_file_path);
+
+  if (std::ofstream journal_stream(
+          journal_file_path,
+          std::ios::binary | std::ios::app
+      );
+      journal_stream) {
+    journal_stream.write(this->journal_buffer_.data(), this->journal_buffer_.size());
+    journal_stream.close();
+
+    if (journal_stream.fail()) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  // The records are only committed once they are on storage, along with
+  // the directory entry of a new journal.
+  if (!SyncJsonFile(journal_file_path)
+      || (is_journal_created && !SyncJsonFileDirectory(journal_file_path))) {
+    return false;
+  }
+
+  this->journal_buffer_.clear();
+
+  std::error_code error_code;
+  std::uintmax_t journal_file_size = std::filesystem::file_size(
+      journal_file_path,
+      error_code
+  );
+
+  if (error_code) {
+    return false;
+  }
+
+  if (journal_file_size >= this->journal_compaction_threshold_) {
+    return this->CompactJournal();
+  }
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::CompactJournal() {
+  return this->Write(this->journal_indent_width_);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+std::filesystem::path GenericConfigReader<DOC, OBJ, VAL>::journal_file_path() const {
+  std::filesystem::path journal_file_path = this->config_file_path();
+  journal_file_path += ".journal";
+
+  return journal_file_path;
+}
+
+/* Functions for Cached Conversions */
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+std::shared_ptr<const T> GenericConfigReader<DOC, OBJ, VAL>::GetCached(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  std::string key_path;
+  (AppendJsonPointerToken(&key_path, ToJsonKey(keys)), ...);
+
+  std::type_index type(typeid(T));
+
+  {
+    std::shared_lock lock(this->conversion_cache_mutex_);
+
+    if (this->conversion_cache_generation_ == this->generation_) {
+      auto conversions_it = this->conversion_cache_.find(key_path);
+      if (conversions_it != this->conversion_cache_.cend()) {
+        for (const CachedConversion& conversion : conversions_it->second) {
+          if (conversion.type == type) {
+            return std::static_pointer_cast<const T>(conversion.value);
+          }
+        }
+      }
+    }
+  }
+
+  // Converted outside of the lock, so that a throwing conversion leaves the
+  // cache as it was.
+  std::shared_ptr<const T> value = std::make_shared<const T>(
+      this->template GetConverted<T>(keys...)
+  );
+
+  std::unique_lock lock(this->conversion_cache_mutex_);
+
+  if (this->conversion_cache_generation_ != this->generation_) {
+    this->conversion_cache_.clear();
+    this->conversion_cache_generation_ = this->generation_;
+  }
+
+  std::vector<CachedConversion>& conversions =
+      this->conversion_cache_[std::move(key_path)];
+
+  // Another thread may have converted the same value in the meantime.
+  for (const CachedConversion& conversion : conversions) {
+    if (conversion.type == type) {
+      return std::static_pointer_cast<const T>(conversion.value);
+    }
+  }
+
+  conversions.push_back(CachedConversion{ type, value });
+
+  return value;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ClearConversionCache() {
+  std::unique_lock lock(this->conversion_cache_mutex_);
+  this->conversion_cache_.clear();
+}
+
+/* Functions for Freezing */
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::Freeze() {
+  this->frozen_index_.Clear();
+  FreezeValue(this->json_document_, &this->frozen_index_);
+  this->is_frozen_ = true;
+  this->ReplicateToNumaNodes();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::Thaw() {
+  this->frozen_index_.Clear();
+  this->numa_replicas_.clear();
+  this->is_frozen_ = false;
+}
+
+/* Functions for Memory Accounting */
+
+template <typename DOC, typename OBJ, typename VAL>
+JsonMemoryStats GenericConfigReader<DOC, OBJ, VAL>::MemoryStats() const {
+  JsonMemoryStats memory_stats;
+  memory_stats.document = MeasureSubtree(
+      this->json_document_,
+      0,
+      0,
+      nullptr,
+      nullptr
+  );
+
+  for (const auto& [key_path, value] : this->overrides_) {
+    memory_stats.overrides += MeasureSubtree(
+        value,
+        0,
+        0,
+        nullptr,
+        nullptr
+    );
+  }
+
+  this->MeasureAllocators(&memory_stats);
+
+  std::size_t live_size = memory_stats.document.string_size
+      + memory_stats.document.member_array_size
+      + memory_stats.overrides.string_size
+      + memory_stats.overrides.member_array_size;
+  memory_stats.wasted_size = (memory_stats.used_size > live_size)
+      ? memory_stats.used_size - live_size
+      : 0;
+
+  memory_stats.buffer_size = this->source_text_.capacity()
+      + this->journal_buffer_.capacity();
+  for (const std::string& write_buffer : this->write_buffers_) {
+    memory_stats.buffer_size += write_buffer.capacity();
+  }
+
+  return memory_stats;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+std::map<std::string, JsonSubtreeMemoryStats> GenericConfigReader<DOC, OBJ, VAL>::SubtreeMemoryStats(
+    std::size_t max_depth
+) const {
+  std::map<std::string, JsonSubtreeMemoryStats> subtree_stats;
+  std::string key_path;
+  MeasureSubtree(this->json_document_, 0, max_depth, &key_path, &subtree_stats);
+
+  return subtree_stats;
+}
+
+/* Private Helper Functions */
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ReplicateToNumaNodes() {
+  this->numa_replicas_.clear();
+
+  std::size_t numa_node_count = NumaNodeCount();
+  if (!this->numa_replication_ || numa_node_count <= 1) {
+    return;
+  }
+
+  this->numa_replicas_.resize(numa_node_count);
+
+  std::vector<std::future<void>> futures;
+  for (std::size_t i = 0; i < numa_node_count; i += 1) {
+    futures.push_back(std::async(
+        std::launch::async,
+        [this, i]() {
+          // The pages that this thread touches first, which include those of
+          // the copy, are placed on the preferred node.
+          PreferNumaNode(i);
+
+          JsonMemoryResourceScope memory_resource_scope(this->memory_resource_);
+          std::unique_ptr<NumaReplica> replica = std::make_unique<NumaReplica>();
+
+          static_cast<JsonValue&>(replica->document) = CopyValue(
+              this->json_document_,
+              &replica->document
+          );
+          FreezeValue(replica->document, &replica->frozen_index);
+
+          this->numa_replicas_[i] = std::move(replica);
+        }
+    ));
+  }
+
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+const JsonFrozenIndex<VAL>& GenericConfigReader<DOC, OBJ, VAL>::LocalFrozenIndex() const {
+  if (this->numa_replicas_.empty()) {
+    return this->frozen_index_;
+  }
+
+  std::size_t numa_node = CurrentNumaNode();
+
+  return (numa_node < this->numa_replicas_.size())
+      ? this->numa_replicas_[numa_node]->frozen_index
+      : this->frozen_index_;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+const VAL* GenericConfigReader<DOC, OBJ, VAL>::FindDocumentValueByKeys(
+    std::initializer_list<JsonKey> keys
+) const {
+  if (!this->is_frozen()) {
+    return FindValueByKeys(this->json_document_, keys);
+  }
+
+  const typename JsonFrozenIndex<VAL>::Node* node_ptr =
+      this->LocalFrozenIndex().FindByKeys(keys);
+
+  return (node_ptr == nullptr) ? nullptr : node_ptr->value;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ThrowMissingKeyPath() {
+  throw std::out_of_range("There is no value at the key path.");
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ThrowIfFrozen() const {
+  if (this->is_frozen()) {
+    throw std::logic_error("The document is frozen. Thaw() it to modify it.");
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T, typename ...Args>
+T GenericConfigReader<DOC, OBJ, VAL>::GetConverted(
+    const Args&... keys
+) const {
+  if constexpr (std::is_same<T, bool>::value) {
+    return this->GetBool(keys...);
+  } else if constexpr (std::is_arithmetic<T>::value) {
+    return this->template GetNumber<T>(keys...);
+  } else if constexpr (std::is_same<T, std::string>::value) {
+    return this->GetString(keys...);
+  } else if constexpr (std::is_same<T, std::filesystem::path>::value) {
+    return this->GetPath(keys...);
+  } else if constexpr (IsSpecializationOf<T, std::deque>::value) {
+    return this->template GetDeque<typename T::value_type>(keys...);
+  } else if constexpr (IsSpecializationOf<T, std::set>::value) {
+    return this->template GetSet<typename T::value_type>(keys...);
+  } else if constexpr (IsSpecializationOf<T, std::unordered_set>::value) {
+    return this->template GetUnorderedSet<typename T::value_type>(keys...);
+  } else if constexpr (IsSpecializationOf<T, std::vector>::value) {
+    return this->template GetVector<typename T::value_type>(keys...);
+  } else {
+    static_assert(
+        IsSpecializationOf<T, std::vector>::value,
+        "T must be a type that a Get* function returns."
+    );
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+template <typename T>
+VAL GenericConfigReader<DOC, OBJ, VAL>::MakeNumberValue(
+    T value
+) {
+  static_assert(
+      std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+      "T must be a number type."
+  );
+
+  // Both backends store every number as a double, a std::int64_t or a
+  // std::uint64_t.
+  if constexpr (std::is_same<T, float>::value) {
+    return JsonValue(WidenFloat(value));
+  } else if constexpr (std::is_floating_point<T>::value) {
+    return JsonValue(static_cast<double>(value));
+  } else if constexpr (std::is_signed<T>::value) {
+    return JsonValue(static_cast<std::int64_t>(value));
+  } else {
+    return JsonValue(static_cast<std::uint64_t>(value));
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+DOC GenericConfigReader<DOC, OBJ, VAL>::MakeDocument() const {
+  // Allocators that the document creates pick up the reader's resource.
+  JsonMemoryResourceScope memory_resource_scope(this->memory_resource_);
+
+  return JsonDocument();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::AcquireDocuments(
+    std::size_t document_count,
+    std::deque<JsonDocument>* documents
+) {
+  while (documents->size() < document_count
+      && !this->spare_documents_.empty()) {
+    documents->push_back(std::move(this->spare_documents_.back()));
+    this->spare_documents_.pop_back();
+  }
+
+  JsonMemoryResourceScope memory_resource_scope(this->memory_resource_);
+  documents->resize(std::max(documents->size(), document_count));
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ReleaseDocuments(
+    std::deque<JsonDocument>* documents
+) {
+  for (JsonDocument& document : *documents) {
+    ClearDocument(&document);
+    this->spare_documents_.push_back(std::move(document));
+  }
+
+  documents->clear();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::FindOverrideByKeys(
+    std::initializer_list<JsonKey> keys,
+    const VAL** value_ptr
+) const {
+  // Find the longest overridden prefix of the key path, then look up the
+  // rest of the key path in its value.
+  std::string key_path;
+  const JsonValue* override_value_ptr = nullptr;
+  const JsonKey* remaining_key_ptr = keys.end();
+
+  for (const JsonKey* key_ptr = keys.begin(); key_ptr != keys.end(); key_ptr++) {
+    AppendJsonPointerToken(&key_path, *key_ptr);
+
+    typename std::unordered_map<std::string, JsonValue>::const_iterator it =
+        this->overrides_.find(key_path);
+    if (it != this->overrides_.cend()) {
+      override_value_ptr = &it->second;
+      remaining_key_ptr = key_ptr + 1;
+    }
+  }
+
+  if (override_value_ptr == nullptr) {
+    return false;
+  }
+
+  for (const JsonKey* key_ptr = remaining_key_ptr;
+      key_ptr != keys.end() && override_value_ptr != nullptr;
+      key_ptr++) {
+    override_value_ptr = FindValue(*override_value_ptr, *key_ptr);
+  }
+
+  *value_ptr = override_value_ptr;
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::SetOverrideByKeys(
+    VAL value,
+    std::initializer_list<JsonKey> keys
+) {
+  std::string key_path;
+  for (const JsonKey& key : keys) {
+    AppendJsonPointerToken(&key_path, key);
+  }
+
+  this->overrides_.insert_or_assign(key_path, std::move(value));
+  this->generation_ += 1;
+
+  this->NotifySubscribers({ std::move(key_path) });
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::IsRecordingChanges() const noexcept {
+  return this->is_journal_enabled_ || !this->source_text_.empty();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::RecordChange(
+    const std::vector<JsonKey>& keys
+) {
+  if (this->is_journal_enabled_) {
+    const JsonValue* value_ptr = &this->json_document_;
+    for (const JsonKey& key : keys) {
+      value_ptr = FindValue(*value_ptr, key);
+      if (value_ptr == nullptr) {
+        break;
+      }
+    }
+
+    AppendJournalRecord(&this->journal_buffer_, keys, value_ptr);
+  }
+
+  if (!this->source_text_.empty()) {
+    std::string key_path;
+    for (const JsonKey& key : keys) {
+      AppendJsonPointerToken(&key_path, key);
+    }
+
+    this->edited_key_paths_.push_back(std::move(key_path));
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::RecordChanges(
+    const std::vector<std::string>& key_paths
+) {
+  if (!this->IsRecordingChanges()) {
+    return;
+  }
+
+  std::vector<std::string> reference_tokens;
+  std::vector<JsonKey> keys;
+
+  for (const std::string& key_path : key_paths) {
+    if (!ParseJsonPointer(key_path, &reference_tokens)) {
+      continue;
+    }
+
+    // Patches insert and remove array elements, which shifts the elements
+    // after them, so a change below an array element is recorded as the
+    // whole value that contains the element. A missing member is recorded
+    // as removed.
+    keys.clear();
+    const JsonValue* value_ptr = &this->json_document_;
+
+    for (const std::string& reference_token : reference_tokens) {
+      JsonKey key(reference_token);
+      const JsonValue* child_ptr = FindValue(*value_ptr, key);
+
+      if (child_ptr != nullptr) {
+        keys.push_back(key);
+        value_ptr = child_ptr;
+        continue;
+      }
+
+      std::size_t index;
+      if (reference_token != "-"
+          && !ParseJsonPointerArrayIndex(reference_token, &index)) {
+        keys.push_back(key);
+        value_ptr = nullptr;
+      }
+
+      break;
+    }
+
+    this->RecordChange(keys);
+  }
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::ReplayJournal(
+    std::vector<std::string>* changed_key_paths
+) {
+  std::ifstream journal_stream(this->journal_file_path(), std::ios::binary);
+  if (!journal_stream) {
+    return;
+  }
+
+  std::deque<JsonDocument> record_documents;
+  this->AcquireDocuments(1, &record_documents);
+  JsonDocument& record = record_documents.front();
+
+  std::string record_text;
+  std::vector<JsonKey> keys;
+  std::vector<std::string> reference_tokens;
+  std::vector<UndoEntry> undo_log;
+
+  while (std::getline(journal_stream, record_text)) {
+    // An interrupted append leaves a torn record at the end of the journal,
+    // which is ignored.
+    const JsonValue* value_ptr;
+    ClearDocument(&record);
+    if (!this->ParseConfigText(record_text, &record)
+        || !ReadJournalRecord(record, &keys, &value_ptr)) {
+      break;
+    }
+
+    reference_tokens.clear();
+    for (const JsonKey& key : keys) {
+      reference_tokens.push_back(
+          key.is_index() ? std::to_string(key.index()) : std::string(key.view())
+      );
+    }
+
+    // Values are set like SetDeep*, creating the values on the way.
+    if (value_ptr == nullptr) {
+      this->RemoveAtReferenceTokens(reference_tokens, &undo_log);
+    } else {
+      JsonValue* destination_ptr = &this->json_document_;
+      for (std::size_t i = 0; i < keys.size() && destination_ptr != nullptr; i += 1) {
+        destination_ptr = this->FindOrAddValue(
+            *destination_ptr,
+            keys[i],
+            true,
+            reference_tokens,
+            i + 1,
+            &undo_log
+        );
+      }
+
+      if (destination_ptr != nullptr) {
+        *destination_ptr = CopyValue(*value_ptr, &this->json_document_);
+      }
+    }
+
+    undo_log.clear();
+
+    if (this->subscriptions_.empty() && this->source_text_.empty()) {
+      continue;
+    }
+
+    std::string key_path;
+    for (const JsonKey& key : keys) {
+      AppendJsonPointerToken(&key_path, key);
+    }
+
+    // The replayed changes are not in the text of the config file.
+    if (!this->source_text_.empty()) {
+      this->edited_key_paths_.push_back(key_path);
+    }
+
+    if (!this->subscriptions_.empty()) {
+      changed_key_paths->push_back(std::move(key_path));
+    }
+  }
+
+  this->generation_ += 1;
+
+  ClearDocument(&record);
+  this->ReleaseDocuments(&record_documents);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::RemoveJournal() {
+  this->journal_buffer_.clear();
+
+  std::error_code error_code;
+  std::filesystem::remove(this->journal_file_path(), error_code);
+
+  return !error_code;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::ParseSourceFile(
+    const std::filesystem::path& file_path,
+    std::string* source_text,
+    JsonDocument* document
+) const {
+  std::error_code error_code;
+  std::uintmax_t file_size = std::filesystem::file_size(file_path, error_code);
+
+  if (error_code) {
+    return false;
+  }
+
+  source_text->resize(static_cast<std::size_t>(file_size));
+  if (std::ifstream source_stream(file_path, std::ios::binary);
+      source_stream) {
+    source_stream.read(source_text->data(), source_text->size());
+
+    if (!source_stream) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  // Only JSON text can be patched, so the contents of compressed and binary
+  // files are not kept.
+  if (DetectJsonCompression(*source_text) != JsonCompression::kNone
+      || this->ConfigFileFormat(file_path) != JsonFileFormat::kText) {
+    source_text->clear();
+    return this->ParseConfigFile(file_path, document);
+  }
+
+  return this->ParseConfigText(*source_text, document);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::KeepSourceText(
+    std::string* source_text,
+    std::filesystem::file_time_type source_file_time
+) {
+  this->source_text_.swap(*source_text);
+  this->source_file_time_ = source_file_time;
+  this->edited_key_paths_.clear();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::WriteEditedSpans(
+    int indent_width
+) {
+  struct Splice {
+    JsonSpan span;
+    const JsonValue* value_ptr;
+  };
+
+  // An added or removed value is replaced along with its closest ancestor
+  // that is both in the text and in the document. The root always is.
+  std::vector<Splice> splices;
+  std::vector<std::string> reference_tokens;
+
+  for (const std::string& key_path : this->edited_key_paths_) {
+    if (!ParseJsonPointer(key_path, &reference_tokens)) {
+      return false;
+    }
+
+    std::size_t count = reference_tokens.size();
+
+    while (true) {
+      const JsonValue* value_ptr = ResolveReferenceTokens(
+          this->json_document_,
+          reference_tokens,
+          count
+      );
+
+      JsonSpan span;
+      if (value_ptr != nullptr
+          && FindJsonValueSpan(this->source_text_, reference_tokens, count, &span)) {
+        splices.push_back(Splice{ span, value_ptr });
+        break;
+      }
+
+      if (count == 0) {
+        return false;
+      }
+
+      count -= 1;
+    }
+  }
+
+  // Spans of values are either nested or disjoint, so sorting them by begin
+  // and then by decreasing end puts every span after the spans around it.
+  // Only the outermost spans are replaced.
+  std::sort(
+      splices.begin(),
+      splices.end(),
+      [](const Splice& splice, const Splice& other_splice) {
+        return (splice.span.begin != other_splice.span.begin)
+            ? splice.span.begin < other_splice.span.begin
+            : splice.span.end > other_splice.span.end;
+      }
+  );
+
+  std::vector<Splice> outer_splices;
+  for (const Splice& splice : splices) {
+    if (outer_splices.empty() || splice.span.begin >= outer_splices.back().span.end) {
+      outer_splices.push_back(splice);
+    }
+  }
+
+  // Lines after the first one of a replaced value are indented like the
+  // line that the value starts on.
+  std::vector<std::string> replacement_texts(outer_splices.size());
+  std::string serialized_text;
+  bool is_same_size = true;
+
+  for (std::size_t i = 0; i < outer_splices.size(); i += 1) {
+    const JsonSpan& span = outer_splices[i].span;
+
+    std::size_t line_begin = this->source_text_.rfind('\n', span.begin);
+    line_begin = (line_begin == std::string::npos) ? 0 : line_begin + 1;
+
+    std::size_t indent_end = line_begin;
+    while (indent_end < span.begin && IsJsonWhitespace(this->source_text_[indent_end])) {
+      indent_end += 1;
+    }
+
+    std::string_view indent(
+        this->source_text_.data() + line_begin,
+        indent_end - line_begin
+    );
+
+    serialized_text.clear();
+    AppendSerializedValue(&serialized_text, *outer_splices[i].value_ptr, indent_width);
+
+    std::string& replacement_text = replacement_texts[i];
+    for (char ch : serialized_text) {
+      replacement_text.push_back(ch);
+
+      if (ch == '\n') {
+        replacement_text.append(indent);
+      }
+    }
+
+    is_same_size = is_same_size && replacement_text.size() == span.end - span.begin;
+  }
+
+  // The text must still be the contents of the config file, which its size
+  // and modification time vouch for.
+  std::error_code error_code;
+  std::uintmax_t config_file_size = std::filesystem::file_size(
+      this->config_file_path(),
+      error_code
+  );
+
+  if (error_code || config_file_size != this->source_text_.size()) {
+    return false;
+  }
+
+  std::filesystem::file_time_type config_file_time =
+      std::filesystem::last_write_time(this->config_file_path(), error_code);
+
+  if (error_code || config_file_time != this->source_file_time_) {
+    return false;
+  }
+
+  if (outer_splices.empty()) {
+    return true;
+  }
+
+  // Patch the file in place if the sizes match. Otherwise, everything after
+  // the first change is rewritten, from the replacements and the text
+  // between them. The text is only updated once the file is, and a failure
+  // after the file was touched drops it, so that the next write is a full
+  // one.
+  std::size_t source_text_size = this->source_text_.size();
+  bool is_written = false;
+
+  if (std::fstream config_stream(
+          this->config_file_path(),
+          std::ios::in | std::ios::out | std::ios::binary
+      );
+      config_stream) {
+    if (is_same_size) {
+      for (std::size_t i = 0; i < outer_splices.size(); i += 1) {
+        config_stream.seekp(outer_splices[i].span.begin);
+        config_stream.write(replacement_texts[i].data(), replacement_texts[i].size());
+      }
+    } else {
+      config_stream.seekp(outer_splices.front().span.begin);
+
+      for (std::size_t i = 0; i < outer_splices.size(); i += 1) {
+        const JsonSpan& span = outer_splices[i].span;
+        std::size_t next_begin = (i + 1 < outer_splices.size())
+            ? outer_splices[i + 1].span.begin
+            : this->source_text_.size();
+
+        config_stream.write(replacement_texts[i].data(), replacement_texts[i].size());
+        config_stream.write(
+            this->source_text_.data() + span.end,
+            next_begin - span.end
+        );
+
+        source_text_size += replacement_texts[i].size();
+        source_text_size -= span.end - span.begin;
+      }
+    }
+
+    config_stream.close();
+    is_written = !config_stream.fail();
+  } else {
+    return false;
+  }
+
+  if (is_written && source_text_size < config_file_size) {
+    std::filesystem::resize_file(
+        this->config_file_path(),
+        source_text_size,
+        error_code
+    );
+
+    is_written = !error_code;
+  }
+
+  if (is_written) {
+    this->source_file_time_ = std::filesystem::last_write_time(
+        this->config_file_path(),
+        error_code
+    );
+
+    is_written = !error_code;
+  }
+
+  if (!is_written) {
+    this->source_text_.clear();
+    this->edited_key_paths_.clear();
+    return false;
+  }
+
+  for (std::size_t i = outer_splices.size(); i > 0; i -= 1) {
+    const JsonSpan& span = outer_splices[i - 1].span;
+    this->source_text_.replace(
+        span.begin,
+        span.end - span.begin,
+        replacement_texts[i - 1]
+    );
+  }
+
+  this->edited_key_paths_.clear();
+
+  return true;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::MatchesQueryFilter(
+    const VAL& value,
+    const JsonQueryStep& step
+) {
+  const JsonValue* filtered_value_ptr = &value;
+
+  for (const std::string& name : step.filter_path) {
+    filtered_value_ptr = FindValue(*filtered_value_ptr, std::string_view(name));
+
+    // A missing value is only unequal to any literal.
+    if (filtered_value_ptr == nullptr) {
+      return step.filter_operator == JsonQueryOperator::kNotEqual;
+    }
+  }
+
+  return MatchesJsonQueryFilter(step, ToQueryValueView(*filtered_value_ptr));
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::CreateConfigFileIfMissing() const {
+  if (std::filesystem::exists(this->config_file_path())) {
+    return true;
+  }
+
+  if (this->file_format() == JsonFileFormat::kText) {
+    return this->WriteConfigFile({ "{}\n" });
+  }
+
+  std::string empty_object;
+  JsonBinaryWriter(&empty_object, this->file_format()).StartObject(0);
+
+  return this->WriteConfigFile({ empty_object });
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+JsonFileFormat GenericConfigReader<DOC, OBJ, VAL>::ConfigFileFormat(
+    const std::filesystem::path& file_path
+) const {
+  if (file_path == this->config_file_path()) {
+    return this->file_format();
+  }
+
+  return JsonFileFormatFromExtension(file_path);
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+JsonCompression GenericConfigReader<DOC, OBJ, VAL>::DetectConfigFileCompression() const {
+  if (std::ifstream config_stream(this->config_file_path(), std::ios::binary);
+      config_stream) {
+    char leading_bytes[4];
+    config_stream.read(leading_bytes, sizeof(leading_bytes));
+
+    if (config_stream.gcount() > 0) {
+      return DetectJsonCompression(
+          std::string_view(leading_bytes, config_stream.gcount())
+      );
+    }
+  }
+
+  // Files without contents are compressed according to their extension.
+  return JsonCompressionFromExtension(this->config_file_path());
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::WriteConfigFile(
+    const std::vector<std::string>& texts
+) const {
+  JsonCompression compression = this->DetectConfigFileCompression();
+
+  // Check before anything is written.
+  if (!IsJsonCompressionEnabled(compression)) {
+    return false;
+  }
+
+  std::ios::openmode open_mode =
+      (compression == JsonCompression::kNone
+          && this->file_format() == JsonFileFormat::kText)
+      ? std::ios::out
+      : std::ios::out | std::ios::binary;
+
+  // The text is written to a temporary file that then replaces the config
+  // file, so that a failed write or a crash leaves the config file intact.
+  std::filesystem::path temp_file_path = JsonTempFilePath(this->config_file_path());
+  bool is_written = false;
+
+  if (std::ofstream config_stream(temp_file_path, open_mode);
+      config_stream) {
+    if (compression == JsonCompression::kNone) {
+      for (const std::string& text : texts) {
+        config_stream.write(text.data(), text.size());
+      }
+
+      is_written = true;
+    } else {
+      JsonCompressor compressor(
+          &config_stream,
+          compression,
+          this->compression_dictionary_
+      );
+
+      is_written = true;
+      for (const std::string& text : texts) {
+        if (!compressor.Write(text)) {
+          is_written = false;
+          break;
+        }
+      }
+
+      is_written = is_written && compressor.Finish();
+    }
+
+    config_stream.close();
+    is_written = is_written && !config_stream.fail();
+  }
+
+  if (!is_written) {
+    std::error_code error_code;
+    std::filesystem::remove(temp_file_path, error_code);
+    return false;
+  }
+
+  return ReplaceJsonFile(temp_file_path, this->config_file_path());
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::ParseConfigFile(
+    const std::filesystem::path& file_path,
+    JsonDocument* document
+) const {
+  std::ifstream config_stream(file_path, std::ios::binary);
+  if (!config_stream) {
+    return false;
+  }
+
+  // A document creates its parse stack when it is first parsed.
+  JsonMemoryResourceScope memory_resource_scope(this->memory_resource_);
+
+  char leading_bytes[4];
+  config_stream.read(leading_bytes, sizeof(leading_bytes));
+  JsonCompression compression = DetectJsonCompression(
+      std::string_view(leading_bytes, config_stream.gcount())
+  );
+
+  config_stream.clear();
+  config_stream.seekg(0);
+
+  JsonFileFormat file_format = this->ConfigFileFormat(file_path);
+
+  if (compression == JsonCompression::kNone) {
+    return (file_format == JsonFileFormat::kText)
+        ? this->ParseConfigStream(config_stream, document)
+        : DecodeConfigStream(config_stream, file_format, document);
+  }
+
+  // The parser reads the decompressed text as it is produced.
+  JsonDecompressingStreamBuf decompressing_stream_buf(
+      config_stream.rdbuf(),
+      compression,
+      this->compression_dictionary_
+  );
+  std::istream decompressing_stream(&decompressing_stream_buf);
+
+  bool is_parsed = (file_format == JsonFileFormat::kText)
+      ? this->ParseConfigStream(decompressing_stream, document)
+      : DecodeConfigStream(decompressing_stream, file_format, document);
+
+  return is_parsed && decompressing_stream_buf.is_complete();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+std::shared_ptr<typename GenericConfigReader<DOC, OBJ, VAL>::SubtreeHashMap>
+GenericConfigReader<DOC, OBJ, VAL>::GetSubtreeHashes(
+    std::size_t thread_count
+) const {
+  {
+    std::lock_guard lock(this->subtree_hash_cache_mutex_);
+
+    if (this->subtree_hash_cache_ != nullptr
+        && this->subtree_hash_cache_generation_ == this->generation_) {
+      return this->subtree_hash_cache_;
+    }
+  }
+
+  // Hash into a map of this call's own, so that concurrent calls don't
+  // write to a shared one, then publish it.
+  std::shared_ptr<SubtreeHashMap> subtree_hashes =
+      std::make_shared<SubtreeHashMap>();
+  this->HashDocumentSubtrees(thread_count, subtree_hashes.get());
+
+  std::lock_guard lock(this->subtree_hash_cache_mutex_);
+  this->subtree_hash_cache_ = subtree_hashes;
+  this->subtree_hash_cache_generation_ = this->generation_;
+
+  return subtree_hashes;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+bool GenericConfigReader<DOC, OBJ, VAL>::IsSubscribedKeyPath(
+    std::string_view key_path
+) const {
+  // A key path is of interest if a subscription covers it, or if it leads to
+  // a subscribed value.
+  for (const Subscription& subscription : this->subscriptions_) {
+    if (IsJsonPointerPrefix(subscription.key_path_prefix, key_path)
+        || IsJsonPointerPrefix(key_path, subscription.key_path_prefix)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::NotifySubscribers(
+    const std::vector<std::string>& changed_key_paths
+) {
+  if (changed_key_paths.empty()) {
+    return;
+  }
+
+  // Callbacks may subscribe, unsubscribe or notify again, which leaves the
+  // subscriptions in place until the outermost notification ends, so they
+  // are iterated by index rather than copied. Subscriptions added by the
+  // callbacks are not notified of this change.
+  this->notification_depth_ += 1;
+
+  try {
+    std::vector<std::string> subscribed_key_paths;
+    std::size_t subscription_count = this->subscriptions_.size();
+
+    for (std::size_t i = 0; i < subscription_count; i += 1) {
+      const Subscription& subscription = this->subscriptions_[i];
+      if (subscription.id == kRemovedSubscriptionId) {
+        continue;
+      }
+
+      auto is_subscribed = [&subscription](const std::string& changed_key_path) {
+        return IsJsonPointerPrefix(subscription.key_path_prefix, changed_key_path)
+            || IsJsonPointerPrefix(changed_key_path, subscription.key_path_prefix);
+      };
+
+      std::size_t subscribed_count = std::count_if(
+          changed_key_paths.cbegin(),
+          changed_key_paths.cend(),
+          is_subscribed
+      );
+
+      if (subscribed_count == 0) {
+        continue;
+      }
+
+      // Usually every changed key path is subscribed, often a single one, and
+      // the key paths are passed on as they are.
+      if (subscribed_count == changed_key_paths.size()) {
+        subscription.callback(changed_key_paths);
+        continue;
+      }
+
+      subscribed_key_paths.clear();
+      std::copy_if(
+          changed_key_paths.cbegin(),
+          changed_key_paths.cend(),
+          std::back_inserter(subscribed_key_paths),
+          is_subscribed
+      );
+
+      subscription.callback(subscribed_key_paths);
+    }
+  } catch (...) {
+    this->EndNotification();
+    throw;
+  }
+
+  this->EndNotification();
+}
+
+template <typename DOC, typename OBJ, typename VAL>
+void GenericConfigReader<DOC, OBJ, VAL>::EndNotification() {
+  this->notification_depth_ -= 1;
+  if (this->notification_depth_ != 0) {
+    return;
+  }
+
+  this->subscriptions_.erase(
+      std::remove_if(
+          this->subscriptions_.begin(),
+          this->subscriptions_.end(),
+          [](const Subscription& subscription) {
+            return subscription.id == kRemovedSubscriptionId;
+          }
+      ),
+      this->subscriptions_.end()
+  );
+
+  for (Subscription& subscription : this->pending_subscriptions_) {
+    this->subscriptions_.push_back(std::move(subscription));
+  }
+
+  this->pending_subscriptions_.clear();
+}
 
 } // namespace mjsoni
 
@@ -0,0 +1,815 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_BINARY_HPP_
+#define MJSONI_JSON_BINARY_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace mjsoni {
+
+/**
+ * The encoding of a config file. CBOR (RFC 8949) and MessagePack files hold
+ * the same data model as JSON text, but need no number or string scanning
+ * to be read.
+ */
+enum class JsonFileFormat {
+  kText,
+  kCbor,
+  kMessagePack,
+};
+
+// Containers nested deeper than this are rejected, so that malformed input
+// can't exhaust the stack.
+constexpr std::size_t kMaxJsonBinaryDepth = 1024;
+
+/**
+ * Returns the format of a file from its extension, .cbor, .msgpack or .mpk,
+ * looking past a .gz or .zst extension. Any other file is JSON text.
+ */
+inline JsonFileFormat JsonFileFormatFromExtension(
+    const std::filesystem::path& file_path
+) {
+  std::filesystem::path extension = file_path.extension();
+
+  if (extension == ".gz" || extension == ".zst") {
+    extension = file_path.stem().extension();
+  }
+
+  if (extension == ".cbor") {
+    return JsonFileFormat::kCbor;
+  }
+
+  if (extension == ".msgpack" || extension == ".mpk") {
+    return JsonFileFormat::kMessagePack;
+  }
+
+  return JsonFileFormat::kText;
+}
+
+/**
+ * Appends JSON values to a string in CBOR or MessagePack. Containers are
+ * written with definite lengths, so each container's size is written before
+ * its members or elements. Object keys are written with Key().
+ */
+class JsonBinaryWriter {
+ public:
+  JsonBinaryWriter(
+      std::string* output,
+      JsonFileFormat format
+  ) noexcept
+      : output_(output),
+        format_(format) {
+  }
+
+  void Null() {
+    this->output_->push_back(
+        (this->format_ == JsonFileFormat::kCbor) ? '\xF6' : '\xC0'
+    );
+  }
+
+  void Bool(bool value) {
+    if (this->format_ == JsonFileFormat::kCbor) {
+      this->output_->push_back(value ? '\xF5' : '\xF4');
+    } else {
+      this->output_->push_back(value ? '\xC3' : '\xC2');
+    }
+  }
+
+  void Int64(std::int64_t value) {
+    if (value >= 0) {
+      this->Uint64(static_cast<std::uint64_t>(value));
+      return;
+    }
+
+    if (this->format_ == JsonFileFormat::kCbor) {
+      // Negative integers are encoded as -1 - n.
+      this->AppendCborHead(1, static_cast<std::uint64_t>(-(value + 1)));
+      return;
+    }
+
+    if (value >= -32) {
+      this->output_->push_back(static_cast<char>(value));
+    } else if (value >= std::numeric_limits<std::int8_t>::min()) {
+      this->output_->push_back('\xD0');
+      this->AppendBigEndian(static_cast<std::uint8_t>(value), 1);
+    } else if (value >= std::numeric_limits<std::int16_t>::min()) {
+      this->output_->push_back('\xD1');
+      this->AppendBigEndian(static_cast<std::uint16_t>(value), 2);
+    } else if (value >= std::numeric_limits<std::int32_t>::min()) {
+      this->output_->push_back('\xD2');
+      this->AppendBigEndian(static_cast<std::uint32_t>(value), 4);
+    } else {
+      this->output_->push_back('\xD3');
+      this->AppendBigEndian(static_cast<std::uint64_t>(value), 8);
+    }
+  }
+
+  void Uint64(std::uint64_t value) {
+    if (this->format_ == JsonFileFormat::kCbor) {
+      this->AppendCborHead(0, value);
+      return;
+    }
+
+    if (value <= 0x7F) {
+      this->output_->push_back(static_cast<char>(value));
+    } else if (value <= 0xFF) {
+      this->output_->push_back('\xCC');
+      this->AppendBigEndian(value, 1);
+    } else if (value <= 0xFFFF) {
+      this->output_->push_back('\xCD');
+      this->AppendBigEndian(value, 2);
+    } else if (value <= 0xFFFFFFFF) {
+      this->output_->push_back('\xCE');
+      this->AppendBigEndian(value, 4);
+    } else {
+      this->output_->push_back('\xCF');
+      this->AppendBigEndian(value, 8);
+    }
+  }
+
+  void Double(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    this->output_->push_back(
+        (this->format_ == JsonFileFormat::kCbor) ? '\xFB' : '\xCB'
+    );
+    this->AppendBigEndian(bits, 8);
+  }
+
+  void String(std::string_view value) {
+    if (this->format_ == JsonFileFormat::kCbor) {
+      this->AppendCborHead(3, value.size());
+    } else {
+      this->AppendMessagePackHead(value.size(), '\xA0', 32, '\xD9', '\xDA', '\xDB');
+    }
+
+    this->output_->append(value);
+  }
+
+  void Key(std::string_view key) {
+    this->String(key);
+  }
+
+  void StartArray(std::size_t element_count) {
+    if (this->format_ == JsonFileFormat::kCbor) {
+      this->AppendCborHead(4, element_count);
+    } else {
+      this->AppendMessagePackHead(element_count, '\x90', 16, 0, '\xDC', '\xDD');
+    }
+  }
+
+  void StartObject(std::size_t member_count) {
+    if (this->format_ == JsonFileFormat::kCbor) {
+      this->AppendCborHead(5, member_count);
+    } else {
+      this->AppendMessagePackHead(member_count, '\x80', 16, 0, '\xDE', '\xDF');
+    }
+  }
+
+ private:
+  std::string* output_;
+  JsonFileFormat format_;
+
+  void AppendBigEndian(
+      std::uint64_t value,
+      std::size_t size
+  ) {
+    for (std::size_t i = size; i > 0; i -= 1) {
+      this->output_->push_back(static_cast<char>(value >> ((i - 1) * 8)));
+    }
+  }
+
+  /**
+   * Appends the initial byte of a CBOR data item, followed by its argument
+   * in the fewest bytes that hold it.
+   */
+  void AppendCborHead(
+      int major_type,
+      std::uint64_t argument
+  ) {
+    char initial_byte = static_cast<char>(major_type << 5);
+
+    if (argument < 24) {
+      this->output_->push_back(initial_byte | static_cast<char>(argument));
+    } else if (argument <= 0xFF) {
+      this->output_->push_back(initial_byte | 24);
+      this->AppendBigEndian(argument, 1);
+    } else if (argument <= 0xFFFF) {
+      this->output_->push_back(initial_byte | 25);
+      this->AppendBigEndian(argument, 2);
+    } else if (argument <= 0xFFFFFFFF) {
+      this->output_->push_back(initial_byte | 26);
+      this->AppendBigEndian(argument, 4);
+    } else {
+      this->output_->push_back(initial_byte | 27);
+      this->AppendBigEndian(argument, 8);
+    }
+  }
+
+  /**
+   * Appends the head of a MessagePack string, array or map: the fix type
+   * for sizes below fix_limit, or else the smallest of the 8, 16 and 32 bit
+   * types. Arrays and maps have no 8 bit type, which is passed as 0.
+   */
+  void AppendMessagePackHead(
+      std::size_t size,
+      char fix_type,
+      std::size_t fix_limit,
+      char type_8,
+      char type_16,
+      char type_32
+  ) {
+    if (size < fix_limit) {
+      this->output_->push_back(fix_type | static_cast<char>(size));
+    } else if (type_8 != 0 && size <= 0xFF) {
+      this->output_->push_back(type_8);
+      this->AppendBigEndian(size, 1);
+    } else if (size <= 0xFFFF) {
+      this->output_->push_back(type_16);
+      this->AppendBigEndian(size, 2);
+    } else {
+      this->output_->push_back(type_32);
+      this->AppendBigEndian(size, 4);
+    }
+  }
+};
+
+/**
+ * Decodes a CBOR or MessagePack value into the SAX-style events of a
+ * handler, as accepted by rapidjson::Document: Null(), Bool(), Int64(),
+ * Uint64(), Double(), String() and Key() with a pointer, a length and a copy
+ * flag, StartObject(), EndObject() and StartArray(), EndArray() with the
+ * number of members or elements. Strings are passed with the copy flag set,
+ * since they point into the input.
+ *
+ * The whole input must be one value. Byte strings and extension types have
+ * no JSON equivalent and are rejected, as are object keys that are not
+ * strings. CBOR tags are skipped, and undefined is read as null.
+ */
+template <typename Handler>
+class JsonBinaryReader {
+ public:
+  JsonBinaryReader(
+      std::string_view input,
+      JsonFileFormat format
+  ) noexcept
+      : input_(input),
+        format_(format) {
+  }
+
+  bool Read(
+      Handler* handler
+  ) {
+    this->offset_ = 0;
+
+    bool is_read = (this->format_ == JsonFileFormat::kCbor)
+        ? this->ReadCborValue(handler, 0)
+        : this->ReadMessagePackValue(handler, 0);
+
+    return is_read && this->offset_ == this->input_.size();
+  }
+
+ private:
+  std::string_view input_;
+  JsonFileFormat format_;
+  std::size_t offset_ = 0;
+
+  // The contents of a CBOR string of indefinite length, which is split into
+  // chunks.
+  std::string chunked_string_;
+
+  bool ReadByte(
+      std::uint8_t* value
+  ) {
+    if (this->offset_ >= this->input_.size()) {
+      return false;
+    }
+
+    *value = static_cast<std::uint8_t>(this->input_[this->offset_]);
+    this->offset_ += 1;
+
+    return true;
+  }
+
+  bool ReadBigEndian(
+      std::size_t size,
+      std::uint64_t* value
+  ) {
+    if (this->input_.size() - this->offset_ < size) {
+      return false;
+    }
+
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i < size; i += 1) {
+      result = (result << 8)
+          | static_cast<std::uint8_t>(this->input_[this->offset_ + i]);
+    }
+
+    this->offset_ += size;
+    *value = result;
+
+    return true;
+  }
+
+  bool ReadBytes(
+      std::uint64_t size,
+      std::string_view* bytes
+  ) {
+    if (this->input_.size() - this->offset_ < size) {
+      return false;
+    }
+
+    *bytes = this->input_.substr(this->offset_, static_cast<std::size_t>(size));
+    this->offset_ += static_cast<std::size_t>(size);
+
+    return true;
+  }
+
+  static double ToDouble(
+      std::uint64_t bits,
+      std::size_t size
+  ) {
+    if (size == 4) {
+      std::uint32_t float_bits = static_cast<std::uint32_t>(bits);
+      float value;
+      std::memcpy(&value, &float_bits, sizeof(value));
+
+      return value;
+    }
+
+    if (size == 8) {
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+
+      return value;
+    }
+
+    // Half precision, which only CBOR has.
+    int exponent = static_cast<int>((bits >> 10) & 0x1F);
+    double mantissa = static_cast<double>(bits & 0x3FF);
+
+    double value;
+    if (exponent == 0) {
+      value = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+      value = std::ldexp(mantissa + 1024, exponent - 25);
+    } else if (mantissa == 0) {
+      value = std::numeric_limits<double>::infinity();
+    } else {
+      value = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return ((bits & 0x8000) != 0) ? -value : value;
+  }
+
+  /* Functions for CBOR */
+
+  /**
+   * Reads the argument that follows the initial byte of a CBOR data item.
+   * Indefinite lengths set is_indefinite instead.
+   */
+  bool ReadCborArgument(
+      std::uint8_t additional_info,
+      std::uint64_t* argument,
+      bool* is_indefinite
+  ) {
+    *is_indefinite = false;
+
+    if (additional_info < 24) {
+      *argument = additional_info;
+      return true;
+    }
+
+    switch (additional_info) {
+      case 24: {
+        return this->ReadBigEndian(1, argument);
+      }
+
+      case 25: {
+        return this->ReadBigEndian(2, argument);
+      }
+
+      case 26: {
+        return this->ReadBigEndian(4, argument);
+      }
+
+      case 27: {
+        return this->ReadBigEndian(8, argument);
+      }
+
+      case 31: {
+        *is_indefinite = true;
+        return true;
+      }
+
+      default: {
+        return false;
+      }
+    }
+  }
+
+  bool IsCborBreak() const noexcept {
+    return this->offset_ < this->input_.size()
+        && this->input_[this->offset_] == '\xFF';
+  }
+
+  /**
+   * Reads a CBOR text string. The chunks of a string of indefinite length
+   * are joined.
+   */
+  bool ReadCborString(
+      std::uint64_t argument,
+      bool is_indefinite,
+      std::string_view* text
+  ) {
+    if (!is_indefinite) {
+      return this->ReadBytes(argument, text);
+    }
+
+    this->chunked_string_.clear();
+
+    while (!this->IsCborBreak()) {
+      std::uint8_t initial_byte;
+      std::uint64_t chunk_size;
+      bool is_chunk_indefinite;
+      std::string_view chunk;
+
+      if (!this->ReadByte(&initial_byte)
+          || (initial_byte >> 5) != 3
+          || !this->ReadCborArgument(initial_byte & 0x1F, &chunk_size, &is_chunk_indefinite)
+          || is_chunk_indefinite
+          || !this->ReadBytes(chunk_size, &chunk)) {
+        return false;
+      }
+
+      this->chunked_string_.append(chunk);
+    }
+
+    // Skip the break.
+    this->offset_ += 1;
+    *text = this->chunked_string_;
+
+    return true;
+  }
+
+  bool ReadCborValue(
+      Handler* handler,
+      std::size_t depth
+  ) {
+    if (depth > kMaxJsonBinaryDepth) {
+      return false;
+    }
+
+    std::uint8_t initial_byte;
+    if (!this->ReadByte(&initial_byte)) {
+      return false;
+    }
+
+    int major_type = initial_byte >> 5;
+    std::uint8_t additional_info = initial_byte & 0x1F;
+
+    // Floats and simple values don't have an argument.
+    if (major_type == 7) {
+      return this->ReadCborSimpleValue(handler, additional_info);
+    }
+
+    std::uint64_t argument;
+    bool is_indefinite;
+    if (!this->ReadCborArgument(additional_info, &argument, &is_indefinite)) {
+      return false;
+    }
+
+    switch (major_type) {
+      case 0: {
+        return !is_indefinite && handler->Uint64(argument);
+      }
+
+      case 1: {
+        if (is_indefinite) {
+          return false;
+        }
+
+        // The value is -1 - argument, which may be below the range of
+        // std::int64_t.
+        if (argument > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+          return handler->Double(-1.0 - static_cast<double>(argument));
+        }
+
+        return handler->Int64(-1 - static_cast<std::int64_t>(argument));
+      }
+
+      case 3: {
+        std::string_view text;
+
+        return this->ReadCborString(argument, is_indefinite, &text)
+            && handler->String(text.data(), text.size(), true);
+      }
+
+      case 4: {
+        if (!handler->StartArray()) {
+          return false;
+        }
+
+        std::uint64_t element_count = 0;
+        while (is_indefinite ? !this->IsCborBreak() : element_count < argument) {
+          if (!this->ReadCborValue(handler, depth + 1)) {
+            return false;
+          }
+
+          element_count += 1;
+        }
+
+        if (is_indefinite) {
+          this->offset_ += 1;
+        }
+
+        return handler->EndArray(element_count);
+      }
+
+      case 5: {
+        if (!handler->StartObject()) {
+          return false;
+        }
+
+        std::uint64_t member_count = 0;
+        while (is_indefinite ? !this->IsCborBreak() : member_count < argument) {
+          std::uint8_t key_initial_byte;
+          std::uint64_t key_argument;
+          bool is_key_indefinite;
+          std::string_view key;
+
+          if (!this->ReadByte(&key_initial_byte)
+              || (key_initial_byte >> 5) != 3
+              || !this->ReadCborArgument(key_initial_byte & 0x1F, &key_argument, &is_key_indefinite)
+              || !this->ReadCborString(key_argument, is_key_indefinite, &key)
+              || !handler->Key(key.data(), key.size(), true)
+              || !this->ReadCborValue(handler, depth + 1)) {
+            return false;
+          }
+
+          member_count += 1;
+        }
+
+        if (is_indefinite) {
+          this->offset_ += 1;
+        }
+
+        return handler->EndObject(member_count);
+      }
+
+      case 6: {
+        // The tag's meaning is not kept, only the tagged value.
+        return !is_indefinite && this->ReadCborValue(handler, depth + 1);
+      }
+
+      default: {
+        // Byte strings have no JSON equivalent.
+        return false;
+      }
+    }
+  }
+
+  bool ReadCborSimpleValue(
+      Handler* handler,
+      std::uint8_t additional_info
+  ) {
+    switch (additional_info) {
+      case 20: {
+        return handler->Bool(false);
+      }
+
+      case 21: {
+        return handler->Bool(true);
+      }
+
+      case 22:
+      case 23: {
+        return handler->Null();
+      }
+
+      case 25:
+      case 26:
+      case 27: {
+        std::size_t size = std::size_t(1) << (additional_info - 24);
+        std::uint64_t bits;
+
+        return this->ReadBigEndian(size, &bits)
+            && handler->Double(ToDouble(bits, size));
+      }
+
+      default: {
+        return false;
+      }
+    }
+  }
+
+  /* Functions for MessagePack */
+
+  bool ReadMessagePackString(
+      std::size_t size_of_size,
+      std::string_view* text
+  ) {
+    std::uint64_t size;
+
+    return this->ReadBigEndian(size_of_size, &size)
+        && this->ReadBytes(size, text);
+  }
+
+  bool ReadMessagePackArray(
+      Handler* handler,
+      std::uint64_t element_count,
+      std::size_t depth
+  ) {
+    if (!handler->StartArray()) {
+      return false;
+    }
+
+    for (std::uint64_t i = 0; i < element_count; i += 1) {
+      if (!this->ReadMessagePackValue(handler, depth + 1)) {
+        return false;
+      }
+    }
+
+    return handler->EndArray(element_count);
+  }
+
+  bool ReadMessagePackMap(
+      Handler* handler,
+      std::uint64_t member_count,
+      std::size_t depth
+  ) {
+    if (!handler->StartObject()) {
+      return false;
+    }
+
+    for (std::uint64_t i = 0; i < member_count; i += 1) {
+      std::uint8_t key_type;
+      std::string_view key;
+
+      if (!this->ReadByte(&key_type)) {
+        return false;
+      }
+
+      bool is_key_read;
+      if (key_type >= 0xA0 && key_type <= 0xBF) {
+        is_key_read = this->ReadBytes(key_type & 0x1F, &key);
+      } else if (key_type >= 0xD9 && key_type <= 0xDB) {
+        is_key_read = this->ReadMessagePackString(
+            std::size_t(1) << (key_type - 0xD9),
+            &key
+        );
+      } else {
+        is_key_read = false;
+      }
+
+      if (!is_key_read
+          || !handler->Key(key.data(), key.size(), true)
+          || !this->ReadMessagePackValue(handler, depth + 1)) {
+        return false;
+      }
+    }
+
+    return handler->EndObject(member_count);
+  }
+
+  bool ReadMessagePackValue(
+      Handler* handler,
+      std::size_t depth
+  ) {
+    if (depth > kMaxJsonBinaryDepth) {
+      return false;
+    }
+
+    std::uint8_t type;
+    if (!this->ReadByte(&type)) {
+      return false;
+    }
+
+    if (type <= 0x7F) {
+      return handler->Uint64(type);
+    }
+
+    if (type >= 0xE0) {
+      return handler->Int64(static_cast<std::int8_t>(type));
+    }
+
+    if (type <= 0x8F) {
+      return this->ReadMessagePackMap(handler, type & 0x0F, depth);
+    }
+
+    if (type <= 0x9F) {
+      return this->ReadMessagePackArray(handler, type & 0x0F, depth);
+    }
+
+    if (type <= 0xBF) {
+      std::string_view text;
+
+      return this->ReadBytes(type & 0x1F, &text)
+          && handler->String(text.data(), text.size(), true);
+    }
+
+    std::uint64_t argument;
+
+    switch (type) {
+      case 0xC0: {
+        return handler->Null();
+      }
+
+      case 0xC2: {
+        return handler->Bool(false);
+      }
+
+      case 0xC3: {
+        return handler->Bool(true);
+      }
+
+      case 0xCA:
+      case 0xCB: {
+        std::size_t size = (type == 0xCA) ? 4 : 8;
+
+        return this->ReadBigEndian(size, &argument)
+            && handler->Double(ToDouble(argument, size));
+      }
+
+      case 0xCC:
+      case 0xCD:
+      case 0xCE:
+      case 0xCF: {
+        return this->ReadBigEndian(std::size_t(1) << (type - 0xCC), &argument)
+            && handler->Uint64(argument);
+      }
+
+      case 0xD0:
+      case 0xD1:
+      case 0xD2:
+      case 0xD3: {
+        std::size_t size = std::size_t(1) << (type - 0xD0);
+        if (!this->ReadBigEndian(size, &argument)) {
+          return false;
+        }
+
+        // Sign-extend the value to 64 bits.
+        std::size_t unused_bits = 64 - (size * 8);
+        std::int64_t value = static_cast<std::int64_t>(argument << unused_bits)
+            >> unused_bits;
+
+        return handler->Int64(value);
+      }
+
+      case 0xD9:
+      case 0xDA:
+      case 0xDB: {
+        std::string_view text;
+
+        return this->ReadMessagePackString(std::size_t(1) << (type - 0xD9), &text)
+            && handler->String(text.data(), text.size(), true);
+      }
+
+      case 0xDC:
+      case 0xDD: {
+        return this->ReadBigEndian((type == 0xDC) ? 2 : 4, &argument)
+            && this->ReadMessagePackArray(handler, argument, depth);
+      }
+
+      case 0xDE:
+      case 0xDF: {
+        return this->ReadBigEndian((type == 0xDE) ? 2 : 4, &argument)
+            && this->ReadMessagePackMap(handler, argument, depth);
+      }
+
+      default: {
+        // Binary and extension types have no JSON equivalent.
+        return false;
+      }
+    }
+  }
+};
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_BINARY_HPP_
@@ -0,0 +1,560 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_COMPRESSION_HPP_
+#define MJSONI_JSON_COMPRESSION_HPP_
+
+/**
+ * Compressed config files are supported for the formats whose libraries are
+ * enabled. Define MJSONI_ENABLE_ZLIB to read and write gzip files, linking
+ * with zlib, and MJSONI_ENABLE_ZSTD to read and write zstd files, linking
+ * with libzstd.
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(MJSONI_ENABLE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace mjsoni {
+
+enum class JsonCompression {
+  kNone,
+  kGzip,
+  kZstd,
+};
+
+// The size of each buffer that compressed and decompressed data passes
+// through.
+constexpr std::size_t kJsonCompressionBufferSize = 1 << 16;
+
+/**
+ * Returns the compression of a file from its leading bytes.
+ */
+inline JsonCompression DetectJsonCompression(
+    std::string_view leading_bytes
+) noexcept {
+  if (leading_bytes.size() >= 2
+      && leading_bytes[0] == '\x1F'
+      && leading_bytes[1] == '\x8B') {
+    return JsonCompression::kGzip;
+  }
+
+  if (leading_bytes.size() >= 4
+      && leading_bytes.substr(0, 4) == std::string_view("\x28\xB5\x2F\xFD", 4)) {
+    return JsonCompression::kZstd;
+  }
+
+  return JsonCompression::kNone;
+}
+
+/**
+ * Returns the compression of a file from its extension, for files that have
+ * no contents yet.
+ */
+inline JsonCompression JsonCompressionFromExtension(
+    const std::filesystem::path& file_path
+) {
+  std::filesystem::path extension = file_path.extension();
+
+  if (extension == ".gz") {
+    return JsonCompression::kGzip;
+  }
+
+  if (extension == ".zst") {
+    return JsonCompression::kZstd;
+  }
+
+  return JsonCompression::kNone;
+}
+
+/**
+ * Returns whether the library for the compression is enabled.
+ */
+constexpr bool IsJsonCompressionEnabled(
+    JsonCompression compression
+) noexcept {
+  switch (compression) {
+    case JsonCompression::kNone: {
+      return true;
+    }
+
+    case JsonCompression::kGzip: {
+#if defined(MJSONI_ENABLE_ZLIB)
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    case JsonCompression::kZstd: {
+#if defined(MJSONI_ENABLE_ZSTD)
+      return true;
+#else
+      return false;
+#endif
+    }
+  }
+
+  return false;
+}
+
+/**
+ * A read-only stream buffer that decompresses the data of another stream
+ * buffer as it is read, one bounded buffer at a time, so that a parser can
+ * read a compressed file without it being decompressed anywhere else.
+ * Concatenated gzip members and zstd frames are read as one stream.
+ *
+ * The dictionary is only used for zstd, since gzip has no preset
+ * dictionaries.
+ */
+class JsonDecompressingStreamBuf : public std::streambuf {
+ public:
+  JsonDecompressingStreamBuf(
+      std::streambuf* source,
+      JsonCompression compression,
+      std::string_view dictionary
+  ) : source_(source),
+      compression_(compression),
+      input_buffer_(kJsonCompressionBufferSize),
+      output_buffer_(kJsonCompressionBufferSize) {
+    switch (compression) {
+      case JsonCompression::kNone: {
+        this->is_failed_ = true;
+        break;
+      }
+
+      case JsonCompression::kGzip: {
+#if defined(MJSONI_ENABLE_ZLIB)
+        // Adding 16 to the window bits selects the gzip format.
+        this->is_failed_ = inflateInit2(&this->inflate_stream_, MAX_WBITS + 16) != Z_OK;
+        this->is_context_created_ = !this->is_failed_;
+#else
+        this->is_failed_ = true;
+#endif
+        break;
+      }
+
+      case JsonCompression::kZstd: {
+#if defined(MJSONI_ENABLE_ZSTD)
+        this->decompression_context_ = ZSTD_createDCtx();
+        this->is_failed_ = this->decompression_context_ == nullptr
+            || (!dictionary.empty()
+                && ZSTD_isError(ZSTD_DCtx_loadDictionary(
+                    this->decompression_context_,
+                    dictionary.data(),
+                    dictionary.size()
+                )));
+#else
+        static_cast<void>(dictionary);
+        this->is_failed_ = true;
+#endif
+        break;
+      }
+    }
+  }
+
+  JsonDecompressingStreamBuf(const JsonDecompressingStreamBuf&) = delete;
+
+  JsonDecompressingStreamBuf& operator=(const JsonDecompressingStreamBuf&) = delete;
+
+  ~JsonDecompressingStreamBuf() override {
+#if defined(MJSONI_ENABLE_ZLIB)
+    if (this->is_context_created_) {
+      inflateEnd(&this->inflate_stream_);
+    }
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+    ZSTD_freeDCtx(this->decompression_context_);
+#endif
+  }
+
+  /**
+   * Returns whether all of the compressed data was read and decompressed
+   * without errors. A truncated file is not complete.
+   */
+  bool is_complete() const noexcept {
+    return !this->is_failed_ && this->is_frame_ended_ && this->is_source_ended_;
+  }
+
+ protected:
+  int_type underflow() override {
+    if (this->gptr() < this->egptr()) {
+      return traits_type::to_int_type(*this->gptr());
+    }
+
+    std::size_t output_size = 0;
+    while (output_size == 0 && !this->is_failed_) {
+      if (this->input_begin_ == this->input_end_) {
+        if (this->is_source_ended_) {
+          break;
+        }
+
+        this->input_begin_ = 0;
+        this->input_end_ = static_cast<std::size_t>(this->source_->sgetn(
+            this->input_buffer_.data(),
+            static_cast<std::streamsize>(this->input_buffer_.size())
+        ));
+
+        if (this->input_end_ == 0) {
+          this->is_source_ended_ = true;
+          break;
+        }
+      }
+
+      output_size = this->DecompressInput();
+    }
+
+    if (output_size == 0) {
+      return traits_type::eof();
+    }
+
+    this->setg(
+        this->output_buffer_.data(),
+        this->output_buffer_.data(),
+        this->output_buffer_.data() + output_size
+    );
+
+    return traits_type::to_int_type(*this->gptr());
+  }
+
+ private:
+  std::streambuf* source_;
+  JsonCompression compression_;
+
+  std::vector<char> input_buffer_;
+  std::size_t input_begin_ = 0;
+  std::size_t input_end_ = 0;
+  std::vector<char> output_buffer_;
+
+  bool is_failed_ = false;
+  bool is_source_ended_ = false;
+
+  // Whether the last gzip member or zstd frame was read to its end.
+  bool is_frame_ended_ = false;
+
+#if defined(MJSONI_ENABLE_ZLIB)
+  z_stream inflate_stream_ = {};
+  bool is_context_created_ = false;
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+  ZSTD_DCtx* decompression_context_ = nullptr;
+#endif
+
+  /**
+   * Decompresses from the pending input into the output buffer, and returns
+   * the number of bytes decompressed.
+   */
+  std::size_t DecompressInput() {
+#if defined(MJSONI_ENABLE_ZLIB)
+    if (this->compression_ == JsonCompression::kGzip) {
+      // A new member starts after the end of the previous one.
+      if (this->is_frame_ended_) {
+        if (inflateReset(&this->inflate_stream_) != Z_OK) {
+          this->is_failed_ = true;
+          return 0;
+        }
+      }
+
+      this->inflate_stream_.next_in = reinterpret_cast<Bytef*>(
+          this->input_buffer_.data() + this->input_begin_
+      );
+      this->inflate_stream_.avail_in = static_cast<uInt>(
+          this->input_end_ - this->input_begin_
+      );
+      this->inflate_stream_.next_out = reinterpret_cast<Bytef*>(
+          this->output_buffer_.data()
+      );
+      this->inflate_stream_.avail_out = static_cast<uInt>(
+          this->output_buffer_.size()
+      );
+
+      int result = inflate(&this->inflate_stream_, Z_NO_FLUSH);
+      if (result != Z_OK && result != Z_STREAM_END) {
+        this->is_failed_ = true;
+        return 0;
+      }
+
+      this->is_frame_ended_ = (result == Z_STREAM_END);
+      this->input_begin_ = this->input_end_ - this->inflate_stream_.avail_in;
+
+      return this->output_buffer_.size() - this->inflate_stream_.avail_out;
+    }
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+    if (this->compression_ == JsonCompression::kZstd) {
+      ZSTD_inBuffer input = {
+          this->input_buffer_.data(),
+          this->input_end_,
+          this->input_begin_
+      };
+      ZSTD_outBuffer output = {
+          this->output_buffer_.data(),
+          this->output_buffer_.size(),
+          0
+      };
+
+      std::size_t result = ZSTD_decompressStream(
+          this->decompression_context_,
+          &output,
+          &input
+      );
+
+      if (ZSTD_isError(result)) {
+        this->is_failed_ = true;
+        return 0;
+      }
+
+      // A result of 0 means that a frame was completely decoded and flushed.
+      this->is_frame_ended_ = (result == 0);
+      this->input_begin_ = input.pos;
+
+      return output.pos;
+    }
+#endif
+
+    this->is_failed_ = true;
+    return 0;
+  }
+};
+
+/**
+ * Compresses data as it is written, one bounded buffer at a time, and
+ * writes the compressed data to a stream. Finish() must be called after the
+ * last write to end the compressed stream.
+ *
+ * The dictionary is only used for zstd, since gzip has no preset
+ * dictionaries.
+ */
+class JsonCompressor {
+ public:
+  JsonCompressor(
+      std::ostream* sink,
+      JsonCompression compression,
+      std::string_view dictionary
+  ) : sink_(sink),
+      compression_(compression),
+      output_buffer_(kJsonCompressionBufferSize) {
+    switch (compression) {
+      case JsonCompression::kNone: {
+        this->is_failed_ = true;
+        break;
+      }
+
+      case JsonCompression::kGzip: {
+#if defined(MJSONI_ENABLE_ZLIB)
+        // Adding 16 to the window bits selects the gzip format.
+        this->is_failed_ = deflateInit2(
+            &this->deflate_stream_,
+            Z_DEFAULT_COMPRESSION,
+            Z_DEFLATED,
+            MAX_WBITS + 16,
+            8,
+            Z_DEFAULT_STRATEGY
+        ) != Z_OK;
+        this->is_context_created_ = !this->is_failed_;
+#else
+        this->is_failed_ = true;
+#endif
+        break;
+      }
+
+      case JsonCompression::kZstd: {
+#if defined(MJSONI_ENABLE_ZSTD)
+        this->compression_context_ = ZSTD_createCCtx();
+        this->is_failed_ = this->compression_context_ == nullptr
+            || (!dictionary.empty()
+                && ZSTD_isError(ZSTD_CCtx_loadDictionary(
+                    this->compression_context_,
+                    dictionary.data(),
+                    dictionary.size()
+                )));
+#else
+        static_cast<void>(dictionary);
+        this->is_failed_ = true;
+#endif
+        break;
+      }
+    }
+  }
+
+  JsonCompressor(const JsonCompressor&) = delete;
+
+  JsonCompressor& operator=(const JsonCompressor&) = delete;
+
+  ~JsonCompressor() {
+#if defined(MJSONI_ENABLE_ZLIB)
+    if (this->is_context_created_) {
+      deflateEnd(&this->deflate_stream_);
+    }
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+    ZSTD_freeCCtx(this->compression_context_);
+#endif
+  }
+
+  bool Write(
+      std::string_view data
+  ) {
+    // Large writes are compressed in bounded pieces.
+    while (!data.empty() && !this->is_failed_) {
+      std::string_view piece = data.substr(0, kJsonCompressionBufferSize);
+      data.remove_prefix(piece.size());
+
+      this->Compress(piece, false);
+    }
+
+    return !this->is_failed_;
+  }
+
+  bool Finish() {
+    if (!this->is_failed_) {
+      this->Compress({}, true);
+    }
+
+    return !this->is_failed_;
+  }
+
+ private:
+  std::ostream* sink_;
+  JsonCompression compression_;
+
+  std::vector<char> output_buffer_;
+
+  bool is_failed_ = false;
+
+#if defined(MJSONI_ENABLE_ZLIB)
+  z_stream deflate_stream_ = {};
+  bool is_context_created_ = false;
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+  ZSTD_CCtx* compression_context_ = nullptr;
+#endif
+
+  /**
+   * Compresses the input, writing each filled output buffer to the sink. If
+   * is_end is true, then the compressed stream is ended.
+   */
+  void Compress(
+      std::string_view input,
+      bool is_end
+  ) {
+#if defined(MJSONI_ENABLE_ZLIB)
+    if (this->compression_ == JsonCompression::kGzip) {
+      this->deflate_stream_.next_in = reinterpret_cast<Bytef*>(
+          const_cast<char*>(input.data())
+      );
+      this->deflate_stream_.avail_in = static_cast<uInt>(input.size());
+
+      int result;
+      do {
+        this->deflate_stream_.next_out = reinterpret_cast<Bytef*>(
+            this->output_buffer_.data()
+        );
+        this->deflate_stream_.avail_out = static_cast<uInt>(
+            this->output_buffer_.size()
+        );
+
+        result = deflate(&this->deflate_stream_, is_end ? Z_FINISH : Z_NO_FLUSH);
+        if (result == Z_STREAM_ERROR) {
+          this->is_failed_ = true;
+          return;
+        }
+
+        this->WriteOutput(
+            this->output_buffer_.size() - this->deflate_stream_.avail_out
+        );
+      } while (!this->is_failed_
+          && (is_end ? result != Z_STREAM_END : this->deflate_stream_.avail_out == 0));
+
+      return;
+    }
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+    if (this->compression_ == JsonCompression::kZstd) {
+      ZSTD_inBuffer zstd_input = { input.data(), input.size(), 0 };
+
+      std::size_t remaining;
+      do {
+        ZSTD_outBuffer zstd_output = {
+            this->output_buffer_.data(),
+            this->output_buffer_.size(),
+            0
+        };
+
+        remaining = ZSTD_compressStream2(
+            this->compression_context_,
+            &zstd_output,
+            &zstd_input,
+            is_end ? ZSTD_e_end : ZSTD_e_continue
+        );
+
+        if (ZSTD_isError(remaining)) {
+          this->is_failed_ = true;
+          return;
+        }
+
+        this->WriteOutput(zstd_output.pos);
+      } while (!this->is_failed_
+          && (is_end ? remaining != 0 : zstd_input.pos != zstd_input.size));
+
+      return;
+    }
+#endif
+
+    static_cast<void>(input);
+    static_cast<void>(is_end);
+    this->is_failed_ = true;
+  }
+
+  void WriteOutput(
+      std::size_t size
+  ) {
+    if (size == 0) {
+      return;
+    }
+
+    this->sink_->write(this->output_buffer_.data(), size);
+    if (!*this->sink_) {
+      this->is_failed_ = true;
+    }
+  }
+};
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_COMPRESSION_HPP_
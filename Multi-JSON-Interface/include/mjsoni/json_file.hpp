@@ -0,0 +1,143 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_FILE_HPP_
+#define MJSONI_JSON_FILE_HPP_
+
+/**
+ * Durable writes of config files. A config file is replaced by writing its
+ * new contents to a sibling temporary file, syncing that file to storage,
+ * and renaming it over the config file, so that a crash or a failed write
+ * leaves either the old or the new contents, but never a mix of them.
+ */
+
+#include <filesystem>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mjsoni {
+
+/**
+ * Returns the path of the temporary file that replaces the file.
+ */
+inline std::filesystem::path JsonTempFilePath(
+    const std::filesystem::path& file_path
+) {
+  std::filesystem::path temp_file_path = file_path;
+  temp_file_path += ".tmp";
+
+  return temp_file_path;
+}
+
+/**
+ * Flushes the written contents of the file to storage. Returns true without
+ * syncing on platforms that are not supported.
+ */
+inline bool SyncJsonFile(
+    const std::filesystem::path& file_path
+) {
+#if defined(_WIN32)
+  int file_descriptor = _wopen(file_path.c_str(), _O_RDWR | _O_BINARY);
+  if (file_descriptor == -1) {
+    return false;
+  }
+
+  bool is_synced = (_commit(file_descriptor) == 0);
+  _close(file_descriptor);
+
+  return is_synced;
+#elif defined(__unix__) || defined(__APPLE__)
+  int file_descriptor = open(file_path.c_str(), O_RDONLY);
+  if (file_descriptor == -1) {
+    return false;
+  }
+
+  bool is_synced = (fsync(file_descriptor) == 0);
+  close(file_descriptor);
+
+  return is_synced;
+#else
+  static_cast<void>(file_path);
+  return true;
+#endif
+}
+
+/**
+ * Flushes the directory entries of the file's directory to storage, so that
+ * a created, renamed or removed file stays so after a crash. Windows has no
+ * equivalent, so it always returns true there.
+ */
+inline bool SyncJsonFileDirectory(
+    const std::filesystem::path& file_path
+) {
+#if !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__))
+  std::filesystem::path directory_path = file_path.parent_path();
+  if (directory_path.empty()) {
+    directory_path = ".";
+  }
+
+  int file_descriptor = open(directory_path.c_str(), O_RDONLY);
+  if (file_descriptor == -1) {
+    return false;
+  }
+
+  bool is_synced = (fsync(file_descriptor) == 0);
+  close(file_descriptor);
+
+  return is_synced;
+#else
+  static_cast<void>(file_path);
+  return true;
+#endif
+}
+
+/**
+ * Syncs the completely written temporary file and renames it over the file.
+ * The temporary file is removed if it cannot replace the file.
+ */
+inline bool ReplaceJsonFile(
+    const std::filesystem::path& temp_file_path,
+    const std::filesystem::path& file_path
+) {
+  std::error_code error_code;
+
+  if (!SyncJsonFile(temp_file_path)) {
+    std::filesystem::remove(temp_file_path, error_code);
+    return false;
+  }
+
+  std::filesystem::rename(temp_file_path, file_path, error_code);
+  if (error_code) {
+    std::filesystem::remove(temp_file_path, error_code);
+    return false;
+  }
+
+  return SyncJsonFileDirectory(file_path);
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_FILE_HPP_
@@ -0,0 +1,557 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_FROZEN_HPP_
+#define MJSONI_JSON_FROZEN_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "json_hash.hpp"
+#include "json_key.hpp"
+#include "json_number.hpp"
+
+namespace mjsoni {
+
+enum class JsonFrozenKind : std::uint8_t {
+  kNull,
+  kFalse,
+  kTrue,
+  kInt64,
+  kUint64,
+  kDouble,
+  kString,
+  kArray,
+  kObject,
+};
+
+/**
+ * A member of an object that is being frozen. The key must stay valid until
+ * the object's members are indexed.
+ */
+struct JsonFrozenMember {
+  std::string_view key;
+  std::uint32_t node;
+};
+
+/**
+ * A read-only index over a document, for lookups by key path. The values
+ * are laid out contiguously in preorder as fixed-size nodes, with numbers
+ * and booleans stored inline. Each object's member names are placed in a
+ * perfect hash table built with hash-and-displace: a member is found with
+ * one displacement and one slot, using the compile-time hash of a JsonKey,
+ * and a single key comparison. Array elements are found by index.
+ *
+ * Nodes point to the values of the document that was frozen, which must not
+ * change or move while the index is in use.
+ */
+template <typename VAL>
+class JsonFrozenIndex {
+ public:
+  struct Node {
+    JsonFrozenKind kind;
+    bool is_hashed;
+
+    // The number of members or elements of a container.
+    std::uint32_t size;
+
+    // The first element slot of an array, or the table of an object.
+    std::uint32_t first;
+
+    union {
+      std::int64_t int64_value;
+      std::uint64_t uint64_value;
+      double double_value;
+    };
+
+    const VAL* value;
+  };
+
+  /**
+   * Removes every node, keeping the memory for the next freeze.
+   */
+  void Clear() noexcept {
+    this->nodes_.clear();
+    this->element_slots_.clear();
+    this->tables_.clear();
+    this->key_slots_.clear();
+    this->displacements_.clear();
+  }
+
+  /* Functions for Building */
+
+  std::uint32_t AddNull(const VAL* value) {
+    return this->AddNode(JsonFrozenKind::kNull, value);
+  }
+
+  std::uint32_t AddBool(const VAL* value, bool bool_value) {
+    return this->AddNode(bool_value ? JsonFrozenKind::kTrue : JsonFrozenKind::kFalse, value);
+  }
+
+  std::uint32_t AddInt64(const VAL* value, std::int64_t int64_value) {
+    std::uint32_t node = this->AddNode(JsonFrozenKind::kInt64, value);
+    this->nodes_[node].int64_value = int64_value;
+
+    return node;
+  }
+
+  std::uint32_t AddUint64(const VAL* value, std::uint64_t uint64_value) {
+    std::uint32_t node = this->AddNode(JsonFrozenKind::kUint64, value);
+    this->nodes_[node].uint64_value = uint64_value;
+
+    return node;
+  }
+
+  std::uint32_t AddDouble(const VAL* value, double double_value) {
+    std::uint32_t node = this->AddNode(JsonFrozenKind::kDouble, value);
+    this->nodes_[node].double_value = double_value;
+
+    return node;
+  }
+
+  std::uint32_t AddString(const VAL* value) {
+    return this->AddNode(JsonFrozenKind::kString, value);
+  }
+
+  /**
+   * Adds an array node, whose elements are then added after it and set with
+   * SetArrayElement().
+   */
+  std::uint32_t AddArray(const VAL* value, std::size_t element_count) {
+    std::uint32_t node = this->AddNode(JsonFrozenKind::kArray, value);
+    this->nodes_[node].size = static_cast<std::uint32_t>(element_count);
+    this->nodes_[node].first = static_cast<std::uint32_t>(this->element_slots_.size());
+    this->element_slots_.resize(this->element_slots_.size() + element_count, kNoNode);
+
+    return node;
+  }
+
+  void SetArrayElement(
+      std::uint32_t array_node,
+      std::size_t index,
+      std::uint32_t element_node
+  ) {
+    this->element_slots_[this->nodes_[array_node].first + index] = element_node;
+  }
+
+  /**
+   * Adds an object node, whose member values are then added after it and
+   * indexed with IndexObjectMembers().
+   */
+  std::uint32_t AddObject(const VAL* value) {
+    return this->AddNode(JsonFrozenKind::kObject, value);
+  }
+
+  /**
+   * Builds the perfect hash table of the object's member names. Only the
+   * first of several members with the same name is indexed, as lookups in
+   * the document find the first one. If no displacements are found, which
+   * takes distinct names with equal 64-bit hashes, then the members are
+   * searched linearly instead.
+   */
+  void IndexObjectMembers(
+      std::uint32_t object_node,
+      std::vector<JsonFrozenMember>* members
+  );
+
+  /* Functions for Lookups */
+
+  const Node* root() const noexcept {
+    return this->nodes_.empty() ? nullptr : this->nodes_.data();
+  }
+
+  bool empty() const noexcept {
+    return this->nodes_.empty();
+  }
+
+  const Node* FindChild(
+      const Node& node,
+      const JsonKey& key
+  ) const noexcept;
+
+  const Node* FindByKeys(
+      std::initializer_list<JsonKey> keys
+  ) const noexcept {
+    const Node* node_ptr = this->root();
+
+    for (const JsonKey& key : keys) {
+      if (node_ptr == nullptr) {
+        return nullptr;
+      }
+
+      node_ptr = this->FindChild(*node_ptr, key);
+    }
+
+    return node_ptr;
+  }
+
+  /**
+   * Reads the inline number of the node like the backends' conversions do.
+   * Integer types only accept integers, and floating-point types accept any
+   * number.
+   */
+  template <typename T>
+  static bool ToNumber(
+      const Node& node,
+      T* number
+  ) noexcept;
+
+ private:
+  static constexpr std::uint32_t kNoNode = std::numeric_limits<std::uint32_t>::max();
+
+  // Displacements that are tried for a bucket before the object falls back
+  // to linear search.
+  static constexpr std::uint32_t kMaxDisplacement = 1 << 16;
+
+  struct Table {
+    std::uint32_t first_slot;
+    std::uint32_t slot_mask;
+    std::uint32_t first_bucket;
+    std::uint32_t bucket_mask;
+  };
+
+  struct KeySlot {
+    std::uint64_t key_hash;
+    std::string_view key;
+    std::uint32_t node;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<std::uint32_t> element_slots_;
+  std::vector<Table> tables_;
+  std::vector<KeySlot> key_slots_;
+  std::vector<std::uint32_t> displacements_;
+
+  std::uint32_t AddNode(JsonFrozenKind kind, const VAL* value) {
+    Node node;
+    node.kind = kind;
+    node.is_hashed = false;
+    node.size = 0;
+    node.first = 0;
+    node.uint64_value = 0;
+    node.value = value;
+
+    this->nodes_.push_back(node);
+
+    return static_cast<std::uint32_t>(this->nodes_.size() - 1);
+  }
+
+  static std::uint32_t CeilPowerOfTwo(std::size_t value) noexcept {
+    std::uint32_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+
+    return result;
+  }
+
+  static std::uint64_t BucketOf(std::uint64_t key_hash) noexcept {
+    return MixHash(key_hash) >> 32;
+  }
+
+  static std::uint64_t SlotOf(
+      std::uint64_t key_hash,
+      std::uint32_t displacement
+  ) noexcept {
+    return MixHash(key_hash + (displacement * 0x9E3779B97F4A7C15ULL));
+  }
+
+  bool PlaceBuckets(
+      const Table& table,
+      const std::vector<JsonFrozenMember>& members,
+      const std::vector<std::uint64_t>& key_hashes
+  );
+};
+
+template <typename VAL>
+void JsonFrozenIndex<VAL>::IndexObjectMembers(
+    std::uint32_t object_node,
+    std::vector<JsonFrozenMember>* members
+) {
+  // Keep the first member of each name.
+  if (members->size() > 1) {
+    std::unordered_set<std::string_view> seen_keys;
+    seen_keys.reserve(members->size());
+
+    members->erase(
+        std::remove_if(
+            members->begin(),
+            members->end(),
+            [&seen_keys](const JsonFrozenMember& member) {
+              return !seen_keys.insert(member.key).second;
+            }
+        ),
+        members->end()
+    );
+  }
+
+  std::vector<std::uint64_t> key_hashes;
+  key_hashes.reserve(members->size());
+  for (const JsonFrozenMember& member : *members) {
+    key_hashes.push_back(JsonKey::Hash(member.key.data(), member.key.size()));
+  }
+
+  // About four members per bucket, and a load factor of at most 0.8.
+  Table table;
+  table.first_slot = static_cast<std::uint32_t>(this->key_slots_.size());
+  table.slot_mask = CeilPowerOfTwo(members->size() + (members->size() / 4)) - 1;
+  table.first_bucket = static_cast<std::uint32_t>(this->displacements_.size());
+  table.bucket_mask = CeilPowerOfTwo(members->size() / 4) - 1;
+
+  Node& node = this->nodes_[object_node];
+  node.size = static_cast<std::uint32_t>(members->size());
+  node.first = static_cast<std::uint32_t>(this->tables_.size());
+
+  this->key_slots_.resize(
+      this->key_slots_.size() + table.slot_mask + 1,
+      KeySlot{ 0, std::string_view(), kNoNode }
+  );
+  this->displacements_.resize(this->displacements_.size() + table.bucket_mask + 1, 0);
+
+  node.is_hashed = this->PlaceBuckets(table, *members, key_hashes);
+
+  if (!node.is_hashed) {
+    // Store the members in order, for linear search.
+    for (std::size_t i = 0; i < members->size(); i += 1) {
+      this->key_slots_[table.first_slot + i] = KeySlot{
+          key_hashes[i],
+          (*members)[i].key,
+          (*members)[i].node
+      };
+    }
+  }
+
+  this->tables_.push_back(table);
+}
+
+template <typename VAL>
+bool JsonFrozenIndex<VAL>::PlaceBuckets(
+    const Table& table,
+    const std::vector<JsonFrozenMember>& members,
+    const std::vector<std::uint64_t>& key_hashes
+) {
+  std::vector<std::vector<std::uint32_t>> buckets(table.bucket_mask + 1);
+  for (std::size_t i = 0; i < members.size(); i += 1) {
+    buckets[BucketOf(key_hashes[i]) & table.bucket_mask].push_back(
+        static_cast<std::uint32_t>(i)
+    );
+  }
+
+  // Place the largest buckets first, while the table is mostly empty.
+  std::vector<std::uint32_t> bucket_order(buckets.size());
+  for (std::size_t i = 0; i < bucket_order.size(); i += 1) {
+    bucket_order[i] = static_cast<std::uint32_t>(i);
+  }
+
+  std::stable_sort(
+      bucket_order.begin(),
+      bucket_order.end(),
+      [&buckets](std::uint32_t left, std::uint32_t right) {
+        return buckets[left].size() > buckets[right].size();
+      }
+  );
+
+  std::vector<bool> is_slot_used(table.slot_mask + 1, false);
+  std::vector<std::uint32_t> bucket_slots;
+
+  for (std::uint32_t bucket : bucket_order) {
+    const std::vector<std::uint32_t>& bucket_members = buckets[bucket];
+    if (bucket_members.empty()) {
+      break;
+    }
+
+    bool is_placed = false;
+    for (std::uint32_t displacement = 0;
+        !is_placed && displacement < kMaxDisplacement;
+        displacement += 1) {
+      bucket_slots.clear();
+
+      is_placed = true;
+      for (std::uint32_t member : bucket_members) {
+        std::uint32_t slot = static_cast<std::uint32_t>(
+            SlotOf(key_hashes[member], displacement) & table.slot_mask
+        );
+
+        if (is_slot_used[slot]
+            || std::find(bucket_slots.cbegin(), bucket_slots.cend(), slot)
+                != bucket_slots.cend()) {
+          is_placed = false;
+          break;
+        }
+
+        bucket_slots.push_back(slot);
+      }
+
+      if (!is_placed) {
+        continue;
+      }
+
+      this->displacements_[table.first_bucket + bucket] = displacement;
+
+      for (std::size_t i = 0; i < bucket_members.size(); i += 1) {
+        std::uint32_t member = bucket_members[i];
+
+        is_slot_used[bucket_slots[i]] = true;
+        this->key_slots_[table.first_slot + bucket_slots[i]] = KeySlot{
+            key_hashes[member],
+            members[member].key,
+            members[member].node
+        };
+      }
+    }
+
+    if (!is_placed) {
+      std::fill(
+          this->key_slots_.begin() + table.first_slot,
+          this->key_slots_.begin() + table.first_slot + table.slot_mask + 1,
+          KeySlot{ 0, std::string_view(), kNoNode }
+      );
+
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename VAL>
+const typename JsonFrozenIndex<VAL>::Node* JsonFrozenIndex<VAL>::FindChild(
+    const Node& node,
+    const JsonKey& key
+) const noexcept {
+  if (key.is_index()) {
+    if (node.kind != JsonFrozenKind::kArray || key.index() >= node.size) {
+      return nullptr;
+    }
+
+    return &this->nodes_[this->element_slots_[node.first + key.index()]];
+  }
+
+  if (node.kind != JsonFrozenKind::kObject || node.size == 0) {
+    return nullptr;
+  }
+
+  const Table& table = this->tables_[node.first];
+  std::uint64_t key_hash = key.hash();
+
+  if (!node.is_hashed) {
+    for (std::uint32_t i = 0; i < node.size; i += 1) {
+      const KeySlot& key_slot = this->key_slots_[table.first_slot + i];
+
+      if (key_slot.key_hash == key_hash
+          && key.Equals(key_slot.key.data(), key_slot.key.size())) {
+        return &this->nodes_[key_slot.node];
+      }
+    }
+
+    return nullptr;
+  }
+
+  std::uint32_t displacement = this->displacements_[
+      table.first_bucket + (BucketOf(key_hash) & table.bucket_mask)
+  ];
+  const KeySlot& key_slot = this->key_slots_[
+      table.first_slot + (SlotOf(key_hash, displacement) & table.slot_mask)
+  ];
+
+  // Names that aren't members may land on any slot.
+  if (key_slot.node == kNoNode
+      || key_slot.key_hash != key_hash
+      || !key.Equals(key_slot.key.data(), key_slot.key.size())) {
+    return nullptr;
+  }
+
+  return &this->nodes_[key_slot.node];
+}
+
+template <typename VAL>
+template <typename T>
+bool JsonFrozenIndex<VAL>::ToNumber(
+    const Node& node,
+    T* number
+) noexcept {
+  if constexpr (std::is_floating_point<T>::value) {
+    double double_value;
+
+    switch (node.kind) {
+      case JsonFrozenKind::kInt64: {
+        double_value = static_cast<double>(node.int64_value);
+        break;
+      }
+
+      case JsonFrozenKind::kUint64: {
+        double_value = static_cast<double>(node.uint64_value);
+        break;
+      }
+
+      case JsonFrozenKind::kDouble: {
+        double_value = node.double_value;
+        break;
+      }
+
+      default: {
+        return false;
+      }
+    }
+
+    if constexpr (std::is_same<T, float>::value) {
+      if (!IsInFloatRange(double_value)) {
+        return false;
+      }
+    }
+
+    *number = static_cast<T>(double_value);
+
+    return true;
+  } else {
+    if (node.kind == JsonFrozenKind::kInt64) {
+      if (!IsInRangeOf<T>(node.int64_value)) {
+        return false;
+      }
+
+      *number = static_cast<T>(node.int64_value);
+
+      return true;
+    }
+
+    if (node.kind == JsonFrozenKind::kUint64) {
+      if (!IsInRangeOf<T>(node.uint64_value)) {
+        return false;
+      }
+
+      *number = static_cast<T>(node.uint64_value);
+
+      return true;
+    }
+
+    return false;
+  }
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_FROZEN_HPP_
@@ -0,0 +1,110 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_HASH_HPP_
+#define MJSONI_JSON_HASH_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace mjsoni {
+
+/**
+ * Seeds for the structural hash of each kind of JSON value, so that values
+ * of different kinds with the same contents hash differently.
+ */
+enum class JsonHashSeed : std::uint64_t {
+  kNull = 0x6E756C6C00000000ULL,
+  kFalse = 0x66616C7365000000ULL,
+  kTrue = 0x7472756500000000ULL,
+  kNumber = 0x6E756D6265720000ULL,
+  kString = 0x737472696E670000ULL,
+  kArray = 0x6172726179000000ULL,
+  kObject = 0x6F626A6563740000ULL,
+};
+
+/**
+ * Finalizes a hash so that every input bit affects every output bit.
+ */
+constexpr std::uint64_t MixHash(std::uint64_t hash) noexcept {
+  hash ^= hash >> 30;
+  hash *= 0xBF58476D1CE4E5B9ULL;
+  hash ^= hash >> 27;
+  hash *= 0x94D049BB133111EBULL;
+  hash ^= hash >> 31;
+
+  return hash;
+}
+
+/**
+ * Combines a hash into an order-dependent running hash, as used for array
+ * elements.
+ */
+constexpr std::uint64_t CombineHash(
+    std::uint64_t seed,
+    std::uint64_t hash
+) noexcept {
+  return MixHash(seed ^ (hash + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2)));
+}
+
+/**
+ * Hashes a JSON number. Integral doubles hash like the equal integer, since
+ * both backends consider 1 and 1.0 to be equal.
+ */
+inline std::uint64_t HashJsonNumber(double value) noexcept {
+  if (value >= static_cast<double>(std::numeric_limits<std::int64_t>::min())
+      && value < static_cast<double>(std::numeric_limits<std::int64_t>::max())
+      && std::trunc(value) == value) {
+    return CombineHash(
+        static_cast<std::uint64_t>(JsonHashSeed::kNumber),
+        static_cast<std::uint64_t>(static_cast<std::int64_t>(value))
+    );
+  }
+
+  // Normalize negative zero, which compares equal to zero.
+  if (value == 0) {
+    value = 0;
+  }
+
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  return CombineHash(static_cast<std::uint64_t>(JsonHashSeed::kNumber), bits);
+}
+
+inline std::uint64_t HashJsonNumber(std::int64_t value) noexcept {
+  return CombineHash(
+      static_cast<std::uint64_t>(JsonHashSeed::kNumber),
+      static_cast<std::uint64_t>(value)
+  );
+}
+
+inline std::uint64_t HashJsonNumber(std::uint64_t value) noexcept {
+  if (value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+    return HashJsonNumber(static_cast<std::int64_t>(value));
+  }
+
+  return HashJsonNumber(static_cast<double>(value));
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_HASH_HPP_
@@ -0,0 +1,239 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_KEY_HPP_
+#define MJSONI_JSON_KEY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+namespace mjsoni {
+
+/**
+ * An object key whose length, hash and leading bytes are known at compile
+ * time. Lookups with a JsonKey reject non-matching members by length and by
+ * their leading bytes before comparing the rest of the key, and never need
+ * strlen.
+ *
+ * A key made from a std::string_view at runtime only knows its length. Its
+ * hash is computed when a frozen lookup needs it, so that lookups in an
+ * unfrozen document don't pay for it.
+ *
+ * Keys are usually created with the _key literal:
+ *
+ *   using namespace mjsoni::literals;
+ *   reader.GetInt("server"_key, "timeout"_key);
+ *
+ * A key can instead be an array index, which selects an element of an array
+ * rather than a member of an object. Integers in key paths are converted to
+ * index keys:
+ *
+ *   reader.GetInt("servers", 3, "port");
+ *
+ * A negative integer becomes kInvalidIndex, which matches no element.
+ */
+class JsonKey {
+ public:
+  static constexpr std::size_t kInvalidIndex =
+      std::numeric_limits<std::size_t>::max();
+
+  constexpr JsonKey(const char* data, std::size_t size) noexcept
+      : key_(data, size),
+        hash_(Hash(data, size)),
+        prefix_word_(PrefixWord(data, size)),
+        is_precomputed_(true) {
+  }
+
+  constexpr explicit JsonKey(std::string_view key) noexcept
+      : key_(key),
+        hash_(0),
+        prefix_word_(0),
+        is_precomputed_(false) {
+  }
+
+  constexpr explicit JsonKey(std::size_t index) noexcept
+      : key_(),
+        hash_(0),
+        prefix_word_(0),
+        is_precomputed_(true),
+        index_(index),
+        is_index_(true) {
+  }
+
+  /**
+   * Returns the FNV-1a hash of the key.
+   */
+  static constexpr std::uint64_t Hash(
+      const char* data,
+      std::size_t size
+  ) noexcept {
+    std::uint64_t hash = 14695981039346656037ULL;
+
+    for (std::size_t i = 0; i < size; i += 1) {
+      hash ^= static_cast<unsigned char>(data[i]);
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+
+  /**
+   * Packs the first eight bytes of the key, or fewer if the key is shorter,
+   * into a word. Two keys of the same length with different words cannot be
+   * equal.
+   */
+  static constexpr std::uint64_t PrefixWord(
+      const char* data,
+      std::size_t size
+  ) noexcept {
+    std::uint64_t word = 0;
+    std::size_t prefix_size = (size < sizeof(word)) ? size : sizeof(word);
+
+    for (std::size_t i = 0; i < prefix_size; i += 1) {
+      word |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i]))
+          << (i * 8);
+    }
+
+    return word;
+  }
+
+  /**
+   * Returns whether the key is equal to the specified string, testing the
+   * length and, if they are precomputed, the leading bytes before comparing
+   * the remaining bytes.
+   */
+  constexpr bool Equals(
+      const char* data,
+      std::size_t size
+  ) const noexcept {
+    if (size != this->size()) {
+      return false;
+    }
+
+    if (!this->is_precomputed_) {
+      return this->key_ == std::string_view(data, size);
+    }
+
+    if (PrefixWord(data, size) != this->prefix_word()) {
+      return false;
+    }
+
+    if (size <= sizeof(this->prefix_word_)) {
+      return true;
+    }
+
+    return this->key_.substr(sizeof(this->prefix_word_))
+        == std::string_view(data, size).substr(sizeof(this->prefix_word_));
+  }
+
+  constexpr operator std::string_view() const noexcept {
+    return this->key_;
+  }
+
+  /* Getter and Setters */
+
+  constexpr const char* data() const noexcept {
+    return this->key_.data();
+  }
+
+  constexpr std::size_t size() const noexcept {
+    return this->key_.size();
+  }
+
+  constexpr std::uint64_t hash() const noexcept {
+    return this->is_precomputed_
+        ? this->hash_
+        : Hash(this->key_.data(), this->key_.size());
+  }
+
+  constexpr std::uint64_t prefix_word() const noexcept {
+    return this->is_precomputed_
+        ? this->prefix_word_
+        : PrefixWord(this->key_.data(), this->key_.size());
+  }
+
+  constexpr std::string_view view() const noexcept {
+    return this->key_;
+  }
+
+  constexpr std::size_t index() const noexcept {
+    return this->index_;
+  }
+
+  constexpr bool is_index() const noexcept {
+    return this->is_index_;
+  }
+
+ private:
+  std::string_view key_;
+  std::uint64_t hash_;
+  std::uint64_t prefix_word_;
+  bool is_precomputed_;
+  std::size_t index_ = 0;
+  bool is_index_ = false;
+};
+
+/**
+ * Converts a key of a key path to a JsonKey. A JsonKey is passed through
+ * unchanged, an integer becomes an array index, and any other key is viewed
+ * as a string.
+ */
+constexpr const JsonKey& ToJsonKey(const JsonKey& key) noexcept {
+  return key;
+}
+
+constexpr JsonKey ToJsonKey(std::string_view key) noexcept {
+  return JsonKey(key);
+}
+
+template <
+    typename T,
+    typename = std::enable_if_t<
+        std::is_integral_v<T>
+            && !std::is_same_v<T, bool>
+            && !std::is_same_v<T, char>
+    >
+>
+constexpr JsonKey ToJsonKey(T index) noexcept {
+  if constexpr (std::is_signed_v<T>) {
+    if (index < 0) {
+      return JsonKey(JsonKey::kInvalidIndex);
+    }
+  }
+
+  return JsonKey(static_cast<std::size_t>(index));
+}
+
+inline namespace literals {
+
+constexpr JsonKey operator""_key(
+    const char* data,
+    std::size_t size
+) noexcept {
+  return JsonKey(data, size);
+}
+
+} // namespace literals
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_KEY_HPP_
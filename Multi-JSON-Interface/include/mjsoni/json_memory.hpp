@@ -0,0 +1,635 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_MEMORY_HPP_
+#define MJSONI_JSON_MEMORY_HPP_
+
+/**
+ * A reader's documents allocate from the std::pmr::memory_resource that is
+ * passed to its constructor, for the backends that support it. Define
+ * MJSONI_ENABLE_PMR before including rapid_json_config_reader.hpp, and
+ * before any other include of RapidJSON, so that rapidjson::Document
+ * allocates its values and its parse stack with PmrJsonAllocator. This needs
+ * a RapidJSON version that has RAPIDJSON_DEFAULT_ALLOCATOR. nlohmann::json
+ * always allocates with std::allocator, so its backend ignores the resource.
+ *
+ * On Linux, JsonHugePageResource backs memory with huge pages, optionally on
+ * a given NUMA node, and the NUMA functions below report and select the
+ * nodes that threads allocate on.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace mjsoni {
+
+/**
+ * Selects the memory resource of the allocators that are created on the
+ * current thread while the scope is alive. Scopes may be nested.
+ */
+class JsonMemoryResourceScope {
+ public:
+  explicit JsonMemoryResourceScope(
+      std::pmr::memory_resource* memory_resource
+  ) noexcept
+      : previous_memory_resource_(CurrentMemoryResourceRef()) {
+    CurrentMemoryResourceRef() = memory_resource;
+  }
+
+  ~JsonMemoryResourceScope() {
+    CurrentMemoryResourceRef() = this->previous_memory_resource_;
+  }
+
+  JsonMemoryResourceScope(const JsonMemoryResourceScope&) = delete;
+  JsonMemoryResourceScope& operator=(const JsonMemoryResourceScope&) = delete;
+
+  /**
+   * Returns the memory resource of the innermost scope, or the default memory
+   * resource if there is none.
+   */
+  static std::pmr::memory_resource* current() noexcept {
+    std::pmr::memory_resource* memory_resource = CurrentMemoryResourceRef();
+
+    return (memory_resource != nullptr)
+        ? memory_resource
+        : std::pmr::get_default_resource();
+  }
+
+ private:
+  std::pmr::memory_resource* previous_memory_resource_;
+
+  static std::pmr::memory_resource*& CurrentMemoryResourceRef() noexcept {
+    thread_local std::pmr::memory_resource* current_memory_resource = nullptr;
+    return current_memory_resource;
+  }
+};
+
+/**
+ * A RapidJSON base allocator that allocates from the memory resource of the
+ * JsonMemoryResourceScope it was created in. RapidJSON frees blocks with a
+ * static function that is not given their sizes, so each block starts with a
+ * header that records its resource and size.
+ */
+class PmrJsonAllocator {
+ public:
+  static constexpr bool kNeedFree = true;
+
+  PmrJsonAllocator() noexcept
+      : memory_resource_(JsonMemoryResourceScope::current()) {
+  }
+
+  explicit PmrJsonAllocator(
+      std::pmr::memory_resource* memory_resource
+  ) noexcept
+      : memory_resource_(memory_resource) {
+  }
+
+  void* Malloc(std::size_t size) {
+    if (size == 0) {
+      return nullptr;
+    }
+
+    std::size_t block_size = kHeaderSize + size;
+    void* block = this->memory_resource_->allocate(
+        block_size,
+        alignof(std::max_align_t)
+    );
+    new (block) BlockHeader { this->memory_resource_, block_size };
+
+    return static_cast<char*>(block) + kHeaderSize;
+  }
+
+  void* Realloc(
+      void* original_ptr,
+      std::size_t original_size,
+      std::size_t new_size
+  ) {
+    static_cast<void>(original_size);
+
+    if (new_size == 0) {
+      Free(original_ptr);
+      return nullptr;
+    }
+
+    if (original_ptr == nullptr) {
+      return this->Malloc(new_size);
+    }
+
+    std::size_t original_capacity = GetHeader(original_ptr)->block_size
+        - kHeaderSize;
+    if (new_size <= original_capacity) {
+      return original_ptr;
+    }
+
+    void* new_ptr = this->Malloc(new_size);
+    std::memcpy(new_ptr, original_ptr, original_capacity);
+    Free(original_ptr);
+
+    return new_ptr;
+  }
+
+  static void Free(void* ptr) noexcept {
+    if (ptr == nullptr) {
+      return;
+    }
+
+    BlockHeader* header = GetHeader(ptr);
+    header->memory_resource->deallocate(
+        header,
+        header->block_size,
+        alignof(std::max_align_t)
+    );
+  }
+
+  constexpr std::pmr::memory_resource* memory_resource() const noexcept {
+    return this->memory_resource_;
+  }
+
+ private:
+  struct BlockHeader {
+    std::pmr::memory_resource* memory_resource;
+    std::size_t block_size;
+  };
+
+  // The header is padded so that the block after it stays aligned.
+  static constexpr std::size_t kHeaderSize =
+      (sizeof(BlockHeader) + alignof(std::max_align_t) - 1)
+          / alignof(std::max_align_t)
+          * alignof(std::max_align_t);
+
+  std::pmr::memory_resource* memory_resource_;
+
+  static BlockHeader* GetHeader(void* ptr) noexcept {
+    return std::launder(
+        reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - kHeaderSize)
+    );
+  }
+};
+
+/**
+ * A memory resource that hands out memory from large chunks in order, and
+ * frees nothing until it is released. It suits configs that are read once
+ * and then only queried. Memory of cleared documents is not reused until
+ * Release() is called, so a reader that reads again and again is better
+ * served by a pooling resource.
+ *
+ * Unlike std::pmr::monotonic_buffer_resource, it may be shared by the
+ * threads of ReadParallel() and ReadLayers().
+ */
+class JsonBumpResource : public std::pmr::memory_resource {
+ public:
+  static constexpr std::size_t kDefaultChunkSize = 1 << 20;
+
+  explicit JsonBumpResource(
+      std::size_t chunk_size = kDefaultChunkSize,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource()
+  ) noexcept
+      : chunk_size_(std::max<std::size_t>(chunk_size, 1)),
+        upstream_(upstream) {
+  }
+
+  ~JsonBumpResource() override {
+    this->Release();
+  }
+
+  JsonBumpResource(const JsonBumpResource&) = delete;
+  JsonBumpResource& operator=(const JsonBumpResource&) = delete;
+
+  /**
+   * Returns every chunk to the upstream resource. Memory that was allocated
+   * from this resource must not be used afterwards.
+   */
+  void Release() noexcept {
+    std::lock_guard lock(this->mutex_);
+
+    for (const Chunk& chunk : this->chunks_) {
+      this->upstream_->deallocate(chunk.data, chunk.size, chunk.alignment);
+    }
+
+    this->chunks_.clear();
+    this->next_ = nullptr;
+    this->remaining_size_ = 0;
+    this->capacity_ = 0;
+    this->allocated_size_ = 0;
+  }
+
+  /**
+   * Returns the number of bytes obtained from the upstream resource.
+   */
+  std::size_t capacity() const {
+    std::lock_guard lock(this->mutex_);
+    return this->capacity_;
+  }
+
+  /**
+   * Returns the number of bytes handed out, not counting padding.
+   */
+  std::size_t allocated_size() const {
+    std::lock_guard lock(this->mutex_);
+    return this->allocated_size_;
+  }
+
+  std::pmr::memory_resource* upstream_resource() const noexcept {
+    return this->upstream_;
+  }
+
+ private:
+  struct Chunk {
+    void* data;
+    std::size_t size;
+    std::size_t alignment;
+  };
+
+  mutable std::mutex mutex_;
+  std::size_t chunk_size_;
+  std::pmr::memory_resource* upstream_;
+  std::vector<Chunk> chunks_;
+  void* next_ = nullptr;
+  std::size_t remaining_size_ = 0;
+  std::size_t capacity_ = 0;
+  std::size_t allocated_size_ = 0;
+
+  void* do_allocate(
+      std::size_t bytes,
+      std::size_t alignment
+  ) override {
+    std::lock_guard lock(this->mutex_);
+
+    if (std::align(alignment, bytes, this->next_, this->remaining_size_)
+        == nullptr) {
+      // Requests that don't fit in a chunk get a chunk of their own. The
+      // rest of the current chunk is abandoned.
+      Chunk chunk;
+      chunk.size = std::max(this->chunk_size_, bytes);
+      chunk.alignment = std::max(alignment, alignof(std::max_align_t));
+      chunk.data = this->upstream_->allocate(chunk.size, chunk.alignment);
+
+      this->chunks_.push_back(chunk);
+      this->next_ = chunk.data;
+      this->remaining_size_ = chunk.size;
+      this->capacity_ += chunk.size;
+    }
+
+    void* ptr = this->next_;
+    this->next_ = static_cast<char*>(this->next_) + bytes;
+    this->remaining_size_ -= bytes;
+    this->allocated_size_ += bytes;
+
+    return ptr;
+  }
+
+  void do_deallocate(
+      void* ptr,
+      std::size_t bytes,
+      std::size_t alignment
+  ) override {
+    static_cast<void>(ptr);
+    static_cast<void>(bytes);
+    static_cast<void>(alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other
+  ) const noexcept override {
+    return this == &other;
+  }
+};
+
+// The size of the huge pages that JsonHugePageResource maps.
+constexpr std::size_t kHugePageSize = 1 << 21;
+
+namespace detail {
+
+// The largest NUMA node number that the node masks hold.
+constexpr std::size_t kMaxNumaNodeCount = 1024;
+
+constexpr std::size_t kNumaNodeMaskBits = 8 * sizeof(unsigned long);
+
+// The mempolicy modes of the Linux kernel, which libc doesn't declare.
+constexpr int kNumaPolicyPreferred = 1;
+constexpr int kNumaPolicyBind = 2;
+
+struct NumaNodeMask {
+  unsigned long words[kMaxNumaNodeCount / kNumaNodeMaskBits];
+};
+
+inline NumaNodeMask MakeNumaNodeMask(std::size_t numa_node) noexcept {
+  NumaNodeMask node_mask = {};
+  node_mask.words[numa_node / kNumaNodeMaskBits] =
+      1UL << (numa_node % kNumaNodeMaskBits);
+
+  return node_mask;
+}
+
+} // namespace detail
+
+/**
+ * Returns the number of NUMA nodes of the system, or 1 if it is unknown.
+ */
+inline std::size_t NumaNodeCount() {
+#if defined(__linux__)
+  static const std::size_t numa_node_count = []() {
+    // The file lists the node numbers as ranges, e.g. "0-3".
+    std::ifstream possible_stream("/sys/devices/system/node/possible");
+    std::string possible_text;
+    std::getline(possible_stream, possible_text);
+
+    std::size_t max_numa_node = 0;
+    std::size_t numa_node = 0;
+    for (char ch : possible_text) {
+      if (ch >= '0' && ch <= '9') {
+        numa_node = numa_node * 10 + (ch - '0');
+        max_numa_node = std::max(max_numa_node, numa_node);
+      } else {
+        numa_node = 0;
+      }
+    }
+
+    return std::min(max_numa_node + 1, detail::kMaxNumaNodeCount);
+  }();
+
+  return numa_node_count;
+#else
+  return 1;
+#endif
+}
+
+/**
+ * Returns the NUMA node of the CPU that the calling thread runs on, or 0 if
+ * it is unknown. The thread may have moved by the time the result is used.
+ */
+inline std::size_t CurrentNumaNode() noexcept {
+#if defined(__linux__) && defined(__GLIBC__) \
+    && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+  // getcpu() goes through the vDSO, which is much cheaper than a syscall.
+  unsigned int cpu;
+  unsigned int numa_node;
+  return (getcpu(&cpu, &numa_node) == 0) ? numa_node : 0;
+#elif defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu;
+  unsigned int numa_node;
+  return (syscall(SYS_getcpu, &cpu, &numa_node, nullptr) == 0)
+      ? numa_node
+      : 0;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Makes the calling thread prefer the NUMA node for the pages that it
+ * touches first, falling back to other nodes when the node is out of memory.
+ * Returns false if the policy could not be set.
+ */
+inline bool PreferNumaNode(std::size_t numa_node) noexcept {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+  if (numa_node >= detail::kMaxNumaNodeCount) {
+    return false;
+  }
+
+  detail::NumaNodeMask node_mask = detail::MakeNumaNodeMask(numa_node);
+
+  return syscall(
+      SYS_set_mempolicy,
+      detail::kNumaPolicyPreferred,
+      node_mask.words,
+      detail::kMaxNumaNodeCount + 1
+  ) == 0;
+#else
+  static_cast<void>(numa_node);
+  return false;
+#endif
+}
+
+/**
+ * A memory resource that maps memory in whole huge pages and asks the kernel
+ * to back it with transparent huge pages, so that a large document takes
+ * fewer TLB entries. With use_hugetlb, it first tries pages of the reserved
+ * huge page pool (MAP_HUGETLB). With a NUMA node, the pages are bound to
+ * that node.
+ *
+ * Each allocation is mapped on its own, so the resource is meant to be the
+ * upstream of a JsonBumpResource whose chunk size is a multiple of
+ * kHugePageSize, e.g.
+ *
+ *   mjsoni::JsonHugePageResource huge_page_resource;
+ *   mjsoni::JsonBumpResource arena(mjsoni::kHugePageSize, &huge_page_resource);
+ *   mjsoni::RapidJsonConfigReader reader(config_file_path, &arena);
+ *
+ * Outside of Linux, it allocates from the default memory resource.
+ */
+class JsonHugePageResource : public std::pmr::memory_resource {
+ public:
+  static constexpr int kAnyNumaNode = -1;
+
+  explicit JsonHugePageResource(
+      bool use_hugetlb = false,
+      int numa_node = kAnyNumaNode
+  ) noexcept
+      : use_hugetlb_(use_hugetlb),
+        numa_node_(numa_node) {
+  }
+
+  JsonHugePageResource(const JsonHugePageResource&) = delete;
+  JsonHugePageResource& operator=(const JsonHugePageResource&) = delete;
+
+  constexpr bool use_hugetlb() const noexcept {
+    return this->use_hugetlb_;
+  }
+
+  constexpr int numa_node() const noexcept {
+    return this->numa_node_;
+  }
+
+ private:
+  bool use_hugetlb_;
+  int numa_node_;
+
+  static constexpr std::size_t RoundUpToHugePage(std::size_t size) noexcept {
+    return (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  }
+
+  void* do_allocate(
+      std::size_t bytes,
+      std::size_t alignment
+  ) override {
+#if defined(__linux__)
+    if (alignment > kHugePageSize) {
+      throw std::bad_alloc();
+    }
+
+    std::size_t size = RoundUpToHugePage(bytes);
+    void* data = MAP_FAILED;
+
+#if defined(MAP_HUGETLB)
+    if (this->use_hugetlb_) {
+      data = mmap(
+          nullptr,
+          size,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+          -1,
+          0
+      );
+    }
+#endif
+
+    if (data == MAP_FAILED) {
+      // Transparent huge pages need the mapping to be aligned to a huge page,
+      // so a huge page more is mapped and the unaligned ends are unmapped.
+      void* mapping = mmap(
+          nullptr,
+          size + kHugePageSize,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS,
+          -1,
+          0
+      );
+      if (mapping == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+
+      std::uintptr_t mapping_address = reinterpret_cast<std::uintptr_t>(mapping);
+      std::size_t head_size = RoundUpToHugePage(mapping_address)
+          - mapping_address;
+      if (head_size != 0) {
+        munmap(mapping, head_size);
+      }
+
+      data = static_cast<char*>(mapping) + head_size;
+      munmap(static_cast<char*>(data) + size, kHugePageSize - head_size);
+
+#if defined(MADV_HUGEPAGE)
+      madvise(data, size, MADV_HUGEPAGE);
+#endif
+    }
+
+#if defined(SYS_mbind)
+    if (this->numa_node_ >= 0
+        && static_cast<std::size_t>(this->numa_node_) < detail::kMaxNumaNodeCount) {
+      detail::NumaNodeMask node_mask = detail::MakeNumaNodeMask(this->numa_node_);
+      syscall(
+          SYS_mbind,
+          data,
+          size,
+          detail::kNumaPolicyBind,
+          node_mask.words,
+          detail::kMaxNumaNodeCount + 1,
+          0
+      );
+    }
+#endif
+
+    return data;
+#else
+    return std::pmr::get_default_resource()->allocate(bytes, alignment);
+#endif
+  }
+
+  void do_deallocate(
+      void* ptr,
+      std::size_t bytes,
+      std::size_t alignment
+  ) override {
+#if defined(__linux__)
+    static_cast<void>(alignment);
+    munmap(ptr, RoundUpToHugePage(bytes));
+#else
+    std::pmr::get_default_resource()->deallocate(ptr, bytes, alignment);
+#endif
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other
+  ) const noexcept override {
+    return this == &other;
+  }
+};
+
+/**
+ * The memory of a subtree of a document, as measured by a traversal. The
+ * values of the subtree, including its root, are its nodes.
+ */
+struct JsonSubtreeMemoryStats {
+  std::size_t node_count = 0;
+
+  // The bytes of the string values and member names.
+  std::size_t string_size = 0;
+
+  // The bytes of the arrays that hold the members of objects and the
+  // elements of arrays, including their unused capacity. The nodes, other
+  // than the root, are stored in these arrays.
+  std::size_t member_array_size = 0;
+
+  JsonSubtreeMemoryStats& operator+=(
+      const JsonSubtreeMemoryStats& other
+  ) noexcept {
+    this->node_count += other.node_count;
+    this->string_size += other.string_size;
+    this->member_array_size += other.member_array_size;
+
+    return *this;
+  }
+};
+
+/**
+ * The memory that a reader holds. Backends whose values free their memory,
+ * such as nlohmann::json, report the memory of the values as the
+ * allocators' capacity and use, and waste nothing.
+ */
+struct JsonMemoryStats {
+  // The bytes that the allocators of the reader's documents obtained.
+  std::size_t capacity = 0;
+
+  // The bytes of the capacity that the allocators handed out.
+  std::size_t used_size = 0;
+
+  // The bytes handed out that no value refers to anymore, such as those of
+  // values that were overwritten or removed. Pool allocators don't reuse
+  // them until the document is read again.
+  std::size_t wasted_size = 0;
+
+  // The capacity of the buffers that the reader keeps between reads and
+  // writes, such as the serialized and source texts.
+  std::size_t buffer_size = 0;
+
+  // The memory of the document and of the override values.
+  JsonSubtreeMemoryStats document;
+  JsonSubtreeMemoryStats overrides;
+};
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_MEMORY_HPP_
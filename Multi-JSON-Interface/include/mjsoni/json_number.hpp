@@ -0,0 +1,158 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_NUMBER_HPP_
+#define MJSONI_JSON_NUMBER_HPP_
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <system_error>
+#include <type_traits>
+
+namespace mjsoni {
+
+/**
+ * Returns whether the double can be narrowed to a float without overflowing
+ * to infinity.
+ */
+inline bool IsInFloatRange(double value) noexcept {
+  return value >= -static_cast<double>(std::numeric_limits<float>::max())
+      && value <= static_cast<double>(std::numeric_limits<float>::max());
+}
+
+/**
+ * Returns whether the integer is representable by the integer type T. Both
+ * bounds are checked with a single unsigned comparison, by shifting the
+ * range of T to start at 0.
+ */
+template <typename T>
+constexpr bool IsInRangeOf(std::int64_t value) noexcept {
+  static_assert(std::is_integral<T>::value, "T must be an integer type.");
+
+  if constexpr (std::is_signed<T>::value) {
+    constexpr std::uint64_t kMin = static_cast<std::uint64_t>(
+        static_cast<std::int64_t>(std::numeric_limits<T>::min())
+    );
+    constexpr std::uint64_t kMax = static_cast<std::uint64_t>(
+        static_cast<std::int64_t>(std::numeric_limits<T>::max())
+    );
+
+    return static_cast<std::uint64_t>(value) - kMin <= kMax - kMin;
+  } else {
+    return (value >= 0)
+        & (static_cast<std::uint64_t>(value)
+            <= static_cast<std::uint64_t>(std::numeric_limits<T>::max()));
+  }
+}
+
+template <typename T>
+constexpr bool IsInRangeOf(std::uint64_t value) noexcept {
+  static_assert(std::is_integral<T>::value, "T must be an integer type.");
+
+  return value <= static_cast<std::uint64_t>(std::numeric_limits<T>::max());
+}
+
+/**
+ * The fixed-width integer type with the specified size and signedness.
+ */
+template <std::size_t kSize, bool kIsSigned>
+struct FixedWidthInteger;
+
+template <>
+struct FixedWidthInteger<1, true> { using type = std::int8_t; };
+
+template <>
+struct FixedWidthInteger<2, true> { using type = std::int16_t; };
+
+template <>
+struct FixedWidthInteger<4, true> { using type = std::int32_t; };
+
+template <>
+struct FixedWidthInteger<8, true> { using type = std::int64_t; };
+
+template <>
+struct FixedWidthInteger<1, false> { using type = std::uint8_t; };
+
+template <>
+struct FixedWidthInteger<2, false> { using type = std::uint16_t; };
+
+template <>
+struct FixedWidthInteger<4, false> { using type = std::uint32_t; };
+
+template <>
+struct FixedWidthInteger<8, false> { using type = std::uint64_t; };
+
+/**
+ * Maps a number type to the type that the number functions are instantiated
+ * for. Integer types with the same size and signedness, such as long and
+ * either int or long long, map to the same fixed-width type.
+ */
+template <typename T, bool kIsIntegral = std::is_integral<T>::value>
+struct CanonicalNumber {
+  using type = T;
+};
+
+template <typename T>
+struct CanonicalNumber<T, true> {
+  using type = typename FixedWidthInteger<sizeof(T), std::is_signed<T>::value>::type;
+};
+
+/**
+ * Widens a float to the double nearest to the float's shortest round-trip
+ * decimal representation. Both backends store numbers as doubles, so this
+ * makes 0.1f write as 0.1 instead of 0.10000000149011612. Narrowing the
+ * result gives back the original float.
+ */
+inline double WidenFloat(float value) noexcept {
+  if (!std::isfinite(value)) {
+    return value;
+  }
+
+  char buffer[32];
+  std::to_chars_result to_chars_result = std::to_chars(
+      buffer,
+      buffer + sizeof(buffer),
+      value
+  );
+
+  if (to_chars_result.ec != std::errc()) {
+    return value;
+  }
+
+  double double_value;
+  std::from_chars_result from_chars_result = std::from_chars(
+      buffer,
+      to_chars_result.ptr,
+      double_value
+  );
+
+  if (from_chars_result.ec != std::errc()
+      || static_cast<float>(double_value) != value) {
+    return value;
+  }
+
+  return double_value;
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_NUMBER_HPP_
@@ -0,0 +1,220 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_POINTER_HPP_
+#define MJSONI_JSON_POINTER_HPP_
+
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json_key.hpp"
+
+namespace mjsoni {
+
+/**
+ * Splits an RFC 6901 JSON Pointer into its unescaped reference tokens.
+ * Returns false if the pointer is malformed. The empty pointer refers to the
+ * whole document and produces no tokens.
+ */
+inline bool ParseJsonPointer(
+    std::string_view pointer,
+    std::vector<std::string>* reference_tokens
+) {
+  reference_tokens->clear();
+
+  if (pointer.empty()) {
+    return true;
+  }
+
+  if (pointer.front() != '/') {
+    return false;
+  }
+
+  std::size_t token_begin = 1;
+
+  while (true) {
+    std::size_t token_end = pointer.find('/', token_begin);
+    std::string_view escaped_token = pointer.substr(
+        token_begin,
+        token_end - token_begin
+    );
+
+    std::string token;
+    token.reserve(escaped_token.size());
+
+    for (std::size_t i = 0; i < escaped_token.size(); i += 1) {
+      if (escaped_token[i] != '~') {
+        token.push_back(escaped_token[i]);
+        continue;
+      }
+
+      // Only ~0 and ~1 are valid escape sequences.
+      if (i + 1 >= escaped_token.size()) {
+        return false;
+      }
+
+      i += 1;
+      if (escaped_token[i] == '0') {
+        token.push_back('~');
+      } else if (escaped_token[i] == '1') {
+        token.push_back('/');
+      } else {
+        return false;
+      }
+    }
+
+    reference_tokens->push_back(std::move(token));
+
+    if (token_end == std::string_view::npos) {
+      break;
+    }
+
+    token_begin = token_end + 1;
+  }
+
+  return true;
+}
+
+/**
+ * Escapes the reference token and appends it to the JSON Pointer.
+ */
+inline void AppendJsonPointerToken(
+    std::string* pointer,
+    std::string_view token
+) {
+  pointer->push_back('/');
+
+  for (char ch : token) {
+    if (ch == '~') {
+      pointer->append("~0");
+    } else if (ch == '/') {
+      pointer->append("~1");
+    } else {
+      pointer->push_back(ch);
+    }
+  }
+}
+
+/**
+ * Returns the JSON Pointer of the unescaped reference tokens, the inverse of
+ * ParseJsonPointer.
+ */
+inline std::string MakeJsonPointerFromTokens(
+    const std::vector<std::string>& reference_tokens
+) {
+  std::string pointer;
+  for (const std::string& reference_token : reference_tokens) {
+    AppendJsonPointerToken(&pointer, std::string_view(reference_token));
+  }
+
+  return pointer;
+}
+
+/**
+ * Appends the key to the JSON Pointer, as a decimal token if it is an array
+ * index.
+ */
+inline void AppendJsonPointerToken(
+    std::string* pointer,
+    const JsonKey& key
+) {
+  if (!key.is_index()) {
+    AppendJsonPointerToken(pointer, key.view());
+    return;
+  }
+
+  char index_text[24];
+  std::to_chars_result result = std::to_chars(
+      index_text,
+      index_text + sizeof(index_text),
+      key.index()
+  );
+
+  pointer->push_back('/');
+  pointer->append(index_text, result.ptr);
+}
+
+/**
+ * Returns a JSON Pointer built from a compile-time key pack, as accepted by
+ * the Get* and Set* functions.
+ */
+template <typename ...Args>
+inline std::string MakeJsonPointer(
+    const Args&... keys
+) {
+  std::string pointer;
+  (AppendJsonPointerToken(&pointer, ToJsonKey(keys)), ...);
+
+  return pointer;
+}
+
+/**
+ * Returns whether the prefix pointer refers to the same value as the pointer
+ * or to one of its ancestors.
+ */
+inline bool IsJsonPointerPrefix(
+    std::string_view prefix,
+    std::string_view pointer
+) {
+  if (pointer.size() < prefix.size()
+      || pointer.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+
+  return pointer.size() == prefix.size() || pointer[prefix.size()] == '/';
+}
+
+/**
+ * Parses a reference token as an array index. Leading zeros and any
+ * non-digit characters are rejected, as required by RFC 6901.
+ */
+inline bool ParseJsonPointerArrayIndex(
+    std::string_view token,
+    std::size_t* index
+) {
+  if (token.empty() || (token.size() > 1 && token.front() == '0')) {
+    return false;
+  }
+
+  std::size_t result = 0;
+
+  for (char ch : token) {
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+
+    if (result > (std::numeric_limits<std::size_t>::max() - 9) / 10) {
+      return false;
+    }
+
+    result = (result * 10) + (ch - '0');
+  }
+
+  *index = result;
+
+  return true;
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_POINTER_HPP_
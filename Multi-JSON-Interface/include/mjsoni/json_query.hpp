@@ -0,0 +1,749 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_QUERY_HPP_
+#define MJSONI_JSON_QUERY_HPP_
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "json_pointer.hpp"
+#include "json_scan.hpp"
+
+namespace mjsoni {
+
+enum class JsonQueryStepKind {
+  // Selects the object member with the name. Steps compiled from a JSON
+  // Pointer also select the array element if the name is an array index.
+  kMember,
+
+  // Selects the array element at the index. Negative indices count from
+  // the end of the array.
+  kIndex,
+
+  // Selects all members or elements.
+  kWildcard,
+
+  // Selects the array elements in the slice, as in Python.
+  kSlice,
+
+  // Selects the members or elements that satisfy the filter.
+  kFilter,
+};
+
+enum class JsonQueryOperator {
+  kExists,
+  kEqual,
+  kNotEqual,
+  kLess,
+  kLessEqual,
+  kGreater,
+  kGreaterEqual,
+};
+
+enum class JsonQueryValueKind {
+  kNull,
+  kBool,
+  kNumber,
+  kString,
+
+  // An object or an array, which filters only test for existence.
+  kStructured,
+};
+
+/**
+ * A view of a scalar JSON value, as compared by query filters.
+ */
+struct JsonQueryValueView {
+  JsonQueryValueKind kind;
+  bool bool_value;
+  double number_value;
+  std::string_view string_value;
+};
+
+struct JsonQueryStep {
+  JsonQueryStepKind kind;
+
+  // kMember
+  std::string name;
+  std::optional<std::size_t> array_index;
+
+  // kIndex
+  std::int64_t index = 0;
+
+  // kSlice
+  std::optional<std::int64_t> slice_start;
+  std::optional<std::int64_t> slice_end;
+  std::int64_t slice_step = 1;
+
+  // kFilter. The filter tests the value at the member names, relative to
+  // each candidate.
+  std::vector<std::string> filter_path;
+  JsonQueryOperator filter_operator = JsonQueryOperator::kExists;
+  JsonQueryValueKind filter_literal_kind = JsonQueryValueKind::kNull;
+  bool filter_literal_bool = false;
+  double filter_literal_number = 0;
+  std::string filter_literal_string;
+};
+
+/**
+ * A compiled query, evaluated by the readers' Query functions. Compiling is
+ * done once, so that a query can be evaluated many times without parsing
+ * the expression again.
+ */
+struct JsonQuery {
+  std::vector<JsonQueryStep> steps;
+};
+
+/**
+ * Compiles an RFC 6901 JSON Pointer into a query that selects at most one
+ * value. Returns false if the pointer is malformed.
+ */
+inline bool CompileJsonPointerQuery(
+    std::string_view pointer,
+    JsonQuery* query
+) {
+  std::vector<std::string> reference_tokens;
+  if (!ParseJsonPointer(pointer, &reference_tokens)) {
+    return false;
+  }
+
+  query->steps.clear();
+  query->steps.reserve(reference_tokens.size());
+
+  for (std::string& reference_token : reference_tokens) {
+    JsonQueryStep step;
+    step.kind = JsonQueryStepKind::kMember;
+
+    std::size_t index;
+    if (ParseJsonPointerArrayIndex(reference_token, &index)) {
+      step.array_index = index;
+    }
+
+    step.name = std::move(reference_token);
+    query->steps.push_back(std::move(step));
+  }
+
+  return true;
+}
+
+namespace detail {
+
+inline void SkipJsonQueryWhitespace(
+    std::string_view text,
+    std::size_t* offset
+) {
+  while (*offset < text.size() && IsJsonWhitespace(text[*offset])) {
+    *offset += 1;
+  }
+}
+
+constexpr bool IsJsonQueryNameChar(char ch) noexcept {
+  return (ch >= 'a' && ch <= 'z')
+      || (ch >= 'A' && ch <= 'Z')
+      || (ch >= '0' && ch <= '9')
+      || ch == '_'
+      || static_cast<unsigned char>(ch) >= 0x80;
+}
+
+inline bool ParseJsonQueryName(
+    std::string_view text,
+    std::size_t* offset,
+    std::string* name
+) {
+  std::size_t name_begin = *offset;
+  while (*offset < text.size() && IsJsonQueryNameChar(text[*offset])) {
+    *offset += 1;
+  }
+
+  name->assign(text.substr(name_begin, *offset - name_begin));
+
+  return !name->empty();
+}
+
+inline void AppendUtf8(
+    std::string* text,
+    std::uint32_t code_point
+) {
+  if (code_point < 0x80) {
+    text->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    text->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    text->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    text->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    text->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    text->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+/**
+ * Parses a single- or double-quoted string literal with JSON escapes.
+ * Escaped surrogates are rejected.
+ */
+inline bool ParseJsonQueryString(
+    std::string_view text,
+    std::size_t* offset,
+    std::string* value
+) {
+  char quote = text[*offset];
+  *offset += 1;
+
+  value->clear();
+
+  while (*offset < text.size()) {
+    char ch = text[*offset];
+    *offset += 1;
+
+    if (ch == quote) {
+      return true;
+    }
+
+    if (ch != '\\') {
+      value->push_back(ch);
+      continue;
+    }
+
+    if (*offset >= text.size()) {
+      return false;
+    }
+
+    char escaped_ch = text[*offset];
+    *offset += 1;
+
+    switch (escaped_ch) {
+      case '\\':
+      case '/':
+      case '\'':
+      case '"': {
+        value->push_back(escaped_ch);
+        break;
+      }
+
+      case 'b': {
+        value->push_back('\b');
+        break;
+      }
+
+      case 'f': {
+        value->push_back('\f');
+        break;
+      }
+
+      case 'n': {
+        value->push_back('\n');
+        break;
+      }
+
+      case 'r': {
+        value->push_back('\r');
+        break;
+      }
+
+      case 't': {
+        value->push_back('\t');
+        break;
+      }
+
+      case 'u': {
+        std::uint32_t code_point;
+        if (text.size() - *offset < 4) {
+          return false;
+        }
+
+        std::from_chars_result result = std::from_chars(
+            text.data() + *offset,
+            text.data() + *offset + 4,
+            code_point,
+            16
+        );
+
+        if (result.ec != std::errc()
+            || result.ptr != text.data() + *offset + 4
+            || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+          return false;
+        }
+
+        *offset += 4;
+        AppendUtf8(value, code_point);
+        break;
+      }
+
+      default: {
+        return false;
+      }
+    }
+  }
+
+  return false;
+}
+
+inline bool ParseJsonQueryInteger(
+    std::string_view text,
+    std::size_t* offset,
+    std::int64_t* value
+) {
+  std::from_chars_result result = std::from_chars(
+      text.data() + *offset,
+      text.data() + text.size(),
+      *value
+  );
+
+  if (result.ec != std::errc()) {
+    return false;
+  }
+
+  *offset = result.ptr - text.data();
+
+  return true;
+}
+
+inline bool ParseJsonQueryFilter(
+    std::string_view text,
+    std::size_t* offset,
+    JsonQueryStep* step
+) {
+  step->kind = JsonQueryStepKind::kFilter;
+
+  SkipJsonQueryWhitespace(text, offset);
+  bool is_parenthesized = *offset < text.size() && text[*offset] == '(';
+  if (is_parenthesized) {
+    *offset += 1;
+    SkipJsonQueryWhitespace(text, offset);
+  }
+
+  if (*offset >= text.size() || text[*offset] != '@') {
+    return false;
+  }
+
+  *offset += 1;
+
+  // The relative path is a sequence of .name and ['name'] segments.
+  while (*offset < text.size()) {
+    std::string name;
+
+    if (text[*offset] == '.') {
+      *offset += 1;
+      if (!ParseJsonQueryName(text, offset, &name)) {
+        return false;
+      }
+    } else if (text[*offset] == '[') {
+      *offset += 1;
+      SkipJsonQueryWhitespace(text, offset);
+      if (*offset >= text.size()
+          || (text[*offset] != '\'' && text[*offset] != '"')
+          || !ParseJsonQueryString(text, offset, &name)) {
+        return false;
+      }
+
+      SkipJsonQueryWhitespace(text, offset);
+      if (*offset >= text.size() || text[*offset] != ']') {
+        return false;
+      }
+
+      *offset += 1;
+    } else {
+      break;
+    }
+
+    step->filter_path.push_back(std::move(name));
+  }
+
+  SkipJsonQueryWhitespace(text, offset);
+
+  std::string_view operator_text = text.substr(*offset, 2);
+  if (operator_text == "==") {
+    step->filter_operator = JsonQueryOperator::kEqual;
+  } else if (operator_text == "!=") {
+    step->filter_operator = JsonQueryOperator::kNotEqual;
+  } else if (operator_text == "<=") {
+    step->filter_operator = JsonQueryOperator::kLessEqual;
+  } else if (operator_text == ">=") {
+    step->filter_operator = JsonQueryOperator::kGreaterEqual;
+  } else if (operator_text.substr(0, 1) == "<") {
+    step->filter_operator = JsonQueryOperator::kLess;
+  } else if (operator_text.substr(0, 1) == ">") {
+    step->filter_operator = JsonQueryOperator::kGreater;
+  } else {
+    step->filter_operator = JsonQueryOperator::kExists;
+  }
+
+  if (step->filter_operator != JsonQueryOperator::kExists) {
+    bool is_two_chars = step->filter_operator != JsonQueryOperator::kLess
+        && step->filter_operator != JsonQueryOperator::kGreater;
+    *offset += is_two_chars ? 2 : 1;
+
+    SkipJsonQueryWhitespace(text, offset);
+    if (*offset >= text.size()) {
+      return false;
+    }
+
+    std::string_view literal_text = text.substr(*offset);
+    if (literal_text.front() == '\'' || literal_text.front() == '"') {
+      step->filter_literal_kind = JsonQueryValueKind::kString;
+      if (!ParseJsonQueryString(text, offset, &step->filter_literal_string)) {
+        return false;
+      }
+    } else if (literal_text.substr(0, 4) == "true") {
+      step->filter_literal_kind = JsonQueryValueKind::kBool;
+      step->filter_literal_bool = true;
+      *offset += 4;
+    } else if (literal_text.substr(0, 5) == "false") {
+      step->filter_literal_kind = JsonQueryValueKind::kBool;
+      step->filter_literal_bool = false;
+      *offset += 5;
+    } else if (literal_text.substr(0, 4) == "null") {
+      step->filter_literal_kind = JsonQueryValueKind::kNull;
+      *offset += 4;
+    } else {
+      step->filter_literal_kind = JsonQueryValueKind::kNumber;
+
+      std::from_chars_result result = std::from_chars(
+          literal_text.data(),
+          literal_text.data() + literal_text.size(),
+          step->filter_literal_number
+      );
+
+      if (result.ec != std::errc()) {
+        return false;
+      }
+
+      *offset += result.ptr - literal_text.data();
+    }
+
+    SkipJsonQueryWhitespace(text, offset);
+  }
+
+  if (is_parenthesized) {
+    if (*offset >= text.size() || text[*offset] != ')') {
+      return false;
+    }
+
+    *offset += 1;
+    SkipJsonQueryWhitespace(text, offset);
+  }
+
+  return true;
+}
+
+/**
+ * Parses the selector between the brackets of a bracketed segment, which is
+ * a quoted name, a wildcard, an index, a slice or a filter.
+ */
+inline bool ParseJsonQuerySelector(
+    std::string_view text,
+    std::size_t* offset,
+    JsonQueryStep* step
+) {
+  SkipJsonQueryWhitespace(text, offset);
+  if (*offset >= text.size()) {
+    return false;
+  }
+
+  char ch = text[*offset];
+
+  if (ch == '\'' || ch == '"') {
+    step->kind = JsonQueryStepKind::kMember;
+    return ParseJsonQueryString(text, offset, &step->name);
+  }
+
+  if (ch == '*') {
+    step->kind = JsonQueryStepKind::kWildcard;
+    *offset += 1;
+    return true;
+  }
+
+  if (ch == '?') {
+    *offset += 1;
+    return ParseJsonQueryFilter(text, offset, step);
+  }
+
+  std::int64_t index;
+  bool has_index = ParseJsonQueryInteger(text, offset, &index);
+
+  SkipJsonQueryWhitespace(text, offset);
+  if (*offset >= text.size() || text[*offset] != ':') {
+    step->kind = JsonQueryStepKind::kIndex;
+    step->index = index;
+    return has_index;
+  }
+
+  step->kind = JsonQueryStepKind::kSlice;
+  if (has_index) {
+    step->slice_start = index;
+  }
+
+  *offset += 1;
+  SkipJsonQueryWhitespace(text, offset);
+  if (ParseJsonQueryInteger(text, offset, &index)) {
+    step->slice_end = index;
+  }
+
+  SkipJsonQueryWhitespace(text, offset);
+  if (*offset < text.size() && text[*offset] == ':') {
+    *offset += 1;
+    SkipJsonQueryWhitespace(text, offset);
+    ParseJsonQueryInteger(text, offset, &step->slice_step);
+  }
+
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * Compiles a JSONPath expression into a query. The supported subset is the
+ * root $, followed by any of these segments:
+ *
+ *   .name, ['name']   an object member
+ *   .*, [*]           all members or elements
+ *   [3], [-1]         an array element, counting from the end if negative
+ *   [1:10:2]          an array slice, whose bounds and step are optional
+ *   [?@.key op lit]   the members or elements that pass a filter
+ *
+ * A filter tests the value at a relative path of member names with one of
+ * ==, !=, <, <=, > or >= against a string, number, true, false or null
+ * literal, or tests only that the value exists if no operator is given. The
+ * filter may be parenthesized. Descendant segments and unions are not
+ * supported. Returns false if the expression is malformed.
+ */
+inline bool CompileJsonPathQuery(
+    std::string_view path,
+    JsonQuery* query
+) {
+  query->steps.clear();
+
+  std::size_t offset = 0;
+  detail::SkipJsonQueryWhitespace(path, &offset);
+  if (offset >= path.size() || path[offset] != '$') {
+    return false;
+  }
+
+  offset += 1;
+
+  while (true) {
+    detail::SkipJsonQueryWhitespace(path, &offset);
+    if (offset >= path.size()) {
+      return true;
+    }
+
+    JsonQueryStep step;
+
+    if (path[offset] == '.') {
+      offset += 1;
+      if (offset < path.size() && path[offset] == '*') {
+        step.kind = JsonQueryStepKind::kWildcard;
+        offset += 1;
+      } else {
+        step.kind = JsonQueryStepKind::kMember;
+        if (!detail::ParseJsonQueryName(path, &offset, &step.name)) {
+          return false;
+        }
+      }
+    } else if (path[offset] == '[') {
+      offset += 1;
+      if (!detail::ParseJsonQuerySelector(path, &offset, &step)) {
+        return false;
+      }
+
+      detail::SkipJsonQueryWhitespace(path, &offset);
+      if (offset >= path.size() || path[offset] != ']') {
+        return false;
+      }
+
+      offset += 1;
+    } else {
+      return false;
+    }
+
+    query->steps.push_back(std::move(step));
+  }
+}
+
+/**
+ * Compiles a JSONPath expression if it starts with $, or a JSON Pointer
+ * otherwise.
+ */
+inline bool CompileJsonQuery(
+    std::string_view expression,
+    JsonQuery* query
+) {
+  if (!expression.empty() && expression.front() == '$') {
+    return CompileJsonPathQuery(expression, query);
+  }
+
+  return CompileJsonPointerQuery(expression, query);
+}
+
+/**
+ * Resolves a possibly negative index of a kIndex step against an array of
+ * the specified size. Returns false if the index is out of bounds.
+ */
+inline bool NormalizeJsonQueryIndex(
+    std::int64_t index,
+    std::size_t size,
+    std::size_t* normalized_index
+) {
+  std::int64_t signed_size = static_cast<std::int64_t>(size);
+  if (index < 0) {
+    index += signed_size;
+  }
+
+  if (index < 0 || index >= signed_size) {
+    return false;
+  }
+
+  *normalized_index = static_cast<std::size_t>(index);
+
+  return true;
+}
+
+/**
+ * Calls the function with each index selected by a kSlice step from an
+ * array of the specified size, in slice order. Stops and returns false as
+ * soon as the function returns false.
+ */
+template <typename Function>
+bool ForEachJsonQuerySliceIndex(
+    const JsonQueryStep& step,
+    std::size_t size,
+    Function function
+) {
+  std::int64_t signed_size = static_cast<std::int64_t>(size);
+  std::int64_t slice_step = step.slice_step;
+
+  if (slice_step == 0) {
+    return true;
+  }
+
+  auto normalize = [signed_size](std::int64_t index) {
+    return (index >= 0) ? index : signed_size + index;
+  };
+
+  if (slice_step > 0) {
+    std::int64_t lower = std::clamp<std::int64_t>(
+        normalize(step.slice_start.value_or(0)),
+        0,
+        signed_size
+    );
+    std::int64_t upper = std::clamp<std::int64_t>(
+        step.slice_end.has_value() ? normalize(*step.slice_end) : signed_size,
+        0,
+        signed_size
+    );
+
+    for (std::int64_t i = lower; i < upper; i += slice_step) {
+      if (!function(static_cast<std::size_t>(i))) {
+        return false;
+      }
+    }
+  } else {
+    std::int64_t upper = std::clamp<std::int64_t>(
+        step.slice_start.has_value() ? normalize(*step.slice_start) : signed_size - 1,
+        -1,
+        signed_size - 1
+    );
+    std::int64_t lower = std::clamp<std::int64_t>(
+        step.slice_end.has_value() ? normalize(*step.slice_end) : -1,
+        -1,
+        signed_size - 1
+    );
+
+    for (std::int64_t i = upper; i > lower; i += slice_step) {
+      if (!function(static_cast<std::size_t>(i))) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Returns whether the value passes the comparison of a kFilter step. Values
+ * of different kinds are only ever unequal, and only numbers and strings
+ * are ordered.
+ */
+inline bool MatchesJsonQueryFilter(
+    const JsonQueryStep& step,
+    const JsonQueryValueView& value
+) {
+  if (step.filter_operator == JsonQueryOperator::kExists) {
+    return true;
+  }
+
+  int comparison;
+  if (value.kind != step.filter_literal_kind) {
+    return step.filter_operator == JsonQueryOperator::kNotEqual;
+  } else if (value.kind == JsonQueryValueKind::kNumber) {
+    comparison = (value.number_value < step.filter_literal_number)
+        ? -1
+        : (value.number_value > step.filter_literal_number) ? 1 : 0;
+  } else if (value.kind == JsonQueryValueKind::kString) {
+    comparison = value.string_value.compare(step.filter_literal_string);
+  } else if (value.kind == JsonQueryValueKind::kBool) {
+    bool is_equal = value.bool_value == step.filter_literal_bool;
+    return (step.filter_operator == JsonQueryOperator::kEqual && is_equal)
+        || (step.filter_operator == JsonQueryOperator::kNotEqual && !is_equal);
+  } else {
+    // Both are null.
+    return step.filter_operator == JsonQueryOperator::kEqual;
+  }
+
+  switch (step.filter_operator) {
+    case JsonQueryOperator::kEqual: {
+      return comparison == 0;
+    }
+
+    case JsonQueryOperator::kNotEqual: {
+      return comparison != 0;
+    }
+
+    case JsonQueryOperator::kLess: {
+      return comparison < 0;
+    }
+
+    case JsonQueryOperator::kLessEqual: {
+      return comparison <= 0;
+    }
+
+    case JsonQueryOperator::kGreater: {
+      return comparison > 0;
+    }
+
+    case JsonQueryOperator::kGreaterEqual: {
+      return comparison >= 0;
+    }
+
+    default: {
+      return false;
+    }
+  }
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_QUERY_HPP_
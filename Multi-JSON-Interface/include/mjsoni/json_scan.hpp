@@ -0,0 +1,577 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_JSON_SCAN_HPP_
+#define MJSONI_JSON_SCAN_HPP_
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "json_pointer.hpp"
+
+namespace mjsoni {
+
+/**
+ * The structure of the root container of a JSON text, as found by
+ * ScanJsonTopLevel. Offsets are relative to the start of the text.
+ */
+struct JsonTopLevelScan {
+  // Either '{' or '['.
+  char open_bracket;
+
+  // The offsets of the opening and closing brackets of the root container.
+  std::size_t open_offset;
+  std::size_t close_offset;
+
+  // The offsets of the commas that separate the root container's members or
+  // elements.
+  std::vector<std::size_t> comma_offsets;
+};
+
+/**
+ * Returns whether the character is JSON whitespace.
+ */
+constexpr bool IsJsonWhitespace(char ch) noexcept {
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+/**
+ * Finds the bracket offsets and top-level commas of a JSON text whose root
+ * is an object or an array, without parsing any values. Returns false if the
+ * root is not a container, or if the brackets and strings are not balanced.
+ * Passing the scan does not imply that the text is valid JSON.
+ */
+inline bool ScanJsonTopLevel(
+    std::string_view text,
+    JsonTopLevelScan* scan
+) {
+  std::size_t offset = 0;
+  while (offset < text.size() && IsJsonWhitespace(text[offset])) {
+    offset += 1;
+  }
+
+  if (offset >= text.size() || (text[offset] != '{' && text[offset] != '[')) {
+    return false;
+  }
+
+  scan->open_bracket = text[offset];
+  scan->open_offset = offset;
+  scan->comma_offsets.clear();
+
+  std::size_t depth = 0;
+
+  for (; offset < text.size(); offset += 1) {
+    char ch = text[offset];
+
+    if (ch == '"') {
+      // Skip to the closing quote, stepping over escape sequences.
+      offset += 1;
+      while (offset < text.size() && text[offset] != '"') {
+        if (text[offset] == '\\') {
+          offset += 1;
+        }
+
+        offset += 1;
+      }
+
+      if (offset >= text.size()) {
+        return false;
+      }
+    } else if (ch == '{' || ch == '[') {
+      depth += 1;
+    } else if (ch == '}' || ch == ']') {
+      depth -= 1;
+
+      if (depth == 0) {
+        break;
+      }
+    } else if (ch == ',' && depth == 1) {
+      scan->comma_offsets.push_back(offset);
+    }
+  }
+
+  if (offset >= text.size()) {
+    return false;
+  }
+
+  char expected_close_bracket = (scan->open_bracket == '{') ? '}' : ']';
+  if (text[offset] != expected_close_bracket) {
+    return false;
+  }
+
+  scan->close_offset = offset;
+
+  // Only whitespace may follow the root container.
+  for (offset += 1; offset < text.size(); offset += 1) {
+    if (!IsJsonWhitespace(text[offset])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Picks up to chunk_count - 1 top-level commas that split the root container
+ * into chunks of roughly equal size. The returned offsets are ascending.
+ */
+inline std::vector<std::size_t> SelectJsonSplitOffsets(
+    const JsonTopLevelScan& scan,
+    std::size_t chunk_count
+) {
+  std::vector<std::size_t> split_offsets;
+
+  std::size_t content_size = scan.close_offset - scan.open_offset;
+
+  for (std::size_t i = 1; i < chunk_count; i += 1) {
+    std::size_t target_offset = scan.open_offset + ((content_size * i) / chunk_count);
+
+    std::vector<std::size_t>::const_iterator it = std::lower_bound(
+        scan.comma_offsets.cbegin(),
+        scan.comma_offsets.cend(),
+        target_offset
+    );
+
+    if (it == scan.comma_offsets.cend()) {
+      break;
+    }
+
+    if (split_offsets.empty() || split_offsets.back() < *it) {
+      split_offsets.push_back(*it);
+    }
+  }
+
+  return split_offsets;
+}
+
+/**
+ * A read-only stream buffer over a chunk of a JSON text, wrapped in the
+ * brackets of the root container, so that a parser can read the chunk as a
+ * document of its own without it being copied. The text must outlive the
+ * stream buffer.
+ */
+class JsonChunkStreamBuf : public std::streambuf {
+ public:
+  JsonChunkStreamBuf(
+      std::string_view chunk,
+      char open_bracket,
+      char close_bracket
+  ) : chunk_(chunk),
+      brackets_{ open_bracket, close_bracket } {
+    this->setg(&this->brackets_[0], &this->brackets_[0], &this->brackets_[1]);
+  }
+
+  JsonChunkStreamBuf(const JsonChunkStreamBuf&) = delete;
+
+  JsonChunkStreamBuf& operator=(const JsonChunkStreamBuf&) = delete;
+
+ protected:
+  int_type underflow() override {
+    // The get area moves from the open bracket to the chunk, and then to the
+    // close bracket. It is never written to.
+    if (this->part_ == Part::kOpenBracket) {
+      this->part_ = Part::kChunk;
+
+      if (!this->chunk_.empty()) {
+        char* chunk_data = const_cast<char*>(this->chunk_.data());
+        this->setg(chunk_data, chunk_data, chunk_data + this->chunk_.size());
+
+        return traits_type::to_int_type(*chunk_data);
+      }
+    }
+
+    if (this->part_ == Part::kChunk) {
+      this->part_ = Part::kCloseBracket;
+      this->setg(&this->brackets_[1], &this->brackets_[1], &this->brackets_[2]);
+
+      return traits_type::to_int_type(this->brackets_[1]);
+    }
+
+    return traits_type::eof();
+  }
+
+ private:
+  enum class Part {
+    kOpenBracket,
+    kChunk,
+    kCloseBracket,
+  };
+
+  std::string_view chunk_;
+  char brackets_[2];
+  Part part_ = Part::kOpenBracket;
+};
+
+/**
+ * The byte range of a value in a JSON text, from its first character to just
+ * past its last one.
+ */
+struct JsonSpan {
+  std::size_t begin;
+  std::size_t end;
+};
+
+/**
+ * Returns the offset of the first non-whitespace character at or after the
+ * offset, or the size of the text if there is none.
+ */
+inline std::size_t SkipJsonWhitespace(
+    std::string_view text,
+    std::size_t offset
+) {
+  while (offset < text.size() && IsJsonWhitespace(text[offset])) {
+    offset += 1;
+  }
+
+  return offset;
+}
+
+/**
+ * Returns the offset just past the string whose opening quote is at the
+ * offset, or npos if the string is not terminated.
+ */
+inline std::size_t SkipJsonString(
+    std::string_view text,
+    std::size_t offset
+) {
+  for (offset += 1; offset < text.size(); offset += 1) {
+    if (text[offset] == '\\') {
+      offset += 1;
+    } else if (text[offset] == '"') {
+      return offset + 1;
+    }
+  }
+
+  return std::string_view::npos;
+}
+
+/**
+ * Returns the offset just past the value that starts at the offset, or npos
+ * if the value is not terminated. Containers are skipped by balancing their
+ * brackets, and other values end at the next delimiter, so the value is not
+ * validated.
+ */
+inline std::size_t SkipJsonValue(
+    std::string_view text,
+    std::size_t offset
+) {
+  if (offset >= text.size()) {
+    return std::string_view::npos;
+  }
+
+  if (text[offset] == '"') {
+    return SkipJsonString(text, offset);
+  }
+
+  if (text[offset] == '{' || text[offset] == '[') {
+    std::size_t depth = 0;
+
+    while (offset < text.size()) {
+      char ch = text[offset];
+
+      if (ch == '"') {
+        offset = SkipJsonString(text, offset);
+        if (offset == std::string_view::npos) {
+          return std::string_view::npos;
+        }
+
+        continue;
+      }
+
+      if (ch == '{' || ch == '[') {
+        depth += 1;
+      } else if (ch == '}' || ch == ']') {
+        depth -= 1;
+
+        if (depth == 0) {
+          return offset + 1;
+        }
+      }
+
+      offset += 1;
+    }
+
+    return std::string_view::npos;
+  }
+
+  std::size_t begin = offset;
+  while (offset < text.size()
+      && !IsJsonWhitespace(text[offset])
+      && text[offset] != ','
+      && text[offset] != '}'
+      && text[offset] != ']') {
+    offset += 1;
+  }
+
+  return (offset == begin) ? std::string_view::npos : offset;
+}
+
+/**
+ * Parses the four hexadecimal digits of a \u escape sequence at the offset.
+ */
+inline bool ParseJsonHexCodeUnit(
+    std::string_view escaped,
+    std::size_t offset,
+    std::uint32_t* code_unit
+) {
+  if (offset > escaped.size() || escaped.size() - offset < 4) {
+    return false;
+  }
+
+  std::from_chars_result result = std::from_chars(
+      escaped.data() + offset,
+      escaped.data() + offset + 4,
+      *code_unit,
+      16
+  );
+
+  return result.ec == std::errc() && result.ptr == escaped.data() + offset + 4;
+}
+
+/**
+ * Unescapes the contents of a JSON string, without its quotes, into UTF-8.
+ * Returns false if an escape sequence is malformed.
+ */
+inline bool UnescapeJsonString(
+    std::string_view escaped,
+    std::string* str
+) {
+  str->clear();
+
+  for (std::size_t i = 0; i < escaped.size(); i += 1) {
+    if (escaped[i] != '\\') {
+      str->push_back(escaped[i]);
+      continue;
+    }
+
+    i += 1;
+    if (i >= escaped.size()) {
+      return false;
+    }
+
+    switch (escaped[i]) {
+      case '\\':
+      case '/':
+      case '"': {
+        str->push_back(escaped[i]);
+        break;
+      }
+
+      case 'b': {
+        str->push_back('\b');
+        break;
+      }
+
+      case 'f': {
+        str->push_back('\f');
+        break;
+      }
+
+      case 'n': {
+        str->push_back('\n');
+        break;
+      }
+
+      case 'r': {
+        str->push_back('\r');
+        break;
+      }
+
+      case 't': {
+        str->push_back('\t');
+        break;
+      }
+
+      case 'u': {
+        std::uint32_t code_point;
+        if (!ParseJsonHexCodeUnit(escaped, i + 1, &code_point)) {
+          return false;
+        }
+
+        i += 4;
+
+        // A high surrogate must be followed by an escaped low surrogate.
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+          std::uint32_t low_surrogate;
+          if (escaped.substr(i + 1, 2) != "\\u"
+              || !ParseJsonHexCodeUnit(escaped, i + 3, &low_surrogate)
+              || low_surrogate < 0xDC00
+              || low_surrogate > 0xDFFF) {
+            return false;
+          }
+
+          i += 6;
+          code_point = 0x10000
+              + ((code_point - 0xD800) << 10)
+              + (low_surrogate - 0xDC00);
+        }
+
+        if (code_point < 0x80) {
+          str->push_back(static_cast<char>(code_point));
+        } else if (code_point < 0x800) {
+          str->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+          str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else if (code_point < 0x10000) {
+          str->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+          str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+          str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        } else {
+          str->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+          str->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+          str->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+          str->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+
+        break;
+      }
+
+      default: {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Finds the span of the value at the first count reference tokens in a JSON
+ * text, skipping over the values before it without parsing them. If an
+ * object has several members with the same name, then the first one is
+ * found. Returns false if there is no such value.
+ */
+inline bool FindJsonValueSpan(
+    std::string_view text,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t count,
+    JsonSpan* span
+) {
+  std::size_t offset = SkipJsonWhitespace(text, 0);
+  std::string name;
+
+  for (std::size_t i = 0; i < count; i += 1) {
+    if (offset >= text.size()) {
+      return false;
+    }
+
+    const std::string& reference_token = reference_tokens[i];
+
+    if (text[offset] == '{') {
+      offset = SkipJsonWhitespace(text, offset + 1);
+
+      bool is_found = false;
+      while (offset < text.size() && text[offset] == '"') {
+        std::size_t name_end = SkipJsonString(text, offset);
+        if (name_end == std::string_view::npos) {
+          return false;
+        }
+
+        // Names are only unescaped if they have escape sequences.
+        std::string_view escaped_name = text.substr(
+            offset + 1,
+            name_end - offset - 2
+        );
+
+        bool is_match;
+        if (escaped_name.find('\\') == std::string_view::npos) {
+          is_match = (escaped_name == reference_token);
+        } else {
+          if (!UnescapeJsonString(escaped_name, &name)) {
+            return false;
+          }
+
+          is_match = (name == reference_token);
+        }
+
+        offset = SkipJsonWhitespace(text, name_end);
+        if (offset >= text.size() || text[offset] != ':') {
+          return false;
+        }
+
+        offset = SkipJsonWhitespace(text, offset + 1);
+
+        if (is_match) {
+          is_found = true;
+          break;
+        }
+
+        offset = SkipJsonValue(text, offset);
+        if (offset == std::string_view::npos) {
+          return false;
+        }
+
+        offset = SkipJsonWhitespace(text, offset);
+        if (offset < text.size() && text[offset] == ',') {
+          offset = SkipJsonWhitespace(text, offset + 1);
+        }
+      }
+
+      if (!is_found) {
+        return false;
+      }
+    } else if (text[offset] == '[') {
+      std::size_t index;
+      if (!ParseJsonPointerArrayIndex(reference_token, &index)) {
+        return false;
+      }
+
+      offset = SkipJsonWhitespace(text, offset + 1);
+      if (offset >= text.size() || text[offset] == ']') {
+        return false;
+      }
+
+      for (std::size_t j = 0; j < index; j += 1) {
+        offset = SkipJsonValue(text, offset);
+        if (offset == std::string_view::npos) {
+          return false;
+        }
+
+        offset = SkipJsonWhitespace(text, offset);
+        if (offset >= text.size() || text[offset] != ',') {
+          return false;
+        }
+
+        offset = SkipJsonWhitespace(text, offset + 1);
+      }
+    } else {
+      return false;
+    }
+  }
+
+  std::size_t value_end = SkipJsonValue(text, offset);
+  if (value_end == std::string_view::npos) {
+    return false;
+  }
+
+  span->begin = offset;
+  span->end = value_end;
+
+  return true;
+}
+
+} // namespace mjsoni
+
+#endif // MJSONI_JSON_SCAN_HPP_
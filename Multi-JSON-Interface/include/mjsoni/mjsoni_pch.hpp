@@ -0,0 +1,70 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_MJSONI_PCH_HPP_
+#define MJSONI_MJSONI_PCH_HPP_
+
+/**
+ * A header suitable for precompilation. It includes every backend that is
+ * available, together with the standard headers that the readers use, e.g.
+ *
+ *   g++ -std=c++17 -x c++-header mjsoni/mjsoni_pch.hpp -o mjsoni_pch.hpp.gch
+ *
+ * Combine it with MJSONI_EXTERN_TEMPLATES to also avoid recompiling the
+ * non-template members in each translation unit.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <istream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "config_reader_pool.hpp"
+#include "generic_json_config_reader.hpp"
+
+#if __has_include(<rapidjson/document.h>)
+#include "rapid_json_config_reader.hpp"
+#endif
+
+#if __has_include(<nlohmann/json.hpp>)
+#include "nlohmann_json_config_reader.hpp"
+#endif
+
+#endif // MJSONI_MJSONI_PCH_HPP_
@@ -0,0 +1,3176 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MJSONI_NLOHMANN_JSON_CONFIG_READER_HPP_
+#define MJSONI_NLOHMANN_JSON_CONFIG_READER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include "generic_json_config_reader.hpp"
+
+namespace mjsoni {
+
+using NlohmannJsonConfigReader = GenericConfigReader<nlohmann::json, nlohmann::json, nlohmann::json>;
+
+/* Constructors and Destructors */
+
+template <>
+inline NlohmannJsonConfigReader::GenericConfigReader(
+    std::filesystem::path config_file_path,
+    std::pmr::memory_resource* memory_resource
+) : config_file_path_(std::move(config_file_path)),
+    memory_resource_(
+        (memory_resource != nullptr)
+            ? memory_resource
+            : std::pmr::get_default_resource()
+    ),
+    json_document_(nlohmann::json::object()),
+    file_format_(JsonFileFormatFromExtension(this->config_file_path_)) {
+}
+
+/* Functions for Generic Types */
+
+template <>
+template <typename Container, typename ...Args>
+Container NlohmannJsonConfigReader::GetArrayCopy(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  using ElementType = typename Container::value_type;
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  Container container;
+  if constexpr (std::is_same<ElementType, std::string_view>::value) {
+    for (nlohmann::json::const_iterator it = value_ref.cbegin(); it != value_ref.cend(); it++) {
+      container.insert(
+          container.end(),
+          it->get_ref<const std::string&>()
+      );
+    }
+  } else if constexpr (std::is_same<ElementType, std::filesystem::path>::value) {
+    for (nlohmann::json::const_iterator it = value_ref.cbegin(); it != value_ref.cend(); it++) {
+      container.insert(
+          container.end(),
+          std::filesystem::path(it->get_ref<const std::string&>())
+      );
+    }
+  } else {
+    for (nlohmann::json::const_iterator it = value_ref.cbegin(); it != value_ref.cend(); it++) {
+      container.insert(
+          container.end(),
+          it->template get<ElementType>()
+      );
+    }
+  }
+
+  return container;
+}
+
+template <>
+template <typename Iter, typename ...Args>
+void NlohmannJsonConfigReader::SetArray(
+    Iter first,
+    Iter last,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  using ElementType = typename std::iterator_traits<Iter>::value_type;
+
+  nlohmann::json json_array = nlohmann::json::array();
+
+  if constexpr (std::is_same<ElementType, std::string_view>::value) {
+    for (Iter it = first; it != last; it++) {
+      json_array.push_back(std::string(*it));
+    }
+  } else if constexpr (std::is_same<ElementType, std::filesystem::path>::value) {
+    for (Iter it = first; it != last; it++) {
+      json_array.push_back(it->string());
+    }
+  } else {
+    for (Iter it = first; it != last; it++) {
+      json_array.push_back(*it);
+    }
+  }
+
+  this->SetValue(
+      std::move(json_array),
+      keys...
+  );
+}
+
+template <>
+template <typename Iter, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepArray(
+    Iter first,
+    Iter last,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  using ElementType = typename std::iterator_traits<Iter>::value_type;
+
+  nlohmann::json json_array = nlohmann::json::array();
+
+  if constexpr (std::is_same<ElementType, std::string_view>::value) {
+    for (Iter it = first; it != last; it++) {
+      json_array.push_back(std::string(*it));
+    }
+  } else if constexpr (std::is_same<ElementType, std::filesystem::path>::value) {
+    for (Iter it = first; it != last; it++) {
+      json_array.push_back(it->string());
+    }
+  } else {
+    for (Iter it = first; it != last; it++) {
+      json_array.push_back(*it);
+    }
+  }
+
+  this->SetDeepValue(
+      std::move(json_array),
+      keys...
+  );
+}
+
+/* Functions for bool */
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::GetBool(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.get<bool>();
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::GetBoolOrDefault(
+    bool default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasBool(keys...)) {
+    return default_value;
+  }
+
+  return this->GetBool(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasBool(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->ContainsKey(keys...)) {
+    return false;
+  }
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.is_boolean();
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetBool(
+    bool value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetValue(
+      nlohmann::json(value),
+      keys...
+  );
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetDeepBool(
+    bool value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepValue(
+      nlohmann::json(value),
+      keys...
+  );
+}
+
+/* Functions for std::deque */
+
+template <>
+template <typename T, typename ...Args>
+std::deque<T> NlohmannJsonConfigReader::GetDeque(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  return this->GetArrayCopy<std::deque<T>>(
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+std::deque<T> NlohmannJsonConfigReader::GetDequeOrDefault(
+    const std::deque<T>& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasDeque(keys...)) {
+    return default_value;
+  }
+
+  return this->GetDeque<T>(keys...);
+}
+
+template <>
+template <typename T, typename ...Args>
+std::deque<T> NlohmannJsonConfigReader::GetDequeOrDefault(
+    std::deque<T>&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasDeque(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetDeque<T>(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasDeque(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->ContainsKey(keys...)) {
+    return false;
+  }
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.is_array();
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeque(
+    const std::deque<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeque(
+    std::deque<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepDeque(
+    const std::deque<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepDeque(
+    std::deque<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+/* Functions for std::filesystem::path */
+
+template <>
+template <typename ...Args>
+std::filesystem::path NlohmannJsonConfigReader::GetPath(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return std::filesystem::path(value_ref.get_ref<const std::string&>());
+}
+
+template <>
+template <typename ...Args>
+std::filesystem::path NlohmannJsonConfigReader::GetPathOrDefault(
+    const std::filesystem::path& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasPath(keys...)) {
+    return default_value;
+  }
+
+  return this->GetPath(keys...);
+}
+
+template <>
+template <typename ...Args>
+std::filesystem::path NlohmannJsonConfigReader::GetPathOrDefault(
+    std::filesystem::path&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasPath(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetPath(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasPath(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  return this->HasString(
+      keys...
+  );
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetPath(
+    const std::filesystem::path& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetString(
+      value.string(),
+      keys...
+  );
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetDeepPath(
+    const std::filesystem::path& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepString(
+      value.string(),
+      keys...
+  );
+}
+
+/* Functions for std::set */
+
+template <>
+template <typename T, typename ...Args>
+std::set<T> NlohmannJsonConfigReader::GetSet(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  return this->GetArrayCopy<std::set<T>>(
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+std::set<T> NlohmannJsonConfigReader::GetSetOrDefault(
+    const std::set<T>& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasSet(keys...)) {
+    return default_value;
+  }
+
+  return this->GetSet<T>(keys...);
+}
+
+template <>
+template <typename T, typename ...Args>
+std::set<T> NlohmannJsonConfigReader::GetSetOrDefault(
+    std::set<T>&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasSet(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetSet<T>(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasSet(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->ContainsKey(keys...)) {
+    return false;
+  }
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.is_array();
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetSet(
+    const std::set<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetSet(
+    std::set<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepSet(
+    const std::set<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepSet(
+    std::set<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+/* Functions for std::string */
+
+template <>
+template <typename ...Args>
+std::string NlohmannJsonConfigReader::GetString(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.get<std::string>();
+}
+
+template <>
+template <typename ...Args>
+std::string NlohmannJsonConfigReader::GetStringOrDefault(
+    const std::string& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasString(keys...)) {
+    return default_value;
+  }
+
+  return this->GetString(keys...);
+}
+
+template <>
+template <typename ...Args>
+std::string NlohmannJsonConfigReader::GetStringOrDefault(
+    std::string&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasString(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetString(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasString(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->ContainsKey(keys...)) {
+    return false;
+  }
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.is_string();
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetString(
+    const std::string& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetValue(
+      nlohmann::json(value),
+      keys...
+  );
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetString(
+    std::string&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetValue(
+      nlohmann::json(std::move(value)),
+      keys...
+  );
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetDeepString(
+    const std::string& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepValue(
+      nlohmann::json(value),
+      keys...
+  );
+}
+
+template <>
+template <typename ...Args>
+void NlohmannJsonConfigReader::SetDeepString(
+    std::string&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepValue(
+      nlohmann::json(std::move(value)),
+      keys...
+  );
+}
+
+/* Functions for std::unordered_set */
+
+template <>
+template <typename T, typename ...Args>
+std::unordered_set<T> NlohmannJsonConfigReader::GetUnorderedSet(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  return this->GetArrayCopy<std::unordered_set<T>>(
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+std::unordered_set<T> NlohmannJsonConfigReader::GetUnorderedSetOrDefault(
+    const std::unordered_set<T>& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasUnorderedSet(keys...)) {
+    return default_value;
+  }
+
+  return this->GetUnorderedSet<T>(keys...);
+}
+
+template <>
+template <typename T, typename ...Args>
+std::unordered_set<T> NlohmannJsonConfigReader::GetUnorderedSetOrDefault(
+    std::unordered_set<T>&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasUnorderedSet(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetUnorderedSet<T>(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasUnorderedSet(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->ContainsKey(keys...)) {
+    return false;
+  }
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.is_array();
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetUnorderedSet(
+    const std::unordered_set<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetUnorderedSet(
+    std::unordered_set<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepUnorderedSet(
+    const std::unordered_set<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepUnorderedSet(
+    std::unordered_set<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+/* Functions for std::vector */
+
+template <>
+template <typename T, typename ...Args>
+std::vector<T> NlohmannJsonConfigReader::GetVector(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  return this->GetArrayCopy<std::vector<T>>(
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+std::vector<T> NlohmannJsonConfigReader::GetVectorOrDefault(
+    const std::vector<T>& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasVector(keys...)) {
+    return default_value;
+  }
+
+  return this->GetVector<T>(keys...);
+}
+
+template <>
+template <typename T, typename ...Args>
+std::vector<T> NlohmannJsonConfigReader::GetVectorOrDefault(
+    std::vector<T>&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasVector(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetVector<T>(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool NlohmannJsonConfigReader::HasVector(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->ContainsKey(keys...)) {
+    return false;
+  }
+
+  const nlohmann::json& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.is_array();
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetVector(
+    const std::vector<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetVector(
+    std::vector<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepVector(
+    const std::vector<T>& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
+}
+
+template <>
+template <typename T, typename ...Args>
+void NlohmannJsonConfigReader::SetDeepVector(
+    std::vector<T>&& value,
+    const Args&... keys
+) {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  this->SetDeepArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
+}
+
+/* Private Helper Functions */
+
+template <>
+inline const nlohmann::json* NlohmannJsonConfigReader::FindValue(
+    const nlohmann::json& object,
+    std::string_view key
+) {
+  if (!object.is_object()) {
+    return nullptr;
+  }
+
+  nlohmann::json::const_iterator it = object.find(key);
+  if (it == object.cend()) {
+    return nullptr;
+  }
+
+  return &*it;
+}
+
+template <>
+inline const nlohmann::json* NlohmannJsonConfigReader::FindValue(
+    const nlohmann::json& object,
+    const JsonKey& key
+) {
+  // Index keys select array elements directly.
+  if (key.is_index()) {
+    if (!object.is_array() || key.index() >= object.size()) {
+      return nullptr;
+    }
+
+    return &object[key.index()];
+  }
+
+  // Objects are ordered maps here, so the member lookup is already
+  // logarithmic and only benefits from the key's known length.
+  return FindValue(object, key.view());
+}
+
+template <>
+inline nlohmann::json* NlohmannJsonConfigReader::FindValue(
+    nlohmann::json& object,
+    std::string_view key
+) {
+  return const_cast<nlohmann::json*>(
+      FindValue(static_cast<const nlohmann::json&>(object), key)
+  );
+}
+
+template <>
+inline nlohmann::json* NlohmannJsonConfigReader::FindValue(
+    nlohmann::json& object,
+    const JsonKey& key
+) {
+  return const_cast<nlohmann::json*>(
+      FindValue(static_cast<const nlohmann::json&>(object), key)
+  );
+}
+
+template <>
+inline const nlohmann::json* NlohmannJsonConfigReader::FindValueByKeys(
+    const nlohmann::json& root,
+    std::initializer_list<JsonKey> keys
+) {
+  const nlohmann::json* value_ptr = &root;
+
+  for (const JsonKey& key : keys) {
+    value_ptr = FindValue(*value_ptr, key);
+    if (value_ptr == nullptr) {
+      return nullptr;
+    }
+  }
+
+  return value_ptr;
+}
+
+template <>
+inline nlohmann::json* NlohmannJsonConfigReader::FindValueByKeys(
+    nlohmann::json& root,
+    std::initializer_list<JsonKey> keys
+) {
+  return const_cast<nlohmann::json*>(
+      FindValueByKeys(static_cast<const nlohmann::json&>(root), keys)
+  );
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::SetValueByKeys(
+    nlohmann::json value,
+    std::initializer_list<JsonKey> keys
+) {
+  // Every key but the last one has to lead to an existing object, or to an
+  // existing array if the last key is an index.
+  nlohmann::json* object_ptr = &this->json_document_;
+
+  const JsonKey* last_key_ptr = keys.end() - 1;
+  for (const JsonKey* key_ptr = keys.begin(); key_ptr != last_key_ptr; key_ptr++) {
+    object_ptr = FindValue(*object_ptr, *key_ptr);
+    if (object_ptr == nullptr) {
+      return false;
+    }
+  }
+
+  // An element is replaced if it exists, or appended if the index is the
+  // size of the array.
+  if (last_key_ptr->is_index()) {
+    if (!object_ptr->is_array() || last_key_ptr->index() > object_ptr->size()) {
+      return false;
+    }
+
+    if (last_key_ptr->index() < object_ptr->size()) {
+      (*object_ptr)[last_key_ptr->index()] = std::move(value);
+    } else {
+      object_ptr->push_back(std::move(value));
+    }
+
+    return true;
+  }
+
+  if (!object_ptr->is_object()) {
+    return false;
+  }
+
+  // Assigning through operator[] adds the key-value if it does not exist.
+  (*object_ptr)[std::string(last_key_ptr->view())] = std::move(value);
+
+  return true;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::SetDeepValueByKeys(
+    nlohmann::json value,
+    std::initializer_list<JsonKey> keys
+) {
+  // An index past the bound leaves the document unchanged, so the key path
+  // is checked before anything is created. Past the first missing value,
+  // the arrays on the way are created empty.
+  const nlohmann::json* existing_value_ptr = &this->json_document_;
+  for (const JsonKey& key : keys) {
+    if (key.is_index()) {
+      std::size_t size = (existing_value_ptr != nullptr && existing_value_ptr->is_array())
+          ? existing_value_ptr->size()
+          : 0;
+
+      if (key.index() >= size && key.index() - size >= kMaxArrayGrowth) {
+        return false;
+      }
+    }
+
+    existing_value_ptr = (existing_value_ptr != nullptr)
+        ? FindValue(*existing_value_ptr, key)
+        : nullptr;
+  }
+
+  nlohmann::json* value_ptr = &this->json_document_;
+
+  for (const JsonKey& key : keys) {
+    // Arrays on the way to the destination are grown with nulls to include
+    // the index, and values that aren't arrays are replaced by arrays.
+    if (key.is_index()) {
+      if (!value_ptr->is_array()) {
+        *value_ptr = nlohmann::json::array();
+      }
+
+      if (key.index() >= value_ptr->size()) {
+        value_ptr->get_ref<nlohmann::json::array_t&>().resize(key.index() + 1);
+      }
+
+      value_ptr = &(*value_ptr)[key.index()];
+      continue;
+    }
+
+    // Values on the way to the destination that are missing or aren't
+    // objects are replaced by objects.
+    if (!value_ptr->is_object()) {
+      *value_ptr = nlohmann::json::object();
+    }
+
+    nlohmann::json* member_value_ptr = FindValue(*value_ptr, key);
+    if (member_value_ptr == nullptr) {
+      member_value_ptr = &value_ptr->emplace(std::string(key.view()), nullptr)
+          .first.value();
+    }
+
+    value_ptr = member_value_ptr;
+  }
+
+  *value_ptr = std::move(value);
+
+  return true;
+}
+
+template <>
+inline nlohmann::json* NlohmannJsonConfigReader::FindOrAddValue(
+    nlohmann::json& parent,
+    const JsonKey& key,
+    bool is_deep,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t reference_token_count,
+    std::vector<UndoEntry>* undo_log
+) {
+  nlohmann::json* value_ptr = FindValue(parent, key);
+  if (value_ptr != nullptr) {
+    return value_ptr;
+  }
+
+  std::vector<std::string> child_reference_tokens(
+      reference_tokens.cbegin(),
+      reference_tokens.cbegin() + reference_token_count
+  );
+
+  // An index far past the end of an array is rejected, rather than filling
+  // the array with nulls.
+  if (key.is_index()) {
+    std::size_t size = parent.is_array() ? parent.size() : 0;
+    if (key.index() - size >= kMaxArrayGrowth) {
+      return nullptr;
+    }
+  }
+
+  // Only SetDeep* replaces a parent of the wrong kind.
+  if (key.is_index() ? !parent.is_array() : !parent.is_object()) {
+    if (!is_deep) {
+      return nullptr;
+    }
+
+    undo_log->push_back(UndoEntry{
+        UndoEntry::Kind::kReplaced,
+        std::vector<std::string>(
+            child_reference_tokens.cbegin(),
+            child_reference_tokens.cend() - 1
+        ),
+        0,
+        std::move(parent)
+    });
+
+    parent = key.is_index() ? nlohmann::json::array() : nlohmann::json::object();
+  }
+
+  if (key.is_index()) {
+    // Only SetDeep* grows an array beyond the element after its end.
+    if (!is_deep && key.index() != parent.size()) {
+      return nullptr;
+    }
+
+    while (key.index() >= parent.size()) {
+      child_reference_tokens.back() = std::to_string(parent.size());
+      undo_log->push_back(UndoEntry{
+          UndoEntry::Kind::kInsertedElement,
+          child_reference_tokens,
+          parent.size(),
+          nullptr
+      });
+
+      parent.push_back(nullptr);
+    }
+
+    return &parent[key.index()];
+  }
+
+  nlohmann::json* member_value_ptr = &parent.emplace(std::string(key.view()), nullptr)
+      .first.value();
+
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kAddedMember,
+      std::move(child_reference_tokens),
+      0,
+      nullptr
+  });
+
+  return member_value_ptr;
+}
+
+template <>
+inline nlohmann::json NlohmannJsonConfigReader::CopyValue(
+    const nlohmann::json& value,
+    nlohmann::json* /* document */
+) {
+  return value;
+}
+
+template <>
+inline nlohmann::json NlohmannJsonConfigReader::MakeStringValue(
+    std::string_view text,
+    nlohmann::json* /* document */
+) {
+  return nlohmann::json(text);
+}
+
+template <>
+inline void NlohmannJsonConfigReader::AppendJournalRecord(
+    std::string* journal_buffer,
+    const std::vector<JsonKey>& keys,
+    const nlohmann::json* value_ptr
+) {
+  journal_buffer->append("{\"p\":[");
+
+  for (std::size_t i = 0; i < keys.size(); i += 1) {
+    if (i != 0) {
+      journal_buffer->push_back(',');
+    }
+
+    if (keys[i].is_index()) {
+      journal_buffer->append(std::to_string(keys[i].index()));
+    } else {
+      journal_buffer->append(nlohmann::json(std::string(keys[i].view())).dump());
+    }
+  }
+
+  journal_buffer->push_back(']');
+
+  if (value_ptr != nullptr) {
+    journal_buffer->append(",\"v\":");
+    journal_buffer->append(value_ptr->dump());
+  }
+
+  journal_buffer->append("}\n");
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ReadJournalRecord(
+    const nlohmann::json& record,
+    std::vector<JsonKey>* keys,
+    const nlohmann::json** value_ptr
+) {
+  const nlohmann::json* key_path_ptr = FindValue(record, std::string_view("p"));
+  if (key_path_ptr == nullptr || !key_path_ptr->is_array()) {
+    return false;
+  }
+
+  keys->clear();
+  for (nlohmann::json::const_iterator it = key_path_ptr->cbegin();
+      it != key_path_ptr->cend();
+      it++) {
+    if (it->is_number_unsigned()) {
+      keys->push_back(JsonKey(it->get<std::size_t>()));
+    } else if (it->is_string()) {
+      const std::string& name = it->get_ref<const std::string&>();
+      keys->push_back(JsonKey(std::string_view(name)));
+    } else {
+      return false;
+    }
+  }
+
+  *value_ptr = FindValue(record, std::string_view("v"));
+
+  return true;
+}
+
+template <>
+inline const nlohmann::json* NlohmannJsonConfigReader::ResolveReferenceTokens(
+    const nlohmann::json& root,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t count
+) {
+  const nlohmann::json* value_ptr = &root;
+
+  for (std::size_t i = 0; i < count && value_ptr != nullptr; i += 1) {
+    if (value_ptr->is_object()) {
+      value_ptr = FindValue(*value_ptr, std::string_view(reference_tokens[i]));
+    } else if (value_ptr->is_array()) {
+      std::size_t index;
+      if (!ParseJsonPointerArrayIndex(reference_tokens[i], &index)
+          || index >= value_ptr->size()) {
+        return nullptr;
+      }
+
+      value_ptr = &(*value_ptr)[index];
+    } else {
+      return nullptr;
+    }
+  }
+
+  return value_ptr;
+}
+
+template <>
+inline nlohmann::json* NlohmannJsonConfigReader::ResolveReferenceTokens(
+    nlohmann::json& root,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t count
+) {
+  return const_cast<nlohmann::json*>(
+      ResolveReferenceTokens(
+          static_cast<const nlohmann::json&>(root),
+          reference_tokens,
+          count
+      )
+  );
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ReplaceAtReferenceTokens(
+    const std::vector<std::string>& reference_tokens,
+    nlohmann::json value,
+    std::vector<UndoEntry>* undo_log
+) {
+  nlohmann::json* value_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      reference_tokens,
+      reference_tokens.size()
+  );
+
+  if (value_ptr == nullptr) {
+    return false;
+  }
+
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kReplaced,
+      reference_tokens,
+      0,
+      std::move(*value_ptr)
+  });
+
+  *value_ptr = std::move(value);
+
+  return true;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::AddAtReferenceTokens(
+    std::vector<std::string>* reference_tokens,
+    nlohmann::json value,
+    std::vector<UndoEntry>* undo_log
+) {
+  // Adding to the root replaces the whole document.
+  if (reference_tokens->empty()) {
+    return this->ReplaceAtReferenceTokens(
+        *reference_tokens,
+        std::move(value),
+        undo_log
+    );
+  }
+
+  nlohmann::json* parent_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      *reference_tokens,
+      reference_tokens->size() - 1
+  );
+
+  if (parent_ptr == nullptr) {
+    return false;
+  }
+
+  std::string& last_token = reference_tokens->back();
+
+  if (parent_ptr->is_object()) {
+    nlohmann::json* value_ptr = FindValue(*parent_ptr, std::string_view(last_token));
+    if (value_ptr != nullptr) {
+      undo_log->push_back(UndoEntry{
+          UndoEntry::Kind::kReplaced,
+          *reference_tokens,
+          0,
+          std::move(*value_ptr)
+      });
+
+      *value_ptr = std::move(value);
+    } else {
+      parent_ptr->emplace(last_token, std::move(value));
+
+      undo_log->push_back(UndoEntry{
+          UndoEntry::Kind::kAddedMember,
+          *reference_tokens,
+          0,
+          nlohmann::json()
+      });
+    }
+
+    return true;
+  }
+
+  if (!parent_ptr->is_array()) {
+    return false;
+  }
+
+  // The "-" token refers to the position past the last element. It is
+  // replaced by that index, so that the undo log and the changed key paths
+  // refer to the added element.
+  std::size_t index;
+  if (last_token == "-") {
+    index = parent_ptr->size();
+    last_token = std::to_string(index);
+  } else if (!ParseJsonPointerArrayIndex(last_token, &index)
+      || index > parent_ptr->size()) {
+    return false;
+  }
+
+  parent_ptr->insert(parent_ptr->cbegin() + index, std::move(value));
+
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kInsertedElement,
+      *reference_tokens,
+      index,
+      nlohmann::json()
+  });
+
+  return true;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::RemoveAtReferenceTokens(
+    const std::vector<std::string>& reference_tokens,
+    std::vector<UndoEntry>* undo_log
+) {
+  // The root of the document cannot be removed.
+  if (reference_tokens.empty()) {
+    return false;
+  }
+
+  nlohmann::json* parent_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      reference_tokens,
+      reference_tokens.size() - 1
+  );
+
+  if (parent_ptr == nullptr) {
+    return false;
+  }
+
+  const std::string& last_token = reference_tokens.back();
+
+  if (parent_ptr->is_object()) {
+    nlohmann::json::iterator it = parent_ptr->find(last_token);
+    if (it == parent_ptr->end()) {
+      return false;
+    }
+
+    undo_log->push_back(UndoEntry{
+        UndoEntry::Kind::kRemovedMember,
+        reference_tokens,
+        0,
+        std::move(*it)
+    });
+
+    parent_ptr->erase(it);
+
+    return true;
+  }
+
+  if (!parent_ptr->is_array()) {
+    return false;
+  }
+
+  std::size_t index;
+  if (!ParseJsonPointerArrayIndex(last_token, &index)
+      || index >= parent_ptr->size()) {
+    return false;
+  }
+
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kRemovedElement,
+      reference_tokens,
+      index,
+      std::move((*parent_ptr)[index])
+  });
+
+  parent_ptr->erase(index);
+
+  return true;
+}
+
+template <>
+inline void NlohmannJsonConfigReader::RollBack(
+    std::vector<UndoEntry>* undo_log
+) {
+  // Undo the mutations in reverse order, so that every entry's reference
+  // tokens resolve against the same state that they were recorded in.
+  for (std::vector<UndoEntry>::reverse_iterator it = undo_log->rbegin();
+      it != undo_log->rend();
+      it++) {
+    if (it->kind == UndoEntry::Kind::kReplaced) {
+      *ResolveReferenceTokens(
+          this->json_document_,
+          it->reference_tokens,
+          it->reference_tokens.size()
+      ) = std::move(it->old_value);
+
+      continue;
+    }
+
+    nlohmann::json& parent_ref = *ResolveReferenceTokens(
+        this->json_document_,
+        it->reference_tokens,
+        it->reference_tokens.size() - 1
+    );
+
+    switch (it->kind) {
+      case UndoEntry::Kind::kAddedMember: {
+        parent_ref.erase(it->reference_tokens.back());
+        break;
+      }
+
+      case UndoEntry::Kind::kRemovedMember: {
+        parent_ref.emplace(it->reference_tokens.back(), std::move(it->old_value));
+        break;
+      }
+
+      case UndoEntry::Kind::kInsertedElement: {
+        parent_ref.erase(it->index);
+        break;
+      }
+
+      case UndoEntry::Kind::kRemovedElement: {
+        parent_ref.insert(parent_ref.cbegin() + it->index, std::move(it->old_value));
+        break;
+      }
+
+      default: {
+        break;
+      }
+    }
+  }
+
+  undo_log->clear();
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ApplyJsonPatchOperation(
+    const nlohmann::json& operation,
+    std::vector<std::string>* changed_key_paths,
+    std::vector<UndoEntry>* undo_log
+) {
+  const nlohmann::json* op_ptr = FindValue(operation, std::string_view("op"));
+  const nlohmann::json* path_ptr = FindValue(operation, std::string_view("path"));
+  const nlohmann::json* value_ptr = FindValue(operation, std::string_view("value"));
+
+  if (op_ptr == nullptr || !op_ptr->is_string()
+      || path_ptr == nullptr || !path_ptr->is_string()) {
+    return false;
+  }
+
+  std::string_view op = op_ptr->get_ref<const std::string&>();
+  std::string_view path = path_ptr->get_ref<const std::string&>();
+
+  std::vector<std::string> path_tokens;
+  if (!ParseJsonPointer(path, &path_tokens)) {
+    return false;
+  }
+
+  if (op == "test") {
+    const nlohmann::json* target_ptr = ResolveReferenceTokens(
+        this->json_document_,
+        path_tokens,
+        path_tokens.size()
+    );
+
+    return value_ptr != nullptr
+        && target_ptr != nullptr
+        && *target_ptr == *value_ptr;
+  }
+
+  if (op == "add" || op == "replace") {
+    if (value_ptr == nullptr) {
+      return false;
+    }
+
+    bool is_applied = (op == "add")
+        ? this->AddAtReferenceTokens(&path_tokens, *value_ptr, undo_log)
+        : this->ReplaceAtReferenceTokens(path_tokens, *value_ptr, undo_log);
+
+    if (is_applied) {
+      changed_key_paths->push_back(MakeJsonPointerFromTokens(path_tokens));
+    }
+
+    return is_applied;
+  }
+
+  if (op == "remove") {
+    if (!this->RemoveAtReferenceTokens(path_tokens, undo_log)) {
+      return false;
+    }
+
+    changed_key_paths->emplace_back(path);
+
+    return true;
+  }
+
+  if (op != "move" && op != "copy") {
+    return false;
+  }
+
+  const nlohmann::json* from_ptr = FindValue(operation, std::string_view("from"));
+  if (from_ptr == nullptr || !from_ptr->is_string()) {
+    return false;
+  }
+
+  std::string_view from = from_ptr->get_ref<const std::string&>();
+
+  std::vector<std::string> from_tokens;
+  if (!ParseJsonPointer(from, &from_tokens)) {
+    return false;
+  }
+
+  const nlohmann::json* source_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      from_tokens,
+      from_tokens.size()
+  );
+
+  if (source_ptr == nullptr) {
+    return false;
+  }
+
+  if (op == "move") {
+    if (from == path) {
+      return true;
+    }
+
+    // A value cannot be moved into one of its own children.
+    if (from_tokens.size() < path_tokens.size()
+        && std::equal(from_tokens.cbegin(), from_tokens.cend(), path_tokens.cbegin())) {
+      return false;
+    }
+  }
+
+  nlohmann::json value_copy = *source_ptr;
+
+  if (op == "move") {
+    if (!this->RemoveAtReferenceTokens(from_tokens, undo_log)) {
+      return false;
+    }
+
+    changed_key_paths->emplace_back(from);
+  }
+
+  if (!this->AddAtReferenceTokens(&path_tokens, std::move(value_copy), undo_log)) {
+    return false;
+  }
+
+  changed_key_paths->push_back(MakeJsonPointerFromTokens(path_tokens));
+
+  return true;
+}
+
+template <>
+inline void NlohmannJsonConfigReader::MergePatchRecursive(
+    nlohmann::json& target,
+    const nlohmann::json& patch,
+    std::string* key_path,
+    std::vector<std::string>* changed_key_paths
+) {
+  // A patch that is not an object replaces the target outright.
+  if (!patch.is_object()) {
+    if (target != patch) {
+      target = patch;
+
+      if (changed_key_paths != nullptr) {
+        changed_key_paths->push_back(*key_path);
+      }
+    }
+
+    return;
+  }
+
+  if (!target.is_object()) {
+    target = nlohmann::json::object();
+
+    if (changed_key_paths != nullptr) {
+      changed_key_paths->push_back(*key_path);
+    }
+  }
+
+  for (nlohmann::json::const_iterator it = patch.cbegin(); it != patch.cend(); it++) {
+    std::size_t parent_key_path_size = key_path->size();
+    AppendJsonPointerToken(key_path, it.key());
+
+    nlohmann::json::iterator target_it = target.find(it.key());
+
+    if (it->is_null()) {
+      // Null removes the member.
+      if (target_it != target.end()) {
+        target.erase(target_it);
+
+        if (changed_key_paths != nullptr) {
+          changed_key_paths->push_back(*key_path);
+        }
+      }
+    } else {
+      if (target_it == target.end()) {
+        target_it = target.emplace(it.key(), nlohmann::json()).first;
+      }
+
+      this->MergePatchRecursive(
+          *target_it,
+          *it,
+          key_path,
+          changed_key_paths
+      );
+    }
+
+    key_path->resize(parent_key_path_size);
+  }
+}
+
+template <>
+inline std::uint64_t NlohmannJsonConfigReader::HashSubtrees(
+    const nlohmann::json& value,
+    SubtreeHashMap* subtree_hashes
+) {
+  SubtreeHashMap::const_iterator hash_it = subtree_hashes->find(&value);
+  if (hash_it != subtree_hashes->cend()) {
+    return hash_it->second;
+  }
+
+  std::uint64_t hash;
+
+  switch (value.type()) {
+    case nlohmann::json::value_t::boolean: {
+      hash = static_cast<std::uint64_t>(
+          value.get<bool>() ? JsonHashSeed::kTrue : JsonHashSeed::kFalse
+      );
+
+      break;
+    }
+
+    case nlohmann::json::value_t::number_integer: {
+      hash = HashJsonNumber(value.get<std::int64_t>());
+      break;
+    }
+
+    case nlohmann::json::value_t::number_unsigned: {
+      hash = HashJsonNumber(value.get<std::uint64_t>());
+      break;
+    }
+
+    case nlohmann::json::value_t::number_float: {
+      hash = HashJsonNumber(value.get<double>());
+      break;
+    }
+
+    case nlohmann::json::value_t::string: {
+      const std::string& string_ref = value.get_ref<const std::string&>();
+
+      hash = CombineHash(
+          static_cast<std::uint64_t>(JsonHashSeed::kString),
+          JsonKey::Hash(string_ref.data(), string_ref.size())
+      );
+
+      break;
+    }
+
+    case nlohmann::json::value_t::array: {
+      hash = static_cast<std::uint64_t>(JsonHashSeed::kArray);
+      for (nlohmann::json::const_iterator it = value.cbegin(); it != value.cend(); it++) {
+        hash = CombineHash(hash, HashSubtrees(*it, subtree_hashes));
+      }
+
+      break;
+    }
+
+    case nlohmann::json::value_t::object: {
+      // Members are summed so that the hash does not depend on key order,
+      // matching the RapidJSON backend.
+      std::uint64_t members_hash = 0;
+      for (nlohmann::json::const_iterator it = value.cbegin(); it != value.cend(); it++) {
+        members_hash += CombineHash(
+            JsonKey::Hash(it.key().data(), it.key().size()),
+            HashSubtrees(*it, subtree_hashes)
+        );
+      }
+
+      hash = CombineHash(static_cast<std::uint64_t>(JsonHashSeed::kObject), members_hash);
+
+      break;
+    }
+
+    default: {
+      hash = static_cast<std::uint64_t>(JsonHashSeed::kNull);
+      break;
+    }
+  }
+
+  subtree_hashes->emplace(&value, hash);
+
+  return hash;
+}
+
+template <>
+inline JsonQueryValueView NlohmannJsonConfigReader::ToQueryValueView(
+    const nlohmann::json& value
+) {
+  JsonQueryValueView view = { JsonQueryValueKind::kStructured, false, 0, {} };
+
+  if (value.is_null()) {
+    view.kind = JsonQueryValueKind::kNull;
+  } else if (value.is_boolean()) {
+    view.kind = JsonQueryValueKind::kBool;
+    view.bool_value = value.get<bool>();
+  } else if (value.is_number()) {
+    view.kind = JsonQueryValueKind::kNumber;
+    view.number_value = value.get<double>();
+  } else if (value.is_string()) {
+    view.kind = JsonQueryValueKind::kString;
+    view.string_value = value.get_ref<const std::string&>();
+  }
+
+  return view;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::QueryRecursive(
+    const nlohmann::json& value,
+    const JsonQuery& query,
+    std::size_t step_index,
+    std::size_t max_result_count,
+    std::vector<const nlohmann::json*>* results
+) {
+  if (step_index == query.steps.size()) {
+    results->push_back(&value);
+    return results->size() < max_result_count;
+  }
+
+  const JsonQueryStep& step = query.steps[step_index];
+  std::size_t next_step_index = step_index + 1;
+
+  auto query_child = [&query, next_step_index, max_result_count, results](
+      const nlohmann::json& child
+  ) {
+    return QueryRecursive(
+        child,
+        query,
+        next_step_index,
+        max_result_count,
+        results
+    );
+  };
+
+  switch (step.kind) {
+    case JsonQueryStepKind::kMember: {
+      if (value.is_object()) {
+        const nlohmann::json* member_value_ptr = FindValue(
+            value,
+            std::string_view(step.name)
+        );
+
+        return member_value_ptr == nullptr || query_child(*member_value_ptr);
+      }
+
+      if (value.is_array()
+          && step.array_index.has_value()
+          && *step.array_index < value.size()) {
+        return query_child(value[*step.array_index]);
+      }
+
+      return true;
+    }
+
+    case JsonQueryStepKind::kIndex: {
+      std::size_t index;
+      if (value.is_array()
+          && NormalizeJsonQueryIndex(step.index, value.size(), &index)) {
+        return query_child(value[index]);
+      }
+
+      return true;
+    }
+
+    case JsonQueryStepKind::kSlice: {
+      if (!value.is_array()) {
+        return true;
+      }
+
+      return ForEachJsonQuerySliceIndex(
+          step,
+          value.size(),
+          [&value, &query_child](std::size_t index) {
+            return query_child(value[index]);
+          }
+      );
+    }
+
+    case JsonQueryStepKind::kWildcard:
+    case JsonQueryStepKind::kFilter: {
+      if (!value.is_structured()) {
+        return true;
+      }
+
+      bool is_filter = step.kind == JsonQueryStepKind::kFilter;
+
+      // Iterating an object visits its member values.
+      for (const nlohmann::json& child : value) {
+        if ((!is_filter || MatchesQueryFilter(child, step))
+            && !query_child(child)) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    default: {
+      return true;
+    }
+  }
+}
+
+template <>
+inline void NlohmannJsonConfigReader::DiffRecursive(
+    const nlohmann::json& old_value,
+    SubtreeHashMap* old_subtree_hashes,
+    const nlohmann::json& new_value,
+    SubtreeHashMap* new_subtree_hashes,
+    std::string* key_path,
+    bool is_subscribed_only,
+    std::vector<std::string>* changed_key_paths
+) const {
+  // Skip subtrees whose hashes are equal, and when diffing for subscribers,
+  // the parts of the documents that are not subscribed to.
+  if (is_subscribed_only && !this->IsSubscribedKeyPath(*key_path)) {
+    return;
+  }
+
+  if (HashSubtrees(old_value, old_subtree_hashes)
+      == HashSubtrees(new_value, new_subtree_hashes)) {
+    return;
+  }
+
+  if (old_value.is_object() && new_value.is_object()) {
+    for (nlohmann::json::const_iterator it = old_value.cbegin(); it != old_value.cend(); it++) {
+      const nlohmann::json* new_member_value_ptr = FindValue(new_value, std::string_view(it.key()));
+
+      std::size_t parent_key_path_size = key_path->size();
+      AppendJsonPointerToken(key_path, it.key());
+
+      if (new_member_value_ptr == nullptr) {
+        if (!is_subscribed_only || this->IsSubscribedKeyPath(*key_path)) {
+          changed_key_paths->push_back(*key_path);
+        }
+      } else {
+        this->DiffRecursive(
+            *it,
+            old_subtree_hashes,
+            *new_member_value_ptr,
+            new_subtree_hashes,
+            key_path,
+            is_subscribed_only,
+            changed_key_paths
+        );
+      }
+
+      key_path->resize(parent_key_path_size);
+    }
+
+    for (nlohmann::json::const_iterator it = new_value.cbegin(); it != new_value.cend(); it++) {
+      if (FindValue(old_value, std::string_view(it.key())) != nullptr) {
+        continue;
+      }
+
+      std::size_t parent_key_path_size = key_path->size();
+      AppendJsonPointerToken(key_path, it.key());
+
+      if (!is_subscribed_only || this->IsSubscribedKeyPath(*key_path)) {
+        changed_key_paths->push_back(*key_path);
+      }
+
+      key_path->resize(parent_key_path_size);
+    }
+
+    return;
+  }
+
+  if (old_value.is_array() && new_value.is_array()
+      && old_value.size() == new_value.size()) {
+    for (std::size_t i = 0; i < old_value.size(); i += 1) {
+      std::size_t parent_key_path_size = key_path->size();
+      AppendJsonPointerToken(key_path, std::to_string(i));
+
+      this->DiffRecursive(
+          old_value[i],
+          old_subtree_hashes,
+          new_value[i],
+          new_subtree_hashes,
+          key_path,
+          is_subscribed_only,
+          changed_key_paths
+      );
+
+      key_path->resize(parent_key_path_size);
+    }
+
+    return;
+  }
+
+  changed_key_paths->push_back(*key_path);
+}
+
+template <>
+inline void NlohmannJsonConfigReader::HashDocumentSubtrees(
+    std::size_t thread_count,
+    SubtreeHashMap* subtree_hashes
+) const {
+  const nlohmann::json& root = this->json_document_;
+
+  if (thread_count > 1 && root.is_object() && root.size() > 1) {
+    // Hash contiguous ranges of the top-level members into separate maps,
+    // then merge them.
+    std::vector<const nlohmann::json*> member_value_ptrs;
+    for (nlohmann::json::const_iterator it = root.cbegin(); it != root.cend(); it++) {
+      member_value_ptrs.push_back(&(*it));
+    }
+
+    std::size_t member_count = member_value_ptrs.size();
+    std::size_t task_count = std::min(thread_count, member_count);
+
+    std::vector<std::future<SubtreeHashMap>> futures;
+    for (std::size_t task = 0; task < task_count; task += 1) {
+      std::size_t first_member = (member_count * task) / task_count;
+      std::size_t last_member = (member_count * (task + 1)) / task_count;
+
+      futures.push_back(std::async(
+          std::launch::async,
+          [&member_value_ptrs, first_member, last_member]() {
+            SubtreeHashMap task_subtree_hashes;
+
+            for (std::size_t i = first_member; i < last_member; i += 1) {
+              HashSubtrees(*member_value_ptrs[i], &task_subtree_hashes);
+            }
+
+            return task_subtree_hashes;
+          }
+      ));
+    }
+
+    for (std::future<SubtreeHashMap>& future : futures) {
+      SubtreeHashMap task_subtree_hashes = future.get();
+      subtree_hashes->merge(task_subtree_hashes);
+    }
+  }
+
+  HashSubtrees(root, subtree_hashes);
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ParseConfigStream(
+    std::istream& config_stream,
+    nlohmann::json* document
+) const {
+  *document = nlohmann::json::parse(
+      config_stream,
+      nullptr,
+      false
+  );
+
+  // Check that the config is JSON compliant. If it isn't, then the parser
+  // returns a discarded value.
+  return !document->is_discarded();
+}
+
+/**
+ * Builds a nlohmann::json from the events of a JsonBinaryReader, so that both
+ * backends decode CBOR and MessagePack alike, with the same nesting limit.
+ * nlohmann::json's own decoders recurse without a limit, so deeply nested
+ * input could exhaust the stack.
+ */
+class NlohmannJsonBinaryBuilder {
+ public:
+  explicit NlohmannJsonBinaryBuilder(nlohmann::json* root)
+      : root_(root) {
+  }
+
+  bool Null() {
+    this->Add(nullptr);
+    return true;
+  }
+
+  bool Bool(bool value) {
+    this->Add(value);
+    return true;
+  }
+
+  bool Int64(std::int64_t value) {
+    this->Add(value);
+    return true;
+  }
+
+  bool Uint64(std::uint64_t value) {
+    this->Add(value);
+    return true;
+  }
+
+  bool Double(double value) {
+    this->Add(value);
+    return true;
+  }
+
+  bool String(
+      const char* data,
+      std::size_t size,
+      bool /* copy */
+  ) {
+    this->Add(std::string(data, size));
+    return true;
+  }
+
+  bool Key(
+      const char* data,
+      std::size_t size,
+      bool /* copy */
+  ) {
+    this->key_.assign(data, size);
+    return true;
+  }
+
+  bool StartObject() {
+    this->containers_.push_back(this->Add(nlohmann::json::object()));
+    return true;
+  }
+
+  bool EndObject(std::size_t /* member_count */) {
+    this->containers_.pop_back();
+    return true;
+  }
+
+  bool StartArray() {
+    this->containers_.push_back(this->Add(nlohmann::json::array()));
+    return true;
+  }
+
+  bool EndArray(std::size_t /* element_count */) {
+    this->containers_.pop_back();
+    return true;
+  }
+
+ private:
+  nlohmann::json* root_;
+
+  // The open containers, innermost last. A container only grows while it is
+  // the innermost one, so the pointers to the outer ones stay valid.
+  std::vector<nlohmann::json*> containers_;
+  std::string key_;
+
+  nlohmann::json* Add(nlohmann::json value) {
+    if (this->containers_.empty()) {
+      *this->root_ = std::move(value);
+      return this->root_;
+    }
+
+    nlohmann::json& container = *this->containers_.back();
+    if (container.is_array()) {
+      container.push_back(std::move(value));
+      return &container.back();
+    }
+
+    nlohmann::json& member = container[this->key_];
+    member = std::move(value);
+    return &member;
+  }
+};
+
+template <>
+inline bool NlohmannJsonConfigReader::DecodeConfigStream(
+    std::istream& config_stream,
+    JsonFileFormat file_format,
+    nlohmann::json* document
+) {
+  std::string config_bytes(
+      (std::istreambuf_iterator<char>(config_stream)),
+      std::istreambuf_iterator<char>()
+  );
+
+  // Tags are skipped, like the RapidJSON backend does.
+  nlohmann::json decoded_document;
+  NlohmannJsonBinaryBuilder builder(&decoded_document);
+  if (!JsonBinaryReader<NlohmannJsonBinaryBuilder>(config_bytes, file_format).Read(&builder)) {
+    return false;
+  }
+
+  *document = std::move(decoded_document);
+
+  return true;
+}
+
+template <>
+inline void NlohmannJsonConfigReader::MergeLayerRecursive(
+    nlohmann::json& target,
+    nlohmann::json& layer,
+    nlohmann::json* /* document */
+) {
+  // Objects are merged member by member. Any other value replaces the target
+  // as a whole, including null.
+  if (!target.is_object() || !layer.is_object()) {
+    target = std::move(layer);
+    return;
+  }
+
+  for (nlohmann::json::iterator it = layer.begin(); it != layer.end(); it++) {
+    nlohmann::json* target_member_value_ptr = FindValue(
+        target,
+        std::string_view(it.key())
+    );
+
+    if (target_member_value_ptr == nullptr) {
+      target.emplace(it.key(), std::move(*it));
+    } else {
+      MergeLayerRecursive(*target_member_value_ptr, *it, nullptr);
+    }
+  }
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ParseConfigText(
+    std::string_view text,
+    nlohmann::json* document
+) const {
+  *document = nlohmann::json::parse(
+      text.cbegin(),
+      text.cend(),
+      nullptr,
+      false
+  );
+
+  // Check that the config is JSON compliant. If it isn't, then the parser
+  // returns a discarded value.
+  return !document->is_discarded();
+}
+
+template <>
+inline void NlohmannJsonConfigReader::AppendParsedChunk(
+    nlohmann::json* document,
+    nlohmann::json* chunk_document
+) {
+  // As with a serial parse, later duplicate keys win.
+  if (document->is_object()) {
+    for (nlohmann::json::iterator it = chunk_document->begin();
+        it != chunk_document->end();
+        it++) {
+      (*document)[it.key()] = std::move(*it);
+    }
+  } else {
+    nlohmann::json::array_t& array_ref = document->get_ref<nlohmann::json::array_t&>();
+    nlohmann::json::array_t& chunk_array_ref = chunk_document->get_ref<nlohmann::json::array_t&>();
+
+    array_ref.insert(
+        array_ref.end(),
+        std::make_move_iterator(chunk_array_ref.begin()),
+        std::make_move_iterator(chunk_array_ref.end())
+    );
+  }
+}
+
+template <>
+inline void NlohmannJsonConfigReader::ClearDocument(
+    nlohmann::json* document
+) {
+  *document = nullptr;
+}
+
+template <>
+inline std::uint32_t NlohmannJsonConfigReader::FreezeValue(
+    const nlohmann::json& value,
+    JsonFrozenIndex<nlohmann::json>* frozen_index
+) {
+  switch (value.type()) {
+    case nlohmann::json::value_t::boolean: {
+      return frozen_index->AddBool(&value, value.get<bool>());
+    }
+
+    case nlohmann::json::value_t::number_integer: {
+      return frozen_index->AddInt64(&value, value.get<std::int64_t>());
+    }
+
+    case nlohmann::json::value_t::number_unsigned: {
+      return frozen_index->AddUint64(&value, value.get<std::uint64_t>());
+    }
+
+    case nlohmann::json::value_t::number_float: {
+      return frozen_index->AddDouble(&value, value.get<double>());
+    }
+
+    case nlohmann::json::value_t::string: {
+      return frozen_index->AddString(&value);
+    }
+
+    case nlohmann::json::value_t::array: {
+      std::uint32_t array_node = frozen_index->AddArray(&value, value.size());
+      for (std::size_t i = 0; i < value.size(); i += 1) {
+        frozen_index->SetArrayElement(array_node, i, FreezeValue(value[i], frozen_index));
+      }
+
+      return array_node;
+    }
+
+    case nlohmann::json::value_t::object: {
+      std::uint32_t object_node = frozen_index->AddObject(&value);
+
+      std::vector<JsonFrozenMember> members;
+      members.reserve(value.size());
+      for (nlohmann::json::const_iterator it = value.cbegin(); it != value.cend(); it++) {
+        members.push_back(JsonFrozenMember{
+            it.key(),
+            FreezeValue(*it, frozen_index)
+        });
+      }
+
+      frozen_index->IndexObjectMembers(object_node, &members);
+
+      return object_node;
+    }
+
+    default: {
+      return frozen_index->AddNull(&value);
+    }
+  }
+}
+
+template <>
+inline JsonSubtreeMemoryStats NlohmannJsonConfigReader::MeasureSubtree(
+    const nlohmann::json& value,
+    std::size_t depth,
+    std::size_t max_depth,
+    std::string* key_path,
+    std::map<std::string, JsonSubtreeMemoryStats>* subtree_stats
+) {
+  JsonSubtreeMemoryStats stats;
+  stats.node_count = 1;
+
+  // Key paths are only built for the subtrees that are recorded.
+  std::map<std::string, JsonSubtreeMemoryStats>* child_subtree_stats =
+      (depth < max_depth) ? subtree_stats : nullptr;
+
+  switch (value.type()) {
+    case nlohmann::json::value_t::string: {
+      stats.string_size = value.get_ref<const std::string&>().size();
+      break;
+    }
+
+    case nlohmann::json::value_t::array: {
+      stats.member_array_size =
+          value.get_ref<const nlohmann::json::array_t&>().capacity()
+              * sizeof(nlohmann::json);
+
+      for (std::size_t i = 0; i < value.size(); i += 1) {
+        std::size_t parent_key_path_size = 0;
+        if (child_subtree_stats != nullptr) {
+          parent_key_path_size = key_path->size();
+          AppendJsonPointerToken(key_path, JsonKey(i));
+        }
+
+        stats += MeasureSubtree(
+            value[i],
+            depth + 1,
+            max_depth,
+            key_path,
+            child_subtree_stats
+        );
+
+        if (child_subtree_stats != nullptr) {
+          key_path->resize(parent_key_path_size);
+        }
+      }
+
+      break;
+    }
+
+    case nlohmann::json::value_t::object: {
+      // Members are nodes of a std::map, each of which also holds a color
+      // and three links.
+      stats.member_array_size = value.size()
+          * (sizeof(nlohmann::json::object_t::value_type) + 4 * sizeof(void*));
+
+      for (nlohmann::json::const_iterator it = value.cbegin(); it != value.cend(); it++) {
+        stats.string_size += it.key().size();
+
+        std::size_t parent_key_path_size = 0;
+        if (child_subtree_stats != nullptr) {
+          parent_key_path_size = key_path->size();
+          AppendJsonPointerToken(key_path, it.key());
+        }
+
+        stats += MeasureSubtree(
+            *it,
+            depth + 1,
+            max_depth,
+            key_path,
+            child_subtree_stats
+        );
+
+        if (child_subtree_stats != nullptr) {
+          key_path->resize(parent_key_path_size);
+        }
+      }
+
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
+
+  if (subtree_stats != nullptr) {
+    subtree_stats->emplace(*key_path, stats);
+  }
+
+  return stats;
+}
+
+template <>
+inline void NlohmannJsonConfigReader::MeasureAllocators(
+    JsonMemoryStats* memory_stats
+) const {
+  // Values free their own memory, so the allocators hold just the memory of
+  // the values.
+  std::size_t live_size = memory_stats->document.string_size
+      + memory_stats->document.member_array_size
+      + memory_stats->overrides.string_size
+      + memory_stats->overrides.member_array_size;
+
+  memory_stats->capacity = live_size;
+  memory_stats->used_size = live_size;
+}
+
+template <>
+inline void NlohmannJsonConfigReader::CommitParsedDocuments(
+    std::deque<nlohmann::json>* parsed_documents
+) {
+  nlohmann::json& parsed_document = parsed_documents->front();
+
+  std::vector<std::string> changed_key_paths;
+  if (!this->subscriptions_.empty()) {
+    SubtreeHashMap old_subtree_hashes;
+    SubtreeHashMap new_subtree_hashes;
+    std::string key_path;
+
+    this->DiffRecursive(
+        this->json_document_,
+        &old_subtree_hashes,
+        parsed_document,
+        &new_subtree_hashes,
+        &key_path,
+        true,
+        &changed_key_paths
+    );
+  }
+
+  this->json_document_.swap(parsed_document);
+  this->generation_ += 1;
+
+  this->ReleaseDocuments(parsed_documents);
+
+  this->ReplayJournal(&changed_key_paths);
+
+  // The index referred to the previous document.
+  if (this->is_frozen()) {
+    this->Freeze();
+  }
+
+  this->NotifySubscribers(changed_key_paths);
+}
+
+template <>
+inline void NlohmannJsonConfigReader::SerializeDocument(
+    int indent_width,
+    std::size_t thread_count
+) {
+  const nlohmann::json& root = this->json_document_;
+
+  if (thread_count <= 1
+      || indent_width < 0
+      || !root.is_structured()
+      || root.size() <= 1) {
+    this->write_buffers_.resize(1);
+    this->write_buffers_.front() = root.dump(indent_width);
+
+    return;
+  }
+
+  std::vector<nlohmann::json::const_iterator> item_its;
+  for (nlohmann::json::const_iterator it = root.cbegin(); it != root.cend(); it++) {
+    item_its.push_back(it);
+  }
+
+  // Each task writes its range of the root's members or elements, each one
+  // prefixed by its separator, so that concatenating the buffers gives the
+  // same text as a serial dump. Values are dumped on their own and then
+  // indented by one level, which is safe because newlines inside strings are
+  // always escaped.
+  std::size_t item_count = item_its.size();
+  std::size_t task_count = std::min(thread_count, item_count);
+  this->write_buffers_.resize(task_count);
+
+  bool is_object = root.is_object();
+
+  std::vector<std::future<void>> futures;
+  for (std::size_t task = 0; task < task_count; task += 1) {
+    std::size_t first_item = (item_count * task) / task_count;
+    std::size_t last_item = (item_count * (task + 1)) / task_count;
+
+    futures.push_back(std::async(
+        std::launch::async,
+        [&item_its, indent_width, is_object, task_count, first_item, last_item,
+            task, &write_buffer = this->write_buffers_[task]]() {
+          write_buffer.clear();
+
+          if (task == 0) {
+            write_buffer.push_back(is_object ? '{' : '[');
+          }
+
+          for (std::size_t i = first_item; i < last_item; i += 1) {
+            if (i != 0) {
+              write_buffer.push_back(',');
+            }
+
+            write_buffer.push_back('\n');
+            write_buffer.append(indent_width, ' ');
+
+            if (is_object) {
+              write_buffer.append(nlohmann::json(item_its[i].key()).dump());
+              write_buffer.append(": ");
+            }
+
+            std::string value_text = item_its[i]->dump(indent_width);
+            for (char ch : value_text) {
+              write_buffer.push_back(ch);
+
+              if (ch == '\n') {
+                write_buffer.append(indent_width, ' ');
+              }
+            }
+          }
+
+          if (task == task_count - 1) {
+            write_buffer.push_back('\n');
+            write_buffer.push_back(is_object ? '}' : ']');
+          }
+        }
+    ));
+  }
+
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
+}
+
+template <>
+inline void NlohmannJsonConfigReader::AppendSerializedValue(
+    std::string* text,
+    const nlohmann::json& value,
+    int indent_width
+) {
+  text->append(value.dump(indent_width));
+}
+
+template <>
+inline void NlohmannJsonConfigReader::EncodeValue(
+    JsonBinaryWriter* writer,
+    const nlohmann::json& value
+) {
+  switch (value.type()) {
+    case nlohmann::json::value_t::boolean: {
+      writer->Bool(value.get<bool>());
+      break;
+    }
+
+    case nlohmann::json::value_t::number_integer: {
+      writer->Int64(value.get<std::int64_t>());
+      break;
+    }
+
+    case nlohmann::json::value_t::number_unsigned: {
+      writer->Uint64(value.get<std::uint64_t>());
+      break;
+    }
+
+    case nlohmann::json::value_t::number_float: {
+      writer->Double(value.get<double>());
+      break;
+    }
+
+    case nlohmann::json::value_t::string: {
+      writer->String(value.get_ref<const std::string&>());
+      break;
+    }
+
+    case nlohmann::json::value_t::array: {
+      writer->StartArray(value.size());
+      for (nlohmann::json::const_iterator it = value.cbegin(); it != value.cend(); it++) {
+        EncodeValue(writer, *it);
+      }
+
+      break;
+    }
+
+    case nlohmann::json::value_t::object: {
+      writer->StartObject(value.size());
+      for (nlohmann::json::const_iterator it = value.cbegin(); it != value.cend(); it++) {
+        writer->Key(it.key());
+        EncodeValue(writer, *it);
+      }
+
+      break;
+    }
+
+    case nlohmann::json::value_t::binary: {
+      // Byte strings, which nlohmann::json reads from binary files, are
+      // written as arrays of their bytes.
+      const nlohmann::json::binary_t& binary_ref = value.get_binary();
+
+      writer->StartArray(binary_ref.size());
+      for (std::uint8_t byte : binary_ref) {
+        writer->Uint64(byte);
+      }
+
+      break;
+    }
+
+    default: {
+      writer->Null();
+      break;
+    }
+  }
+}
+
+template <>
+template <typename T>
+bool NlohmannJsonConfigReader::ToNumber(
+    const nlohmann::json& value,
+    T* number
+) {
+  // nlohmann::json stores integers as either std::int64_t or std::uint64_t,
+  // so read the number as stored, then check that it fits in T.
+  if constexpr (std::is_floating_point<T>::value) {
+    if (!value.is_number()) {
+      return false;
+    }
+
+    double double_value = value.get<double>();
+    if constexpr (std::is_same<T, float>::value) {
+      if (!IsInFloatRange(double_value)) {
+        return false;
+      }
+    }
+
+    *number = static_cast<T>(double_value);
+
+    return true;
+  } else {
+    if (value.is_number_unsigned()) {
+      std::uint64_t uint64_value = value.get<std::uint64_t>();
+      if (!IsInRangeOf<T>(uint64_value)) {
+        return false;
+      }
+
+      *number = static_cast<T>(uint64_value);
+
+      return true;
+    }
+
+    if (value.is_number_integer()) {
+      std::int64_t int64_value = value.get<std::int64_t>();
+      if (!IsInRangeOf<T>(int64_value)) {
+        return false;
+      }
+
+      *number = static_cast<T>(int64_value);
+
+      return true;
+    }
+
+    return false;
+  }
+}
+
+/* Functions for Patches */
+
+template <>
+inline bool NlohmannJsonConfigReader::ApplyMergePatch(
+    const nlohmann::json& patch,
+    std::vector<std::string>* changed_key_paths
+) {
+  this->ThrowIfFrozen();
+
+  // A merge patch cannot fail, so there is nothing to roll back.
+  std::string key_path;
+  std::vector<std::string> applied_key_paths;
+
+  this->generation_ += 1;
+
+  this->MergePatchRecursive(
+      this->json_document_,
+      patch,
+      &key_path,
+      &applied_key_paths
+  );
+
+  this->RecordChanges(applied_key_paths);
+  this->NotifySubscribers(applied_key_paths);
+
+  if (changed_key_paths != nullptr) {
+    changed_key_paths->insert(
+        changed_key_paths->end(),
+        std::make_move_iterator(applied_key_paths.begin()),
+        std::make_move_iterator(applied_key_paths.end())
+    );
+  }
+
+  return true;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ApplyJsonPatch(
+    const nlohmann::json& patch,
+    std::vector<std::string>* changed_key_paths
+) {
+  this->ThrowIfFrozen();
+
+  if (!patch.is_array()) {
+    return false;
+  }
+
+  // Rolled back operations still move values, so the generation changes
+  // either way.
+  this->generation_ += 1;
+
+  std::vector<UndoEntry> undo_log;
+  std::vector<std::string> applied_key_paths;
+
+  for (nlohmann::json::const_iterator it = patch.cbegin(); it != patch.cend(); it++) {
+    if (!this->ApplyJsonPatchOperation(*it, &applied_key_paths, &undo_log)) {
+      this->RollBack(&undo_log);
+      return false;
+    }
+  }
+
+  this->RecordChanges(applied_key_paths);
+  this->NotifySubscribers(applied_key_paths);
+
+  if (changed_key_paths != nullptr) {
+    changed_key_paths->insert(
+        changed_key_paths->end(),
+        std::make_move_iterator(applied_key_paths.begin()),
+        std::make_move_iterator(applied_key_paths.end())
+    );
+  }
+
+  return true;
+}
+
+/* Functions for Diffs */
+
+template <>
+inline std::uint64_t NlohmannJsonConfigReader::Hash() const {
+  const nlohmann::json& root = this->json_document_;
+
+  return this->GetSubtreeHashes(1)->at(&root);
+}
+
+template <>
+inline std::vector<std::string> NlohmannJsonConfigReader::Diff(
+    const NlohmannJsonConfigReader& other,
+    std::size_t thread_count
+) const {
+  const nlohmann::json& old_root = this->json_document_;
+  const nlohmann::json& new_root = other.json_document_;
+
+  // With both hash caches complete, the walk below only reads them, so the
+  // top-level members can be compared concurrently.
+  std::shared_ptr<SubtreeHashMap> old_subtree_hashes =
+      this->GetSubtreeHashes(thread_count);
+  std::shared_ptr<SubtreeHashMap> new_subtree_hashes =
+      other.GetSubtreeHashes(thread_count);
+
+  std::vector<std::string> changed_key_paths;
+  std::string key_path;
+
+  if (thread_count <= 1
+      || !old_root.is_object()
+      || !new_root.is_object()
+      || old_subtree_hashes->at(&old_root) == new_subtree_hashes->at(&new_root)) {
+    this->DiffRecursive(
+        old_root,
+        old_subtree_hashes.get(),
+        new_root,
+        new_subtree_hashes.get(),
+        &key_path,
+        false,
+        &changed_key_paths
+    );
+
+    return changed_key_paths;
+  }
+
+  // Split the old members into contiguous ranges, one per task, and keep the
+  // results in member order.
+  std::vector<nlohmann::json::const_iterator> member_its;
+  for (nlohmann::json::const_iterator it = old_root.cbegin(); it != old_root.cend(); it++) {
+    member_its.push_back(it);
+  }
+
+  std::size_t member_count = member_its.size();
+  std::size_t task_count = std::min(thread_count, member_count);
+
+  std::vector<std::future<std::vector<std::string>>> futures;
+  for (std::size_t task = 0; task < task_count; task += 1) {
+    std::size_t first_member = (member_count * task) / task_count;
+    std::size_t last_member = (member_count * (task + 1)) / task_count;
+
+    futures.push_back(std::async(
+        std::launch::async,
+        [this, &member_its, &new_root, &old_subtree_hashes, &new_subtree_hashes,
+            first_member, last_member]() {
+          std::vector<std::string> task_changed_key_paths;
+          std::string task_key_path;
+
+          for (std::size_t i = first_member; i < last_member; i += 1) {
+            const nlohmann::json::const_iterator& it = member_its[i];
+
+            const nlohmann::json* new_member_value_ptr = FindValue(
+                new_root,
+                std::string_view(it.key())
+            );
+
+            task_key_path.clear();
+            AppendJsonPointerToken(&task_key_path, it.key());
+
+            if (new_member_value_ptr == nullptr) {
+              task_changed_key_paths.push_back(task_key_path);
+              continue;
+            }
+
+            this->DiffRecursive(
+                *it,
+                old_subtree_hashes.get(),
+                *new_member_value_ptr,
+                new_subtree_hashes.get(),
+                &task_key_path,
+                false,
+                &task_changed_key_paths
+            );
+          }
+
+          return task_changed_key_paths;
+        }
+    ));
+  }
+
+  for (std::future<std::vector<std::string>>& future : futures) {
+    std::vector<std::string> task_changed_key_paths = future.get();
+
+    changed_key_paths.insert(
+        changed_key_paths.end(),
+        std::make_move_iterator(task_changed_key_paths.begin()),
+        std::make_move_iterator(task_changed_key_paths.end())
+    );
+  }
+
+  // Members that only exist in the new document.
+  for (nlohmann::json::const_iterator it = new_root.cbegin(); it != new_root.cend(); it++) {
+    if (FindValue(old_root, std::string_view(it.key())) == nullptr) {
+      key_path.clear();
+      AppendJsonPointerToken(&key_path, it.key());
+      changed_key_paths.push_back(key_path);
+    }
+  }
+
+  return changed_key_paths;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::ReadLayers(
+    const std::vector<std::filesystem::path>& overlay_file_paths,
+    std::size_t thread_count
+) {
+  if (!this->CreateConfigFileIfMissing()) {
+    return false;
+  }
+
+  // Taken before the config file is read, so that a change while it is read
+  // makes the next format-preserving write a full one.
+  std::error_code error_code;
+  std::filesystem::file_time_type config_file_time =
+      std::filesystem::last_write_time(this->config_file_path(), error_code);
+
+  if (error_code) {
+    return false;
+  }
+
+  std::vector<const std::filesystem::path*> layer_file_paths;
+  layer_file_paths.push_back(&this->config_file_path());
+  for (const std::filesystem::path& overlay_file_path : overlay_file_paths) {
+    layer_file_paths.push_back(&overlay_file_path);
+  }
+
+  // Parse each layer into a separate document, so that the current one is
+  // kept if parsing fails and can be compared against for subscribers.
+  std::size_t layer_count = layer_file_paths.size();
+  std::deque<nlohmann::json> layer_documents;
+  this->AcquireDocuments(layer_count, &layer_documents);
+
+  // The text of the config file is only kept if there are no overlays,
+  // since the merged document doesn't match it otherwise.
+  std::string source_text;
+  bool is_source_kept = this->preserve_format() && layer_count == 1;
+
+  std::size_t task_count = std::min(std::max<std::size_t>(thread_count, 1), layer_count);
+  auto parse_layers = [this, &layer_file_paths, &layer_documents, &source_text,
+      is_source_kept, layer_count, task_count](
+      std::size_t first_layer
+  ) {
+    for (std::size_t i = first_layer; i < layer_count; i += task_count) {
+      bool is_layer_parsed = (i == 0 && is_source_kept)
+          ? this->ParseSourceFile(*layer_file_paths[i], &source_text, &layer_documents[i])
+          : this->ParseConfigFile(*layer_file_paths[i], &layer_documents[i]);
+
+      if (!is_layer_parsed) {
+        return false;
+      }
+    }
+
+    return true;
+  };
+
+  bool is_parsed = true;
+  if (task_count == 1) {
+    is_parsed = parse_layers(0);
+  } else {
+    std::vector<std::future<bool>> futures;
+    for (std::size_t task = 0; task < task_count; task += 1) {
+      futures.push_back(std::async(std::launch::async, parse_layers, task));
+    }
+
+    for (std::future<bool>& future : futures) {
+      is_parsed = future.get() && is_parsed;
+    }
+  }
+
+  if (!is_parsed) {
+    return false;
+  }
+
+  for (std::size_t i = 1; i < layer_count; i += 1) {
+    MergeLayerRecursive(
+        layer_documents.front(),
+        layer_documents[i],
+        &layer_documents.front()
+    );
+  }
+
+  this->KeepSourceText(&source_text, config_file_time);
+  this->CommitParsedDocuments(&layer_documents);
+
+  return true;
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::Read() {
+  return this->ReadLayers({}, 1);
+}
+
+template <>
+inline bool NlohmannJsonConfigReader::Write(int indent_width) {
+  return this->WriteParallel(indent_width, 1);
+}
+
+/**
+ * Define MJSONI_EXTERN_TEMPLATES in every translation unit, and additionally
+ * MJSONI_INSTANTIATE_TEMPLATES in exactly one, to compile the non-template
+ * members of the reader once instead of in each translation unit.
+ */
+#if defined(MJSONI_INSTANTIATE_TEMPLATES)
+template class GenericConfigReader<
+    nlohmann::json,
+    nlohmann::json,
+    nlohmann::json
+>;
+#elif defined(MJSONI_EXTERN_TEMPLATES)
+extern template class GenericConfigReader<
+    nlohmann::json,
+    nlohmann::json,
+    nlohmann::json
+>;
+#endif
+
+} // namespace mjsoni
+
+#endif // MJSONI_NLOHMANN_JSON_CONFIG_READER_HPP_
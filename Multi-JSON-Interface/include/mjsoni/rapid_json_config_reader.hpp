@@ -20,64 +20,102 @@
 #ifndef MJSONI_RAPID_JSON_CONFIG_READER_HPP_
 #define MJSONI_RAPID_JSON_CONFIG_READER_HPP_
 
+#include <algorithm>
 #include <cstdarg>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <future>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <string>
 #include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
+
+#if defined(MJSONI_ENABLE_PMR)
+#include "json_memory.hpp"
+
+#if !defined(RAPIDJSON_DEFAULT_ALLOCATOR)
+#define RAPIDJSON_DEFAULT_ALLOCATOR \
+    ::RAPIDJSON_NAMESPACE::MemoryPoolAllocator< ::mjsoni::PmrJsonAllocator >
+#endif
+
+#if !defined(RAPIDJSON_DEFAULT_STACK_ALLOCATOR)
+#define RAPIDJSON_DEFAULT_STACK_ALLOCATOR ::mjsoni::PmrJsonAllocator
+#endif
+#endif
 
 #include <rapidjson/document.h>
 #include <rapidjson/istreamwrapper.h>
-#include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/prettywriter.h>
+#include <rapidjson/writer.h>
 #include "generic_json_config_reader.hpp"
 
 namespace mjsoni {
 
 using RapidJsonConfigReader = GenericConfigReader<rapidjson::Document, rapidjson::Value, rapidjson::Value>;
 
-/* Constructors and Destructors */
+#if defined(MJSONI_ENABLE_PMR)
+static_assert(
+    std::is_same<
+        rapidjson::Document::AllocatorType,
+        rapidjson::MemoryPoolAllocator<PmrJsonAllocator>
+    >::value,
+    "RapidJSON must be included after MJSONI_ENABLE_PMR is defined, and must "
+    "support RAPIDJSON_DEFAULT_ALLOCATOR."
+);
+#endif
 
-template <>
-inline RapidJsonConfigReader::GenericConfigReader(
-    std::filesystem::path config_file_path
-) : config_file_path_(std::move(config_file_path)) {
-}
+namespace detail {
 
-/* Functions for Generic Types */
+/**
+ * A RapidJSON output stream that appends to a std::string, so that a writer
+ * can serialize into a reusable buffer instead of a std::ostream.
+ */
+class StringOutputStream {
+ public:
+  using Ch = char;
 
-template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::ContainsKey(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  explicit StringOutputStream(std::string* buffer) noexcept
+      : buffer_(buffer) {
+  }
 
-  return this->ContainsKeyRecursive(
-      this->json_document(),
-      keys...
-  );
-}
+  void Put(char ch) {
+    this->buffer_->push_back(ch);
+  }
 
-template <>
-template <typename ...Args>
-const RapidJsonConfigReader::JsonValue&
-RapidJsonConfigReader::GetValueRef(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  void Flush() noexcept {
+  }
 
-  return this->GetValueRefRecursive(
-      this->json_document_,
-      keys...
-  );
+ private:
+  std::string* buffer_;
+};
+
+} // namespace detail
+
+/* Constructors and Destructors */
+
+template <>
+inline RapidJsonConfigReader::GenericConfigReader(
+    std::filesystem::path config_file_path,
+    std::pmr::memory_resource* memory_resource
+) : config_file_path_(std::move(config_file_path)),
+    memory_resource_(
+        (memory_resource != nullptr)
+            ? memory_resource
+            : std::pmr::get_default_resource()
+    ),
+    json_document_(this->MakeDocument()),
+    file_format_(JsonFileFormatFromExtension(this->config_file_path_)),
+    override_document_(this->MakeDocument()) {
 }
 
+/* Functions for Generic Types */
+
 template <>
 template <typename Container, typename ...Args>
 Container RapidJsonConfigReader::GetArrayCopy(
@@ -88,6 +126,8 @@ Container RapidJsonConfigReader::GetArrayCopy(
       "Number of keys must be greater than 1."
   );
 
+  using ElementType = typename Container::value_type;
+
   const rapidjson::Value& value_ref = this->GetValueRef(
       keys...
   );
@@ -95,9 +135,9 @@ Container RapidJsonConfigReader::GetArrayCopy(
   const rapidjson::Value::ConstArray& array_ref = value_ref.GetArray();
 
   Container container;
-  if constexpr (std::is_same<Container::value_type, std::string>::value
-      || std::is_same<Container::value_type, std::string_view>::value
-      || std::is_same<Container::value_type, std::filesystem::path>::value) {
+  if constexpr (std::is_same<ElementType, std::string>::value
+      || std::is_same<ElementType, std::string_view>::value
+      || std::is_same<ElementType, std::filesystem::path>::value) {
     for (rapidjson::Value::ConstValueIterator it = array_ref.begin(); it != array_ref.end(); it++) {
       container.insert(
           container.end(),
@@ -108,7 +148,7 @@ Container RapidJsonConfigReader::GetArrayCopy(
     for (rapidjson::Value::ConstValueIterator it = array_ref.begin(); it != array_ref.end(); it++) {
       container.insert(
           container.end(),
-          it->template Get<Container::value_type>()
+          it->template Get<ElementType>()
       );
     }
   }
@@ -128,29 +168,31 @@ void RapidJsonConfigReader::SetArray(
       "Number of keys must be greater than 1."
   );
 
+  using ElementType = typename std::iterator_traits<Iter>::value_type;
+
   const rapidjson::Value& value_ref = this->GetValueRef(
       keys...
   );
 
   rapidjson::Value json_array(rapidjson::kArrayType);
 
-  if constexpr (std::is_same<Iter::value_type, std::string>::value
-      || std::is_same<Iter::value_type, std::string_view>::value) {
+  if constexpr (std::is_same<ElementType, std::string>::value
+      || std::is_same<ElementType, std::string_view>::value) {
     for (Iter it = first; it != last; it += 1) {
       json_array.PushBack(
           rapidjson::Value(it->data(), this->json_document_.GetAllocator()),
           this->json_document_.GetAllocator()
       );
     }
-  } else if constexpr (std::is_same<Iter::value_type, std::filesystem::path>::value) {
+  } else if constexpr (std::is_same<ElementType, std::filesystem::path>::value) {
     for (Iter it = first; it != last; it += 1) {
       json_array.PushBack(
           rapidjson::Value(it->string().data(), this->json_document_.GetAllocator()),
           this->json_document_.GetAllocator()
       );
     }
-  } else if constexpr (std::is_same<Iter::value_type, char*>::value
-      || std::is_same<Iter::value_type, const char*>::value) {
+  } else if constexpr (std::is_same<ElementType, char*>::value
+      || std::is_same<ElementType, const char*>::value) {
     for (Iter it = first; it != last; it += 1) {
       json_array.PushBack(
           rapidjson::Value(*it, this->json_document_.GetAllocator()),
@@ -181,27 +223,29 @@ void RapidJsonConfigReader::SetDeepArray(
       "Number of keys must be greater than 1."
   );
 
+  using ElementType = typename std::iterator_traits<Iter>::value_type;
+
   rapidjson::Value json_array(rapidjson::kArrayType);
 
-  if constexpr (std::is_same<Iter::value_type, char*>::value
-      || std::is_same<Iter::value_type, const char*>::value
-      || std::is_same<Iter::value_type, std::string>::value
-      || std::is_same<Iter::value_type, std::string_view>::value) {
+  if constexpr (std::is_same<ElementType, char*>::value
+      || std::is_same<ElementType, const char*>::value
+      || std::is_same<ElementType, std::string>::value
+      || std::is_same<ElementType, std::string_view>::value) {
     for (Iter it = first; it != last; it++) {
       json_array.PushBack(
           rapidjson::Value(it->data(), this->json_document_.GetAllocator()),
           this->json_document_.GetAllocator()
       );
     }
-  } else if constexpr (std::is_same<Iter::value_type, std::filesystem::path>::value) {
+  } else if constexpr (std::is_same<ElementType, std::filesystem::path>::value) {
     for (Iter it = first; it != last; it += 1) {
       json_array.PushBack(
           rapidjson::Value(it->string().data(), this->json_document_.GetAllocator()),
           this->json_document_.GetAllocator()
       );
     }
-  } else if constexpr (std::is_same<Iter::value_type, char*>::value
-      || std::is_same<Iter::value_type, const char*>::value) {
+  } else if constexpr (std::is_same<ElementType, char*>::value
+      || std::is_same<ElementType, const char*>::value) {
     for (Iter it = first; it != last; it++) {
       json_array.PushBack(
           rapidjson::Value(*it, this->json_document_.GetAllocator()),
@@ -220,42 +264,6 @@ void RapidJsonConfigReader::SetDeepArray(
   );
 }
 
-template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetValue(
-    RapidJsonConfigReader::JsonValue value,
-    const Args&... keys
-) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
-
-  this->SetValueRecursive(
-      std::move(value),
-      this->json_document_,
-      keys...
-  );
-}
-
-template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepValue(
-    RapidJsonConfigReader::JsonValue value,
-    const Args&... keys
-) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
-
-  this->SetDeepValueRecursive(
-      std::move(value),
-      this->json_document_,
-      keys...
-  );
-}
-
 /* Functions for bool */
 
 template <>
@@ -494,11 +502,11 @@ void RapidJsonConfigReader::SetDeepDeque(
   );
 }
 
-/* Functions for int */
+/* Functions for std::filesystem::path */
 
 template <>
 template <typename ...Args>
-int RapidJsonConfigReader::GetInt(
+std::filesystem::path RapidJsonConfigReader::GetPath(
     const Args&... keys
 ) const {
   static_assert(
@@ -506,17 +514,17 @@ int RapidJsonConfigReader::GetInt(
       "Number of keys must be greater than 1."
   );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
+  std::string value = this->GetString(
       keys...
   );
 
-  return value_ref.GetInt();
+  return std::filesystem::path(std::move(value));
 }
 
 template <>
 template <typename ...Args>
-int RapidJsonConfigReader::GetIntOrDefault(
-    int default_value,
+std::filesystem::path RapidJsonConfigReader::GetPathOrDefault(
+    const std::filesystem::path& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -524,16 +532,17 @@ int RapidJsonConfigReader::GetIntOrDefault(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasInt(keys...)) {
+  if (!this->HasPath(keys...)) {
     return default_value;
   }
 
-  return this->GetInt(keys...);
+  return this->GetPath(keys...);
 }
 
 template <>
 template <typename ...Args>
-bool RapidJsonConfigReader::HasInt(
+std::filesystem::path RapidJsonConfigReader::GetPathOrDefault(
+    std::filesystem::path&& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -541,21 +550,32 @@ bool RapidJsonConfigReader::HasInt(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->ContainsKey(keys...)) {
-    return false;
+  if (!this->HasPath(keys...)) {
+    return std::move(default_value);
   }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
+  return this->GetPath(keys...);
+}
+
+template <>
+template <typename ...Args>
+bool RapidJsonConfigReader::HasPath(
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
   );
 
-  return value_ref.IsInt();
+  return this->HasString(
+      keys...
+  );
 }
 
 template <>
 template <typename ...Args>
-void RapidJsonConfigReader::SetInt(
-    int value,
+void RapidJsonConfigReader::SetPath(
+    const std::filesystem::path& value,
     const Args&... keys
 ) {
   static_assert(
@@ -563,16 +583,16 @@ void RapidJsonConfigReader::SetInt(
       "Number of keys must be greater than 1."
   );
 
-  this->SetValue(
-      rapidjson::Value(value),
+  this->SetString(
+      value.string(),
       keys...
   );
 }
 
 template <>
 template <typename ...Args>
-void RapidJsonConfigReader::SetDeepInt(
-    int value,
+void RapidJsonConfigReader::SetDeepPath(
+    const std::filesystem::path& value,
     const Args&... keys
 ) {
   static_assert(
@@ -580,17 +600,17 @@ void RapidJsonConfigReader::SetDeepInt(
       "Number of keys must be greater than 1."
   );
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
+  this->SetDeepString(
+      value.string(),
       keys...
   );
 }
 
-/* Functions for std::int32_t */
+/* Functions for std::set */
 
 template <>
-template <typename ...Args>
-std::int32_t RapidJsonConfigReader::GetInt32(
+template <typename T, typename ...Args>
+std::set<T> RapidJsonConfigReader::GetSet(
     const Args&... keys
 ) const {
   static_assert(
@@ -598,17 +618,15 @@ std::int32_t RapidJsonConfigReader::GetInt32(
       "Number of keys must be greater than 1."
   );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
+  return this->GetArrayCopy<std::set<T>>(
       keys...
   );
-
-  return value_ref.GetInt();
 }
 
 template <>
-template <typename ...Args>
-std::int32_t RapidJsonConfigReader::GetInt32OrDefault(
-    std::int32_t default_value,
+template <typename T, typename ...Args>
+std::set<T> RapidJsonConfigReader::GetSetOrDefault(
+    const std::set<T>& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -616,16 +634,34 @@ std::int32_t RapidJsonConfigReader::GetInt32OrDefault(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasInt32(keys...)) {
+  if (!this->HasSet(keys...)) {
     return default_value;
   }
 
-  return this->GetInt32(keys...);
+  return this->GetSet<T>(keys...);
+}
+
+template <>
+template <typename T, typename ...Args>
+std::set<T> RapidJsonConfigReader::GetSetOrDefault(
+    std::set<T>&& default_value,
+    const Args&... keys
+) const {
+  static_assert(
+      sizeof...(keys) >= 1,
+      "Number of keys must be greater than 1."
+  );
+
+  if (!this->HasSet(keys...)) {
+    return std::move(default_value);
+  }
+
+  return this->GetSet<T>(keys...);
 }
 
 template <>
 template <typename ...Args>
-bool RapidJsonConfigReader::HasInt32(
+bool RapidJsonConfigReader::HasSet(
     const Args&... keys
 ) const {
   static_assert(
@@ -641,13 +677,13 @@ bool RapidJsonConfigReader::HasInt32(
       keys...
   );
 
-  return value_ref.IsInt();
+  return value_ref.IsArray();
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetInt32(
-    std::int32_t value,
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetSet(
+    const std::set<T>& value,
     const Args&... keys
 ) {
   static_assert(
@@ -655,16 +691,17 @@ void RapidJsonConfigReader::SetInt32(
       "Number of keys must be greater than 1."
   );
 
-  this->SetValue(
-      rapidjson::Value(value),
+  this->SetArray(
+      value.cbegin(),
+      value.cend(),
       keys...
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepInt32(
-    std::int32_t value,
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetSet(
+    std::set<T>&& value,
     const Args&... keys
 ) {
   static_assert(
@@ -672,88 +709,90 @@ void RapidJsonConfigReader::SetDeepInt32(
       "Number of keys must be greater than 1."
   );
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
+  this->SetArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
       keys...
   );
 }
 
-/* Functions for std::int64_t */
-
 template <>
-template <typename ...Args>
-std::int64_t RapidJsonConfigReader::GetInt64(
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetDeepSet(
+    const std::set<T>& value,
     const Args&... keys
-) const {
+) {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
+  this->SetDeepArray(
+      value.cbegin(),
+      value.cend(),
       keys...
   );
-
-  return value_ref.GetInt64();
 }
 
 template <>
-template <typename ...Args>
-std::int64_t RapidJsonConfigReader::GetInt64OrDefault(
-    std::int64_t default_value,
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetDeepSet(
+    std::set<T>&& value,
     const Args&... keys
-) const {
+) {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasInt64(keys...)) {
-    return default_value;
-  }
-
-  return this->GetInt64(keys...);
+  this->SetDeepArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
+      keys...
+  );
 }
 
+/* Functions for std::string */
+
 template <>
 template <typename ...Args>
-void RapidJsonConfigReader::SetInt64(
-    std::int64_t value,
+std::string RapidJsonConfigReader::GetString(
     const Args&... keys
-) {
+) const {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  this->SetValue(
-      rapidjson::Value(value),
+  const rapidjson::Value& value_ref = this->GetValueRef(
       keys...
   );
+
+  return value_ref.GetString();
 }
 
 template <>
 template <typename ...Args>
-void RapidJsonConfigReader::SetDeepInt64(
-    std::int64_t value,
+std::string RapidJsonConfigReader::GetStringOrDefault(
+    const std::string& default_value,
     const Args&... keys
-) {
+) const {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
-      keys...
-  );
-}
+  if (!this->HasString(keys...)) {
+    return default_value;
+  }
 
-/* Functions for long */
+  return this->GetString(keys...);
+}
 
 template <>
 template <typename ...Args>
-long RapidJsonConfigReader::GetLong(
+std::string RapidJsonConfigReader::GetStringOrDefault(
+    std::string&& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -761,17 +800,16 @@ long RapidJsonConfigReader::GetLong(
       "Number of keys must be greater than 1."
   );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+  if (!this->HasString(keys...)) {
+    return std::move(default_value);
+  }
 
-  return value_ref.GetInt();
+  return this->GetString(keys...);
 }
 
 template <>
 template <typename ...Args>
-long RapidJsonConfigReader::GetLongOrDefault(
-    long default_value,
+bool RapidJsonConfigReader::HasString(
     const Args&... keys
 ) const {
   static_assert(
@@ -779,17 +817,21 @@ long RapidJsonConfigReader::GetLongOrDefault(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasLong(keys...)) {
-    return default_value;
+  if (!this->ContainsKey(keys...)) {
+    return false;
   }
 
-  return this->GetLong(keys...);
+  const rapidjson::Value& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.GetString();
 }
 
 template <>
 template <typename ...Args>
-void RapidJsonConfigReader::SetLong(
-    long value,
+void RapidJsonConfigReader::SetString(
+    const std::string& value,
     const Args&... keys
 ) {
   static_assert(
@@ -798,15 +840,15 @@ void RapidJsonConfigReader::SetLong(
   );
 
   this->SetValue(
-      rapidjson::Value(value),
+      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
       keys...
   );
 }
 
 template <>
 template <typename ...Args>
-void RapidJsonConfigReader::SetDeepLong(
-    long value,
+void RapidJsonConfigReader::SetString(
+    std::string&& value,
     const Args&... keys
 ) {
   static_assert(
@@ -814,88 +856,85 @@ void RapidJsonConfigReader::SetDeepLong(
       "Number of keys must be greater than 1."
   );
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
+  this->SetValue(
+      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
       keys...
   );
 }
 
-/* Functions for long long */
-
 template <>
 template <typename ...Args>
-long long RapidJsonConfigReader::GetLongLong(
+void RapidJsonConfigReader::SetDeepString(
+    const std::string& value,
     const Args&... keys
-) const {
+) {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
+  this->SetDeepValue(
+      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
       keys...
   );
-
-  return value_ref.GetInt64();
 }
 
 template <>
 template <typename ...Args>
-long long RapidJsonConfigReader::GetLongLongOrDefault(
-    long long default_value,
+void RapidJsonConfigReader::SetDeepString(
+    std::string&& value,
     const Args&... keys
-) const {
+) {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasLongLong(keys...)) {
-    return default_value;
-  }
-
-  return this->GetLongLong(keys...);
+  this->SetDeepValue(
+      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
+      keys...
+  );
 }
 
+/* Functions for std::unordered_set */
+
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetLongLong(
-    long long value,
+template <typename T, typename ...Args>
+std::unordered_set<T> RapidJsonConfigReader::GetUnorderedSet(
     const Args&... keys
-) {
+) const {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  this->SetValue(
-      rapidjson::Value(value),
+  return this->GetArrayCopy<std::unordered_set<T>>(
       keys...
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepLongLong(
-    long long value,
+template <typename T, typename ...Args>
+std::unordered_set<T> RapidJsonConfigReader::GetUnorderedSetOrDefault(
+    const std::unordered_set<T>& default_value,
     const Args&... keys
-) {
+) const {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
-      keys...
-  );
-}
+  if (!this->HasUnorderedSet(keys...)) {
+    return default_value;
+  }
 
-/* Functions for std::filesystem::path */
+  return this->GetUnorderedSet<T>(keys...);
+}
 
 template <>
-template <typename ...Args>
-std::filesystem::path RapidJsonConfigReader::GetPath(
+template <typename T, typename ...Args>
+std::unordered_set<T> RapidJsonConfigReader::GetUnorderedSetOrDefault(
+    std::unordered_set<T>&& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -903,17 +942,16 @@ std::filesystem::path RapidJsonConfigReader::GetPath(
       "Number of keys must be greater than 1."
   );
 
-  std::string value = this->GetString(
-      keys...
-  );
+  if (!this->HasUnorderedSet(keys...)) {
+    return std::move(default_value);
+  }
 
-  return std::filesystem::path(std::move(value));
+  return this->GetUnorderedSet<T>(keys...);
 }
 
 template <>
 template <typename ...Args>
-std::filesystem::path RapidJsonConfigReader::GetPathOrDefault(
-    const std::filesystem::path& default_value,
+bool RapidJsonConfigReader::HasUnorderedSet(
     const Args&... keys
 ) const {
   static_assert(
@@ -921,50 +959,57 @@ std::filesystem::path RapidJsonConfigReader::GetPathOrDefault(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasPath(keys...)) {
-    return default_value;
+  if (!this->ContainsKey(keys...)) {
+    return false;
   }
 
-  return this->GetPath(keys...);
+  const rapidjson::Value& value_ref = this->GetValueRef(
+      keys...
+  );
+
+  return value_ref.IsArray();
 }
 
 template <>
-template <typename ...Args>
-std::filesystem::path RapidJsonConfigReader::GetPathOrDefault(
-    std::filesystem::path&& default_value,
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetUnorderedSet(
+    const std::unordered_set<T>& value,
     const Args&... keys
-) const {
+) {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasPath(keys...)) {
-    return std::move(default_value);
-  }
-
-  return this->GetPath(keys...);
+  this->SetArray(
+      value.cbegin(),
+      value.cend(),
+      keys...
+  );
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasPath(
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetUnorderedSet(
+    std::unordered_set<T>&& value,
     const Args&... keys
-) const {
+) {
   static_assert(
       sizeof...(keys) >= 1,
       "Number of keys must be greater than 1."
   );
 
-  return this->HasString(
+  this->SetArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
       keys...
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetPath(
-    const std::filesystem::path& value,
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetDeepUnorderedSet(
+    const std::unordered_set<T>& value,
     const Args&... keys
 ) {
   static_assert(
@@ -972,16 +1017,17 @@ void RapidJsonConfigReader::SetPath(
       "Number of keys must be greater than 1."
   );
 
-  this->SetString(
-      value.string(),
+  this->SetDeepArray(
+      value.cbegin(),
+      value.cend(),
       keys...
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepPath(
-    const std::filesystem::path& value,
+template <typename T, typename ...Args>
+void RapidJsonConfigReader::SetDeepUnorderedSet(
+    std::unordered_set<T>&& value,
     const Args&... keys
 ) {
   static_assert(
@@ -989,17 +1035,18 @@ void RapidJsonConfigReader::SetDeepPath(
       "Number of keys must be greater than 1."
   );
 
-  this->SetDeepString(
-      value.string(),
+  this->SetDeepArray(
+      std::make_move_iterator(value.begin()),
+      std::make_move_iterator(value.end()),
       keys...
   );
 }
 
-/* Functions for std::set */
+/* Functions of std::vector */
 
 template <>
 template <typename T, typename ...Args>
-std::set<T> RapidJsonConfigReader::GetSet(
+std::vector<T> RapidJsonConfigReader::GetVector(
     const Args&... keys
 ) const {
   static_assert(
@@ -1007,15 +1054,15 @@ std::set<T> RapidJsonConfigReader::GetSet(
       "Number of keys must be greater than 1."
   );
 
-  return this->GetArrayCopy<std::set<T>>(
+  return this->GetArrayCopy<std::vector<T>>(
       keys...
   );
 }
 
 template <>
 template <typename T, typename ...Args>
-std::set<T> RapidJsonConfigReader::GetSetOrDefault(
-    const std::set<T>& default_value,
+std::vector<T> RapidJsonConfigReader::GetVectorOrDefault(
+    const std::vector<T>& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -1023,17 +1070,17 @@ std::set<T> RapidJsonConfigReader::GetSetOrDefault(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasSet(keys...)) {
+  if (!this->ContainsKey(keys...)) {
     return default_value;
   }
 
-  return this->GetSet<T>(keys...);
+  return this->GetVector<T>(keys...);
 }
 
 template <>
 template <typename T, typename ...Args>
-std::set<T> RapidJsonConfigReader::GetSetOrDefault(
-    std::set<T>&& default_value,
+std::vector<T> RapidJsonConfigReader::GetVectorOrDefault(
+    std::vector<T>&& default_value,
     const Args&... keys
 ) const {
   static_assert(
@@ -1041,16 +1088,16 @@ std::set<T> RapidJsonConfigReader::GetSetOrDefault(
       "Number of keys must be greater than 1."
   );
 
-  if (!this->HasSet(keys...)) {
+  if (!this->ContainsKey(keys...)) {
     return std::move(default_value);
   }
 
-  return this->GetSet<T>(keys...);
+  return this->GetVector<T>(keys...);
 }
 
 template <>
 template <typename ...Args>
-bool RapidJsonConfigReader::HasSet(
+bool RapidJsonConfigReader::HasVector(
     const Args&... keys
 ) const {
   static_assert(
@@ -1071,8 +1118,8 @@ bool RapidJsonConfigReader::HasSet(
 
 template <>
 template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetSet(
-    const std::set<T>& value,
+void RapidJsonConfigReader::SetVector(
+    const std::vector<T>& value,
     const Args&... keys
 ) {
   static_assert(
@@ -1089,8 +1136,8 @@ void RapidJsonConfigReader::SetSet(
 
 template <>
 template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetSet(
-    std::set<T>&& value,
+void RapidJsonConfigReader::SetVector(
+    std::vector<T>&& value,
     const Args&... keys
 ) {
   static_assert(
@@ -1107,8 +1154,8 @@ void RapidJsonConfigReader::SetSet(
 
 template <>
 template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetDeepSet(
-    const std::set<T>& value,
+void RapidJsonConfigReader::SetDeepVector(
+    const std::vector<T>& value,
     const Args&... keys
 ) {
   static_assert(
@@ -1125,8 +1172,8 @@ void RapidJsonConfigReader::SetDeepSet(
 
 template <>
 template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetDeepSet(
-    std::set<T>&& value,
+void RapidJsonConfigReader::SetDeepVector(
+    std::vector<T>&& value,
     const Args&... keys
 ) {
   static_assert(
@@ -1141,1113 +1188,2172 @@ void RapidJsonConfigReader::SetDeepSet(
   );
 }
 
-/* Functions for std::string */
+/* Private Helper Functions */
 
 template <>
-template <typename ...Args>
-std::string RapidJsonConfigReader::GetString(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline const rapidjson::Value* RapidJsonConfigReader::FindValue(
+    const rapidjson::Value& object,
+    std::string_view key
+) {
+  if (!object.IsObject()) {
+    return nullptr;
+  }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+  // Compare the stored member name lengths first, so that strlen is never
+  // needed and most non-matching members are rejected without a memcmp.
+  for (rapidjson::Value::ConstMemberIterator it = object.MemberBegin();
+      it != object.MemberEnd();
+      it++) {
+    if (it->name.GetStringLength() == key.size()
+        && std::memcmp(it->name.GetString(), key.data(), key.size()) == 0) {
+      return &it->value;
+    }
+  }
 
-  return value_ref.GetString();
+  return nullptr;
 }
 
 template <>
-template <typename ...Args>
-std::string RapidJsonConfigReader::GetStringOrDefault(
-    const std::string& default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline const rapidjson::Value* RapidJsonConfigReader::FindValue(
+    const rapidjson::Value& object,
+    const JsonKey& key
+) {
+  // Index keys select array elements directly.
+  if (key.is_index()) {
+    if (!object.IsArray() || key.index() >= object.Size()) {
+      return nullptr;
+    }
 
-  if (!this->HasString(keys...)) {
-    return default_value;
+    return &object[static_cast<rapidjson::SizeType>(key.index())];
   }
 
-  return this->GetString(keys...);
-}
-
-template <>
-template <typename ...Args>
-std::string RapidJsonConfigReader::GetStringOrDefault(
-    std::string&& default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  if (!object.IsObject()) {
+    return nullptr;
+  }
 
-  if (!this->HasString(keys...)) {
-    return std::move(default_value);
+  for (rapidjson::Value::ConstMemberIterator it = object.MemberBegin();
+      it != object.MemberEnd();
+      it++) {
+    if (key.Equals(it->name.GetString(), it->name.GetStringLength())) {
+      return &it->value;
+    }
   }
 
-  return this->GetString(keys...);
+  return nullptr;
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasString(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+inline rapidjson::Value* RapidJsonConfigReader::FindValue(
+    rapidjson::Value& object,
+    std::string_view key
+) {
+  return const_cast<rapidjson::Value*>(
+      FindValue(static_cast<const rapidjson::Value&>(object), key)
   );
+}
 
-  if (!this->ContainsKey(keys...)) {
-    return false;
-  }
-
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
+template <>
+inline rapidjson::Value* RapidJsonConfigReader::FindValue(
+    rapidjson::Value& object,
+    const JsonKey& key
+) {
+  return const_cast<rapidjson::Value*>(
+      FindValue(static_cast<const rapidjson::Value&>(object), key)
   );
-
-  return value_ref.GetString();
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetString(
-    const std::string& value,
-    const Args&... keys
+inline const rapidjson::Value* RapidJsonConfigReader::FindValueByKeys(
+    const rapidjson::Value& root,
+    std::initializer_list<JsonKey> keys
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  const rapidjson::Value* value_ptr = &root;
 
-  this->SetValue(
-      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
-      keys...
-  );
+  for (const JsonKey& key : keys) {
+    value_ptr = FindValue(*value_ptr, key);
+    if (value_ptr == nullptr) {
+      return nullptr;
+    }
+  }
+
+  return value_ptr;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetString(
-    std::string&& value,
-    const Args&... keys
+inline rapidjson::Value* RapidJsonConfigReader::FindValueByKeys(
+    rapidjson::Value& root,
+    std::initializer_list<JsonKey> keys
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
-
-  this->SetValue(
-      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
-      keys...
+  return const_cast<rapidjson::Value*>(
+      FindValueByKeys(static_cast<const rapidjson::Value&>(root), keys)
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepString(
-    const std::string& value,
-    const Args&... keys
+inline bool RapidJsonConfigReader::SetValueByKeys(
+    rapidjson::Value value,
+    std::initializer_list<JsonKey> keys
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  // Every key but the last one has to lead to an existing object, or to an
+  // existing array if the last key is an index.
+  rapidjson::Value* object_ptr = &this->json_document_;
+
+  const JsonKey* last_key_ptr = keys.end() - 1;
+  for (const JsonKey* key_ptr = keys.begin(); key_ptr != last_key_ptr; key_ptr++) {
+    object_ptr = FindValue(*object_ptr, *key_ptr);
+    if (object_ptr == nullptr) {
+      return false;
+    }
+  }
 
-  this->SetDeepValue(
-      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
-      keys...
-  );
-}
+  // An element is replaced if it exists, or appended if the index is the
+  // size of the array.
+  if (last_key_ptr->is_index()) {
+    if (!object_ptr->IsArray() || last_key_ptr->index() > object_ptr->Size()) {
+      return false;
+    }
 
-template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepString(
-    std::string&& value,
-    const Args&... keys
-) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+    if (last_key_ptr->index() < object_ptr->Size()) {
+      (*object_ptr)[static_cast<rapidjson::SizeType>(last_key_ptr->index())] =
+          std::move(value);
+    } else {
+      object_ptr->PushBack(std::move(value), this->json_document_.GetAllocator());
+    }
 
-  this->SetDeepValue(
-      rapidjson::Value(value.data(), this->json_document_.GetAllocator()),
-      keys...
-  );
-}
+    return true;
+  }
 
-/* Functions for unsigned int */
+  if (!object_ptr->IsObject()) {
+    return false;
+  }
 
-template <>
-template <typename ...Args>
-unsigned int RapidJsonConfigReader::GetUnsignedInt(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+  // Check for the existence of the key-value and add the value if it does
+  // not exist.
+  rapidjson::Value* value_ptr = FindValue(*object_ptr, *last_key_ptr);
+  if (value_ptr != nullptr) {
+    *value_ptr = std::move(value);
+    return true;
+  }
+
+  rapidjson::Value copy_key(
+      last_key_ptr->data(),
+      static_cast<rapidjson::SizeType>(last_key_ptr->size()),
+      this->json_document_.GetAllocator()
   );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
+  object_ptr->AddMember(
+      copy_key,
+      std::move(value),
+      this->json_document_.GetAllocator()
   );
 
-  return value_ref.GetUint();
+  return true;
 }
 
 template <>
-template <typename ...Args>
-unsigned int RapidJsonConfigReader::GetUnsignedIntOrDefault(
-    unsigned int default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline bool RapidJsonConfigReader::SetDeepValueByKeys(
+    rapidjson::Value value,
+    std::initializer_list<JsonKey> keys
+) {
+  // An index past the bound leaves the document unchanged, so the key path
+  // is checked before anything is created. Past the first missing value,
+  // the arrays on the way are created empty.
+  const rapidjson::Value* existing_value_ptr = &this->json_document_;
+  for (const JsonKey& key : keys) {
+    if (key.is_index()) {
+      std::size_t size = (existing_value_ptr != nullptr && existing_value_ptr->IsArray())
+          ? existing_value_ptr->Size()
+          : 0;
+
+      if (key.index() >= size && key.index() - size >= kMaxArrayGrowth) {
+        return false;
+      }
+    }
 
-  if (!this->HasUnsignedInt(keys...)) {
-    return default_value;
+    existing_value_ptr = (existing_value_ptr != nullptr)
+        ? FindValue(*existing_value_ptr, key)
+        : nullptr;
   }
 
-  return this->GetUnsignedInt(keys...);
-}
+  rapidjson::Value* value_ptr = &this->json_document_;
+
+  for (const JsonKey& key : keys) {
+    // Arrays on the way to the destination are grown with nulls to include
+    // the index, and values that aren't arrays are replaced by arrays.
+    if (key.is_index()) {
+      if (!value_ptr->IsArray()) {
+        value_ptr->SetArray();
+      }
+
+      if (key.index() >= value_ptr->Size()) {
+        value_ptr->Reserve(
+            static_cast<rapidjson::SizeType>(key.index() + 1),
+            this->json_document_.GetAllocator()
+        );
+
+        while (key.index() >= value_ptr->Size()) {
+          value_ptr->PushBack(rapidjson::Value(), this->json_document_.GetAllocator());
+        }
+      }
+
+      value_ptr = &(*value_ptr)[static_cast<rapidjson::SizeType>(key.index())];
+      continue;
+    }
 
-template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasUnsignedInt(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+    // Values on the way to the destination that are missing or aren't
+    // objects are replaced by objects.
+    if (!value_ptr->IsObject()) {
+      value_ptr->SetObject();
+    }
 
-  if (!this->ContainsKey(keys...)) {
-    return false;
-  }
+    rapidjson::Value* member_value_ptr = FindValue(*value_ptr, key);
+    if (member_value_ptr == nullptr) {
+      rapidjson::Value copy_key(
+          key.data(),
+          static_cast<rapidjson::SizeType>(key.size()),
+          this->json_document_.GetAllocator()
+      );
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+      value_ptr->AddMember(
+          copy_key,
+          rapidjson::Value(),
+          this->json_document_.GetAllocator()
+      );
 
-  return value_ref.IsUint();
-}
+      member_value_ptr = &(value_ptr->MemberEnd() - 1)->value;
+    }
 
-template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetUnsignedInt(
-    unsigned int value,
-    const Args&... keys
-) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+    value_ptr = member_value_ptr;
+  }
 
-  this->SetValue(
-      rapidjson::Value(value),
-      keys...
-  );
+  *value_ptr = std::move(value);
+
+  return true;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepUnsignedInt(
-    unsigned int value,
-    const Args&... keys
+inline rapidjson::Value* RapidJsonConfigReader::FindOrAddValue(
+    rapidjson::Value& parent,
+    const JsonKey& key,
+    bool is_deep,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t reference_token_count,
+    std::vector<UndoEntry>* undo_log
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  rapidjson::Value* value_ptr = FindValue(parent, key);
+  if (value_ptr != nullptr) {
+    return value_ptr;
+  }
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
-      keys...
+  std::vector<std::string> child_reference_tokens(
+      reference_tokens.cbegin(),
+      reference_tokens.cbegin() + reference_token_count
   );
-}
 
-/* Functions for std::uint32_t */
+  // An index far past the end of an array is rejected, rather than filling
+  // the array with nulls.
+  if (key.is_index()) {
+    std::size_t size = parent.IsArray() ? parent.Size() : 0;
+    if (key.index() - size >= kMaxArrayGrowth) {
+      return nullptr;
+    }
+  }
 
-template <>
-template <typename ...Args>
-std::uint32_t RapidJsonConfigReader::GetUnsignedInt32(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  // Only SetDeep* replaces a parent of the wrong kind.
+  if (key.is_index() ? !parent.IsArray() : !parent.IsObject()) {
+    if (!is_deep) {
+      return nullptr;
+    }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+    undo_log->push_back(UndoEntry{
+        UndoEntry::Kind::kReplaced,
+        std::vector<std::string>(
+            child_reference_tokens.cbegin(),
+            child_reference_tokens.cend() - 1
+        ),
+        0,
+        std::move(parent)
+    });
+
+    if (key.is_index()) {
+      parent.SetArray();
+    } else {
+      parent.SetObject();
+    }
+  }
 
-  return value_ref.GetUint();
-}
+  if (key.is_index()) {
+    // Only SetDeep* grows an array beyond the element after its end.
+    if (!is_deep && key.index() != parent.Size()) {
+      return nullptr;
+    }
 
-template <>
-template <typename ...Args>
-std::uint32_t RapidJsonConfigReader::GetUnsignedInt32OrDefault(
-    std::uint32_t default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+    while (key.index() >= parent.Size()) {
+      child_reference_tokens.back() = std::to_string(parent.Size());
+      undo_log->push_back(UndoEntry{
+          UndoEntry::Kind::kInsertedElement,
+          child_reference_tokens,
+          parent.Size(),
+          rapidjson::Value()
+      });
 
-  if (!this->HasUnsignedInt32(keys...)) {
-    return default_value;
-  }
+      parent.PushBack(rapidjson::Value(), this->json_document_.GetAllocator());
+    }
 
-  return this->GetUnsignedInt32(keys...);
-}
+    return &parent[static_cast<rapidjson::SizeType>(key.index())];
+  }
 
-template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasUnsignedInt32(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+  rapidjson::Value copy_key(
+      key.data(),
+      static_cast<rapidjson::SizeType>(key.size()),
+      this->json_document_.GetAllocator()
   );
 
-  if (!this->ContainsKey(keys...)) {
-    return false;
-  }
-
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
+  parent.AddMember(
+      copy_key,
+      rapidjson::Value(),
+      this->json_document_.GetAllocator()
   );
 
-  return value_ref.IsUint();
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kAddedMember,
+      std::move(child_reference_tokens),
+      parent.MemberCount() - 1,
+      rapidjson::Value()
+  });
+
+  return &(parent.MemberEnd() - 1)->value;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetUnsignedInt32(
-    std::uint32_t value,
-    const Args&... keys
+inline rapidjson::Value RapidJsonConfigReader::CopyValue(
+    const rapidjson::Value& value,
+    rapidjson::Document* document
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  return rapidjson::Value(value, document->GetAllocator());
+}
 
-  this->SetValue(
-      rapidjson::Value(value),
-      keys...
+template <>
+inline rapidjson::Value RapidJsonConfigReader::MakeStringValue(
+    std::string_view text,
+    rapidjson::Document* document
+) {
+  return rapidjson::Value(
+      text.data(),
+      static_cast<rapidjson::SizeType>(text.size()),
+      document->GetAllocator()
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepUnsignedInt32(
-    std::uint32_t value,
-    const Args&... keys
+inline void RapidJsonConfigReader::AppendJournalRecord(
+    std::string* journal_buffer,
+    const std::vector<JsonKey>& keys,
+    const rapidjson::Value* value_ptr
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  detail::StringOutputStream output_stream(journal_buffer);
+  rapidjson::Writer<detail::StringOutputStream> writer(output_stream);
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
-      keys...
-  );
-}
+  writer.StartObject();
 
-/* Functions for std::uint64_t */
+  writer.Key("p", 1);
+  writer.StartArray();
+  for (const JsonKey& key : keys) {
+    if (key.is_index()) {
+      writer.Uint64(key.index());
+    } else {
+      writer.String(key.data(), static_cast<rapidjson::SizeType>(key.size()));
+    }
+  }
+  writer.EndArray();
 
-template <>
-template <typename ...Args>
-std::uint64_t RapidJsonConfigReader::GetUnsignedInt64(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  if (value_ptr != nullptr) {
+    writer.Key("v", 1);
+    value_ptr->Accept(writer);
+  }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+  writer.EndObject();
 
-  return value_ref.GetInt64();
+  journal_buffer->push_back('\n');
 }
 
 template <>
-template <typename ...Args>
-std::uint64_t RapidJsonConfigReader::GetUnsignedInt64OrDefault(
-    std::uint64_t default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline bool RapidJsonConfigReader::ReadJournalRecord(
+    const rapidjson::Value& record,
+    std::vector<JsonKey>* keys,
+    const rapidjson::Value** value_ptr
+) {
+  const rapidjson::Value* key_path_ptr = FindValue(record, std::string_view("p"));
+  if (key_path_ptr == nullptr || !key_path_ptr->IsArray()) {
+    return false;
+  }
 
-  if (!this->HasUnsignedInt64(keys...)) {
-    return default_value;
+  keys->clear();
+  for (rapidjson::Value::ConstValueIterator it = key_path_ptr->Begin();
+      it != key_path_ptr->End();
+      it++) {
+    if (it->IsUint64()) {
+      keys->push_back(JsonKey(static_cast<std::size_t>(it->GetUint64())));
+    } else if (it->IsString()) {
+      keys->push_back(JsonKey(std::string_view(it->GetString(), it->GetStringLength())));
+    } else {
+      return false;
+    }
   }
 
-  return this->GetUnsignedInt64(keys...);
+  *value_ptr = FindValue(record, std::string_view("v"));
+
+  return true;
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasUnsignedInt64(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
-
-  if (!this->ContainsKey(keys...)) {
-    return false;
+inline const rapidjson::Value* RapidJsonConfigReader::ResolveReferenceTokens(
+    const rapidjson::Value& root,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t count
+) {
+  const rapidjson::Value* value_ptr = &root;
+
+  for (std::size_t i = 0; i < count && value_ptr != nullptr; i += 1) {
+    if (value_ptr->IsObject()) {
+      value_ptr = FindValue(*value_ptr, std::string_view(reference_tokens[i]));
+    } else if (value_ptr->IsArray()) {
+      std::size_t index;
+      if (!ParseJsonPointerArrayIndex(reference_tokens[i], &index)
+          || index >= value_ptr->Size()) {
+        return nullptr;
+      }
+
+      value_ptr = &(*value_ptr)[static_cast<rapidjson::SizeType>(index)];
+    } else {
+      return nullptr;
+    }
   }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
-
-  return value_ref.IsUint64();
+  return value_ptr;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetUnsignedInt64(
-    std::uint64_t value,
-    const Args&... keys
+inline rapidjson::Value* RapidJsonConfigReader::ResolveReferenceTokens(
+    rapidjson::Value& root,
+    const std::vector<std::string>& reference_tokens,
+    std::size_t count
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
-
-  this->SetValue(
-      rapidjson::Value(value),
-      keys...
+  return const_cast<rapidjson::Value*>(
+      ResolveReferenceTokens(
+          static_cast<const rapidjson::Value&>(root),
+          reference_tokens,
+          count
+      )
   );
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepUnsignedInt64(
-    std::uint64_t value,
-    const Args&... keys
+inline bool RapidJsonConfigReader::ReplaceAtReferenceTokens(
+    const std::vector<std::string>& reference_tokens,
+    rapidjson::Value value,
+    std::vector<UndoEntry>* undo_log
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+  rapidjson::Value* value_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      reference_tokens,
+      reference_tokens.size()
   );
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
-      keys...
-  );
-}
+  if (value_ptr == nullptr) {
+    return false;
+  }
 
-/* Functions for unsigned long */
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kReplaced,
+      reference_tokens,
+      0,
+      std::move(*value_ptr)
+  });
 
-template <>
-template <typename ...Args>
-unsigned long RapidJsonConfigReader::GetUnsignedLong(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  *value_ptr = std::move(value);
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
-
-  return value_ref.GetUint();
+  return true;
 }
 
 template <>
-template <typename ...Args>
-unsigned long RapidJsonConfigReader::GetUnsignedLongOrDefault(
-    unsigned long default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+inline bool RapidJsonConfigReader::AddAtReferenceTokens(
+    std::vector<std::string>* reference_tokens,
+    rapidjson::Value value,
+    std::vector<UndoEntry>* undo_log
+) {
+  // Adding to the root replaces the whole document.
+  if (reference_tokens->empty()) {
+    return this->ReplaceAtReferenceTokens(
+        *reference_tokens,
+        std::move(value),
+        undo_log
+    );
+  }
+
+  rapidjson::Value* parent_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      *reference_tokens,
+      reference_tokens->size() - 1
   );
 
-  if (!this->HasUnsignedLong(keys...)) {
-    return default_value;
+  if (parent_ptr == nullptr) {
+    return false;
+  }
+
+  std::string& last_token = reference_tokens->back();
+
+  if (parent_ptr->IsObject()) {
+    rapidjson::Value* value_ptr = FindValue(*parent_ptr, std::string_view(last_token));
+    if (value_ptr != nullptr) {
+      undo_log->push_back(UndoEntry{
+          UndoEntry::Kind::kReplaced,
+          *reference_tokens,
+          0,
+          std::move(*value_ptr)
+      });
+
+      *value_ptr = std::move(value);
+    } else {
+      rapidjson::Value copy_key(
+          last_token.data(),
+          static_cast<rapidjson::SizeType>(last_token.size()),
+          this->json_document_.GetAllocator()
+      );
+
+      parent_ptr->AddMember(
+          copy_key,
+          std::move(value),
+          this->json_document_.GetAllocator()
+      );
+
+      undo_log->push_back(UndoEntry{
+          UndoEntry::Kind::kAddedMember,
+          *reference_tokens,
+          parent_ptr->MemberCount() - 1,
+          rapidjson::Value()
+      });
+    }
+
+    return true;
+  }
+
+  if (!parent_ptr->IsArray()) {
+    return false;
+  }
+
+  // The "-" token refers to the position past the last element. It is
+  // replaced by that index, so that the undo log and the changed key paths
+  // refer to the added element.
+  std::size_t index;
+  if (last_token == "-") {
+    index = parent_ptr->Size();
+    last_token = std::to_string(index);
+  } else if (!ParseJsonPointerArrayIndex(last_token, &index)
+      || index > parent_ptr->Size()) {
+    return false;
   }
 
-  return this->GetUnsignedLong(keys...);
+  // RapidJSON arrays can only grow at the end, so the new element is moved
+  // into place by swapping it with its predecessors.
+  parent_ptr->PushBack(std::move(value), this->json_document_.GetAllocator());
+  for (rapidjson::SizeType i = parent_ptr->Size() - 1; i > index; i -= 1) {
+    (*parent_ptr)[i].Swap((*parent_ptr)[i - 1]);
+  }
+
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kInsertedElement,
+      *reference_tokens,
+      index,
+      rapidjson::Value()
+  });
+
+  return true;
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasUnsignedLong(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+inline bool RapidJsonConfigReader::RemoveAtReferenceTokens(
+    const std::vector<std::string>& reference_tokens,
+    std::vector<UndoEntry>* undo_log
+) {
+  // The root of the document cannot be removed.
+  if (reference_tokens.empty()) {
+    return false;
+  }
+
+  rapidjson::Value* parent_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      reference_tokens,
+      reference_tokens.size() - 1
   );
 
-  if (!this->ContainsKey(keys...)) {
+  if (parent_ptr == nullptr) {
     return false;
   }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+  const std::string& last_token = reference_tokens.back();
+
+  if (parent_ptr->IsObject()) {
+    rapidjson::Value::MemberIterator it = parent_ptr->FindMember(
+        rapidjson::Value(rapidjson::StringRef(last_token.data(), last_token.size()))
+    );
+
+    if (it == parent_ptr->MemberEnd()) {
+      return false;
+    }
+
+    undo_log->push_back(UndoEntry{
+        UndoEntry::Kind::kRemovedMember,
+        reference_tokens,
+        static_cast<std::size_t>(it - parent_ptr->MemberBegin()),
+        std::move(it->value)
+    });
+
+    parent_ptr->EraseMember(it);
+
+    return true;
+  }
+
+  if (!parent_ptr->IsArray()) {
+    return false;
+  }
+
+  std::size_t index;
+  if (!ParseJsonPointerArrayIndex(last_token, &index)
+      || index >= parent_ptr->Size()) {
+    return false;
+  }
+
+  undo_log->push_back(UndoEntry{
+      UndoEntry::Kind::kRemovedElement,
+      reference_tokens,
+      index,
+      std::move((*parent_ptr)[static_cast<rapidjson::SizeType>(index)])
+  });
 
-  return value_ref.IsUint();
+  parent_ptr->Erase(parent_ptr->Begin() + index);
+
+  return true;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetUnsignedLong(
-    unsigned long value,
-    const Args&... keys
+inline void RapidJsonConfigReader::RollBack(
+    std::vector<UndoEntry>* undo_log
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  // Undo the mutations in reverse order, so that every entry's reference
+  // tokens resolve against the same state that they were recorded in.
+  for (std::vector<UndoEntry>::reverse_iterator it = undo_log->rbegin();
+      it != undo_log->rend();
+      it++) {
+    if (it->kind == UndoEntry::Kind::kReplaced) {
+      *ResolveReferenceTokens(
+          this->json_document_,
+          it->reference_tokens,
+          it->reference_tokens.size()
+      ) = std::move(it->old_value);
+
+      continue;
+    }
 
-  this->SetValue(
-      rapidjson::Value(static_cast<unsigned int>(value)),
-      keys...
-  );
+    rapidjson::Value& parent_ref = *ResolveReferenceTokens(
+        this->json_document_,
+        it->reference_tokens,
+        it->reference_tokens.size() - 1
+    );
+
+    switch (it->kind) {
+      case UndoEntry::Kind::kAddedMember: {
+        parent_ref.EraseMember(parent_ref.MemberBegin() + it->index);
+        break;
+      }
+
+      case UndoEntry::Kind::kRemovedMember: {
+        const std::string& name = it->reference_tokens.back();
+
+        parent_ref.AddMember(
+            rapidjson::Value(
+                name.data(),
+                static_cast<rapidjson::SizeType>(name.size()),
+                this->json_document_.GetAllocator()
+            ),
+            std::move(it->old_value),
+            this->json_document_.GetAllocator()
+        );
+
+        // Restore the member's original position to keep the key order.
+        for (rapidjson::Value::MemberIterator member_it = parent_ref.MemberEnd() - 1;
+            member_it != parent_ref.MemberBegin() + it->index;
+            member_it--) {
+          member_it->name.Swap((member_it - 1)->name);
+          member_it->value.Swap((member_it - 1)->value);
+        }
+
+        break;
+      }
+
+      case UndoEntry::Kind::kInsertedElement: {
+        parent_ref.Erase(parent_ref.Begin() + it->index);
+        break;
+      }
+
+      case UndoEntry::Kind::kRemovedElement: {
+        parent_ref.PushBack(std::move(it->old_value), this->json_document_.GetAllocator());
+        for (rapidjson::SizeType i = parent_ref.Size() - 1; i > it->index; i -= 1) {
+          parent_ref[i].Swap(parent_ref[i - 1]);
+        }
+
+        break;
+      }
+
+      default: {
+        break;
+      }
+    }
+  }
+
+  undo_log->clear();
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepUnsignedLong(
-    unsigned long value,
-    const Args&... keys
+inline bool RapidJsonConfigReader::ApplyJsonPatchOperation(
+    const rapidjson::Value& operation,
+    std::vector<std::string>* changed_key_paths,
+    std::vector<UndoEntry>* undo_log
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  const rapidjson::Value* op_ptr = FindValue(operation, std::string_view("op"));
+  const rapidjson::Value* path_ptr = FindValue(operation, std::string_view("path"));
+  const rapidjson::Value* value_ptr = FindValue(operation, std::string_view("value"));
 
-  this->SetDeepValue(
-      rapidjson::Value(static_cast<unsigned int>(value)),
-      keys...
-  );
-}
+  if (op_ptr == nullptr || !op_ptr->IsString()
+      || path_ptr == nullptr || !path_ptr->IsString()) {
+    return false;
+  }
 
-/* Functions for unsigned long long */
+  std::string_view op(op_ptr->GetString(), op_ptr->GetStringLength());
+  std::string_view path(path_ptr->GetString(), path_ptr->GetStringLength());
 
-template <>
-template <typename ...Args>
-unsigned long long RapidJsonConfigReader::GetUnsignedLongLong(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  std::vector<std::string> path_tokens;
+  if (!ParseJsonPointer(path, &path_tokens)) {
+    return false;
+  }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
+  if (op == "test") {
+    const rapidjson::Value* target_ptr = ResolveReferenceTokens(
+        this->json_document_,
+        path_tokens,
+        path_tokens.size()
+    );
+
+    return value_ptr != nullptr
+        && target_ptr != nullptr
+        && *target_ptr == *value_ptr;
+  }
+
+  if (op == "add" || op == "replace") {
+    if (value_ptr == nullptr) {
+      return false;
+    }
+
+    rapidjson::Value value_copy(*value_ptr, this->json_document_.GetAllocator());
+
+    bool is_applied = (op == "add")
+        ? this->AddAtReferenceTokens(&path_tokens, std::move(value_copy), undo_log)
+        : this->ReplaceAtReferenceTokens(path_tokens, std::move(value_copy), undo_log);
+
+    if (is_applied) {
+      changed_key_paths->push_back(MakeJsonPointerFromTokens(path_tokens));
+    }
+
+    return is_applied;
+  }
+
+  if (op == "remove") {
+    if (!this->RemoveAtReferenceTokens(path_tokens, undo_log)) {
+      return false;
+    }
+
+    changed_key_paths->emplace_back(path);
+
+    return true;
+  }
+
+  if (op != "move" && op != "copy") {
+    return false;
+  }
+
+  const rapidjson::Value* from_ptr = FindValue(operation, std::string_view("from"));
+  if (from_ptr == nullptr || !from_ptr->IsString()) {
+    return false;
+  }
+
+  std::string_view from(from_ptr->GetString(), from_ptr->GetStringLength());
+
+  std::vector<std::string> from_tokens;
+  if (!ParseJsonPointer(from, &from_tokens)) {
+    return false;
+  }
+
+  const rapidjson::Value* source_ptr = ResolveReferenceTokens(
+      this->json_document_,
+      from_tokens,
+      from_tokens.size()
   );
 
-  return value_ref.GetUint64();
+  if (source_ptr == nullptr) {
+    return false;
+  }
+
+  if (op == "move") {
+    if (from == path) {
+      return true;
+    }
+
+    // A value cannot be moved into one of its own children.
+    if (from_tokens.size() < path_tokens.size()
+        && std::equal(from_tokens.cbegin(), from_tokens.cend(), path_tokens.cbegin())) {
+      return false;
+    }
+  }
+
+  rapidjson::Value value_copy(*source_ptr, this->json_document_.GetAllocator());
+
+  if (op == "move") {
+    if (!this->RemoveAtReferenceTokens(from_tokens, undo_log)) {
+      return false;
+    }
+
+    changed_key_paths->emplace_back(from);
+  }
+
+  if (!this->AddAtReferenceTokens(&path_tokens, std::move(value_copy), undo_log)) {
+    return false;
+  }
+
+  changed_key_paths->push_back(MakeJsonPointerFromTokens(path_tokens));
+
+  return true;
 }
 
 template <>
-template <typename ...Args>
-unsigned long long RapidJsonConfigReader::GetUnsignedLongLongOrDefault(
-    unsigned long long default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline void RapidJsonConfigReader::MergePatchRecursive(
+    rapidjson::Value& target,
+    const rapidjson::Value& patch,
+    std::string* key_path,
+    std::vector<std::string>* changed_key_paths
+) {
+  // A patch that is not an object replaces the target outright.
+  if (!patch.IsObject()) {
+    if (target != patch) {
+      target.CopyFrom(patch, this->json_document_.GetAllocator());
+
+      if (changed_key_paths != nullptr) {
+        changed_key_paths->push_back(*key_path);
+      }
+    }
 
-  if (!this->HasUnsignedLongLong(keys...)) {
-    return default_value;
+    return;
   }
 
-  return this->GetUnsignedLongLong(keys...);
+  if (!target.IsObject()) {
+    target.SetObject();
+
+    if (changed_key_paths != nullptr) {
+      changed_key_paths->push_back(*key_path);
+    }
+  }
+
+  for (rapidjson::Value::ConstMemberIterator it = patch.MemberBegin();
+      it != patch.MemberEnd();
+      it++) {
+    std::string_view name(it->name.GetString(), it->name.GetStringLength());
+    std::size_t parent_key_path_size = key_path->size();
+    AppendJsonPointerToken(key_path, name);
+
+    rapidjson::Value::MemberIterator target_it = target.FindMember(it->name);
+
+    if (it->value.IsNull()) {
+      // Null removes the member.
+      if (target_it != target.MemberEnd()) {
+        target.EraseMember(target_it);
+
+        if (changed_key_paths != nullptr) {
+          changed_key_paths->push_back(*key_path);
+        }
+      }
+    } else {
+      if (target_it == target.MemberEnd()) {
+        target.AddMember(
+            rapidjson::Value(it->name, this->json_document_.GetAllocator()),
+            rapidjson::Value(),
+            this->json_document_.GetAllocator()
+        );
+
+        target_it = target.MemberEnd() - 1;
+      }
+
+      this->MergePatchRecursive(
+          target_it->value,
+          it->value,
+          key_path,
+          changed_key_paths
+      );
+    }
+
+    key_path->resize(parent_key_path_size);
+  }
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasUnsignedLongLong(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline std::uint64_t RapidJsonConfigReader::HashSubtrees(
+    const rapidjson::Value& value,
+    SubtreeHashMap* subtree_hashes
+) {
+  SubtreeHashMap::const_iterator hash_it = subtree_hashes->find(&value);
+  if (hash_it != subtree_hashes->cend()) {
+    return hash_it->second;
+  }
 
-  if (!this->ContainsKey(keys...)) {
-    return false;
+  std::uint64_t hash;
+
+  switch (value.GetType()) {
+    case rapidjson::kNullType: {
+      hash = static_cast<std::uint64_t>(JsonHashSeed::kNull);
+      break;
+    }
+
+    case rapidjson::kFalseType: {
+      hash = static_cast<std::uint64_t>(JsonHashSeed::kFalse);
+      break;
+    }
+
+    case rapidjson::kTrueType: {
+      hash = static_cast<std::uint64_t>(JsonHashSeed::kTrue);
+      break;
+    }
+
+    case rapidjson::kNumberType: {
+      if (value.IsDouble()) {
+        hash = HashJsonNumber(value.GetDouble());
+      } else if (value.IsInt64()) {
+        hash = HashJsonNumber(static_cast<std::int64_t>(value.GetInt64()));
+      } else {
+        hash = HashJsonNumber(static_cast<std::uint64_t>(value.GetUint64()));
+      }
+
+      break;
+    }
+
+    case rapidjson::kStringType: {
+      hash = CombineHash(
+          static_cast<std::uint64_t>(JsonHashSeed::kString),
+          JsonKey::Hash(value.GetString(), value.GetStringLength())
+      );
+
+      break;
+    }
+
+    case rapidjson::kArrayType: {
+      hash = static_cast<std::uint64_t>(JsonHashSeed::kArray);
+      for (rapidjson::Value::ConstValueIterator it = value.Begin(); it != value.End(); it++) {
+        hash = CombineHash(hash, HashSubtrees(*it, subtree_hashes));
+      }
+
+      break;
+    }
+
+    default: {
+      // Members are summed so that the hash does not depend on key order,
+      // matching the equality of objects.
+      std::uint64_t members_hash = 0;
+      for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin();
+          it != value.MemberEnd();
+          it++) {
+        members_hash += CombineHash(
+            JsonKey::Hash(it->name.GetString(), it->name.GetStringLength()),
+            HashSubtrees(it->value, subtree_hashes)
+        );
+      }
+
+      hash = CombineHash(static_cast<std::uint64_t>(JsonHashSeed::kObject), members_hash);
+
+      break;
+    }
   }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+  subtree_hashes->emplace(&value, hash);
 
-  return value_ref.IsUint64();
+  return hash;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetUnsignedLongLong(
-    unsigned long long value,
-    const Args&... keys
+inline JsonQueryValueView RapidJsonConfigReader::ToQueryValueView(
+    const rapidjson::Value& value
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  JsonQueryValueView view = { JsonQueryValueKind::kStructured, false, 0, {} };
+
+  if (value.IsNull()) {
+    view.kind = JsonQueryValueKind::kNull;
+  } else if (value.IsBool()) {
+    view.kind = JsonQueryValueKind::kBool;
+    view.bool_value = value.GetBool();
+  } else if (value.IsNumber()) {
+    view.kind = JsonQueryValueKind::kNumber;
+    view.number_value = value.GetDouble();
+  } else if (value.IsString()) {
+    view.kind = JsonQueryValueKind::kString;
+    view.string_value = std::string_view(
+        value.GetString(),
+        value.GetStringLength()
+    );
+  }
 
-  this->SetValue(
-      rapidjson::Value(value),
-      keys...
-  );
+  return view;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepUnsignedLongLong(
-    unsigned long long value,
-    const Args&... keys
+inline bool RapidJsonConfigReader::QueryRecursive(
+    const rapidjson::Value& value,
+    const JsonQuery& query,
+    std::size_t step_index,
+    std::size_t max_result_count,
+    std::vector<const rapidjson::Value*>* results
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  if (step_index == query.steps.size()) {
+    results->push_back(&value);
+    return results->size() < max_result_count;
+  }
 
-  this->SetDeepValue(
-      rapidjson::Value(value),
-      keys...
-  );
-}
+  const JsonQueryStep& step = query.steps[step_index];
+  std::size_t next_step_index = step_index + 1;
+
+  auto query_child = [&query, next_step_index, max_result_count, results](
+      const rapidjson::Value& child
+  ) {
+    return QueryRecursive(
+        child,
+        query,
+        next_step_index,
+        max_result_count,
+        results
+    );
+  };
+
+  switch (step.kind) {
+    case JsonQueryStepKind::kMember: {
+      if (value.IsObject()) {
+        const rapidjson::Value* member_value_ptr = FindValue(
+            value,
+            std::string_view(step.name)
+        );
+
+        return member_value_ptr == nullptr || query_child(*member_value_ptr);
+      }
+
+      if (value.IsArray()
+          && step.array_index.has_value()
+          && *step.array_index < value.Size()) {
+        return query_child(value[static_cast<rapidjson::SizeType>(*step.array_index)]);
+      }
+
+      return true;
+    }
 
-/* Functions for std::unordered_set */
+    case JsonQueryStepKind::kIndex: {
+      std::size_t index;
+      if (value.IsArray()
+          && NormalizeJsonQueryIndex(step.index, value.Size(), &index)) {
+        return query_child(value[static_cast<rapidjson::SizeType>(index)]);
+      }
 
-template <>
-template <typename T, typename ...Args>
-std::unordered_set<T> RapidJsonConfigReader::GetUnorderedSet(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+      return true;
+    }
 
-  return this->GetArrayCopy<std::unordered_set<T>>(
-      keys...
-  );
+    case JsonQueryStepKind::kSlice: {
+      if (!value.IsArray()) {
+        return true;
+      }
+
+      return ForEachJsonQuerySliceIndex(
+          step,
+          value.Size(),
+          [&value, &query_child](std::size_t index) {
+            return query_child(value[static_cast<rapidjson::SizeType>(index)]);
+          }
+      );
+    }
+
+    case JsonQueryStepKind::kWildcard:
+    case JsonQueryStepKind::kFilter: {
+      bool is_filter = step.kind == JsonQueryStepKind::kFilter;
+
+      if (value.IsObject()) {
+        for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin();
+            it != value.MemberEnd();
+            it++) {
+          if ((!is_filter || MatchesQueryFilter(it->value, step))
+              && !query_child(it->value)) {
+            return false;
+          }
+        }
+      } else if (value.IsArray()) {
+        for (rapidjson::Value::ConstValueIterator it = value.Begin();
+            it != value.End();
+            it++) {
+          if ((!is_filter || MatchesQueryFilter(*it, step))
+              && !query_child(*it)) {
+            return false;
+          }
+        }
+      }
+
+      return true;
+    }
+
+    default: {
+      return true;
+    }
+  }
 }
 
 template <>
-template <typename T, typename ...Args>
-std::unordered_set<T> RapidJsonConfigReader::GetUnorderedSetOrDefault(
-    const std::unordered_set<T>& default_value,
-    const Args&... keys
+inline void RapidJsonConfigReader::DiffRecursive(
+    const rapidjson::Value& old_value,
+    SubtreeHashMap* old_subtree_hashes,
+    const rapidjson::Value& new_value,
+    SubtreeHashMap* new_subtree_hashes,
+    std::string* key_path,
+    bool is_subscribed_only,
+    std::vector<std::string>* changed_key_paths
 ) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  // Skip subtrees whose hashes are equal, and when diffing for subscribers,
+  // the parts of the documents that are not subscribed to.
+  if (is_subscribed_only && !this->IsSubscribedKeyPath(*key_path)) {
+    return;
+  }
 
-  if (!this->HasUnorderedSet(keys...)) {
-    return default_value;
+  if (HashSubtrees(old_value, old_subtree_hashes)
+      == HashSubtrees(new_value, new_subtree_hashes)) {
+    return;
   }
 
-  return this->GetUnorderedSet<T>(keys...);
+  if (old_value.IsObject() && new_value.IsObject()) {
+    // Members usually keep their positions between versions, so check the
+    // same position before searching for a member by name.
+    rapidjson::SizeType member_index = 0;
+    for (rapidjson::Value::ConstMemberIterator it = old_value.MemberBegin();
+        it != old_value.MemberEnd();
+        it++, member_index += 1) {
+      std::string_view name(it->name.GetString(), it->name.GetStringLength());
+
+      const rapidjson::Value* new_member_value_ptr;
+      if (member_index < new_value.MemberCount()
+          && (new_value.MemberBegin() + member_index)->name == it->name) {
+        new_member_value_ptr = &(new_value.MemberBegin() + member_index)->value;
+      } else {
+        new_member_value_ptr = FindValue(new_value, name);
+      }
+
+      std::size_t parent_key_path_size = key_path->size();
+      AppendJsonPointerToken(key_path, name);
+
+      if (new_member_value_ptr == nullptr) {
+        if (!is_subscribed_only || this->IsSubscribedKeyPath(*key_path)) {
+          changed_key_paths->push_back(*key_path);
+        }
+      } else {
+        this->DiffRecursive(
+            it->value,
+            old_subtree_hashes,
+            *new_member_value_ptr,
+            new_subtree_hashes,
+            key_path,
+            is_subscribed_only,
+            changed_key_paths
+        );
+      }
+
+      key_path->resize(parent_key_path_size);
+    }
+
+    member_index = 0;
+    for (rapidjson::Value::ConstMemberIterator it = new_value.MemberBegin();
+        it != new_value.MemberEnd();
+        it++, member_index += 1) {
+      std::string_view name(it->name.GetString(), it->name.GetStringLength());
+
+      bool is_in_old_value = (member_index < old_value.MemberCount()
+          && (old_value.MemberBegin() + member_index)->name == it->name)
+          || FindValue(old_value, name) != nullptr;
+
+      if (is_in_old_value) {
+        continue;
+      }
+
+      std::size_t parent_key_path_size = key_path->size();
+      AppendJsonPointerToken(key_path, name);
+
+      if (!is_subscribed_only || this->IsSubscribedKeyPath(*key_path)) {
+        changed_key_paths->push_back(*key_path);
+      }
+
+      key_path->resize(parent_key_path_size);
+    }
+
+    return;
+  }
+
+  if (old_value.IsArray() && new_value.IsArray()
+      && old_value.Size() == new_value.Size()) {
+    for (rapidjson::SizeType i = 0; i < old_value.Size(); i += 1) {
+      std::size_t parent_key_path_size = key_path->size();
+      AppendJsonPointerToken(key_path, std::to_string(i));
+
+      this->DiffRecursive(
+          old_value[i],
+          old_subtree_hashes,
+          new_value[i],
+          new_subtree_hashes,
+          key_path,
+          is_subscribed_only,
+          changed_key_paths
+      );
+
+      key_path->resize(parent_key_path_size);
+    }
+
+    return;
+  }
+
+  changed_key_paths->push_back(*key_path);
 }
 
 template <>
-template <typename T, typename ...Args>
-std::unordered_set<T> RapidJsonConfigReader::GetUnorderedSetOrDefault(
-    std::unordered_set<T>&& default_value,
-    const Args&... keys
+inline void RapidJsonConfigReader::HashDocumentSubtrees(
+    std::size_t thread_count,
+    SubtreeHashMap* subtree_hashes
 ) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  const rapidjson::Value& root = this->json_document_;
+
+  if (thread_count > 1 && root.IsObject() && root.MemberCount() > 1) {
+    // Hash contiguous ranges of the top-level members into separate maps,
+    // then merge them.
+    std::size_t member_count = root.MemberCount();
+    std::size_t task_count = std::min(thread_count, member_count);
+
+    std::vector<std::future<SubtreeHashMap>> futures;
+    for (std::size_t task = 0; task < task_count; task += 1) {
+      std::size_t first_member = (member_count * task) / task_count;
+      std::size_t last_member = (member_count * (task + 1)) / task_count;
+
+      futures.push_back(std::async(
+          std::launch::async,
+          [&root, first_member, last_member]() {
+            SubtreeHashMap task_subtree_hashes;
+
+            for (std::size_t i = first_member; i < last_member; i += 1) {
+              HashSubtrees((root.MemberBegin() + i)->value, &task_subtree_hashes);
+            }
+
+            return task_subtree_hashes;
+          }
+      ));
+    }
 
-  if (!this->HasUnorderedSet(keys...)) {
-    return std::move(default_value);
+    for (std::future<SubtreeHashMap>& future : futures) {
+      SubtreeHashMap task_subtree_hashes = future.get();
+      subtree_hashes->merge(task_subtree_hashes);
+    }
   }
 
-  return this->GetUnorderedSet<T>(keys...);
+  HashSubtrees(root, subtree_hashes);
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasUnorderedSet(
-    const Args&... keys
+inline bool RapidJsonConfigReader::ParseConfigStream(
+    std::istream& config_stream,
+    rapidjson::Document* document
 ) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  rapidjson::IStreamWrapper config_stream_wrapper(config_stream);
 
-  if (!this->ContainsKey(keys...)) {
-    return false;
+  if (this->full_precision_parse()) {
+    document->ParseStream<rapidjson::kParseFullPrecisionFlag>(config_stream_wrapper);
+  } else {
+    document->ParseStream(config_stream_wrapper);
   }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
-
-  return value_ref.IsArray();
+  // Check that the config is JSON compliant.
+  return !document->HasParseError();
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetUnorderedSet(
-    const std::unordered_set<T>& value,
-    const Args&... keys
+inline bool RapidJsonConfigReader::DecodeConfigStream(
+    std::istream& config_stream,
+    JsonFileFormat file_format,
+    rapidjson::Document* document
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
+  std::string config_bytes(
+      (std::istreambuf_iterator<char>(config_stream)),
+      std::istreambuf_iterator<char>()
   );
 
-  this->SetArray(
-      value.cbegin(),
-      value.cend(),
-      keys...
-  );
+  // The document builds itself from the decoded events. If decoding fails,
+  // then the document is left unchanged.
+  JsonBinaryReader<rapidjson::Document> binary_reader(config_bytes, file_format);
+  bool is_decoded = false;
+
+  auto generator = [&binary_reader, &is_decoded](rapidjson::Document& handler) {
+    is_decoded = binary_reader.Read(&handler);
+    return is_decoded;
+  };
+  document->Populate(generator);
+
+  return is_decoded;
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetUnorderedSet(
-    std::unordered_set<T>&& value,
-    const Args&... keys
+inline void RapidJsonConfigReader::MergeLayerRecursive(
+    rapidjson::Value& target,
+    rapidjson::Value& layer,
+    rapidjson::Document* document
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  // Objects are merged member by member. Any other value replaces the target
+  // as a whole, including null.
+  if (!target.IsObject() || !layer.IsObject()) {
+    target = layer;
+    return;
+  }
 
-  this->SetArray(
-      std::make_move_iterator(value.begin()),
-      std::make_move_iterator(value.end()),
-      keys...
-  );
+  for (rapidjson::Value::MemberIterator it = layer.MemberBegin();
+      it != layer.MemberEnd();
+      it++) {
+    rapidjson::Value* target_member_value_ptr = FindValue(
+        target,
+        std::string_view(it->name.GetString(), it->name.GetStringLength())
+    );
+
+    if (target_member_value_ptr == nullptr) {
+      // Moves the name and value, which keep pointing into the layer's
+      // allocator.
+      target.AddMember(it->name, it->value, document->GetAllocator());
+    } else {
+      MergeLayerRecursive(*target_member_value_ptr, it->value, document);
+    }
+  }
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetDeepUnorderedSet(
-    const std::unordered_set<T>& value,
-    const Args&... keys
-) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline bool RapidJsonConfigReader::ParseConfigText(
+    std::string_view text,
+    rapidjson::Document* document
+) const {
+  // A document creates its parse stack when it is first parsed.
+  JsonMemoryResourceScope memory_resource_scope(this->memory_resource());
 
-  this->SetDeepArray(
-      value.cbegin(),
-      value.cend(),
-      keys...
-  );
+  if (this->full_precision_parse()) {
+    document->Parse<rapidjson::kParseFullPrecisionFlag>(text.data(), text.size());
+  } else {
+    document->Parse(text.data(), text.size());
+  }
+
+  // Check that the config is JSON compliant.
+  return !document->HasParseError();
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetDeepUnorderedSet(
-    std::unordered_set<T>&& value,
-    const Args&... keys
+inline void RapidJsonConfigReader::AppendParsedChunk(
+    rapidjson::Document* document,
+    rapidjson::Document* chunk_document
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  // Moves the chunk's members or elements, which keep pointing into the
+  // chunk's allocator.
+  if (document->IsObject()) {
+    for (rapidjson::Value::MemberIterator it = chunk_document->MemberBegin();
+        it != chunk_document->MemberEnd();
+        it++) {
+      document->AddMember(it->name, it->value, document->GetAllocator());
+    }
+  } else {
+    document->Reserve(
+        document->Size() + chunk_document->Size(),
+        document->GetAllocator()
+    );
 
-  this->SetDeepArray(
-      std::make_move_iterator(value.begin()),
-      std::make_move_iterator(value.end()),
-      keys...
-  );
+    for (rapidjson::Value::ValueIterator it = chunk_document->Begin();
+        it != chunk_document->End();
+        it++) {
+      document->PushBack(*it, document->GetAllocator());
+    }
+  }
 }
 
-/* Functions of std::vector */
+template <>
+inline void RapidJsonConfigReader::ClearDocument(
+    rapidjson::Document* document
+) {
+  // Values don't own memory, so the allocator's chunks are released at
+  // once. The allocator keeps its first chunk for the next parse.
+  document->SetNull();
+  document->GetAllocator().Clear();
+}
 
 template <>
-template <typename T, typename ...Args>
-std::vector<T> RapidJsonConfigReader::GetVector(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline std::uint32_t RapidJsonConfigReader::FreezeValue(
+    const rapidjson::Value& value,
+    JsonFrozenIndex<rapidjson::Value>* frozen_index
+) {
+  switch (value.GetType()) {
+    case rapidjson::kNullType: {
+      return frozen_index->AddNull(&value);
+    }
 
-  return this->GetArrayCopy<std::vector<T>>(
-      keys...
-  );
+    case rapidjson::kFalseType: {
+      return frozen_index->AddBool(&value, false);
+    }
+
+    case rapidjson::kTrueType: {
+      return frozen_index->AddBool(&value, true);
+    }
+
+    case rapidjson::kNumberType: {
+      if (value.IsDouble()) {
+        return frozen_index->AddDouble(&value, value.GetDouble());
+      } else if (value.IsInt64()) {
+        return frozen_index->AddInt64(&value, value.GetInt64());
+      } else {
+        return frozen_index->AddUint64(&value, value.GetUint64());
+      }
+    }
+
+    case rapidjson::kStringType: {
+      return frozen_index->AddString(&value);
+    }
+
+    case rapidjson::kArrayType: {
+      std::uint32_t array_node = frozen_index->AddArray(&value, value.Size());
+      for (rapidjson::SizeType i = 0; i < value.Size(); i += 1) {
+        frozen_index->SetArrayElement(array_node, i, FreezeValue(value[i], frozen_index));
+      }
+
+      return array_node;
+    }
+
+    default: {
+      std::uint32_t object_node = frozen_index->AddObject(&value);
+
+      std::vector<JsonFrozenMember> members;
+      members.reserve(value.MemberCount());
+      for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin();
+          it != value.MemberEnd();
+          it++) {
+        members.push_back(JsonFrozenMember{
+            std::string_view(it->name.GetString(), it->name.GetStringLength()),
+            FreezeValue(it->value, frozen_index)
+        });
+      }
+
+      frozen_index->IndexObjectMembers(object_node, &members);
+
+      return object_node;
+    }
+  }
 }
 
 template <>
-template <typename T, typename ...Args>
-std::vector<T> RapidJsonConfigReader::GetVectorOrDefault(
-    const std::vector<T>& default_value,
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+inline JsonSubtreeMemoryStats RapidJsonConfigReader::MeasureSubtree(
+    const rapidjson::Value& value,
+    std::size_t depth,
+    std::size_t max_depth,
+    std::string* key_path,
+    std::map<std::string, JsonSubtreeMemoryStats>* subtree_stats
+) {
+  JsonSubtreeMemoryStats stats;
+  stats.node_count = 1;
+
+  // Key paths are only built for the subtrees that are recorded.
+  std::map<std::string, JsonSubtreeMemoryStats>* child_subtree_stats =
+      (depth < max_depth) ? subtree_stats : nullptr;
+
+  switch (value.GetType()) {
+    case rapidjson::kStringType: {
+      stats.string_size = value.GetStringLength();
+      break;
+    }
+
+    case rapidjson::kArrayType: {
+      stats.member_array_size = value.Capacity() * sizeof(rapidjson::Value);
+
+      for (rapidjson::SizeType i = 0; i < value.Size(); i += 1) {
+        std::size_t parent_key_path_size = 0;
+        if (child_subtree_stats != nullptr) {
+          parent_key_path_size = key_path->size();
+          AppendJsonPointerToken(key_path, JsonKey(i));
+        }
+
+        stats += MeasureSubtree(
+            value[i],
+            depth + 1,
+            max_depth,
+            key_path,
+            child_subtree_stats
+        );
+
+        if (child_subtree_stats != nullptr) {
+          key_path->resize(parent_key_path_size);
+        }
+      }
+
+      break;
+    }
+
+    case rapidjson::kObjectType: {
+      stats.member_array_size = value.MemberCapacity()
+          * sizeof(rapidjson::Value::Member);
+
+      for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin();
+          it != value.MemberEnd();
+          it++) {
+        stats.string_size += it->name.GetStringLength();
+
+        std::size_t parent_key_path_size = 0;
+        if (child_subtree_stats != nullptr) {
+          parent_key_path_size = key_path->size();
+          AppendJsonPointerToken(
+              key_path,
+              std::string_view(it->name.GetString(), it->name.GetStringLength())
+          );
+        }
+
+        stats += MeasureSubtree(
+            it->value,
+            depth + 1,
+            max_depth,
+            key_path,
+            child_subtree_stats
+        );
+
+        if (child_subtree_stats != nullptr) {
+          key_path->resize(parent_key_path_size);
+        }
+      }
+
+      break;
+    }
+
+    default: {
+      break;
+    }
+  }
 
-  if (!this->ContainsKey(keys...)) {
-    return default_value;
+  if (subtree_stats != nullptr) {
+    subtree_stats->emplace(*key_path, stats);
   }
 
-  return this->GetVector<T>(keys...);
+  return stats;
 }
 
 template <>
-template <typename T, typename ...Args>
-std::vector<T> RapidJsonConfigReader::GetVectorOrDefault(
-    std::vector<T>&& default_value,
-    const Args&... keys
+inline void RapidJsonConfigReader::MeasureAllocators(
+    JsonMemoryStats* memory_stats
 ) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  auto measure_allocator = [memory_stats](const rapidjson::Document& document) {
+    // GetAllocator() has no const overload, but the allocator is only read.
+    const rapidjson::Document::AllocatorType& allocator =
+        const_cast<rapidjson::Document&>(document).GetAllocator();
 
-  if (!this->ContainsKey(keys...)) {
-    return std::move(default_value);
+    memory_stats->capacity += allocator.Capacity();
+    memory_stats->used_size += allocator.Size();
+  };
+
+  measure_allocator(this->json_document_);
+  measure_allocator(this->override_document_);
+
+  for (const rapidjson::Document& document : this->retained_documents_) {
+    measure_allocator(document);
   }
 
-  return this->GetVector<T>(keys...);
+  for (const rapidjson::Document& document : this->spare_documents_) {
+    measure_allocator(document);
+  }
 }
 
 template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::HasVector(
-    const Args&... keys
-) const {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
-
-  if (!this->ContainsKey(keys...)) {
-    return false;
+inline void RapidJsonConfigReader::CommitParsedDocuments(
+    std::deque<rapidjson::Document>* parsed_documents
+) {
+  rapidjson::Document& parsed_document = parsed_documents->front();
+
+  std::vector<std::string> changed_key_paths;
+  if (!this->subscriptions_.empty()) {
+    SubtreeHashMap old_subtree_hashes;
+    SubtreeHashMap new_subtree_hashes;
+    std::string key_path;
+
+    this->DiffRecursive(
+        this->json_document_,
+        &old_subtree_hashes,
+        parsed_document,
+        &new_subtree_hashes,
+        &key_path,
+        true,
+        &changed_key_paths
+    );
   }
 
-  const rapidjson::Value& value_ref = this->GetValueRef(
-      keys...
-  );
+  this->json_document_.Swap(parsed_document);
+  this->generation_ += 1;
 
-  return value_ref.IsArray();
-}
+  // The previous document is released for reuse with the documents that it
+  // referred to, and the remaining parsed documents are kept in their place.
+  ClearDocument(&parsed_documents->front());
+  this->spare_documents_.push_back(std::move(parsed_documents->front()));
+  parsed_documents->pop_front();
+  this->retained_documents_.swap(*parsed_documents);
+  this->ReleaseDocuments(parsed_documents);
 
-template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetVector(
-    const std::vector<T>& value,
-    const Args&... keys
-) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  this->ReplayJournal(&changed_key_paths);
 
-  this->SetArray(
-      value.cbegin(),
-      value.cend(),
-      keys...
-  );
+  // The index referred to the previous document.
+  if (this->is_frozen()) {
+    this->Freeze();
+  }
+
+  this->NotifySubscribers(changed_key_paths);
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetVector(
-    std::vector<T>&& value,
-    const Args&... keys
+inline void RapidJsonConfigReader::SerializeDocument(
+    int indent_width,
+    std::size_t thread_count
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  const rapidjson::Value& root = this->json_document_;
 
-  this->SetArray(
-      std::make_move_iterator(value.begin()),
-      std::make_move_iterator(value.end()),
-      keys...
-  );
+  std::size_t item_count = 0;
+  if (root.IsObject()) {
+    item_count = root.MemberCount();
+  } else if (root.IsArray()) {
+    item_count = root.Size();
+  }
+
+  if (thread_count <= 1 || item_count <= 1) {
+    this->write_buffers_.resize(1);
+    this->write_buffers_.front().clear();
+
+    detail::StringOutputStream output_stream(&this->write_buffers_.front());
+    rapidjson::PrettyWriter pretty_config_writer(output_stream);
+    pretty_config_writer.SetIndent(' ', indent_width);
+
+    root.Accept(pretty_config_writer);
+
+    return;
+  }
+
+  // Each task writes its range of the root as a container of its own, then
+  // turns the brackets into the separators between the ranges, so that
+  // concatenating the buffers gives the same text as a serial write.
+  std::size_t task_count = std::min(thread_count, item_count);
+  this->write_buffers_.resize(task_count);
+
+  std::vector<std::future<void>> futures;
+  for (std::size_t task = 0; task < task_count; task += 1) {
+    std::size_t first_item = (item_count * task) / task_count;
+    std::size_t last_item = (item_count * (task + 1)) / task_count;
+
+    futures.push_back(std::async(
+        std::launch::async,
+        [&root, indent_width, task, task_count, first_item, last_item,
+            &write_buffer = this->write_buffers_[task]]() {
+          write_buffer.clear();
+
+          detail::StringOutputStream output_stream(&write_buffer);
+          rapidjson::PrettyWriter pretty_config_writer(output_stream);
+          pretty_config_writer.SetIndent(' ', indent_width);
+
+          if (root.IsObject()) {
+            pretty_config_writer.StartObject();
+            for (std::size_t i = first_item; i < last_item; i += 1) {
+              const rapidjson::Value::Member& member = *(root.MemberBegin() + i);
+
+              pretty_config_writer.Key(
+                  member.name.GetString(),
+                  member.name.GetStringLength()
+              );
+              member.value.Accept(pretty_config_writer);
+            }
+            pretty_config_writer.EndObject();
+          } else {
+            pretty_config_writer.StartArray();
+            for (std::size_t i = first_item; i < last_item; i += 1) {
+              root[static_cast<rapidjson::SizeType>(i)].Accept(pretty_config_writer);
+            }
+            pretty_config_writer.EndArray();
+          }
+
+          // Replace the opening bracket with the separator after the previous
+          // range, and drop the newline and closing bracket before the next
+          // range.
+          if (task != 0) {
+            write_buffer.front() = ',';
+          }
+
+          if (task != task_count - 1) {
+            write_buffer.resize(write_buffer.size() - 2);
+          }
+        }
+    ));
+  }
+
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetDeepVector(
-    const std::vector<T>& value,
-    const Args&... keys
+inline void RapidJsonConfigReader::AppendSerializedValue(
+    std::string* text,
+    const rapidjson::Value& value,
+    int indent_width
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  detail::StringOutputStream output_stream(text);
+  rapidjson::PrettyWriter pretty_config_writer(output_stream);
+  pretty_config_writer.SetIndent(' ', indent_width);
 
-  this->SetDeepArray(
-      value.cbegin(),
-      value.cend(),
-      keys...
-  );
+  value.Accept(pretty_config_writer);
 }
 
 template <>
-template <typename T, typename ...Args>
-void RapidJsonConfigReader::SetDeepVector(
-    std::vector<T>&& value,
-    const Args&... keys
+inline void RapidJsonConfigReader::EncodeValue(
+    JsonBinaryWriter* writer,
+    const rapidjson::Value& value
 ) {
-  static_assert(
-      sizeof...(keys) >= 1,
-      "Number of keys must be greater than 1."
-  );
+  switch (value.GetType()) {
+    case rapidjson::kNullType: {
+      writer->Null();
+      break;
+    }
 
-  this->SetDeepArray(
-      std::make_move_iterator(value.begin()),
-      std::make_move_iterator(value.end()),
-      keys...
-  );
-}
+    case rapidjson::kFalseType: {
+      writer->Bool(false);
+      break;
+    }
 
-/* Private Helper Functions */
+    case rapidjson::kTrueType: {
+      writer->Bool(true);
+      break;
+    }
 
-template <>
-template <typename ...Args>
-bool RapidJsonConfigReader::ContainsKeyRecursive(
-    const rapidjson::Value& object,
-    std::string_view current_key,
-    const Args&... keys
-) const {
-  // Check for the existence of the key-value.
-  if (!object.HasMember(current_key.data())) {
-    return false;
-  }
+    case rapidjson::kNumberType: {
+      if (value.IsDouble()) {
+        writer->Double(value.GetDouble());
+      } else if (value.IsInt64()) {
+        writer->Int64(value.GetInt64());
+      } else {
+        writer->Uint64(value.GetUint64());
+      }
 
-  // If this is the destination key, then return the value. Otherwise, recurse
-  // one level down.
-  if constexpr (sizeof...(keys) <= 0) {
-    return true;
-  } else {
-    const rapidjson::Value& value_ref = object[current_key.data()];
+      break;
+    }
 
-    return this->ContainsKeyRecursive(
-        value_ref,
-        keys...
-    );
+    case rapidjson::kStringType: {
+      writer->String(std::string_view(value.GetString(), value.GetStringLength()));
+      break;
+    }
+
+    case rapidjson::kArrayType: {
+      writer->StartArray(value.Size());
+      for (rapidjson::Value::ConstValueIterator it = value.Begin(); it != value.End(); it++) {
+        EncodeValue(writer, *it);
+      }
+
+      break;
+    }
+
+    default: {
+      writer->StartObject(value.MemberCount());
+      for (rapidjson::Value::ConstMemberIterator it = value.MemberBegin();
+          it != value.MemberEnd();
+          it++) {
+        writer->Key(std::string_view(it->name.GetString(), it->name.GetStringLength()));
+        EncodeValue(writer, it->value);
+      }
+
+      break;
+    }
   }
 }
 
 template <>
-template <typename ...Args>
-rapidjson::Value& RapidJsonConfigReader::GetValueRefRecursive(
-    rapidjson::Value& object,
-    std::string_view current_key,
-    const Args&... keys
+template <typename T>
+bool RapidJsonConfigReader::ToNumber(
+    const rapidjson::Value& value,
+    T* number
 ) {
-  // If this is the destination key, then return the value. Otherwise, recurse
-  // one level down.
-  rapidjson::Value& value_ref = object[current_key.data()];
+  // Read the number with the widest accessor that holds it exactly, then
+  // check that it fits in T.
+  if constexpr (std::is_floating_point<T>::value) {
+    if (!value.IsNumber()) {
+      return false;
+    }
+
+    double double_value = value.GetDouble();
+    if constexpr (std::is_same<T, float>::value) {
+      if (!IsInFloatRange(double_value)) {
+        return false;
+      }
+    }
 
-  if constexpr (sizeof...(keys)) {
-    return value_ref;
+    *number = static_cast<T>(double_value);
+
+    return true;
   } else {
-    return this->GetValueRef(
-        value_ref,
-        keys...
-    );
+    if (value.IsInt64()) {
+      std::int64_t int64_value = value.GetInt64();
+      if (!IsInRangeOf<T>(int64_value)) {
+        return false;
+      }
+
+      *number = static_cast<T>(int64_value);
+
+      return true;
+    }
+
+    if (value.IsUint64()) {
+      std::uint64_t uint64_value = value.GetUint64();
+      if (!IsInRangeOf<T>(uint64_value)) {
+        return false;
+      }
+
+      *number = static_cast<T>(uint64_value);
+
+      return true;
+    }
+
+    return false;
   }
 }
 
+/* Functions for Patches */
+
 template <>
-template <typename ...Args>
-const rapidjson::Value& RapidJsonConfigReader::GetValueRefRecursive(
-    const rapidjson::Value& object,
-    std::string_view current_key,
-    const Args&... keys
-) const {
-  // If this is the destination key, then return the value. Otherwise, recurse
-  // one level down.
-  const rapidjson::Value& value_ref = object[current_key.data()];
+inline bool RapidJsonConfigReader::ApplyMergePatch(
+    const rapidjson::Value& patch,
+    std::vector<std::string>* changed_key_paths
+) {
+  this->ThrowIfFrozen();
 
-  if constexpr (sizeof...(keys) <= 0) {
-    return value_ref;
-  } else {
-    return this->GetValueRefRecursive(
-        value_ref,
-        keys...
+  // A merge patch cannot fail, so there is nothing to roll back.
+  std::string key_path;
+  std::vector<std::string> applied_key_paths;
+
+  this->generation_ += 1;
+
+  this->MergePatchRecursive(
+      this->json_document_,
+      patch,
+      &key_path,
+      &applied_key_paths
+  );
+
+  this->RecordChanges(applied_key_paths);
+  this->NotifySubscribers(applied_key_paths);
+
+  if (changed_key_paths != nullptr) {
+    changed_key_paths->insert(
+        changed_key_paths->end(),
+        std::make_move_iterator(applied_key_paths.begin()),
+        std::make_move_iterator(applied_key_paths.end())
     );
   }
+
+  return true;
 }
 
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetValueRecursive(
-    rapidjson::Value value,
-    rapidjson::Value& object,
-    std::string_view current_key,
-    const Args&... keys
+inline bool RapidJsonConfigReader::ApplyJsonPatch(
+    const rapidjson::Value& patch,
+    std::vector<std::string>* changed_key_paths
 ) {
-  // If this is the destination key, then set the value. Otherwise, recurse
-  // one level down.
-  rapidjson::Value& value_ref = object[current_key.data()];
+  this->ThrowIfFrozen();
 
-  if constexpr (sizeof...(keys) <= 0) {
-    // Check for the existence of the key-value and add the value if this is the
-    // destination key.
-    if (object.HasMember(current_key.data())) {
-      rapidjson::Value& value_ref = object[current_key.data()];
-      value_ref = std::move(value);
-    } else {
-      rapidjson::Value copy_key(
-          current_key.data(),
-          this->json_document_.GetAllocator()
-      );
+  if (!patch.IsArray()) {
+    return false;
+  }
 
-      object.AddMember(
-          copy_key,
-          std::move(value),
-          this->json_document_.GetAllocator()
-      );
+  // Rolled back operations still move values, so the generation changes
+  // either way.
+  this->generation_ += 1;
+
+  std::vector<UndoEntry> undo_log;
+  std::vector<std::string> applied_key_paths;
+
+  for (rapidjson::Value::ConstValueIterator it = patch.Begin(); it != patch.End(); it++) {
+    if (!this->ApplyJsonPatchOperation(*it, &applied_key_paths, &undo_log)) {
+      this->RollBack(&undo_log);
+      return false;
     }
-  } else {
-    this->SetValueRecursive(
-        std::move(value),
-        value_ref,
-        keys...
+  }
+
+  this->RecordChanges(applied_key_paths);
+  this->NotifySubscribers(applied_key_paths);
+
+  if (changed_key_paths != nullptr) {
+    changed_key_paths->insert(
+        changed_key_paths->end(),
+        std::make_move_iterator(applied_key_paths.begin()),
+        std::make_move_iterator(applied_key_paths.end())
     );
   }
+
+  return true;
 }
 
+/* Functions for Diffs */
+
 template <>
-template <typename ...Args>
-void RapidJsonConfigReader::SetDeepValueRecursive(
-    rapidjson::Value value,
-    rapidjson::Value& object,
-    std::string_view current_key,
-    const Args&... keys
-) {
-  // If this is the destination key, then set the value. Otherwise, recurse
-  // one level down.
+inline std::uint64_t RapidJsonConfigReader::Hash() const {
+  const rapidjson::Value& root = this->json_document_;
 
-  if constexpr (sizeof...(keys) <= 0) {
-    // Check for the existence of the key-value and add the value if this is the
-    // destination key.
-    if (object.HasMember(current_key.data())) {
-      rapidjson::Value& value_ref = object[current_key.data()];
-      value_ref = std::move(value);
-    } else {
-      rapidjson::Value copy_key(
-          current_key.data(),
-          this->json_document_.GetAllocator()
-      );
+  return this->GetSubtreeHashes(1)->at(&root);
+}
 
-      object.AddMember(
-          copy_key,
-          std::move(value),
-          this->json_document_.GetAllocator()
-      );
-    }
-  } else {
-    // Check for the existence of the key-value and add an object if the
-    // object does not exist.
-    if (!object.HasMember(current_key.data())) {
-      rapidjson::Value copy_key(
-          current_key.data(),
-          this->json_document_.GetAllocator()
-      );
+template <>
+inline std::vector<std::string> RapidJsonConfigReader::Diff(
+    const RapidJsonConfigReader& other,
+    std::size_t thread_count
+) const {
+  const rapidjson::Value& old_root = this->json_document_;
+  const rapidjson::Value& new_root = other.json_document_;
+
+  // With both hash caches complete, the walk below only reads them, so the
+  // top-level members can be compared concurrently.
+  std::shared_ptr<SubtreeHashMap> old_subtree_hashes =
+      this->GetSubtreeHashes(thread_count);
+  std::shared_ptr<SubtreeHashMap> new_subtree_hashes =
+      other.GetSubtreeHashes(thread_count);
+
+  std::vector<std::string> changed_key_paths;
+  std::string key_path;
+
+  if (thread_count <= 1
+      || !old_root.IsObject()
+      || !new_root.IsObject()
+      || old_subtree_hashes->at(&old_root) == new_subtree_hashes->at(&new_root)) {
+    this->DiffRecursive(
+        old_root,
+        old_subtree_hashes.get(),
+        new_root,
+        new_subtree_hashes.get(),
+        &key_path,
+        false,
+        &changed_key_paths
+    );
 
-      object.AddMember(
-          copy_key,
-          rapidjson::Value(rapidjson::kObjectType),
-          this->json_document_.GetAllocator()
-      );
-    }
+    return changed_key_paths;
+  }
+
+  // Split the old members into contiguous ranges, one per task, and keep the
+  // results in member order.
+  std::size_t member_count = old_root.MemberCount();
+  std::size_t task_count = std::min(thread_count, member_count);
+
+  std::vector<std::future<std::vector<std::string>>> futures;
+  for (std::size_t task = 0; task < task_count; task += 1) {
+    std::size_t first_member = (member_count * task) / task_count;
+    std::size_t last_member = (member_count * (task + 1)) / task_count;
+
+    futures.push_back(std::async(
+        std::launch::async,
+        [this, &old_root, &new_root, &old_subtree_hashes, &new_subtree_hashes,
+            first_member, last_member]() {
+          std::vector<std::string> task_changed_key_paths;
+          std::string task_key_path;
+
+          for (std::size_t i = first_member; i < last_member; i += 1) {
+            const rapidjson::Value::Member& member = *(old_root.MemberBegin() + i);
+
+            const rapidjson::Value* new_member_value_ptr;
+            if (i < new_root.MemberCount()
+                && (new_root.MemberBegin() + i)->name == member.name) {
+              new_member_value_ptr = &(new_root.MemberBegin() + i)->value;
+            } else {
+              new_member_value_ptr = FindValue(
+                  new_root,
+                  std::string_view(member.name.GetString(), member.name.GetStringLength())
+              );
+            }
+
+            task_key_path.clear();
+            AppendJsonPointerToken(
+                &task_key_path,
+                std::string_view(member.name.GetString(), member.name.GetStringLength())
+            );
+
+            if (new_member_value_ptr == nullptr) {
+              task_changed_key_paths.push_back(task_key_path);
+              continue;
+            }
+
+            this->DiffRecursive(
+                member.value,
+                old_subtree_hashes.get(),
+                *new_member_value_ptr,
+                new_subtree_hashes.get(),
+                &task_key_path,
+                false,
+                &task_changed_key_paths
+            );
+          }
+
+          return task_changed_key_paths;
+        }
+    ));
+  }
 
-    rapidjson::Value& value_ref = object[current_key.data()];
+  for (std::future<std::vector<std::string>>& future : futures) {
+    std::vector<std::string> task_changed_key_paths = future.get();
 
-    this->SetDeepValueRecursive(
-        std::move(value),
-        value_ref,
-        keys...
+    changed_key_paths.insert(
+        changed_key_paths.end(),
+        std::make_move_iterator(task_changed_key_paths.begin()),
+        std::make_move_iterator(task_changed_key_paths.end())
     );
   }
-}
 
-template <>
-inline bool RapidJsonConfigReader::Read() {
-  // Create the config file if it doesn't exist.
-  if (!std::filesystem::exists(this->config_file_path())) {
-    if (std::ofstream config_stream(this->config_file_path());
-        config_stream) {
-      config_stream << "{}" << std::endl;
-    } else {
-      return false;
+  // Members that only exist in the new document.
+  rapidjson::SizeType member_index = 0;
+  for (rapidjson::Value::ConstMemberIterator it = new_root.MemberBegin();
+      it != new_root.MemberEnd();
+      it++, member_index += 1) {
+    std::string_view name(it->name.GetString(), it->name.GetStringLength());
+
+    bool is_in_old_root = (member_index < old_root.MemberCount()
+        && (old_root.MemberBegin() + member_index)->name == it->name)
+        || FindValue(old_root, name) != nullptr;
+
+    if (!is_in_old_root) {
+      key_path.clear();
+      AppendJsonPointerToken(&key_path, name);
+      changed_key_paths.push_back(key_path);
     }
   }
 
-  // Parse the config.
-  if (std::ifstream config_stream(this->config_file_path());
-      config_stream) {
-    rapidjson::IStreamWrapper config_stream_wrapper(config_stream);
-    this->json_document_.ParseStream(config_stream_wrapper);
-  } else {
+  return changed_key_paths;
+}
+
+template <>
+inline bool RapidJsonConfigReader::ReadLayers(
+    const std::vector<std::filesystem::path>& overlay_file_paths,
+    std::size_t thread_count
+) {
+  if (!this->CreateConfigFileIfMissing()) {
     return false;
   }
 
-  // Check that the config is JSON compliant. If it isn't, then the
-  // document is read in as null.
-  if (this->json_document_.IsNull()) {
+  // Taken before the config file is read, so that a change while it is read
+  // makes the next format-preserving write a full one.
+  std::error_code error_code;
+  std::filesystem::file_time_type config_file_time =
+      std::filesystem::last_write_time(this->config_file_path(), error_code);
+
+  if (error_code) {
     return false;
   }
 
-  return true;
-}
-
-template <>
-inline bool RapidJsonConfigReader::Write(int indent_width) {
-  // Write to the config file any new default values.
-  if (std::ofstream config_stream(this->config_file_path());
-      config_stream) {
-    rapidjson::OStreamWrapper config_stream_wrapper(config_stream);
-    rapidjson::PrettyWriter pretty_config_writer(config_stream_wrapper);
-    pretty_config_writer.SetIndent(' ', indent_width);
+  std::vector<const std::filesystem::path*> layer_file_paths;
+  layer_file_paths.push_back(&this->config_file_path());
+  for (const std::filesystem::path& overlay_file_path : overlay_file_paths) {
+    layer_file_paths.push_back(&overlay_file_path);
+  }
 
-    this->json_document().Accept(pretty_config_writer);
+  // Parse each layer into a separate document, so that the current one is
+  // kept if parsing fails and can be compared against for subscribers.
+  std::size_t layer_count = layer_file_paths.size();
+  std::deque<rapidjson::Document> layer_documents;
+  this->AcquireDocuments(layer_count, &layer_documents);
+
+  // The text of the config file is only kept if there are no overlays,
+  // since the merged document doesn't match it otherwise.
+  std::string source_text;
+  bool is_source_kept = this->preserve_format() && layer_count == 1;
+
+  std::size_t task_count = std::min(std::max<std::size_t>(thread_count, 1), layer_count);
+  auto parse_layers = [this, &layer_file_paths, &layer_documents, &source_text,
+      is_source_kept, layer_count, task_count](
+      std::size_t first_layer
+  ) {
+    for (std::size_t i = first_layer; i < layer_count; i += task_count) {
+      bool is_layer_parsed = (i == 0 && is_source_kept)
+          ? this->ParseSourceFile(*layer_file_paths[i], &source_text, &layer_documents[i])
+          : this->ParseConfigFile(*layer_file_paths[i], &layer_documents[i]);
+
+      if (!is_layer_parsed) {
+        return false;
+      }
+    }
 
     return true;
+  };
+
+  bool is_parsed = true;
+  if (task_count == 1) {
+    is_parsed = parse_layers(0);
   } else {
+    std::vector<std::future<bool>> futures;
+    for (std::size_t task = 0; task < task_count; task += 1) {
+      futures.push_back(std::async(std::launch::async, parse_layers, task));
+    }
+
+    for (std::future<bool>& future : futures) {
+      is_parsed = future.get() && is_parsed;
+    }
+  }
+
+  if (!is_parsed) {
     return false;
   }
+
+  for (std::size_t i = 1; i < layer_count; i += 1) {
+    MergeLayerRecursive(
+        layer_documents.front(),
+        layer_documents[i],
+        &layer_documents.front()
+    );
+  }
+
+  this->KeepSourceText(&source_text, config_file_time);
+  this->CommitParsedDocuments(&layer_documents);
+
+  return true;
+}
+
+template <>
+inline bool RapidJsonConfigReader::Read() {
+  return this->ReadLayers({}, 1);
+}
+
+template <>
+inline bool RapidJsonConfigReader::Write(int indent_width) {
+  return this->WriteParallel(indent_width, 1);
 }
 
+/**
+ * Define MJSONI_EXTERN_TEMPLATES in every translation unit, and additionally
+ * MJSONI_INSTANTIATE_TEMPLATES in exactly one, to compile the non-template
+ * members of the reader once instead of in each translation unit.
+ */
+#if defined(MJSONI_INSTANTIATE_TEMPLATES)
+template class GenericConfigReader<
+    rapidjson::Document,
+    rapidjson::Value,
+    rapidjson::Value
+>;
+#elif defined(MJSONI_EXTERN_TEMPLATES)
+extern template class GenericConfigReader<
+    rapidjson::Document,
+    rapidjson::Value,
+    rapidjson::Value
+>;
+#endif
+
 } // namespace mjsoni
 
 #endif // MJSONI_RAPID_JSON_CONFIG_READER_HPP_
@@ -0,0 +1,1759 @@
+/**
+ * Multi JSON Interface
+ * Copyright (C) 2019  Mir Drualga
+ *
+ * This file is part of Multi JSON Interface.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/**
+ * Tests of the config reader, built once for each backend. The backend is
+ * selected by MJSONI_TEST_NLOHMANN_JSON or MJSONI_TEST_RAPIDJSON.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#if defined(MJSONI_TEST_RAPIDJSON)
+
+#include <mjsoni/rapid_json_config_reader.hpp>
+
+using ConfigReader = mjsoni::RapidJsonConfigReader;
+using JsonDocument = rapidjson::Document;
+using JsonValue = rapidjson::Value;
+
+JsonDocument ParseJson(std::string_view text) {
+  JsonDocument document;
+  document.Parse(text.data(), text.size());
+
+  return document;
+}
+
+JsonValue MakeEmptyObject() {
+  return JsonValue(rapidjson::kObjectType);
+}
+
+#elif defined(MJSONI_TEST_NLOHMANN_JSON)
+
+#include <mjsoni/nlohmann_json_config_reader.hpp>
+
+using ConfigReader = mjsoni::NlohmannJsonConfigReader;
+using JsonDocument = nlohmann::json;
+using JsonValue = nlohmann::json;
+
+JsonDocument ParseJson(std::string_view text) {
+  return nlohmann::json::parse(text);
+}
+
+JsonValue MakeEmptyObject() {
+  return nlohmann::json::object();
+}
+
+#else
+#error "Define MJSONI_TEST_NLOHMANN_JSON or MJSONI_TEST_RAPIDJSON."
+#endif
+
+#include <mjsoni/config_reader_pool.hpp>
+
+using namespace mjsoni::literals;
+
+namespace {
+
+int failure_count = 0;
+
+#define CHECK(condition) \
+    do { \
+      if (!(condition)) { \
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        failure_count += 1; \
+      } \
+    } while (false)
+
+#define CHECK_THROWS(exception_type, expression) \
+    do { \
+      bool is_thrown = false; \
+      try { \
+        static_cast<void>(expression); \
+      } catch (const exception_type&) { \
+        is_thrown = true; \
+      } \
+      if (!is_thrown) { \
+        std::fprintf(stderr, "%s:%d: CHECK_THROWS(%s, %s) failed\n", __FILE__, __LINE__, #exception_type, #expression); \
+        failure_count += 1; \
+      } \
+    } while (false)
+
+/**
+ * A directory for the config files of a test, which is removed with its
+ * contents when the test ends.
+ */
+class TestDirectory {
+ public:
+  explicit TestDirectory(std::string_view test_name)
+      : path_(std::filesystem::temp_directory_path()
+            / ("mjsoni_" + std::string(test_name))) {
+    std::filesystem::remove_all(this->path_);
+    std::filesystem::create_directories(this->path_);
+  }
+
+  ~TestDirectory() {
+    std::error_code error_code;
+    std::filesystem::remove_all(this->path_, error_code);
+  }
+
+  std::filesystem::path operator/(std::string_view file_name) const {
+    return this->path_ / file_name;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+std::string ReadFileText(const std::filesystem::path& file_path) {
+  std::ifstream file_stream(file_path, std::ios::binary);
+  std::ostringstream text_stream;
+  text_stream << file_stream.rdbuf();
+
+  return text_stream.str();
+}
+
+void WriteFileText(
+    const std::filesystem::path& file_path,
+    std::string_view text
+) {
+  std::ofstream file_stream(file_path, std::ios::binary);
+  file_stream.write(text.data(), text.size());
+}
+
+void TestGetSet() {
+  TestDirectory directory("get_set");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.Read());
+
+  reader.SetDeepInt(8080, "server", "port");
+  reader.SetDeepString("localhost", "server", "host");
+  reader.SetDeepBool(true, "server", "enabled");
+  reader.SetDeepDouble(0.5, "server", "ratio");
+
+  CHECK(reader.GetInt("server", "port") == 8080);
+  CHECK(reader.GetString("server", "host") == "localhost");
+  CHECK(reader.GetBool("server", "enabled"));
+  CHECK(reader.GetDouble("server", "ratio") == 0.5);
+  CHECK(reader.ContainsKey("server", "port"));
+  CHECK(!reader.ContainsKey("server", "missing"));
+  CHECK(reader.GetIntOrDefault(7, "server", "missing") == 7);
+  CHECK_THROWS(std::out_of_range, reader.GetInt("server", "missing"));
+  CHECK_THROWS(std::out_of_range, reader.GetString("missing", "host"));
+
+  reader.SetInt(9090, "server", "port");
+  CHECK(reader.GetInt("server", "port") == 9090);
+
+  CHECK(reader.Write(2));
+
+  ConfigReader reread_reader(config_file_path);
+  CHECK(reread_reader.Read());
+  CHECK(reread_reader.GetInt("server", "port") == 9090);
+  CHECK(reread_reader.GetString("server", "host") == "localhost");
+  CHECK(reread_reader.Hash() == reader.Hash());
+}
+
+void TestHas() {
+  TestDirectory directory("has");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(1, "values", "int");
+  reader.SetDeepString("text", "values", "string");
+  reader.SetDeepBool(true, "values", "bool");
+  reader.SetDeepDouble(0.5, "values", "double");
+  reader.SetDeepVector(std::vector<int>({ 1, 2 }), "values", "vector");
+
+  CHECK(reader.HasInt("values", "int"));
+  CHECK(reader.HasDouble("values", "int"));
+  CHECK(!reader.HasString("values", "int"));
+  CHECK(!reader.HasBool("values", "int"));
+  CHECK(reader.HasString("values", "string"));
+  CHECK(!reader.HasInt("values", "string"));
+  CHECK(reader.HasBool("values", "bool"));
+  CHECK(!reader.HasInt("values", "bool"));
+  CHECK(reader.HasDouble("values", "double"));
+  CHECK(reader.HasFloat("values", "double"));
+  CHECK(!reader.HasInt("values", "double"));
+  CHECK(reader.HasVector("values", "vector"));
+  CHECK(!reader.HasVector("values", "int"));
+  CHECK(!reader.HasInt("values", "missing"));
+  CHECK(!reader.HasInt("missing", "int"));
+}
+
+void TestContainers() {
+  TestDirectory directory("containers");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.Read());
+
+  reader.SetDeepVector(std::vector<int>({ 3, 1, 2 }), "c", "vector");
+  reader.SetDeepDeque(std::deque<std::string>({ "a", "b" }), "c", "deque");
+  reader.SetDeepSet(std::set<int>({ 5, 4 }), "c", "set");
+  reader.SetDeepUnorderedSet(std::unordered_set<std::string>({ "x" }), "c", "unordered_set");
+  reader.SetDeepPath("dir/file.txt", "c", "path");
+
+  CHECK(reader.GetVector<int>("c", "vector") == std::vector<int>({ 3, 1, 2 }));
+  CHECK(reader.GetDeque<std::string>("c", "deque") == std::deque<std::string>({ "a", "b" }));
+  CHECK(reader.GetSet<int>("c", "set") == std::set<int>({ 4, 5 }));
+  CHECK(reader.GetUnorderedSet<std::string>("c", "unordered_set") == std::unordered_set<std::string>({ "x" }));
+  CHECK(reader.GetPath("c", "path") == std::filesystem::path("dir/file.txt"));
+  CHECK(reader.GetArrayCopy<std::vector<int>>("c", "vector") == std::vector<int>({ 3, 1, 2 }));
+  CHECK(reader.HasDeque("c", "deque"));
+  CHECK(reader.HasSet("c", "set"));
+  CHECK(reader.HasUnorderedSet("c", "unordered_set"));
+  CHECK(reader.HasPath("c", "path"));
+
+  CHECK_THROWS(std::out_of_range, reader.GetVector<int>("c", "missing"));
+  CHECK(reader.GetVectorOrDefault(std::vector<int>({ 9 }), "c", "missing") == std::vector<int>({ 9 }));
+
+  reader.SetVector(std::vector<int>(), "c", "vector");
+  CHECK(reader.GetVector<int>("c", "vector").empty());
+
+  std::vector<double> doubles = { 0.25, 0.5 };
+  reader.SetArray(doubles.begin(), doubles.end(), "c", "array");
+  CHECK(reader.GetVector<double>("c", "array") == doubles);
+
+  CHECK(reader.Write(2));
+
+  ConfigReader reread_reader(config_file_path);
+  CHECK(reread_reader.Read());
+  CHECK(reread_reader.GetDeque<std::string>("c", "deque") == std::deque<std::string>({ "a", "b" }));
+  CHECK(reread_reader.GetSet<int>("c", "set") == std::set<int>({ 4, 5 }));
+  CHECK(reread_reader.GetVector<double>("c", "array") == doubles);
+}
+
+void TestNumbers() {
+  TestDirectory directory("numbers");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(300, "n", "small");
+  reader.SetDeepInt(-1, "n", "negative");
+  reader.SetDeepLongLong(std::int64_t(1) << 40, "n", "large");
+  reader.SetDeepUnsignedLongLong(std::numeric_limits<std::uint64_t>::max(), "n", "huge");
+  reader.SetDeepDouble(1.5, "n", "fraction");
+  reader.SetDeepDouble(1e300, "n", "far");
+  reader.SetDeepFloat(0.1f, "n", "float");
+
+  // Integers that do not fit the requested type are missing, not truncated.
+  CHECK(reader.GetNumber<std::int16_t>("n", "small") == 300);
+  CHECK_THROWS(std::out_of_range, reader.GetNumber<std::int8_t>("n", "small"));
+  CHECK_THROWS(std::out_of_range, reader.GetNumber<std::uint8_t>("n", "small"));
+  CHECK(!reader.HasNumber<std::int8_t>("n", "small"));
+  CHECK(reader.GetNumberOrDefault<std::int8_t>(7, "n", "small") == 7);
+  CHECK_THROWS(std::out_of_range, reader.GetUnsignedInt("n", "negative"));
+  CHECK(!reader.HasUnsignedInt("n", "negative"));
+  CHECK_THROWS(std::out_of_range, reader.GetInt("n", "large"));
+  CHECK(reader.GetLongLong("n", "large") == std::int64_t(1) << 40);
+  CHECK_THROWS(std::out_of_range, reader.GetLongLong("n", "huge"));
+  CHECK(reader.GetUnsignedLongLong("n", "huge") == std::numeric_limits<std::uint64_t>::max());
+
+  // Integer types only accept integers, and floating-point types accept any
+  // number that they can represent.
+  CHECK_THROWS(std::out_of_range, reader.GetInt("n", "fraction"));
+  CHECK(reader.GetDouble("n", "small") == 300.0);
+  CHECK(reader.GetFloat("n", "fraction") == 1.5f);
+  CHECK(reader.GetDouble("n", "far") == 1e300);
+  CHECK_THROWS(std::out_of_range, reader.GetFloat("n", "far"));
+  CHECK(!reader.HasFloat("n", "far"));
+  CHECK(reader.GetFloat("n", "float") == 0.1f);
+  CHECK(reader.GetDouble("n", "float") == 0.1);
+
+  reader.Freeze();
+  CHECK_THROWS(std::out_of_range, reader.GetNumber<std::int8_t>("n", "small"));
+  CHECK_THROWS(std::out_of_range, reader.GetFloat("n", "far"));
+  CHECK(reader.GetFloat("n", "float") == 0.1f);
+}
+
+void TestKeyLiterals() {
+  TestDirectory directory("key_literals");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(8080, "server"_key, "port"_key);
+  reader.SetDeepString("localhost", "server"_key, std::string("host"));
+  reader.SetDeepInt(1, "list"_key, 1);
+
+  CHECK(reader.GetInt("server", "port") == 8080);
+  CHECK(reader.GetInt("server"_key, "port"_key) == 8080);
+  CHECK(reader.GetString(std::string_view("server"), "host"_key) == "localhost");
+  CHECK(reader.HasInt("list"_key, 1));
+  CHECK(reader.ContainsKey("server"_key));
+  CHECK(!reader.ContainsKey("server"_key, "missing"_key));
+  CHECK_THROWS(std::out_of_range, reader.GetInt("server"_key, "missing"_key));
+
+  reader.Freeze();
+  CHECK(reader.GetInt("server"_key, "port"_key) == 8080);
+  CHECK(reader.GetInt("server", std::string("port")) == 8080);
+  CHECK(reader.GetInt("list"_key, 1) == 1);
+  CHECK_THROWS(std::out_of_range, reader.GetInt("server"_key, "missing"_key));
+
+  // Runtime keys hash on demand, to the same values as literals.
+  constexpr mjsoni::JsonKey literal_key = "a_long_member_name"_key;
+  mjsoni::JsonKey runtime_key(std::string_view("a_long_member_name"));
+  CHECK(runtime_key.hash() == literal_key.hash());
+  CHECK(runtime_key.prefix_word() == literal_key.prefix_word());
+  CHECK(runtime_key.Equals("a_long_member_name", 18));
+  CHECK(!runtime_key.Equals("a_long_member_nam_", 18));
+  CHECK(!runtime_key.Equals("a_long", 6));
+
+  reader.Thaw();
+  reader.SetDeepInt(2, "server", std::string("a_long_member_name"));
+  reader.Freeze();
+  CHECK(reader.GetInt(std::string("server"), std::string("a_long_member_name")) == 2);
+  CHECK(reader.GetInt("server"_key, "a_long_member_name"_key) == 2);
+  CHECK(!reader.ContainsKey("server", std::string("a_long_member_nam_")));
+}
+
+void TestArrayIndices() {
+  TestDirectory directory("array_indices");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+
+  reader.SetDeepInt(1, "list", 2);
+  CHECK(reader.GetInt("list", 2) == 1);
+  CHECK(reader.ContainsKey("list", 0));
+  reader.SetInt(3, "list", 3);
+  CHECK(reader.GetInt("list", 3) == 3);
+  reader.SetInt(5, "list", 5);
+  CHECK(!reader.ContainsKey("list", 5));
+
+  // A negative index matches no element, and neither it nor an index far
+  // past the end of an array changes the document.
+  CHECK(!reader.ContainsKey("list", -1));
+  CHECK_THROWS(std::out_of_range, reader.GetInt("list", -1));
+  reader.SetInt(5, "list", -1);
+  reader.SetDeepInt(5, "list", -1);
+  reader.SetDeepInt(5, "list", 100000000);
+  reader.SetDeepInt(5, "other", -1);
+  reader.SetDeepInt(5, "other", 100000000, "a");
+  CHECK(!reader.ContainsKey("list", 4));
+  CHECK(reader.GetInt("list", 3) == 3);
+  CHECK(!reader.ContainsKey("other"));
+
+  ConfigReader::Transaction transaction = reader.BeginTransaction();
+  transaction.SetDeepNumber(1, "list", 0);
+  transaction.SetDeepNumber(5, "list", 100000000);
+  CHECK(!transaction.Commit());
+  CHECK(!reader.HasInt("list", 0));
+
+  reader.Freeze();
+  CHECK_THROWS(std::out_of_range, reader.GetInt("list", -1));
+  CHECK(reader.GetInt("list", 2) == 1);
+}
+
+void TestSetMissingParent() {
+  TestDirectory directory("set_missing_parent");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(1, "a");
+  CHECK(reader.Write(2));
+
+  int notification_count = 0;
+  reader.Subscribe("", [&notification_count](const std::vector<std::string>&) {
+    notification_count += 1;
+  });
+  reader.EnableJournal(2, 1 << 20);
+
+  // A Set* whose parent is missing stores nothing, so it neither notifies
+  // subscribers, journals a change, nor invalidates the cached conversions.
+  std::shared_ptr<const int> cached_value = reader.GetCached<int>("a");
+  reader.SetInt(2, "missing", "b");
+  CHECK(!reader.ContainsKey("missing"));
+  CHECK(notification_count == 0);
+  CHECK(reader.GetCached<int>("a") == cached_value);
+  CHECK(reader.FlushJournal());
+  CHECK(!std::filesystem::exists(reader.journal_file_path()));
+
+  reader.SetInt(2, "a");
+  CHECK(notification_count == 1);
+  CHECK(*reader.GetCached<int>("a") == 2);
+}
+
+void TestSubscriptions() {
+  TestDirectory directory("subscriptions");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.Read());
+  reader.SetDeepInt(1, "server", "port");
+  reader.SetDeepString("a", "server", "host");
+  reader.SetInt(1, "other");
+
+  // Subscribers receive the changed key paths that overlap their own.
+  std::set<std::string> server_key_paths;
+  std::set<std::string> port_key_paths;
+  std::set<std::string> root_key_paths;
+  std::size_t server_id = reader.Subscribe("/server", [&server_key_paths](const std::vector<std::string>& key_paths) {
+    server_key_paths.insert(key_paths.cbegin(), key_paths.cend());
+  });
+  std::size_t port_id = reader.Subscribe("/server/port", [&port_key_paths](const std::vector<std::string>& key_paths) {
+    port_key_paths.insert(key_paths.cbegin(), key_paths.cend());
+  });
+  std::size_t root_id = reader.Subscribe("", [&root_key_paths](const std::vector<std::string>& key_paths) {
+    root_key_paths.insert(key_paths.cbegin(), key_paths.cend());
+  });
+
+  WriteFileText(config_file_path, R"({"server": {"port": 2, "host": "b"}, "other": 2})");
+  CHECK(reader.Read());
+  CHECK(server_key_paths == std::set<std::string>({ "/server/host", "/server/port" }));
+  CHECK(port_key_paths == std::set<std::string>({ "/server/port" }));
+  CHECK(root_key_paths == std::set<std::string>({ "/other", "/server/host", "/server/port" }));
+
+  reader.Unsubscribe(server_id);
+  reader.Unsubscribe(port_id);
+  reader.Unsubscribe(root_id);
+
+  // Callbacks may unsubscribe themselves and others, which stops their
+  // notifications at once, and subscribe, which starts with the next change.
+  int first_count = 0;
+  int second_count = 0;
+  int added_count = 0;
+  std::size_t first_id = 0;
+  std::size_t second_id = 0;
+  first_id = reader.Subscribe("/other", [&](const std::vector<std::string>&) {
+    first_count += 1;
+    reader.Unsubscribe(first_id);
+    reader.Unsubscribe(second_id);
+    reader.Subscribe("/other", [&added_count](const std::vector<std::string>&) {
+      added_count += 1;
+    });
+  });
+  second_id = reader.Subscribe("/other", [&second_count](const std::vector<std::string>&) {
+    second_count += 1;
+  });
+
+  reader.SetInt(3, "other");
+  CHECK(first_count == 1);
+  CHECK(second_count == 0);
+  CHECK(added_count == 0);
+
+  reader.SetInt(4, "other");
+  CHECK(first_count == 1);
+  CHECK(added_count == 1);
+
+  // Callbacks may change the document, which notifies again.
+  int nested_count = 0;
+  reader.Subscribe("/other", [&reader](const std::vector<std::string>&) {
+    reader.SetDeepInt(1, "nested");
+  });
+  reader.Subscribe("/nested", [&nested_count](const std::vector<std::string>&) {
+    nested_count += 1;
+  });
+
+  reader.SetInt(5, "other");
+  CHECK(nested_count == 1);
+  CHECK(added_count == 2);
+
+  // A throwing callback leaves the subscriptions usable.
+  std::size_t throwing_id = reader.Subscribe("/other", [](const std::vector<std::string>&) {
+    throw std::runtime_error("callback");
+  });
+  CHECK_THROWS(std::runtime_error, reader.SetInt(6, "other"));
+  CHECK(added_count == 3);
+  reader.Unsubscribe(throwing_id);
+  reader.SetInt(7, "other");
+  CHECK(added_count == 4);
+}
+
+void TestTransactions() {
+  TestDirectory directory("transactions");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(1, "n", "x");
+
+  ConfigReader::Transaction transaction = reader.BeginTransaction();
+  transaction.SetNumber(2, "n", "x");
+  transaction.SetDeepString("value", "n", "y");
+  CHECK(transaction.Commit());
+  CHECK(reader.GetInt("n", "x") == 2);
+  CHECK(reader.GetString("n", "y") == "value");
+
+  CHECK(transaction.RollBack());
+  CHECK(reader.GetInt("n", "x") == 1);
+  CHECK(!reader.ContainsKey("n", "y"));
+
+  // A Set* whose parent is missing fails the whole commit.
+  ConfigReader::Transaction failing_transaction = reader.BeginTransaction();
+  failing_transaction.SetNumber(3, "n", "x");
+  failing_transaction.SetNumber(4, "missing", "x");
+  CHECK(!failing_transaction.Commit());
+  CHECK(reader.GetInt("n", "x") == 1);
+  CHECK(!reader.ContainsKey("missing"));
+
+  // A Set* whose parent is created by a SetDeep* of the same transaction
+  // succeeds whichever is staged first, although "a" sorts before "c".
+  ConfigReader::Transaction deep_first_transaction = reader.BeginTransaction();
+  deep_first_transaction.SetDeepNumber(1, "n", "b", "c");
+  deep_first_transaction.SetNumber(2, "n", "b", "a");
+  CHECK(deep_first_transaction.Commit());
+  CHECK(reader.GetInt("n", "b", "a") == 2);
+  CHECK(reader.GetInt("n", "b", "c") == 1);
+
+  CHECK(deep_first_transaction.RollBack());
+  CHECK(!reader.ContainsKey("n", "b"));
+
+  ConfigReader::Transaction set_first_transaction = reader.BeginTransaction();
+  set_first_transaction.SetNumber(2, "n", "b", "a");
+  set_first_transaction.SetDeepNumber(1, "n", "b", "c");
+  CHECK(set_first_transaction.Commit());
+  CHECK(reader.GetInt("n", "b", "a") == 2);
+  CHECK(reader.GetInt("n", "b", "c") == 1);
+
+  CHECK(set_first_transaction.RollBack());
+  CHECK(!reader.ContainsKey("n", "b"));
+  CHECK(reader.GetInt("n", "x") == 1);
+
+  // A SetDeep* replaced by a later mutation still creates the parents that
+  // the later mutation relies on, as when applying them one at a time.
+  ConfigReader::Transaction replaced_deep_transaction = reader.BeginTransaction();
+  replaced_deep_transaction.SetDeepNumber(1, "x", "y");
+  replaced_deep_transaction.SetNumber(2, "x", "y");
+  CHECK(replaced_deep_transaction.Commit());
+  CHECK(reader.GetInt("x", "y") == 2);
+
+  CHECK(replaced_deep_transaction.RollBack());
+  CHECK(!reader.ContainsKey("x"));
+
+  ConfigReader::Transaction replaced_descendant_transaction = reader.BeginTransaction();
+  replaced_descendant_transaction.SetDeepNumber(1, "p", "q", "r");
+  replaced_descendant_transaction.SetValue(MakeEmptyObject(), "p", "q");
+  CHECK(replaced_descendant_transaction.Commit());
+  CHECK(reader.ContainsKey("p", "q"));
+  CHECK(!reader.ContainsKey("p", "q", "r"));
+
+  CHECK(replaced_descendant_transaction.RollBack());
+  CHECK(!reader.ContainsKey("p"));
+}
+
+void TestPatchRollback() {
+  TestDirectory directory("patch_rollback");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(1, "a");
+  reader.SetDeepInt(2, "b");
+
+  JsonDocument failing_patch = ParseJson(R"([
+    { "op": "replace", "path": "/a", "value": 10 },
+    { "op": "add", "path": "/c", "value": 3 },
+    { "op": "remove", "path": "/missing" }
+  ])");
+  CHECK(!reader.ApplyJsonPatch(failing_patch, nullptr));
+  CHECK(reader.GetInt("a") == 1);
+  CHECK(reader.GetInt("b") == 2);
+  CHECK(!reader.ContainsKey("c"));
+
+  JsonDocument patch = ParseJson(R"([
+    { "op": "replace", "path": "/a", "value": 10 },
+    { "op": "remove", "path": "/b" }
+  ])");
+  std::vector<std::string> changed_key_paths;
+  CHECK(reader.ApplyJsonPatch(patch, &changed_key_paths));
+  CHECK(reader.GetInt("a") == 10);
+  CHECK(!reader.ContainsKey("b"));
+  CHECK(changed_key_paths.size() == 2);
+
+  // The "-" token is reported as the index of the added element.
+  reader.SetDeepInt(1, "list", 1);
+  JsonDocument append_patch = ParseJson(R"([
+    { "op": "add", "path": "/list/-", "value": 2 },
+    { "op": "copy", "from": "/a", "path": "/list/-" }
+  ])");
+  changed_key_paths.clear();
+  CHECK(reader.ApplyJsonPatch(append_patch, &changed_key_paths));
+  CHECK(reader.GetInt("list", 2) == 2);
+  CHECK(reader.GetInt("list", 3) == 10);
+  CHECK(changed_key_paths == std::vector<std::string>({ "/list/2", "/list/3" }));
+
+  JsonDocument failing_append_patch = ParseJson(R"([
+    { "op": "add", "path": "/list/-", "value": 4 },
+    { "op": "remove", "path": "/missing" }
+  ])");
+  CHECK(!reader.ApplyJsonPatch(failing_append_patch, nullptr));
+  CHECK(!reader.ContainsKey("list", 4));
+
+  JsonDocument merge_patch = ParseJson(R"({ "a": null, "d": { "e": 5 } })");
+  CHECK(reader.ApplyMergePatch(merge_patch, nullptr));
+  CHECK(!reader.ContainsKey("a"));
+  CHECK(reader.GetInt("d", "e") == 5);
+}
+
+void TestJournalReplay() {
+  TestDirectory directory("journal_replay");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  ConfigReader writer(config_file_path);
+  CHECK(writer.Read());
+  writer.SetDeepInt(1, "a");
+  CHECK(writer.Write(2));
+
+  writer.EnableJournal(2, 1 << 20);
+  writer.SetInt(5, "a");
+  writer.SetDeepString("journaled", "b", "c");
+  CHECK(writer.FlushJournal());
+  CHECK(std::filesystem::exists(writer.journal_file_path()));
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.Read());
+  CHECK(reader.GetInt("a") == 5);
+  CHECK(reader.GetString("b", "c") == "journaled");
+
+  CHECK(writer.CompactJournal());
+  CHECK(!std::filesystem::exists(writer.journal_file_path()));
+
+  ConfigReader compacted_reader(config_file_path);
+  CHECK(compacted_reader.Read());
+  CHECK(compacted_reader.GetInt("a") == 5);
+  CHECK(!std::filesystem::exists(mjsoni::JsonTempFilePath(config_file_path)));
+
+  // A compaction that cannot write the config file keeps both the config
+  // file and the journal, which still replay to the same document. The
+  // temporary file is blocked by a directory of the same name.
+  writer.SetInt(6, "a");
+  CHECK(writer.FlushJournal());
+  std::filesystem::create_directory(mjsoni::JsonTempFilePath(config_file_path));
+  CHECK(!writer.CompactJournal());
+  CHECK(std::filesystem::exists(writer.journal_file_path()));
+  std::filesystem::remove(mjsoni::JsonTempFilePath(config_file_path));
+
+  ConfigReader failed_compaction_reader(config_file_path);
+  CHECK(failed_compaction_reader.Read());
+  CHECK(failed_compaction_reader.GetInt("a") == 6);
+  CHECK(failed_compaction_reader.GetString("b", "c") == "journaled");
+}
+
+void TestFreeze() {
+  TestDirectory directory("freeze");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  reader.SetDeepInt(7, "a", "b");
+  reader.SetDeepString("text", "a", "c");
+
+  reader.Freeze();
+  CHECK(reader.is_frozen());
+  CHECK(reader.GetInt("a", "b") == 7);
+  CHECK(reader.GetString("a", "c") == "text");
+  CHECK(reader.ContainsKey("a", "b"));
+  CHECK(!reader.ContainsKey("a", "missing"));
+  CHECK_THROWS(std::logic_error, reader.SetInt(8, "a", "b"));
+
+  // Missing keys throw like they do on a reader that is not frozen.
+  CHECK_THROWS(std::out_of_range, reader.GetInt("a", "missing"));
+  CHECK_THROWS(std::out_of_range, reader.GetInt("missing", "b"));
+  CHECK_THROWS(std::out_of_range, reader.GetString("a", "missing"));
+  CHECK_THROWS(std::out_of_range, reader.GetValueRef("a", "missing"));
+
+  reader.Thaw();
+  reader.SetInt(8, "a", "b");
+  CHECK(reader.GetInt("a", "b") == 8);
+}
+
+void TestCachedConversions() {
+  TestDirectory directory("cached_conversions");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  for (int i = 0; i < 64; i += 1) {
+    reader.SetDeepInt(i, "values", std::to_string(i));
+  }
+
+  CHECK_THROWS(std::out_of_range, reader.GetCached<int>("values", "missing"));
+  CHECK(*reader.GetCached<int>("values", "1") == 1);
+  CHECK(reader.GetCached<int>("values", "1") == reader.GetCached<int>("values", "1"));
+
+  // Const lookups, including those that fill the cache, may run
+  // concurrently.
+  std::atomic<int> mismatch_count = 0;
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < 4; thread_index += 1) {
+    threads.emplace_back([&reader, &mismatch_count]() {
+      for (int round = 0; round < 100; round += 1) {
+        for (int i = 0; i < 64; i += 1) {
+          if (*reader.GetCached<int>("values", std::to_string(i)) != i
+              || *reader.GetCached<double>("values", std::to_string(i)) != i) {
+            mismatch_count += 1;
+          }
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(mismatch_count == 0);
+
+  reader.SetInt(100, "values", "1");
+  CHECK(*reader.GetCached<int>("values", "1") == 100);
+}
+
+void TestParallelReadWrite() {
+  TestDirectory directory("parallel_read_write");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  // The document is large enough for ReadParallel() to split it.
+  constexpr int kMemberCount = 20000;
+
+  ConfigReader writer(config_file_path);
+  CHECK(writer.Read());
+  for (int i = 0; i < kMemberCount; i += 1) {
+    std::string name = "member" + std::to_string(i);
+    writer.SetDeepString(std::string(64, 'a' + (i % 26)), name, "text");
+    writer.SetDeepInt(i, name, "index");
+  }
+
+  CHECK(writer.WriteParallel(2, 4));
+  CHECK(std::filesystem::file_size(config_file_path) > (1 << 20));
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.ReadParallel(4));
+  CHECK(reader.Hash() == writer.Hash());
+  CHECK(reader.GetInt("member12345", "index") == 12345);
+
+  // Chunks are read in place, wrapped in the root's brackets.
+  {
+    mjsoni::JsonChunkStreamBuf chunk_stream_buf(" 1, 2 ", '[', ']');
+    std::istream chunk_stream(&chunk_stream_buf);
+    CHECK(std::string(std::istreambuf_iterator<char>(chunk_stream), {}) == "[ 1, 2 ]");
+
+    mjsoni::JsonChunkStreamBuf empty_chunk_stream_buf("", '{', '}');
+    std::istream empty_chunk_stream(&empty_chunk_stream_buf);
+    CHECK(std::string(std::istreambuf_iterator<char>(empty_chunk_stream), {}) == "{}");
+  }
+
+  // An error in any chunk, or a stray comma between chunks, fails the read
+  // and leaves the document unchanged.
+  std::string config_text = ReadFileText(config_file_path);
+  std::filesystem::path broken_file_path = directory / "broken.json";
+  std::size_t middle_offset = config_text.find("\"member10000\"");
+
+  std::string broken_text = config_text;
+  broken_text.insert(middle_offset, "\"bad\": tru, ");
+  WriteFileText(broken_file_path, broken_text);
+  ConfigReader broken_reader(broken_file_path);
+  std::uint64_t broken_hash = broken_reader.Hash();
+  CHECK(!broken_reader.ReadParallel(4));
+  CHECK(broken_reader.Hash() == broken_hash);
+
+  broken_text = config_text;
+  broken_text.insert(middle_offset, ", ");
+  WriteFileText(broken_file_path, broken_text);
+  CHECK(!broken_reader.ReadParallel(4));
+
+  // Const lookups may run concurrently.
+  std::atomic<int> mismatch_count = 0;
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < 4; thread_index += 1) {
+    threads.emplace_back([&reader, &mismatch_count, thread_index]() {
+      for (int i = thread_index; i < kMemberCount; i += 4) {
+        std::string name = "member" + std::to_string(i);
+        if (reader.GetInt(name, "index") != i) {
+          mismatch_count += 1;
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(mismatch_count == 0);
+
+  // Hash() and Diff() share a cache of subtree hashes, which concurrent
+  // calls fill and read.
+  reader.SetInt(-1, "member0", "index");
+
+  std::uint64_t writer_hash = writer.Hash();
+  std::atomic<int> hash_mismatch_count = 0;
+  std::vector<std::thread> hash_threads;
+  for (int thread_index = 0; thread_index < 4; thread_index += 1) {
+    hash_threads.emplace_back([&reader, &writer, &hash_mismatch_count, writer_hash]() {
+      std::vector<std::string> changed_key_paths = writer.Diff(reader, 2);
+      if (writer.Hash() != writer_hash
+          || reader.Hash() == writer_hash
+          || changed_key_paths.size() != 1
+          || changed_key_paths[0] != "/member0/index") {
+        hash_mismatch_count += 1;
+      }
+    });
+  }
+
+  for (std::thread& thread : hash_threads) {
+    thread.join();
+  }
+
+  CHECK(hash_mismatch_count == 0);
+}
+
+void TestReadLayers() {
+  TestDirectory directory("read_layers");
+  std::filesystem::path config_file_path = directory / "config.json";
+  std::filesystem::path first_overlay_file_path = directory / "first.json";
+  std::filesystem::path second_overlay_file_path = directory / "second.json";
+
+  WriteFileText(
+      config_file_path,
+      R"({"server": {"host": "a", "port": 80, "tls": {"enabled": false}},)"
+      R"( "list": [1, 2, 3], "name": "base", "kept": true})"
+  );
+  WriteFileText(
+      first_overlay_file_path,
+      R"({"server": {"port": 8080, "tls": {"cert": "x"}}, "list": [4],)"
+      R"( "name": {"first": "overlay"}})"
+  );
+  WriteFileText(
+      second_overlay_file_path,
+      R"({"server": {"port": 9090, "tls": null}, "name": "second"})"
+  );
+
+  // Objects merge member by member, later layers win, and any other value,
+  // including arrays and null, replaces the value below it as a whole.
+  for (std::size_t thread_count : { 1, 3 }) {
+    ConfigReader reader(config_file_path);
+    CHECK(reader.ReadLayers(
+        { first_overlay_file_path, second_overlay_file_path },
+        thread_count
+    ));
+    CHECK(reader.GetString("server", "host") == "a");
+    CHECK(reader.GetInt("server", "port") == 9090);
+    CHECK(reader.ContainsKey("server", "tls"));
+    CHECK(!reader.ContainsKey("server", "tls", "enabled"));
+    CHECK(reader.GetVector<int>("list") == std::vector<int>({ 4 }));
+    CHECK(reader.GetString("name") == "second");
+    CHECK(reader.GetBool("kept"));
+  }
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.ReadLayers({ first_overlay_file_path }, 2));
+  CHECK(reader.GetInt("server", "port") == 8080);
+  CHECK(!reader.GetBool("server", "tls", "enabled"));
+  CHECK(reader.GetString("server", "tls", "cert") == "x");
+  CHECK(reader.GetString("name", "first") == "overlay");
+
+  // A missing or malformed layer leaves the document unchanged.
+  std::uint64_t hash = reader.Hash();
+  CHECK(!reader.ReadLayers({ directory / "missing.json" }, 2));
+  CHECK(reader.Hash() == hash);
+
+  WriteFileText(second_overlay_file_path, R"({"server": )");
+  CHECK(!reader.ReadLayers(
+      { first_overlay_file_path, second_overlay_file_path },
+      2
+  ));
+  CHECK(reader.Hash() == hash);
+  CHECK(reader.GetString("name", "first") == "overlay");
+
+  // Without overlays, it reads like Read().
+  CHECK(reader.ReadLayers({}, 2));
+  CHECK(reader.GetInt("server", "port") == 80);
+  CHECK(reader.GetString("name") == "base");
+}
+
+void TestConfigReaderPool() {
+  TestDirectory directory("config_reader_pool");
+  std::filesystem::path first_config_file_path = directory / "first.json";
+  std::filesystem::path second_config_file_path = directory / "second.json";
+
+  WriteFileText(first_config_file_path, R"({"name": "first", "port": 80})");
+  WriteFileText(second_config_file_path, R"({"name": "second"})");
+
+  mjsoni::ConfigReaderPool<ConfigReader> pool(1, 1);
+  CHECK(pool.shard_count() == 1);
+
+  ConfigReader* first_reader;
+  int notification_count = 0;
+  {
+    mjsoni::ConfigReaderPool<ConfigReader>::Handle reader =
+        pool.Acquire(first_config_file_path);
+    CHECK(reader->Read());
+    CHECK(reader->GetString("name") == "first");
+
+    reader->Subscribe("", [&notification_count](const std::vector<std::string>&) {
+      notification_count += 1;
+    });
+    reader->SetOverrideText("8080", "port");
+    CHECK(notification_count == 1);
+    reader->set_preserve_format(true);
+    reader->EnableJournal(2, 1 << 20);
+    reader->Freeze();
+
+    first_reader = reader.get();
+  }
+
+  CHECK(pool.idle_reader_count() == 1);
+
+  // A reused reader is reset to the state of a new one for its file.
+  {
+    mjsoni::ConfigReaderPool<ConfigReader>::Handle reader =
+        pool.Acquire(second_config_file_path);
+    CHECK(reader.get() == first_reader);
+    CHECK(pool.idle_reader_count() == 0);
+    CHECK(reader->config_file_path() == second_config_file_path);
+    CHECK(!reader->is_frozen());
+    CHECK(!reader->is_journal_enabled());
+    CHECK(!reader->preserve_format());
+
+    CHECK(reader->Read());
+    CHECK(reader->GetString("name") == "second");
+    CHECK(!reader->ContainsKey("port"));
+    reader->SetInt(1, "port");
+    CHECK(reader->GetInt("port") == 1);
+    CHECK(notification_count == 1);
+
+    // Readers beyond the idle limit are destroyed when they are released.
+    mjsoni::ConfigReaderPool<ConfigReader>::Handle other_reader =
+        pool.Acquire(first_config_file_path);
+    CHECK(other_reader.get() != first_reader);
+
+    mjsoni::ConfigReaderPool<ConfigReader>::Handle moved_reader =
+        std::move(other_reader);
+    CHECK(!other_reader);
+    CHECK(moved_reader->Read());
+    CHECK(moved_reader->GetInt("port") == 80);
+  }
+
+  CHECK(pool.idle_reader_count() == 1);
+
+  // Threads acquire from their own shards.
+  mjsoni::ConfigReaderPool<ConfigReader> shared_pool(4, 2);
+  std::atomic<int> mismatch_count = 0;
+  std::vector<std::thread> threads;
+  for (int thread_index = 0; thread_index < 4; thread_index += 1) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 50; i += 1) {
+        mjsoni::ConfigReaderPool<ConfigReader>::Handle reader = shared_pool.Acquire(
+            (i % 2 == 0) ? first_config_file_path : second_config_file_path
+        );
+        if (!reader->Read()
+            || reader->GetString("name") != ((i % 2 == 0) ? "first" : "second")) {
+          mismatch_count += 1;
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  CHECK(mismatch_count == 0);
+  CHECK(shared_pool.idle_reader_count() <= 8);
+}
+
+/**
+ * Returns the values selected by the query, which must compile.
+ */
+std::vector<const JsonValue*> RunQuery(
+    const ConfigReader& reader,
+    std::string_view expression
+) {
+  mjsoni::JsonQuery query;
+  CHECK(mjsoni::CompileJsonQuery(expression, &query));
+
+  std::vector<const JsonValue*> results;
+  reader.Query(query, &results);
+
+  return results;
+}
+
+void TestQueries() {
+  TestDirectory directory("queries");
+
+  ConfigReader reader(directory / "config.json");
+  CHECK(reader.Read());
+  CHECK(reader.ApplyMergePatch(ParseJson(R"({
+    "servers": [
+      { "name": "a", "port": 80, "tls": true },
+      { "name": "b", "port": 443 },
+      { "name": "c", "port": 8080, "tls": false }
+    ],
+    "x/y": { "~": 1 }
+  })"), nullptr));
+
+  const JsonValue* name_a = &reader.GetValueRef("servers", 0, "name");
+  const JsonValue* name_b = &reader.GetValueRef("servers", 1, "name");
+  const JsonValue* name_c = &reader.GetValueRef("servers", 2, "name");
+
+  // JSON Pointers, with escapes, and JSONPath member and index steps.
+  CHECK(RunQuery(reader, "/servers/1/port") == std::vector<const JsonValue*>({ &reader.GetValueRef("servers", 1, "port") }));
+  CHECK(RunQuery(reader, "/x~1y/~0") == std::vector<const JsonValue*>({ &reader.GetValueRef("x/y", "~") }));
+  CHECK(RunQuery(reader, "/servers/01").empty());
+  CHECK(RunQuery(reader, "$.servers[0].name") == std::vector<const JsonValue*>({ name_a }));
+  CHECK(RunQuery(reader, "$['x/y']['~']").size() == 1);
+
+  // Negative indices count from the end, and slices work as in Python.
+  CHECK(RunQuery(reader, "$.servers[-1].name") == std::vector<const JsonValue*>({ name_c }));
+  CHECK(RunQuery(reader, "$.servers[-4].name").empty());
+  CHECK(RunQuery(reader, "$.servers[*].name") == std::vector<const JsonValue*>({ name_a, name_b, name_c }));
+  CHECK(RunQuery(reader, "$.servers[1:].name") == std::vector<const JsonValue*>({ name_b, name_c }));
+  CHECK(RunQuery(reader, "$.servers[::-1].name") == std::vector<const JsonValue*>({ name_c, name_b, name_a }));
+  CHECK(RunQuery(reader, "$.servers[0:3:2].name") == std::vector<const JsonValue*>({ name_a, name_c }));
+  CHECK(RunQuery(reader, "$.servers[-2:-1].name") == std::vector<const JsonValue*>({ name_b }));
+
+  // Filters compare members of the candidates, or test their existence.
+  CHECK(RunQuery(reader, "$.servers[?@.port > 100].name") == std::vector<const JsonValue*>({ name_b, name_c }));
+  CHECK(RunQuery(reader, "$.servers[?(@.tls)].name") == std::vector<const JsonValue*>({ name_a, name_c }));
+  CHECK(RunQuery(reader, "$.servers[?(@.tls == true)].name") == std::vector<const JsonValue*>({ name_a }));
+  CHECK(RunQuery(reader, "$.servers[?@.tls != true].name") == std::vector<const JsonValue*>({ name_b, name_c }));
+  CHECK(RunQuery(reader, "$.servers[?@['name'] == 'b'].port") == std::vector<const JsonValue*>({ &reader.GetValueRef("servers", 1, "port") }));
+  CHECK(RunQuery(reader, "$.servers[?@.port >= 443]").size() == 2);
+
+  mjsoni::JsonQuery query;
+  CHECK(!mjsoni::CompileJsonQuery("$..name", &query));
+  CHECK(!mjsoni::CompileJsonQuery("$.servers[", &query));
+  CHECK(!mjsoni::CompileJsonQuery("$[?@.a === 1]", &query));
+
+  CHECK(mjsoni::CompileJsonQuery("$.servers[*]", &query));
+  CHECK(reader.QueryFirst(query) == &reader.GetValueRef("servers", 0));
+  CHECK(mjsoni::CompileJsonQuery("/missing", &query));
+  CHECK(reader.QueryFirst(query) == nullptr);
+}
+
+void TestOverrides() {
+  TestDirectory directory("overrides");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.Read());
+  reader.SetDeepInt(80, "server", "port");
+  reader.SetDeepString("a", "server", "host");
+  reader.SetDeepVector(std::vector<int>({ 1, 2 }), "list");
+  std::uint64_t hash = reader.Hash();
+
+  std::vector<std::string> changed_key_paths;
+  reader.Subscribe("/server", [&changed_key_paths](const std::vector<std::string>& key_paths) {
+    changed_key_paths = key_paths;
+  });
+
+  // Valid JSON text keeps its type, and other text becomes a string.
+  reader.SetOverrideText("8080", "server", "port");
+  CHECK(changed_key_paths == std::vector<std::string>({ "/server/port" }));
+  CHECK(reader.GetInt("server", "port") == 8080);
+  CHECK(reader.GetString("server", "host") == "a");
+  reader.SetOverrideText("hello world", "server", "name");
+  CHECK(reader.GetString("server", "name") == "hello world");
+  CHECK(reader.HasString("server", "name"));
+
+  // An override replaces everything below it, and the longest prefix wins.
+  reader.SetOverride(MakeEmptyObject(), "list");
+  CHECK(!reader.ContainsKey("list", 0));
+  reader.SetOverrideText("[5, 6]", "list", 1);
+  CHECK(reader.GetInt("list", 1, 1) == 6);
+  CHECK(!reader.ContainsKey("list", 0));
+  reader.RemoveOverride("list", 1);
+  CHECK(!reader.ContainsKey("list", 1));
+  reader.RemoveOverride("list");
+  CHECK(reader.GetInt("list", 1) == 2);
+
+  // Overrides hide Set* of the same key path, and are not written, hashed
+  // or queried.
+  reader.SetInt(81, "server", "port");
+  CHECK(reader.GetInt("server", "port") == 8080);
+  reader.SetInt(80, "server", "port");
+  CHECK(reader.Hash() == hash);
+  CHECK(RunQuery(reader, "/server/name").empty());
+  CHECK(reader.Write(2));
+
+  ConfigReader reread_reader(config_file_path);
+  CHECK(reread_reader.Read());
+  CHECK(reread_reader.GetInt("server", "port") == 80);
+  CHECK(!reread_reader.ContainsKey("server", "name"));
+
+  // A frozen reader applies overrides too.
+  reader.Freeze();
+  CHECK(reader.GetInt("server", "port") == 8080);
+  CHECK(reader.GetString("server", "name") == "hello world");
+  reader.Thaw();
+
+  reader.ClearOverrides();
+  CHECK(reader.GetInt("server", "port") == 80);
+  CHECK(!reader.ContainsKey("server", "name"));
+}
+
+void TestPreserveFormat() {
+  TestDirectory directory("preserve_format");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  WriteFileText(
+      config_file_path,
+      "{\n  \"a\" : 1,   \"b\": \"xy\",\n\n  \"list\": [ 1,2 ],\n  \"tail\": true\n}\n"
+  );
+
+  ConfigReader reader(config_file_path);
+  reader.set_preserve_format(true);
+  CHECK(reader.Read());
+
+  // A value of the same size is patched in place.
+  reader.SetInt(2, "a");
+  CHECK(reader.Write(2));
+  CHECK(ReadFileText(config_file_path)
+      == "{\n  \"a\" : 2,   \"b\": \"xy\",\n\n  \"list\": [ 1,2 ],\n  \"tail\": true\n}\n");
+
+  // A shorter value rewrites the rest of the file, which is truncated.
+  reader.SetString("x", "b");
+  CHECK(reader.Write(2));
+  CHECK(ReadFileText(config_file_path)
+      == "{\n  \"a\" : 2,   \"b\": \"x\",\n\n  \"list\": [ 1,2 ],\n  \"tail\": true\n}\n");
+
+  // Several values, one of them longer, are replaced in one write.
+  reader.SetInt(12345, "a");
+  reader.SetBool(false, "tail");
+  CHECK(reader.Write(2));
+  CHECK(ReadFileText(config_file_path)
+      == "{\n  \"a\" : 12345,   \"b\": \"x\",\n\n  \"list\": [ 1,2 ],\n  \"tail\": false\n}\n");
+
+  // An added element replaces its closest ancestor that is in the text.
+  reader.SetDeepInt(3, "list", 2);
+  CHECK(reader.Write(2));
+
+  std::string text = ReadFileText(config_file_path);
+  CHECK(text.find("\"a\" : 12345,   \"b\": \"x\",\n\n") != std::string::npos);
+  CHECK(text.find("[ 1,2 ]") == std::string::npos);
+
+  ConfigReader reread_reader(config_file_path);
+  CHECK(reread_reader.Read());
+  CHECK(reread_reader.Hash() == reader.Hash());
+  CHECK(reread_reader.GetInt("list", 2) == 3);
+
+  // A config file changed by someone else is rewritten as a whole, also if
+  // its size stayed the same.
+  WriteFileText(config_file_path, "{}");
+  reader.SetInt(7, "a");
+  CHECK(reader.Write(2));
+  CHECK(reread_reader.Read());
+  CHECK(reread_reader.Hash() == reader.Hash());
+
+  text = ReadFileText(config_file_path);
+  std::size_t tail_offset = text.find("false");
+  CHECK(tail_offset != std::string::npos);
+  text.replace(tail_offset, 5, "[ 0 ]");
+  WriteFileText(config_file_path, text);
+  std::filesystem::last_write_time(
+      config_file_path,
+      std::filesystem::last_write_time(config_file_path) + std::chrono::seconds(1)
+  );
+
+  reader.SetInt(8, "a");
+  CHECK(reader.Write(2));
+  CHECK(reread_reader.Read());
+  CHECK(reread_reader.Hash() == reader.Hash());
+}
+
+#if defined(MJSONI_ENABLE_ZLIB) || defined(MJSONI_ENABLE_ZSTD)
+void TestCompressedFile(std::string_view file_name) {
+  TestDirectory directory("compressed_file");
+  std::filesystem::path config_file_path = directory / file_name;
+
+  // A missing file is created compressed according to its extension.
+  ConfigReader writer(config_file_path);
+  CHECK(writer.Read());
+  CHECK(mjsoni::DetectJsonCompression(ReadFileText(config_file_path))
+      == mjsoni::JsonCompressionFromExtension(config_file_path));
+
+  for (int i = 0; i < 20000; i += 1) {
+    writer.SetDeepInt(i, "member" + std::to_string(i % 5000), "value" + std::to_string(i));
+  }
+
+  CHECK(writer.Write(2));
+
+  ConfigReader reader(config_file_path);
+  reader.set_preserve_format(true);
+  CHECK(reader.Read());
+  CHECK(reader.Hash() == writer.Hash());
+  CHECK(reader.ReadParallel(4));
+  CHECK(reader.Hash() == writer.Hash());
+
+  // The text of a compressed file is not kept, so writes are full ones.
+  reader.SetInt(1, "x");
+  CHECK(reader.Write(2));
+  CHECK(writer.Read());
+  CHECK(writer.GetInt("x") == 1);
+
+  // A write that fails keeps the old file. The temporary file is blocked by
+  // a directory of the same name.
+  std::filesystem::create_directory(mjsoni::JsonTempFilePath(config_file_path));
+  reader.SetInt(2, "x");
+  CHECK(!reader.Write(2));
+  std::filesystem::remove(mjsoni::JsonTempFilePath(config_file_path));
+  CHECK(writer.Read());
+  CHECK(writer.GetInt("x") == 1);
+
+  // A truncated stream is an error.
+  std::filesystem::resize_file(
+      config_file_path,
+      std::filesystem::file_size(config_file_path) / 2
+  );
+  CHECK(!writer.Read());
+}
+#endif
+
+void TestCompression() {
+#if defined(MJSONI_ENABLE_ZLIB)
+  TestCompressedFile("config.json.gz");
+#else
+  TestDirectory directory("compression");
+
+  // Without zlib, a gzip config file can be neither read nor created.
+  ConfigReader reader(directory / "config.json.gz");
+  CHECK(!reader.Read());
+  CHECK(!reader.Write(2));
+#endif
+
+#if defined(MJSONI_ENABLE_ZSTD)
+  TestCompressedFile("config.json.zst");
+#endif
+}
+
+void TestBinaryFormat(std::string_view file_name) {
+  TestDirectory directory("binary_format");
+  std::filesystem::path config_file_path = directory / file_name;
+
+  ConfigReader writer(config_file_path);
+  CHECK(writer.Read());
+  writer.SetDeepInt(-1, "numbers", "negative");
+  writer.SetDeepLongLong(-5000000000, "numbers", "large_negative");
+  writer.SetDeepUnsignedLongLong(std::numeric_limits<std::uint64_t>::max(), "numbers", "huge");
+  writer.SetDeepDouble(0.1, "numbers", "double");
+  writer.SetDeepString(std::string(300, 'v'), "strings", std::string(70000, 'k'));
+  writer.SetDeepBool(false, "list", 1, 0);
+  for (int i = 0; i < 300; i += 1) {
+    writer.SetDeepInt(i, "long_list", i);
+  }
+
+  CHECK(writer.Write(2));
+
+  ConfigReader reader(config_file_path);
+  CHECK(reader.Read());
+  CHECK(reader.Hash() == writer.Hash());
+  CHECK(reader.GetLongLong("numbers", "large_negative") == -5000000000);
+  CHECK(reader.GetUnsignedLongLong("numbers", "huge") == std::numeric_limits<std::uint64_t>::max());
+  CHECK(reader.GetDouble("numbers", "double") == 0.1);
+  CHECK(reader.GetString("strings", std::string(70000, 'k')) == std::string(300, 'v'));
+  CHECK(!reader.GetBool("list", 1, 0));
+  CHECK(reader.GetInt("long_list", 299) == 299);
+
+  // Malformed files fail to read, and keep the document that was read.
+  std::string bytes = ReadFileText(config_file_path);
+  std::vector<std::string> malformed_files = {
+      "",
+      bytes.substr(0, bytes.size() - 1),
+      bytes + '\0',
+      std::string(2000, (file_name.find("cbor") != std::string_view::npos) ? '\x81' : '\x91') + '\x01',
+  };
+
+  for (const std::string& malformed_file : malformed_files) {
+    WriteFileText(config_file_path, malformed_file);
+    CHECK(!reader.Read());
+    CHECK(reader.Hash() == writer.Hash());
+  }
+}
+
+void TestBinaryFormats() {
+  TestBinaryFormat("config.cbor");
+  TestBinaryFormat("config.msgpack");
+
+  TestDirectory directory("binary_formats");
+
+  // CBOR with indefinite lengths, a half-precision float and a tag, and
+  // MessagePack with a single-precision float, as written by other tools.
+  std::filesystem::path cbor_file_path = directory / "config.cbor";
+  WriteFileText(
+      cbor_file_path,
+      std::string_view("\xBF\x61\x61\x9F\x01\xF9\x3C\x00\xFF\x7F\x61x\x61y\xFF\xC1\x01\xFF", 18)
+  );
+
+  ConfigReader cbor_reader(cbor_file_path);
+  CHECK(cbor_reader.Read());
+  CHECK(cbor_reader.GetInt("a", 0) == 1);
+  CHECK(cbor_reader.GetDouble("a", 1) == 1.0);
+  CHECK(cbor_reader.GetInt("xy") == 1);
+
+  std::filesystem::path message_pack_file_path = directory / "config.msgpack";
+  WriteFileText(
+      message_pack_file_path,
+      std::string_view("\x82\xA1\x61\x01\xA1\x62\x93\xC3\xC0\xCA\x3F\xC0\x00\x00", 14)
+  );
+
+  ConfigReader message_pack_reader(message_pack_file_path);
+  CHECK(message_pack_reader.Read());
+  CHECK(message_pack_reader.GetInt("a") == 1);
+  CHECK(message_pack_reader.GetBool("b", 0));
+  CHECK(message_pack_reader.ContainsKey("b", 1));
+  CHECK(message_pack_reader.GetFloat("b", 2) == 1.5f);
+
+  // Lengths past the end of the file fail without allocating for them.
+  WriteFileText(cbor_file_path, std::string_view("\x9B\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 10));
+  CHECK(!cbor_reader.Read());
+  WriteFileText(message_pack_file_path, std::string_view("\xDD\xFF\xFF\xFF\xFF\x01", 6));
+  CHECK(!message_pack_reader.Read());
+}
+
+/**
+ * A memory resource that counts the allocations and the outstanding bytes
+ * that pass through it to the default resource.
+ */
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  std::size_t allocation_count() const noexcept {
+    return this->allocation_count_;
+  }
+
+  std::size_t outstanding_size() const noexcept {
+    return this->outstanding_size_;
+  }
+
+ private:
+  std::atomic<std::size_t> allocation_count_ = 0;
+  std::atomic<std::size_t> outstanding_size_ = 0;
+
+  void* do_allocate(
+      std::size_t size,
+      std::size_t alignment
+  ) override {
+    this->allocation_count_ += 1;
+    this->outstanding_size_ += size;
+
+    return std::pmr::get_default_resource()->allocate(size, alignment);
+  }
+
+  void do_deallocate(
+      void* data,
+      std::size_t size,
+      std::size_t alignment
+  ) override {
+    this->outstanding_size_ -= size;
+    std::pmr::get_default_resource()->deallocate(data, size, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other
+  ) const noexcept override {
+    return this == &other;
+  }
+};
+
+void TestBumpResource() {
+  CountingResource counting_resource;
+
+  {
+    mjsoni::JsonBumpResource arena(256, &counting_resource);
+    CHECK(arena.upstream_resource() == &counting_resource);
+
+    void* first = arena.allocate(3, 1);
+    void* second = arena.allocate(8, 8);
+    CHECK(reinterpret_cast<std::uintptr_t>(second) % 8 == 0);
+    CHECK(static_cast<char*>(second) >= static_cast<char*>(first) + 3);
+    CHECK(arena.allocated_size() == 11);
+    CHECK(arena.capacity() == 256);
+    CHECK(counting_resource.allocation_count() == 1);
+
+    // Deallocation frees nothing, and a request larger than the chunk size
+    // gets a chunk of its own.
+    arena.deallocate(first, 3, 1);
+    void* large = arena.allocate(1000, 16);
+    CHECK(reinterpret_cast<std::uintptr_t>(large) % 16 == 0);
+    CHECK(arena.allocated_size() == 1011);
+    CHECK(arena.capacity() == 1256);
+    CHECK(counting_resource.allocation_count() == 2);
+
+    arena.Release();
+    CHECK(arena.capacity() == 0);
+    CHECK(arena.allocated_size() == 0);
+    CHECK(counting_resource.outstanding_size() == 0);
+
+    static_cast<void>(arena.allocate(1, 1));
+    CHECK(counting_resource.outstanding_size() == 256);
+  }
+
+  // The destructor releases the chunks.
+  CHECK(counting_resource.outstanding_size() == 0);
+
+  // Threads may allocate concurrently, and get disjoint memory.
+  mjsoni::JsonBumpResource arena(1024, &counting_resource);
+  constexpr std::size_t kAllocationCount = 1000;
+  std::vector<std::vector<std::uint64_t*>> thread_allocations(4);
+  std::vector<std::thread> threads;
+  for (std::size_t thread_index = 0; thread_index < 4; thread_index += 1) {
+    threads.emplace_back([&arena, &thread_allocations, thread_index]() {
+      for (std::size_t i = 0; i < kAllocationCount; i += 1) {
+        std::uint64_t* value = static_cast<std::uint64_t*>(
+            arena.allocate(sizeof(std::uint64_t), alignof(std::uint64_t))
+        );
+        *value = thread_index * kAllocationCount + i;
+        thread_allocations[thread_index].push_back(value);
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  int mismatch_count = 0;
+  for (std::size_t thread_index = 0; thread_index < 4; thread_index += 1) {
+    for (std::size_t i = 0; i < kAllocationCount; i += 1) {
+      if (*thread_allocations[thread_index][i] != thread_index * kAllocationCount + i) {
+        mismatch_count += 1;
+      }
+    }
+  }
+
+  CHECK(mismatch_count == 0);
+  CHECK(arena.allocated_size() == 4 * kAllocationCount * sizeof(std::uint64_t));
+}
+
+void TestMemoryResource() {
+  TestDirectory directory("memory_resource");
+  std::filesystem::path config_file_path = directory / "config.json";
+  std::filesystem::path overlay_file_path = directory / "overlay.json";
+
+  // The document is large enough for ReadParallel() to split it.
+  constexpr int kMemberCount = 20000;
+
+  {
+    ConfigReader writer(config_file_path);
+    CHECK(writer.Read());
+    for (int i = 0; i < kMemberCount; i += 1) {
+      std::string name = "member" + std::to_string(i);
+      writer.SetDeepString(std::string(64, 'a' + (i % 26)), name, "text");
+      writer.SetDeepInt(i, name, "index");
+    }
+
+    CHECK(writer.Write(2));
+  }
+
+  WriteFileText(overlay_file_path, R"({"member1": {"index": -1}})");
+
+  CountingResource counting_resource;
+  {
+    mjsoni::JsonBumpResource arena(
+        mjsoni::JsonBumpResource::kDefaultChunkSize,
+        &counting_resource
+    );
+
+    {
+      ConfigReader reader(config_file_path, &arena);
+      CHECK(reader.memory_resource() == &arena);
+      CHECK(reader.Read());
+      CHECK(reader.GetInt("member12345", "index") == 12345);
+
+      // Only backends built to use the resource allocate from it.
+#if defined(MJSONI_TEST_RAPIDJSON) && defined(MJSONI_ENABLE_PMR)
+      CHECK(arena.allocated_size() > 0);
+#else
+      CHECK(arena.allocated_size() == 0);
+#endif
+
+      CHECK(reader.ReadParallel(4));
+      CHECK(reader.GetString("member7", "text") == std::string(64, 'h'));
+      CHECK(reader.ReadLayers({ overlay_file_path }, 2));
+      CHECK(reader.GetInt("member1", "index") == -1);
+
+      reader.SetDeepString("value", "added", "member");
+      CHECK(reader.GetString("added", "member") == "value");
+
+      // Reset() keeps the resource.
+      reader.Reset(overlay_file_path);
+      CHECK(reader.memory_resource() == &arena);
+      CHECK(reader.Read());
+      CHECK(reader.GetInt("member1", "index") == -1);
+    }
+  }
+
+  CHECK(counting_resource.outstanding_size() == 0);
+
+  // A pooling resource is shared by the threads of ReadParallel(), and gets
+  // all of its memory back when the reader is destroyed.
+  {
+    std::pmr::synchronized_pool_resource pool_resource(&counting_resource);
+
+    {
+      ConfigReader reader(config_file_path, &pool_resource);
+      CHECK(reader.ReadParallel(4));
+      CHECK(reader.GetInt("member12345", "index") == 12345);
+    }
+
+    pool_resource.release();
+    CHECK(counting_resource.outstanding_size() == 0);
+  }
+}
+
+void TestHugePageResource() {
+  CHECK(mjsoni::NumaNodeCount() >= 1);
+  CHECK(mjsoni::CurrentNumaNode() < mjsoni::NumaNodeCount());
+
+  // Without reserved huge pages, MAP_HUGETLB falls back to transparent huge
+  // pages.
+  for (bool use_hugetlb : { false, true }) {
+    for (int numa_node : { mjsoni::JsonHugePageResource::kAnyNumaNode, 0 }) {
+      mjsoni::JsonHugePageResource huge_page_resource(use_hugetlb, numa_node);
+      CHECK(huge_page_resource.use_hugetlb() == use_hugetlb);
+      CHECK(huge_page_resource.numa_node() == numa_node);
+
+      char* data = static_cast<char*>(huge_page_resource.allocate(100, 64));
+#if defined(__linux__)
+      CHECK(reinterpret_cast<std::uintptr_t>(data) % mjsoni::kHugePageSize == 0);
+#endif
+      data[0] = 'a';
+      data[99] = 'b';
+      CHECK(data[0] == 'a' && data[99] == 'b');
+      huge_page_resource.deallocate(data, 100, 64);
+    }
+  }
+
+  TestDirectory directory("huge_page_resource");
+  std::filesystem::path config_file_path = directory / "config.json";
+  WriteFileText(config_file_path, R"({"server": {"port": 80}, "list": [1, 2]})");
+
+  mjsoni::JsonHugePageResource huge_page_resource;
+  mjsoni::JsonBumpResource arena(mjsoni::kHugePageSize, &huge_page_resource);
+
+  ConfigReader reader(config_file_path, &arena);
+  CHECK(reader.Read());
+  reader.Freeze();
+  CHECK(reader.GetInt("server", "port") == 80);
+  CHECK(reader.GetInt("list", 1) == 2);
+}
+
+void TestNumaReplication() {
+  TestDirectory directory("numa_replication");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  constexpr int kMemberCount = 1000;
+
+  ConfigReader writer(config_file_path);
+  CHECK(writer.Read());
+  for (int i = 0; i < kMemberCount; i += 1) {
+    writer.SetDeepInt(i, "member" + std::to_string(i), "index");
+  }
+
+  CHECK(writer.Write(2));
+
+  // Frozen lookups read the replica of the calling thread's node, which must
+  // match the document on every node. On a system with a single node, they
+  // read the document itself.
+  auto count_mismatches = [](const ConfigReader& reader, int offset) {
+    std::atomic<int> mismatch_count = 0;
+    std::vector<std::thread> threads;
+    for (int thread_index = 0; thread_index < 4; thread_index += 1) {
+      threads.emplace_back([&reader, &mismatch_count, offset, thread_index]() {
+        for (int i = thread_index; i < kMemberCount; i += 4) {
+          if (reader.GetInt("member" + std::to_string(i), "index") != i + offset) {
+            mismatch_count += 1;
+          }
+        }
+      });
+    }
+
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+
+    return mismatch_count.load();
+  };
+
+  ConfigReader reader(config_file_path);
+  reader.set_numa_replication(true);
+  CHECK(reader.numa_replication());
+  CHECK(reader.Read());
+  reader.Freeze();
+  CHECK(count_mismatches(reader, 0) == 0);
+
+  // Replicas follow overrides, refreezing and reloads.
+  reader.SetOverrideText("-1", "member0", "index");
+  CHECK(reader.GetInt("member0", "index") == -1);
+  reader.ClearOverrides();
+
+  reader.Thaw();
+  for (int i = 0; i < kMemberCount; i += 1) {
+    reader.SetInt(i + 1, "member" + std::to_string(i), "index");
+  }
+  reader.Freeze();
+  CHECK(count_mismatches(reader, 1) == 0);
+
+  for (int i = 0; i < kMemberCount; i += 1) {
+    writer.SetInt(i + 2, "member" + std::to_string(i), "index");
+  }
+  CHECK(writer.Write(2));
+  CHECK(reader.Read());
+  CHECK(reader.is_frozen());
+  CHECK(count_mismatches(reader, 2) == 0);
+
+  // Toggling replication while frozen refreezes.
+  reader.set_numa_replication(false);
+  CHECK(reader.is_frozen());
+  CHECK(count_mismatches(reader, 2) == 0);
+  reader.set_numa_replication(true);
+  CHECK(count_mismatches(reader, 2) == 0);
+
+  reader.Reset(config_file_path);
+  CHECK(!reader.numa_replication());
+  CHECK(!reader.is_frozen());
+}
+
+void TestMemoryStats() {
+  TestDirectory directory("memory_stats");
+  std::filesystem::path config_file_path = directory / "config.json";
+
+  std::string text(100, 'x');
+  WriteFileText(
+      config_file_path,
+      R"({"text": ")" + text + R"(", "list": [1, 2, 3],)"
+      R"( "server": {"host": "ab", "port": 80}, "a/b": null})"
+  );
+
+  ConfigReader reader(config_file_path);
+  reader.set_preserve_format(true);
+  CHECK(reader.Read());
+
+  // The nodes are the root, its 4 members, the 3 elements and the 2 members
+  // of the server. The strings are the member names and the string values.
+  mjsoni::JsonMemoryStats memory_stats = reader.MemoryStats();
+  CHECK(memory_stats.document.node_count == 10);
+  CHECK(memory_stats.document.string_size == 4 + 4 + 6 + 3 + 4 + 4 + 100 + 2);
+  CHECK(memory_stats.document.member_array_size >= 9 * sizeof(JsonValue));
+  CHECK(memory_stats.overrides.node_count == 0);
+  CHECK(memory_stats.capacity >= memory_stats.used_size);
+  CHECK(memory_stats.used_size >= memory_stats.wasted_size);
+  CHECK(memory_stats.buffer_size >= std::filesystem::file_size(config_file_path));
+
+  // Subtrees are measured down to max_depth, by their JSON Pointers, and
+  // add up to their parents.
+  std::map<std::string, mjsoni::JsonSubtreeMemoryStats> subtree_stats =
+      reader.SubtreeMemoryStats(1);
+  CHECK(subtree_stats.size() == 5);
+  CHECK(subtree_stats.at("").node_count == memory_stats.document.node_count);
+  CHECK(subtree_stats.at("").string_size == memory_stats.document.string_size);
+  CHECK(subtree_stats.at("/text").node_count == 1);
+  CHECK(subtree_stats.at("/text").string_size == 100);
+  CHECK(subtree_stats.at("/list").node_count == 4);
+  CHECK(subtree_stats.at("/list").member_array_size >= 3 * sizeof(JsonValue));
+  CHECK(subtree_stats.at("/server").node_count == 3);
+  CHECK(subtree_stats.at("/server").string_size == 4 + 4 + 2);
+  CHECK(subtree_stats.at("/a~1b").node_count == 1);
+
+  std::size_t child_node_count = 0;
+  for (const auto& [key_path, stats] : subtree_stats) {
+    if (!key_path.empty()) {
+      child_node_count += stats.node_count;
+    }
+  }
+
+  CHECK(child_node_count + 1 == subtree_stats.at("").node_count);
+
+  CHECK(reader.SubtreeMemoryStats(0).size() == 1);
+  subtree_stats = reader.SubtreeMemoryStats(2);
+  CHECK(subtree_stats.size() == 10);
+  CHECK(subtree_stats.at("/list/2").node_count == 1);
+  CHECK(subtree_stats.at("/server/host").string_size == 2);
+
+  // Override values are measured apart from the document.
+  reader.SetOverrideText(R"(["abc", 1])", "extra");
+  memory_stats = reader.MemoryStats();
+  CHECK(memory_stats.overrides.node_count == 3);
+  CHECK(memory_stats.overrides.string_size == 3);
+  CHECK(memory_stats.document.node_count == 10);
+  reader.ClearOverrides();
+
+  // Overwritten values stay in pool allocators until the next read.
+  for (int i = 0; i < 10; i += 1) {
+    reader.SetString(std::string(100, 'a' + i), "text");
+  }
+
+  memory_stats = reader.MemoryStats();
+  CHECK(memory_stats.document.string_size == 4 + 4 + 6 + 3 + 4 + 4 + 100 + 2);
+#if defined(MJSONI_TEST_RAPIDJSON)
+  CHECK(memory_stats.wasted_size >= 9 * 100);
+#else
+  CHECK(memory_stats.wasted_size == 0);
+  CHECK(memory_stats.capacity == memory_stats.used_size);
+#endif
+
+  CHECK(reader.Read());
+  CHECK(reader.MemoryStats().wasted_size < 9 * 100);
+}
+
+} // namespace
+
+int main() {
+  TestGetSet();
+  TestHas();
+  TestContainers();
+  TestNumbers();
+  TestKeyLiterals();
+  TestArrayIndices();
+  TestSetMissingParent();
+  TestSubscriptions();
+  TestTransactions();
+  TestPatchRollback();
+  TestJournalReplay();
+  TestFreeze();
+  TestCachedConversions();
+  TestParallelReadWrite();
+  TestReadLayers();
+  TestConfigReaderPool();
+  TestQueries();
+  TestOverrides();
+  TestPreserveFormat();
+  TestCompression();
+  TestBinaryFormats();
+  TestBumpResource();
+  TestMemoryResource();
+  TestHugePageResource();
+  TestNumaReplication();
+  TestMemoryStats();
+
+  if (failure_count != 0) {
+    std::fprintf(stderr, "%d checks failed\n", failure_count);
+    return 1;
+  }
+
+  return 0;
+}